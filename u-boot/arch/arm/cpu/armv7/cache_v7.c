@@ -7,6 +7,8 @@
  */
 #include <linux/types.h>
 #include <common.h>
+#include <div64.h>
+#include <malloc.h>
 #include <asm/armv7.h>
 #include <asm/utils.h>
 
@@ -45,6 +47,93 @@ static u32 get_clidr(void)
 	return clidr;
 }
 
+/* Geometry of one level of data or unified cache */
+struct v7_cache_level {
+	u32 num_sets;		/* 0 if there is no data cache at this level */
+	u32 num_ways;
+	u32 way_shift;
+	u32 log2_line_len;
+};
+
+/*
+ * Cache geometry is read from CP15 once, on first use, rather than on every
+ * maintenance operation. This lives in .data since cache operations may be
+ * used before relocation.
+ */
+static struct v7_dcache_info {
+	u32 log2_line_len;	/* Smallest line length, 0 until initialised */
+	u32 setway_lines;	/* Number of lines over all levels */
+	ulong flush_all_size;	/* Flush everything above this range size */
+	struct v7_cache_level level[7];
+
+	/* Statistics */
+	u32 inval_range_ops;
+	u32 flush_range_ops;
+	u32 setway_ops;
+	u32 promoted_ops;
+	unsigned long long inval_range_bytes;
+	unsigned long long flush_range_bytes;
+} dcache_info __attribute__((section(".data")));
+
+static struct v7_dcache_info *v7_dcache_info(void)
+{
+	struct v7_dcache_info *info = &dcache_info;
+	struct v7_cache_level *lvl;
+	u32 clidr, ccsidr, cache_type, level;
+	ulong cache_size = 0;
+
+	if (info->log2_line_len)
+		return info;
+
+	clidr = get_clidr();
+	info->log2_line_len = 31;
+	for (level = 0; level < 7; level++) {
+		cache_type = (clidr >> (level * 3)) & 0x7;
+		if ((cache_type != ARMV7_CLIDR_CTYPE_DATA_ONLY) &&
+		    (cache_type != ARMV7_CLIDR_CTYPE_INSTRUCTION_DATA) &&
+		    (cache_type != ARMV7_CLIDR_CTYPE_UNIFIED))
+			continue;
+
+		set_csselr(level, ARMV7_CSSELR_IND_DATA_UNIFIED);
+		ccsidr = get_ccsidr();
+
+		lvl = &info->level[level];
+		lvl->log2_line_len = ((ccsidr & CCSIDR_LINE_SIZE_MASK) >>
+					CCSIDR_LINE_SIZE_OFFSET) + 2;
+		/* Converting from words to bytes */
+		lvl->log2_line_len += 2;
+
+		lvl->num_ways  = ((ccsidr & CCSIDR_ASSOCIATIVITY_MASK) >>
+				CCSIDR_ASSOCIATIVITY_OFFSET) + 1;
+		lvl->num_sets  = ((ccsidr & CCSIDR_NUM_SETS_MASK) >>
+				CCSIDR_NUM_SETS_OFFSET) + 1;
+		/*
+		 * According to ARMv7 ARM number of sets and number of ways need
+		 * not be a power of 2
+		 */
+		lvl->way_shift = 32 - log_2_n_round_up(lvl->num_ways);
+
+		if (lvl->log2_line_len < info->log2_line_len)
+			info->log2_line_len = lvl->log2_line_len;
+		info->setway_lines += lvl->num_sets * lvl->num_ways;
+		cache_size += (lvl->num_sets * lvl->num_ways) <<
+				lvl->log2_line_len;
+	}
+
+	/*
+	 * Once a range covers more lines than the cache holds, a set/way
+	 * flush of everything needs fewer operations. 'dcache calibrate'
+	 * measures the actual break-even point.
+	 */
+#ifdef CONFIG_SYS_DCACHE_FLUSH_ALL_SIZE
+	info->flush_all_size = CONFIG_SYS_DCACHE_FLUSH_ALL_SIZE;
+#else
+	info->flush_all_size = cache_size;
+#endif
+
+	return info;
+}
+
 static void v7_inval_dcache_level_setway(u32 level, u32 num_sets,
 					 u32 num_ways, u32 way_shift,
 					 u32 log2_line_len)
@@ -98,52 +187,28 @@ static void v7_clean_inval_dcache_level_setway(u32 level, u32 num_sets,
 
 static void v7_maint_dcache_level_setway(u32 level, u32 operation)
 {
-	u32 ccsidr;
-	u32 num_sets, num_ways, log2_line_len, log2_num_ways;
-	u32 way_shift;
-
-	set_csselr(level, ARMV7_CSSELR_IND_DATA_UNIFIED);
-
-	ccsidr = get_ccsidr();
-
-	log2_line_len = ((ccsidr & CCSIDR_LINE_SIZE_MASK) >>
-				CCSIDR_LINE_SIZE_OFFSET) + 2;
-	/* Converting from words to bytes */
-	log2_line_len += 2;
-
-	num_ways  = ((ccsidr & CCSIDR_ASSOCIATIVITY_MASK) >>
-			CCSIDR_ASSOCIATIVITY_OFFSET) + 1;
-	num_sets  = ((ccsidr & CCSIDR_NUM_SETS_MASK) >>
-			CCSIDR_NUM_SETS_OFFSET) + 1;
-	/*
-	 * According to ARMv7 ARM number of sets and number of ways need
-	 * not be a power of 2
-	 */
-	log2_num_ways = log_2_n_round_up(num_ways);
+	struct v7_cache_level *lvl = &v7_dcache_info()->level[level];
 
-	way_shift = (32 - log2_num_ways);
 	if (operation == ARMV7_DCACHE_INVAL_ALL) {
-		v7_inval_dcache_level_setway(level, num_sets, num_ways,
-				      way_shift, log2_line_len);
+		v7_inval_dcache_level_setway(level, lvl->num_sets,
+				lvl->num_ways, lvl->way_shift,
+				lvl->log2_line_len);
 	} else if (operation == ARMV7_DCACHE_CLEAN_INVAL_ALL) {
-		v7_clean_inval_dcache_level_setway(level, num_sets, num_ways,
-						   way_shift, log2_line_len);
+		v7_clean_inval_dcache_level_setway(level, lvl->num_sets,
+				lvl->num_ways, lvl->way_shift,
+				lvl->log2_line_len);
 	}
 }
 
 static void v7_maint_dcache_all(u32 operation)
 {
-	u32 level, cache_type, level_start_bit = 0;
-
-	u32 clidr = get_clidr();
+	struct v7_dcache_info *info = v7_dcache_info();
+	u32 level;
 
+	info->setway_ops++;
 	for (level = 0; level < 7; level++) {
-		cache_type = (clidr >> level_start_bit) & 0x7;
-		if ((cache_type == ARMV7_CLIDR_CTYPE_DATA_ONLY) ||
-		    (cache_type == ARMV7_CLIDR_CTYPE_INSTRUCTION_DATA) ||
-		    (cache_type == ARMV7_CLIDR_CTYPE_UNIFIED))
+		if (info->level[level].num_sets)
 			v7_maint_dcache_level_setway(level, operation);
-		level_start_bit += 3;
 	}
 }
 
@@ -194,21 +259,18 @@ static void v7_dcache_inval_range(u32 start, u32 stop, u32 line_len)
 
 static void v7_dcache_maint_range(u32 start, u32 stop, u32 range_op)
 {
-	u32 line_len, ccsidr;
-
-	ccsidr = get_ccsidr();
-	line_len = ((ccsidr & CCSIDR_LINE_SIZE_MASK) >>
-			CCSIDR_LINE_SIZE_OFFSET) + 2;
-	/* Converting from words to bytes */
-	line_len += 2;
-	/* converting from log2(linelen) to linelen */
-	line_len = 1 << line_len;
+	struct v7_dcache_info *info = v7_dcache_info();
+	u32 line_len = 1 << info->log2_line_len;
 
 	switch (range_op) {
 	case ARMV7_DCACHE_CLEAN_INVAL_RANGE:
+		info->flush_range_ops++;
+		info->flush_range_bytes += stop - start;
 		v7_dcache_clean_inval_range(start, stop, line_len);
 		break;
 	case ARMV7_DCACHE_INVAL_RANGE:
+		info->inval_range_ops++;
+		info->inval_range_bytes += stop - start;
 		v7_dcache_inval_range(start, stop, line_len);
 		break;
 	}
@@ -269,11 +331,102 @@ void invalidate_dcache_range(unsigned long start, unsigned long stop)
  */
 void flush_dcache_range(unsigned long start, unsigned long stop)
 {
+	struct v7_dcache_info *info = v7_dcache_info();
+
+	/*
+	 * Cleaning and invalidating other lines as well is harmless, so do
+	 * the whole cache by set/way if that is quicker. This is not done
+	 * for invalidate_dcache_range() since it would write back dirty
+	 * lines over data that a DMA engine has put in the range.
+	 */
+	if (stop > start && stop - start > info->flush_all_size) {
+		info->promoted_ops++;
+		flush_dcache_all();
+		return;
+	}
+
 	v7_dcache_maint_range(start, stop, ARMV7_DCACHE_CLEAN_INVAL_RANGE);
 
 	v7_outer_cache_flush_range(start, stop);
 }
 
+ulong v7_dcache_flush_all_size(void)
+{
+	return v7_dcache_info()->flush_all_size;
+}
+
+void dcache_print_stats(int reset)
+{
+	struct v7_dcache_info *info = v7_dcache_info();
+
+	printf("Line size:        %u bytes (%u lines by set/way)\n",
+	       1 << info->log2_line_len, info->setway_lines);
+	printf("Flush all above:  %lu bytes\n", info->flush_all_size);
+	printf("Invalidate range: %u ops, %llu bytes\n",
+	       info->inval_range_ops, info->inval_range_bytes);
+	printf("Flush range:      %u ops, %llu bytes\n",
+	       info->flush_range_ops, info->flush_range_bytes);
+	printf("Set/way:          %u ops (%u instead of a range flush)\n",
+	       info->setway_ops, info->promoted_ops);
+
+	if (reset) {
+		info->inval_range_ops = 0;
+		info->flush_range_ops = 0;
+		info->setway_ops = 0;
+		info->promoted_ops = 0;
+		info->inval_range_bytes = 0;
+		info->flush_range_bytes = 0;
+	}
+}
+
+#ifndef CONFIG_SPL_BUILD
+#define DCACHE_CALIBRATE_SIZE	(64 << 10)
+
+/*
+ * Time a flush of a dirty buffer by line against a flush of the whole
+ * cache by set/way, and set the range size at which we switch over.
+ */
+int dcache_calibrate(void)
+{
+	struct v7_dcache_info *info = v7_dcache_info();
+	ulong start, stop;
+	unsigned long long t_range, t_all;
+	char *buf;
+
+	if (!dcache_status()) {
+		puts("Data cache is off\n");
+		return -1;
+	}
+
+	buf = memalign(1 << info->log2_line_len, DCACHE_CALIBRATE_SIZE);
+	if (!buf)
+		return -1;
+	start = (ulong)buf;
+	stop = start + DCACHE_CALIBRATE_SIZE;
+
+	memset(buf, 0x5a, DCACHE_CALIBRATE_SIZE);
+	t_range = get_ticks();
+	v7_dcache_maint_range(start, stop, ARMV7_DCACHE_CLEAN_INVAL_RANGE);
+	v7_outer_cache_flush_range(start, stop);
+	t_range = get_ticks() - t_range;
+
+	memset(buf, 0xa5, DCACHE_CALIBRATE_SIZE);
+	t_all = get_ticks();
+	flush_dcache_all();
+	t_all = get_ticks() - t_all;
+	free(buf);
+
+	if (!t_range || t_range >> 32)
+		return -1;
+	info->flush_all_size = lldiv(t_all * DCACHE_CALIBRATE_SIZE, t_range);
+	printf("Range flush %llu ticks per %u KiB, full flush %llu ticks\n",
+	       t_range, DCACHE_CALIBRATE_SIZE >> 10, t_all);
+	printf("Flush all above:  %lu bytes\n", info->flush_all_size);
+
+	return 0;
+}
+#endif
+
 void arm_init_before_mmu(void)
 {
 	v7_outer_cache_enable();
@@ -312,6 +465,11 @@ void flush_dcache_range(unsigned long start, unsigned long stop)
 {
 }
 
+ulong v7_dcache_flush_all_size(void)
+{
+	return 0;
+}
+
 void arm_init_before_mmu(void)
 {
 }
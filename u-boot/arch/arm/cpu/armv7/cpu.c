@@ -20,12 +20,20 @@
 #include <asm/system.h>
 #include <asm/cache.h>
 #include <asm/armv7.h>
+#include <asm/sections.h>
 #include <linux/compiler.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 void __weak cpu_cache_initialization(void){}
 
-int cleanup_before_linux(void)
+static int v7_cleanup_before_linux(const struct cleanup_range *range,
+				   int count)
 {
+	struct cleanup_range self[4];
+	ulong sp, size;
+	int i, nself = 0;
+
 	/*
 	 * this function is called just before we call linux
 	 * it prepares the processor for linux
@@ -43,10 +51,51 @@ int cleanup_before_linux(void)
 	invalidate_icache_all();
 
 	/*
-	 * turn off D-cache
-	 * dcache_disable() in turn flushes the d-cache and disables MMU
+	 * U-Boot keeps running until the kernel is entered, so the state it
+	 * still reads has to be written back as well as the given ranges:
+	 * the stack above this frame, global data, the board info and
+	 * U-Boot's .data. The heap, environment and .bss (mostly large
+	 * buffers) are not used again; anything the caller reads from them
+	 * afterwards must be in @range. If all this adds up to more than
+	 * flushing the whole cache, do that instead.
 	 */
-	dcache_disable();
+	if (range) {
+		asm volatile("mov %0, sp" : "=r"(sp));
+		self[nself].start = sp;
+		self[nself++].end = gd->start_addr_sp;
+		self[nself].start = (ulong)gd;
+		self[nself++].end = (ulong)gd + sizeof(gd_t);
+		self[nself].start = (ulong)gd->bd;
+		self[nself++].end = (ulong)gd->bd + sizeof(bd_t);
+		self[nself].start = (ulong)__data_start;
+		self[nself++].end = (ulong)__image_copy_end;
+
+		size = 0;
+		for (i = 0; i < nself; i++)
+			size += self[i].end - self[i].start;
+		for (i = 0; i < count; i++)
+			size += range[i].end - range[i].start;
+		debug("%s: %lu bytes to flush, %lu for the whole cache\n",
+		      __func__, size, v7_dcache_flush_all_size());
+		if (size > v7_dcache_flush_all_size())
+			range = NULL;
+	}
+
+	if (range) {
+		/* Anything else still dirty is discarded below */
+		for (i = 0; i < count; i++)
+			flush_dcache_range(range[i].start, range[i].end);
+		for (i = 0; i < nself; i++)
+			flush_dcache_range(self[i].start, self[i].end);
+		set_cr(get_cr() & ~(CR_C | CR_M));
+	} else {
+		/*
+		 * turn off D-cache
+		 * dcache_disable() in turn flushes the d-cache and disables
+		 * MMU
+		 */
+		dcache_disable();
+	}
 	v7_outer_cache_disable();
 
 	/*
@@ -68,3 +117,13 @@ int cleanup_before_linux(void)
 
 	return 0;
 }
+
+int cleanup_before_linux(void)
+{
+	return v7_cleanup_before_linux(NULL, 0);
+}
+
+int cleanup_before_linux_ranges(const struct cleanup_range *range, int count)
+{
+	return v7_cleanup_before_linux(range, count);
+}
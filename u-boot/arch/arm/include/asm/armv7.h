@@ -58,4 +58,7 @@ void v7_outer_cache_inval_all(void);
 void v7_outer_cache_flush_range(u32 start, u32 end);
 void v7_outer_cache_inval_range(u32 start, u32 end);
 
+/* Size above which flushing the whole data cache is quicker than a range */
+ulong v7_dcache_flush_all_size(void);
+
 #endif
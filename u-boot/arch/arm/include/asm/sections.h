@@ -8,4 +8,8 @@
 
 #include <asm-generic/sections.h>
 
+/* Section markers, see arch/arm/lib/sections.c */
+extern char __image_copy_start[];
+extern char __data_start[];
+
 #endif
@@ -100,6 +100,11 @@ enum dcache_option {
 	DCACHE_OFF = 0x12,
 	DCACHE_WRITETHROUGH = 0x1a,
 	DCACHE_WRITEBACK = 0x1e,
+#ifdef __ARM_ARCH_7A__
+	DCACHE_WRITECOMBINE = 0x1012,	/* TEX=001: normal, non-cacheable */
+#else
+	DCACHE_WRITECOMBINE = 0x16,	/* bufferable, non-cacheable */
+#endif
 };
 
 /* Size of an MMU section */
@@ -26,6 +26,21 @@ extern ulong IRQ_STACK_START_IN;	/* 8 bytes in IRQ stack */
 int	cpu_init(void);
 int	cleanup_before_linux(void);
 
+/* A memory range which the kernel needs to find in RAM, not in the cache */
+struct cleanup_range {
+	ulong	start;
+	ulong	end;
+};
+
+/*
+ * As cleanup_before_linux(), but only write back the given ranges from the
+ * data cache rather than the whole cache, along with U-Boot's stack, global
+ * data and .data. Anything else the caller reads afterwards must be in a
+ * range. CPUs without support fall back to cleanup_before_linux().
+ */
+int	cleanup_before_linux_ranges(const struct cleanup_range *range,
+				    int count);
+
 /* Set up ARMv7 MMU, caches and TLBs */
 void	cpu_init_cp15(void);
 
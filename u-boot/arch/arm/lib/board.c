@@ -23,6 +23,7 @@
  */
 
 #include <common.h>
+#include <binlog.h>
 #include <command.h>
 #include <environment.h>
 #include <malloc.h>
@@ -513,6 +514,7 @@ void board_init_r(gd_t *id, ulong dest_addr)
 #endif
 
 	gd->flags |= GD_FLG_RELOC;	/* tell others: relocation done */
+	binlog_relocate();
 	bootstage_mark_name(BOOTSTAGE_ID_START_UBOOT_R, "board_init_r");
 
 	monitor_flash_len = _end_ofs;
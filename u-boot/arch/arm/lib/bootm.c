@@ -56,28 +56,109 @@ void arch_lmb_reserve(struct lmb *lmb)
 		    gd->bd->bi_dram[0].start + gd->bd->bi_dram[0].size - sp);
 }
 
+__weak int cleanup_before_linux_ranges(const struct cleanup_range *range,
+				       int count)
+{
+	return cleanup_before_linux();
+}
+
+/*
+ * Bootstage keeps using its records in .bss after the cleanup, which the
+ * range flush does not cover, so it needs the full flush.
+ */
+#if defined(CONFIG_BOOTM_FLUSH_RANGES) && !defined(CONFIG_BOOTSTAGE)
+static int add_cleanup_range(struct cleanup_range *range, int count,
+			     ulong start, ulong end)
+{
+	if (end > start) {
+		range[count].start = start;
+		range[count].end = end;
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * The kernel itself and any relocated ramdisk were flushed when they were
+ * loaded, so only the device tree or ATAGs and a ramdisk used in place
+ * can still be dirty in the cache. boot_jump_linux() also reads @images
+ * after the cleanup. A fake run returns to U-Boot, which needs all of
+ * its memory back, so that flushes the whole cache.
+ */
+static void cleanup_before_linux_images(bootm_headers_t *images, int fake)
+{
+	struct cleanup_range range[3];
+	int count = 0;
+
+	if (fake) {
+		cleanup_before_linux();
+		return;
+	}
+
+	if (IMAGE_ENABLE_OF_LIBFDT && images->ft_len) {
+		count = add_cleanup_range(range, count,
+				(ulong)images->ft_addr,
+				(ulong)images->ft_addr + images->ft_len);
+	} else if (params) {
+		/* Up to and including the ATAG_NONE tag */
+		count = add_cleanup_range(range, count,
+				gd->bd->bi_boot_params,
+				(ulong)params + sizeof(struct tag_header));
+	}
+	if (images->initrd_start == images->rd_start)
+		count = add_cleanup_range(range, count, images->initrd_start,
+					  images->initrd_end);
+	count = add_cleanup_range(range, count, (ulong)images,
+				  (ulong)(images + 1));
+	cleanup_before_linux_ranges(range, count);
+}
+#else
+static void cleanup_before_linux_images(bootm_headers_t *images, int fake)
+{
+	cleanup_before_linux();
+}
+#endif
+
 /**
  * announce_and_cleanup() - Print message and prepare for kernel boot
  *
+ * @images: Images being booted
  * @fake: non-zero to do everything except actually boot
  */
-static void announce_and_cleanup(int fake)
+static void announce_and_cleanup(bootm_headers_t *images, int fake)
 {
 	printf("\nStarting kernel ...%s\n\n", fake ?
 		"(fake run for tracing)" : "");
 	bootstage_mark_name(BOOTSTAGE_ID_BOOTM_HANDOFF, "start_kernel");
 #ifdef CONFIG_BOOTSTAGE_FDT
-	if (flag == BOOTM_STATE_OS_FAKE_GO)
-		bootstage_fdt_add_report();
+	/*
+	 * Start the activities timed below so that they are in the device
+	 * tree, then fill in their times afterwards
+	 */
+#ifdef CONFIG_USB_DEVICE
+	bootstage_start(BOOTSTAGE_ID_ACCUM_USB_STOP, "usb_stop");
 #endif
-#ifdef CONFIG_BOOTSTAGE_REPORT
-	bootstage_report();
+	bootstage_start(BOOTSTAGE_ID_ACCUM_CLEANUP, "cleanup_before_linux");
+	bootstage_fdt_add_report();
 #endif
 
 #ifdef CONFIG_USB_DEVICE
+	bootstage_start(BOOTSTAGE_ID_ACCUM_USB_STOP, "usb_stop");
 	udc_disconnect();
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_USB_STOP);
+#endif
+	bootstage_start(BOOTSTAGE_ID_ACCUM_CLEANUP, "cleanup_before_linux");
+	cleanup_before_linux_images(images, fake);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_CLEANUP);
+
+#ifdef CONFIG_BOOTSTAGE_FDT
+	bootstage_fdt_update(BOOTSTAGE_ID_ACCUM_USB_STOP);
+	bootstage_fdt_update(BOOTSTAGE_ID_ACCUM_CLEANUP);
+#endif
+#ifdef CONFIG_BOOTSTAGE_REPORT
+	bootstage_report();
 #endif
-	cleanup_before_linux();
 }
 
 static void setup_start_tag (bd_t *bd)
@@ -239,7 +320,7 @@ static void boot_jump_linux(bootm_headers_t *images, int flag)
 	debug("## Transferring control to Linux (at address %08lx)" \
 		"...\n", (ulong) kernel_entry);
 	bootstage_mark(BOOTSTAGE_ID_RUN_OS);
-	announce_and_cleanup(fake);
+	announce_and_cleanup(images, fake);
 
 	if (IMAGE_ENABLE_OF_LIBFDT && images->ft_len)
 		r2 = (unsigned long)images->ft_addr;
@@ -9,6 +9,7 @@
 #include <asm/system.h>
 #include <asm/cache.h>
 #include <linux/compiler.h>
+#include <memattr.h>
 
 #if !(defined(CONFIG_SYS_ICACHE_OFF) && defined(CONFIG_SYS_DCACHE_OFF))
 
@@ -67,6 +68,40 @@ void mmu_set_region_dcache_behaviour(u32 start, int size,
 	mmu_page_table_flush((u32)&page_table[start], (u32)&page_table[end]);
 }
 
+#ifdef CONFIG_MEM_ATTR
+static const enum dcache_option mem_attr_dcache[MEM_ATTR_COUNT] = {
+	[MEM_ATTR_OFF]		= DCACHE_OFF,
+	[MEM_ATTR_WRITETHROUGH]	= DCACHE_WRITETHROUGH,
+	[MEM_ATTR_WRITEBACK]	= DCACHE_WRITEBACK,
+	[MEM_ATTR_WRITECOMBINE]	= DCACHE_WRITECOMBINE,
+};
+
+/* Set sections [start, end) from the memory attribute map */
+static void mem_attr_set_sections(ulong start, ulong end)
+{
+	const struct mem_attr_map *map = mem_attr_get_map();
+	u8 attrs[64];
+	ulong i, count;
+
+	for (; start < end; start += count) {
+		count = min(end - start, (ulong)ARRAY_SIZE(attrs));
+		mem_attr_build_table(map, start << MMU_SECTION_SHIFT,
+				     MMU_SECTION_SHIFT, count, attrs);
+		for (i = 0; i < count; i++)
+			set_section_dcache(start + i, mem_attr_dcache[attrs[i]]);
+	}
+}
+
+__weak void dram_bank_mmu_setup(int bank)
+{
+	bd_t *bd = gd->bd;
+
+	debug("%s: bank: %d\n", __func__, bank);
+	mem_attr_set_sections(bd->bi_dram[bank].start >> MMU_SECTION_SHIFT,
+			      (bd->bi_dram[bank].start + bd->bi_dram[bank].size)
+			      >> MMU_SECTION_SHIFT);
+}
+#else
 __weak void dram_bank_mmu_setup(int bank)
 {
 	bd_t *bd = gd->bd;
@@ -83,6 +118,7 @@ __weak void dram_bank_mmu_setup(int bank)
 #endif
 	}
 }
+#endif
 
 /* to activate the MMU we need to set up virtual memory: use 1M areas */
 static inline void mmu_setup(void)
@@ -119,6 +155,45 @@ static int mmu_enabled(void)
 	return get_cr() & CR_M;
 }
 
+#ifdef CONFIG_MEM_ATTR
+/*
+ * Re-map the DRAM sections in [start, start + size) after the memory
+ * attribute map has changed. The area is flushed both before and after the
+ * change, since lines may be allocated or dirtied under the old mapping
+ * until the TLB is invalidated.
+ */
+void mem_attr_apply(ulong start, ulong size)
+{
+	u32 *page_table = (u32 *)gd->arch.tlb_addr;
+	ulong end, bank_start, bank_end, first, last;
+	int bank;
+
+	if (!mmu_enabled())
+		return;
+
+	end = size > ~0UL - start ? ~0UL : start + size - 1;
+	for (bank = 0; bank < CONFIG_NR_DRAM_BANKS; bank++) {
+		bank_start = gd->bd->bi_dram[bank].start;
+		bank_end = bank_start + gd->bd->bi_dram[bank].size - 1;
+		if (!gd->bd->bi_dram[bank].size || end < bank_start ||
+		    start > bank_end)
+			continue;
+
+		first = max(start, bank_start) >> MMU_SECTION_SHIFT;
+		last = min(end, bank_end) >> MMU_SECTION_SHIFT;
+		debug("%s: sections %lx-%lx\n", __func__, first, last);
+
+		flush_dcache_range(first << MMU_SECTION_SHIFT,
+				   (last + 1) << MMU_SECTION_SHIFT);
+		mem_attr_set_sections(first, last + 1);
+		mmu_page_table_flush((u32)&page_table[first],
+				     (u32)&page_table[last + 1]);
+		flush_dcache_range(first << MMU_SECTION_SHIFT,
+				   (last + 1) << MMU_SECTION_SHIFT);
+	}
+}
+#endif
+
 /* cache_bit must be either CR_I or CR_C */
 static void cache_enable(uint32_t cache_bit)
 {
@@ -11,6 +11,9 @@
 
 #include <asm-generic/sections.h>
 
+/* Provided by the host linker script */
+extern char __executable_start[], __data_start[];
+
 struct sb_cmdline_option;
 
 extern struct sb_cmdline_option *__u_boot_sandbox_option_start[],
@@ -8,6 +8,7 @@
  */
 
 #include <common.h>
+#include <fs.h>
 #include <lcd.h>
 #include <asm/io.h>
 #include <asm/arch/cpu.h>
@@ -779,6 +780,8 @@ static int ums_read_sector(struct ums_device *ums_dev,
 static int ums_write_sector(struct ums_device *ums_dev,
 			    ulong start, lbaint_t blkcnt, const void *buf)
 {
+	/* The host changes the filesystems behind our back */
+	fs_invalidate_dev(&ums_dev->mmc->block_dev);
 	if (ums_dev->mmc->block_dev.block_write(ums_dev->dev_num,
 			start + ums_dev->offset, blkcnt, buf) != blkcnt)
 		return -1;
@@ -0,0 +1,767 @@
+/*
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+/*
+ * Binary log buffer
+ *
+ * Each message is stored as a small record holding the format string
+ * pointer and the raw argument values, as picked out of the va_list with
+ * a cut-down version of the vsprintf() format parser. Formatting is
+ * deferred until the log is displayed, so logging a message while the
+ * console is silent costs little more than a memcpy(). A format string
+ * outside U-Boot's text and read-only data (a buffer on the stack, or
+ * environment text) may have changed by then, so such messages are
+ * formatted straight away and the text is stored instead.
+ *
+ * Records live in a byte ring; when it fills up the oldest records are
+ * dropped. The ring and its header are kept in a single memory area which
+ * is writable before relocation, so they need no global variables.
+ */
+
+#include <common.h>
+#include <binlog.h>
+#include <libfdt.h>
+#include <malloc.h>
+#include <asm/sections.h>
+#include <linux/ctype.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#ifndef CONFIG_BINLOG_SIZE
+#define CONFIG_BINLOG_SIZE	(16 << 10)
+#endif
+
+#ifndef CONFIG_BINLOG_FDT_SIZE
+#define CONFIG_BINLOG_FDT_SIZE	4096
+#endif
+
+enum {
+	BINLOG_MAGIC	= 0xb1a71090,
+	BINLOG_ALIGN	= sizeof(long),
+	BINLOG_MAX_STR	= 64,		/* Longest %s argument we copy */
+	BINLOG_MAX_ARGS	= 256,		/* Maximum argument bytes per record */
+	BINLOG_MAX_WIDTH = 64,		/* Field widths are clipped to this */
+};
+
+/* Record flags */
+enum {
+	BINLOG_RF_PRERELOC	= 1 << 0,	/* fmt points to old text */
+	BINLOG_RF_TEXT		= 1 << 1,	/* args hold formatted text */
+};
+
+struct binlog_rec {
+	uint16_t len;		/* Total record length, 0 to wrap */
+	uint8_t level;		/* enum binlog_level */
+	uint8_t subsys;		/* enum binlog_subsys */
+	uint8_t flags;		/* BINLOG_RF_... */
+	uint8_t spare[3];
+	uint32_t time_us;	/* Time of recording */
+	const char *fmt;	/* Format string, NULL with BINLOG_RF_TEXT */
+	uint8_t args[0];	/* Packed argument values */
+};
+
+struct binlog_hdr {
+	uint32_t magic;		/* BINLOG_MAGIC */
+	uint32_t size;		/* Size of data area in bytes */
+	uint32_t head;		/* Offset of oldest record */
+	uint32_t tail;		/* Offset at which to write next record */
+	uint32_t count;		/* Number of records held */
+	uint32_t lost;		/* Number of records overwritten */
+	uint32_t filtered;	/* Number of records not recorded */
+	uint32_t subsys_mask;	/* Subsystems to record */
+	uint8_t level;		/* Record messages at this level or below */
+	uint8_t console_level;	/* Print messages below this level */
+	uint8_t spare[2];
+	uint8_t data[0];
+};
+
+#ifdef CONFIG_BINLOG_ADDR
+#define binlog_base()	((void *)CONFIG_BINLOG_ADDR)
+#else
+/*
+ * Without a fixed address the buffer goes in .data rather than .bss, so that
+ * it can be written before relocation and is copied along with the image.
+ */
+static char binlog_buf[CONFIG_BINLOG_SIZE] __attribute__((section(".data")));
+#define binlog_base()	((void *)binlog_buf)
+#endif
+
+#define BINLOG_DATA_SIZE \
+	((CONFIG_BINLOG_SIZE - sizeof(struct binlog_hdr)) & ~(BINLOG_ALIGN - 1))
+
+static void binlog_reset(struct binlog_hdr *hdr)
+{
+	hdr->head = 0;
+	hdr->tail = 0;
+	hdr->count = 0;
+}
+
+static struct binlog_hdr *binlog_get(void)
+{
+	struct binlog_hdr *hdr = binlog_base();
+
+	if (hdr->magic != BINLOG_MAGIC || hdr->size != BINLOG_DATA_SIZE) {
+		memset(hdr, '\0', sizeof(*hdr));
+		hdr->magic = BINLOG_MAGIC;
+		hdr->size = BINLOG_DATA_SIZE;
+		hdr->subsys_mask = BINLOG_SUBSYS_ALL;
+		hdr->level = CONFIG_BINLOG_LEVEL;
+		hdr->console_level = CONFIG_BINLOG_CONSOLE_LEVEL;
+	}
+
+	return hdr;
+}
+
+static inline struct binlog_rec *binlog_rec_at(struct binlog_hdr *hdr,
+					       uint32_t offset)
+{
+	return (struct binlog_rec *)(hdr->data + offset);
+}
+
+/* Return the record after @offset, following the wrap marker if present */
+static uint32_t binlog_next(struct binlog_hdr *hdr, uint32_t offset)
+{
+	offset += binlog_rec_at(hdr, offset)->len;
+	if (offset == hdr->size || !binlog_rec_at(hdr, offset)->len)
+		offset = 0;
+
+	return offset;
+}
+
+static void binlog_drop_oldest(struct binlog_hdr *hdr)
+{
+	if (!binlog_rec_at(hdr, hdr->head)->len)
+		hdr->head = 0;
+	hdr->head = binlog_next(hdr, hdr->head);
+	hdr->count--;
+	hdr->lost++;
+	if (!hdr->count)
+		binlog_reset(hdr);
+}
+
+/*
+ * Find space for a record of @len bytes at the tail of the ring, dropping
+ * the oldest records as necessary.
+ */
+static struct binlog_rec *binlog_alloc(struct binlog_hdr *hdr, uint len)
+{
+	struct binlog_rec *rec;
+
+	for (;;) {
+		if (!hdr->count) {
+			binlog_reset(hdr);
+			break;
+		}
+		if (hdr->tail > hdr->head) {
+			if (hdr->size - hdr->tail >= len)
+				break;
+			/* Leave a wrap marker and continue at the start */
+			binlog_rec_at(hdr, hdr->tail)->len = 0;
+			hdr->tail = 0;
+		}
+		if (hdr->tail < hdr->head && hdr->head - hdr->tail >= len)
+			break;
+		binlog_drop_oldest(hdr);
+	}
+
+	rec = binlog_rec_at(hdr, hdr->tail);
+	hdr->tail += len;
+	if (hdr->tail == hdr->size)
+		hdr->tail = 0;
+	hdr->count++;
+
+	return rec;
+}
+
+/* Format parser state for one conversion, shared by record and display */
+struct binlog_spec {
+	char flags[6];		/* Flag characters, NUL-terminated */
+	int width;		/* -1 if none, -2 if given as argument */
+	int precision;		/* -1 if none, -2 if given as argument */
+	char qualifier;		/* 'h', 'l', 'L', 'z', 'Z', 't' or 0 */
+	char conv;		/* Conversion character */
+	const char *ext;	/* Start of %p extension */
+	int ext_len;		/* Length of %p extension */
+};
+
+/*
+ * Parse one conversion following a '%'. Returns a pointer to the last
+ * character of the conversion, as vsprintf() does.
+ */
+static const char *binlog_parse_spec(const char *fmt, struct binlog_spec *spec)
+{
+	int nflags = 0;
+
+	for (++fmt; *fmt && strchr("-+ #0", *fmt); fmt++) {
+		if (nflags < sizeof(spec->flags) - 1)
+			spec->flags[nflags++] = *fmt;
+	}
+	spec->flags[nflags] = '\0';
+
+	spec->width = -1;
+	if (isdigit(*fmt)) {
+		spec->width = 0;
+		while (isdigit(*fmt))
+			spec->width = spec->width * 10 + *fmt++ - '0';
+	} else if (*fmt == '*') {
+		spec->width = -2;
+		fmt++;
+	}
+
+	spec->precision = -1;
+	if (*fmt == '.') {
+		fmt++;
+		spec->precision = 0;
+		if (*fmt == '*') {
+			spec->precision = -2;
+			fmt++;
+		}
+		while (isdigit(*fmt))
+			spec->precision = spec->precision * 10 + *fmt++ - '0';
+	}
+
+	spec->qualifier = 0;
+	if (*fmt && strchr("hlLZzt", *fmt)) {
+		spec->qualifier = *fmt++;
+		if (spec->qualifier == 'l' && *fmt == 'l') {
+			spec->qualifier = 'L';
+			fmt++;
+		}
+	}
+
+	spec->conv = *fmt;
+	spec->ext = fmt + 1;
+	spec->ext_len = 0;
+	if (spec->conv == 'p') {
+		while (isalnum(fmt[1])) {
+			fmt++;
+			spec->ext_len++;
+		}
+	}
+	if (!*fmt)
+		fmt--;
+
+	return fmt;
+}
+
+/* Number of bytes pointed to by a %p argument with this extension */
+static int binlog_ptr_size(const struct binlog_spec *spec)
+{
+#ifdef CONFIG_CMD_NET
+	switch (spec->ext_len ? *spec->ext : 0) {
+	case 'm':
+	case 'M':
+		return 6;
+	case 'i':
+	case 'I':
+		if (spec->ext_len > 1 && spec->ext[1] == '6')
+			return 16;
+		if (spec->ext_len > 1 && spec->ext[1] == '4')
+			return 4;
+		break;
+	}
+#endif
+	return 0;
+}
+
+/* Kinds of argument stored in a record */
+enum {
+	ARG_NONE,
+	ARG_INT,
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_STR,
+	ARG_PTR,
+	ARG_PTRDATA,
+};
+
+static int binlog_arg_kind(const struct binlog_spec *spec)
+{
+	switch (spec->conv) {
+	case 'c':
+		return ARG_INT;
+	case 's':
+		return ARG_STR;
+	case 'p':
+		return binlog_ptr_size(spec) ? ARG_PTRDATA : ARG_PTR;
+	case 'n':
+		return ARG_PTR;
+	case 'o':
+	case 'x':
+	case 'X':
+	case 'd':
+	case 'i':
+	case 'u':
+		break;
+	default:
+		return ARG_NONE;
+	}
+
+	switch (spec->qualifier) {
+	case 'L':
+		return ARG_LLONG;
+	case 'l':
+	case 'z':
+	case 'Z':
+	case 't':
+		return ARG_LONG;
+	default:
+		return ARG_INT;
+	}
+}
+
+/*
+ * U-Boot's text and read-only data start at the image and end where .data
+ * begins. Both symbols follow relocation.
+ */
+#if defined(CONFIG_ARM)
+#define binlog_ro_start()	__image_copy_start
+#elif defined(CONFIG_SANDBOX)
+#define binlog_ro_start()	__executable_start
+#endif
+
+/* Check whether @fmt is sure to be unchanged when the log is displayed */
+static int binlog_fmt_is_const(const char *fmt)
+{
+#ifdef binlog_ro_start
+	return fmt >= binlog_ro_start() && fmt < __data_start;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Copy the arguments for @fmt out of @args into @buf. Returns the number of
+ * bytes used, or -1 if they do not fit.
+ */
+static int binlog_pack_args(uint8_t *buf, const char *fmt, va_list args)
+{
+	struct binlog_spec spec;
+	uint8_t *ptr = buf, *end = buf + BINLOG_MAX_ARGS;
+	unsigned long long llval;
+	unsigned long lval;
+	const char *str;
+	int ival, len;
+
+	for (; *fmt; fmt++) {
+		if (*fmt != '%')
+			continue;
+		fmt = binlog_parse_spec(fmt, &spec);
+		if (ptr + 2 * sizeof(int) > end)
+			return -1;
+		if (spec.width == -2) {
+			ival = va_arg(args, int);
+			memcpy(ptr, &ival, sizeof(ival));
+			ptr += sizeof(ival);
+		}
+		if (spec.precision == -2) {
+			ival = va_arg(args, int);
+			memcpy(ptr, &ival, sizeof(ival));
+			ptr += sizeof(ival);
+		}
+
+		switch (binlog_arg_kind(&spec)) {
+		case ARG_INT:
+			ival = va_arg(args, int);
+			len = sizeof(ival);
+			if (ptr + len > end)
+				return -1;
+			memcpy(ptr, &ival, len);
+			break;
+		case ARG_LONG:
+			lval = va_arg(args, unsigned long);
+			len = sizeof(lval);
+			if (ptr + len > end)
+				return -1;
+			memcpy(ptr, &lval, len);
+			break;
+		case ARG_LLONG:
+			llval = va_arg(args, unsigned long long);
+			len = sizeof(llval);
+			if (ptr + len > end)
+				return -1;
+			memcpy(ptr, &llval, len);
+			break;
+		case ARG_PTR:
+			lval = (unsigned long)va_arg(args, void *);
+			len = sizeof(lval);
+			if (ptr + len > end)
+				return -1;
+			memcpy(ptr, &lval, len);
+			break;
+		case ARG_PTRDATA:
+			str = va_arg(args, const char *);
+			len = binlog_ptr_size(&spec);
+			if (ptr + len > end)
+				return -1;
+			memcpy(ptr, str, len);
+			break;
+		case ARG_STR:
+			str = va_arg(args, const char *);
+			if (!str)
+				str = "<NULL>";
+			len = strnlen(str, BINLOG_MAX_STR);
+			if (ptr + len + 1 > end)
+				return -1;
+			memcpy(ptr, str, len);
+			ptr[len++] = '\0';
+			break;
+		default:
+			len = 0;
+			break;
+		}
+		ptr += len;
+	}
+
+	return ptr - buf;
+}
+
+/* Append up to @len bytes of @str to the output buffer */
+static char *binlog_out(char *out, char *end, const char *str, int len)
+{
+	if (len > end - out)
+		len = end - out;
+	if (len > 0)
+		memcpy(out, str, len);
+	else
+		len = 0;
+
+	return out + len;
+}
+
+/*
+ * Format a record into @buf, which is always NUL-terminated. Returns the
+ * number of characters written.
+ */
+static int binlog_format(struct binlog_rec *rec, char *buf, int size)
+{
+	struct binlog_spec spec;
+	const char *fmt, *lit;
+	uint8_t *arg = rec->args;
+	char *out = buf, *end = buf + size - 1;
+	char tmp[BINLOG_MAX_STR + BINLOG_MAX_WIDTH + 2];
+	char conv[32];
+	unsigned long long llval;
+	unsigned long lval;
+	int ival, len;
+
+#ifdef CONFIG_BOOTSTAGE
+	snprintf(out, end - out + 1, "[%10u] ", rec->time_us);
+	out += strlen(out);
+#endif
+	if (rec->flags & BINLOG_RF_TEXT) {
+		lit = (const char *)rec->args;
+		out = binlog_out(out, end, lit, strlen(lit));
+		*out = '\0';
+		return out - buf;
+	}
+	for (fmt = rec->fmt; *fmt && out < end; fmt++) {
+		for (lit = fmt; *fmt && *fmt != '%'; fmt++)
+			;
+		out = binlog_out(out, end, lit, fmt - lit);
+		if (!*fmt)
+			break;
+
+		fmt = binlog_parse_spec(fmt, &spec);
+		if (spec.width == -2) {
+			memcpy(&spec.width, arg, sizeof(int));
+			arg += sizeof(int);
+			if (spec.width < 0) {
+				spec.width = -spec.width;
+				if (strlen(spec.flags) < sizeof(spec.flags) - 1)
+					strcat(spec.flags, "-");
+			}
+		}
+		if (spec.precision == -2) {
+			memcpy(&spec.precision, arg, sizeof(int));
+			arg += sizeof(int);
+			if (spec.precision < 0)
+				spec.precision = 0;
+		}
+		if (spec.width > BINLOG_MAX_WIDTH)
+			spec.width = BINLOG_MAX_WIDTH;
+		if (spec.precision > BINLOG_MAX_WIDTH)
+			spec.precision = BINLOG_MAX_WIDTH;
+
+		/*
+		 * Rebuild a self-contained conversion for sprintf(). With
+		 * CONFIG_SYS_VSNPRINTF its return value counts the NUL, so
+		 * lengths are measured with strlen() instead.
+		 */
+		sprintf(conv, "%%%s", spec.flags);
+		if (spec.width >= 0)
+			sprintf(conv + strlen(conv), "%d", spec.width);
+		if (spec.precision >= 0)
+			sprintf(conv + strlen(conv), ".%d", spec.precision);
+		len = strlen(conv);
+		if (spec.qualifier == 'L') {
+			conv[len++] = 'l';
+			conv[len++] = 'l';
+		} else if (spec.qualifier) {
+			conv[len++] = spec.qualifier;
+		}
+		conv[len++] = spec.conv;
+		memcpy(conv + len, spec.ext, min(spec.ext_len, 4));
+		len += min(spec.ext_len, 4);
+		conv[len] = '\0';
+
+		switch (binlog_arg_kind(&spec)) {
+		case ARG_INT:
+			memcpy(&ival, arg, sizeof(ival));
+			arg += sizeof(ival);
+			sprintf(tmp, conv, ival);
+			break;
+		case ARG_LONG:
+			memcpy(&lval, arg, sizeof(lval));
+			arg += sizeof(lval);
+			sprintf(tmp, conv, lval);
+			break;
+		case ARG_LLONG:
+			memcpy(&llval, arg, sizeof(llval));
+			arg += sizeof(llval);
+			sprintf(tmp, conv, llval);
+			break;
+		case ARG_PTR:
+			memcpy(&lval, arg, sizeof(lval));
+			arg += sizeof(lval);
+			if (spec.conv == 'n')
+				tmp[0] = '\0';
+			else
+				sprintf(tmp, conv, (void *)lval);
+			break;
+		case ARG_PTRDATA:
+			sprintf(tmp, conv, arg);
+			arg += binlog_ptr_size(&spec);
+			break;
+		case ARG_STR:
+			sprintf(tmp, conv, (char *)arg);
+			arg += strlen((char *)arg) + 1;
+			break;
+		default:
+			sprintf(tmp, conv);
+			break;
+		}
+		out = binlog_out(out, end, tmp, strlen(tmp));
+	}
+	*out = '\0';
+
+	return out - buf;
+}
+
+static int binlog_add(int subsys, int level, const char *fmt, va_list args)
+{
+	struct binlog_hdr *hdr = binlog_get();
+	struct binlog_rec *rec;
+	uint8_t argbuf[BINLOG_MAX_ARGS];
+	int is_const = binlog_fmt_is_const(fmt);
+	va_list copy;
+	int len;
+
+	if (level > hdr->level || !(hdr->subsys_mask & (1U << subsys))) {
+		hdr->filtered++;
+		return -1;
+	}
+
+	va_copy(copy, args);
+	if (is_const) {
+		len = binlog_pack_args(argbuf, fmt, copy);
+	} else {
+		vscnprintf((char *)argbuf, sizeof(argbuf), fmt, copy);
+		len = strlen((char *)argbuf) + 1;
+	}
+	va_end(copy);
+	if (len < 0 || sizeof(*rec) + len > hdr->size / 2)
+		return -1;
+
+	rec = binlog_alloc(hdr, ALIGN(sizeof(*rec) + len, BINLOG_ALIGN));
+	rec->len = ALIGN(sizeof(*rec) + len, BINLOG_ALIGN);
+	rec->level = level;
+	rec->subsys = subsys;
+	rec->flags = is_const ? 0 : BINLOG_RF_TEXT;
+#ifndef CONFIG_SANDBOX
+	/* Sandbox does not move its code, so fmt stays valid */
+	if (is_const && !(gd->flags & GD_FLG_RELOC))
+		rec->flags |= BINLOG_RF_PRERELOC;
+#endif
+#ifdef CONFIG_BOOTSTAGE
+	rec->time_us = timer_get_boot_us();
+#else
+	rec->time_us = 0;
+#endif
+	rec->fmt = is_const ? fmt : NULL;
+	memcpy(rec->args, argbuf, len);
+
+	return 0;
+}
+
+int binlog_vrecord(int subsys, int level, const char *fmt, va_list args)
+{
+	struct binlog_hdr *hdr = binlog_get();
+	int show = level < hdr->console_level;
+	int ret;
+
+	ret = binlog_add(subsys, level, fmt, args);
+	if (show && gd->have_console && !(gd->flags & GD_FLG_SILENT))
+		vprintf(fmt, args);
+
+	return ret;
+}
+
+int binlog_record(int subsys, int level, const char *fmt, ...)
+{
+	va_list args;
+	int ret;
+
+	va_start(args, fmt);
+	ret = binlog_vrecord(subsys, level, fmt, args);
+	va_end(args);
+
+	return ret;
+}
+
+int binlog_console(const char *fmt, va_list args)
+{
+	return binlog_add(BINLOG_SUBSYS_CONSOLE, BINLOG_INFO, fmt, args);
+}
+
+int binlog_relocate(void)
+{
+	struct binlog_hdr *hdr = binlog_get();
+	struct binlog_rec *rec;
+	uint32_t offset;
+	int i;
+
+	for (i = 0, offset = hdr->head; i < hdr->count; i++) {
+		rec = binlog_rec_at(hdr, offset);
+		if (rec->flags & BINLOG_RF_PRERELOC) {
+			rec->fmt += gd->reloc_off;
+			rec->flags &= ~BINLOG_RF_PRERELOC;
+		}
+		offset = binlog_next(hdr, offset);
+	}
+
+	return 0;
+}
+
+void binlog_show(int max_level, unsigned subsys_mask)
+{
+	struct binlog_hdr *hdr = binlog_get();
+	struct binlog_rec *rec;
+	char buf[CONFIG_SYS_PBSIZE];
+	uint32_t offset;
+	int i;
+
+	for (i = 0, offset = hdr->head; i < hdr->count; i++) {
+		rec = binlog_rec_at(hdr, offset);
+		if (rec->level <= max_level &&
+		    (subsys_mask & (1U << rec->subsys))) {
+			binlog_format(rec, buf, sizeof(buf));
+			puts(buf);
+		}
+		offset = binlog_next(hdr, offset);
+		if (ctrlc())
+			break;
+	}
+}
+
+void binlog_clear(void)
+{
+	struct binlog_hdr *hdr = binlog_get();
+
+	binlog_reset(hdr);
+	hdr->lost = 0;
+	hdr->filtered = 0;
+}
+
+void binlog_info(void)
+{
+	struct binlog_hdr *hdr = binlog_get();
+	uint used;
+
+	if (!hdr->count)
+		used = 0;
+	else if (hdr->tail > hdr->head)
+		used = hdr->tail - hdr->head;
+	else
+		used = hdr->size - hdr->head + hdr->tail;
+
+	printf("Binary log at %p, %u bytes\n", hdr, hdr->size);
+	printf("records      = %u (%u bytes)\n", hdr->count, used);
+	printf("lost         = %u\n", hdr->lost);
+	printf("filtered     = %u\n", hdr->filtered);
+	printf("level        = %u\n", hdr->level);
+	printf("consolelevel = %u\n", hdr->console_level);
+	printf("subsystems   = %08x\n", hdr->subsys_mask);
+}
+
+void binlog_set_filter(int level, unsigned subsys_mask)
+{
+	struct binlog_hdr *hdr = binlog_get();
+
+	if (level >= 0)
+		hdr->level = level;
+	if (subsys_mask)
+		hdr->subsys_mask = subsys_mask & BINLOG_SUBSYS_ALL;
+}
+
+void binlog_set_console_level(int level)
+{
+	binlog_get()->console_level = level;
+}
+
+#ifdef CONFIG_OF_LIBFDT
+int binlog_fdt_add_report(void *blob)
+{
+	struct binlog_hdr *hdr = binlog_get();
+	struct binlog_rec *rec;
+	char buf[CONFIG_SYS_PBSIZE];
+	char *text, *ptr;
+	uint32_t offset;
+	int i, skip, total;
+	int node, ret;
+
+	if (!blob || !hdr->count)
+		return 0;
+
+	total = 0;
+	for (i = 0, offset = hdr->head; i < hdr->count; i++) {
+		rec = binlog_rec_at(hdr, offset);
+		total += binlog_format(rec, buf, sizeof(buf));
+		offset = binlog_next(hdr, offset);
+	}
+
+	/* Keep the tail of the log if it does not all fit */
+	for (i = 0, offset = hdr->head; i < hdr->count; i++) {
+		if (total < CONFIG_BINLOG_FDT_SIZE)
+			break;
+		rec = binlog_rec_at(hdr, offset);
+		total -= binlog_format(rec, buf, sizeof(buf));
+		offset = binlog_next(hdr, offset);
+	}
+	skip = i;
+
+	text = malloc(total + 1);
+	if (!text)
+		return -1;
+	for (ptr = text; i < hdr->count; i++) {
+		rec = binlog_rec_at(hdr, offset);
+		ptr += binlog_format(rec, ptr, total + 1 - (ptr - text));
+		offset = binlog_next(hdr, offset);
+	}
+	*ptr = '\0';
+
+	ret = -1;
+	node = fdt_add_subnode(blob, 0, "binlog");
+	if (node >= 0 && !fdt_setprop_string(blob, node, "text", text) &&
+	    !fdt_setprop_cell(blob, node, "lost", hdr->lost + skip))
+		ret = 0;
+	free(text);
+	if (ret)
+		puts("binlog: Failed to add to device tree\n");
+
+	return ret;
+}
+#endif
@@ -11,6 +11,7 @@
  */
 
 #include <common.h>
+#include <binlog.h>
 /* TODO: can we just include all these headers whether needed or not? */
 #if defined(CONFIG_CMD_BEDBUG)
 #include <bedbug/type.h>
@@ -707,6 +708,9 @@ static int run_main_loop(void)
 init_fnc_t init_sequence_r[] = {
 	initr_trace,
 	initr_reloc,
+#ifdef CONFIG_BINLOG
+	binlog_relocate,
+#endif
 	/* TODO: could x86/PPC have this also perhaps? */
 #ifdef CONFIG_ARM
 	initr_caches,
@@ -228,7 +228,9 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 		struct bootstage_record *rec = &record[id];
 		int node;
 
-		if (id != BOOTSTAGE_ID_AWAKE && rec->time_us == 0)
+		/* Keep started activities, bootstage_fdt_update() may fill in */
+		if (id != BOOTSTAGE_ID_AWAKE && rec->time_us == 0 &&
+		    !rec->start_us)
 			continue;
 
 		node = fdt_add_subnode(blob, bootstage, simple_itoa(i));
@@ -257,6 +259,26 @@ int bootstage_fdt_add_report(void)
 
 	return 0;
 }
+
+int bootstage_fdt_update(enum bootstage_id id)
+{
+	struct bootstage_record *rec = &record[id];
+	char path[30];
+	int node;
+
+	if (!working_fdt)
+		return -1;
+
+	/* Nodes are numbered in reverse, as in add_bootstages_devicetree() */
+	strcpy(path, "/bootstage/");
+	strcat(path, simple_itoa(BOOTSTAGE_ID_COUNT - 1 - id));
+	node = fdt_path_offset(working_fdt, path);
+	if (node < 0)
+		return -1;
+
+	return fdt_setprop_inplace_cell(working_fdt, node,
+			rec->start_us ? "accum" : "mark", rec->time_us);
+}
 #endif
 
 void bootstage_report(void)
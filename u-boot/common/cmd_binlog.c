@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <binlog.h>
+
+static int do_binlog_show(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	int level = BINLOG_LEVEL_COUNT - 1;
+	unsigned mask = BINLOG_SUBSYS_ALL;
+
+	if (argc > 1)
+		level = simple_strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		mask = simple_strtoul(argv[2], NULL, 16);
+	binlog_show(level, mask);
+
+	return 0;
+}
+
+static int do_binlog_clear(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	binlog_clear();
+
+	return 0;
+}
+
+static int do_binlog_info(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	binlog_info();
+
+	return 0;
+}
+
+static int do_binlog_level(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	if (argc < 2)
+		return CMD_RET_USAGE;
+	binlog_set_filter(simple_strtoul(argv[1], NULL, 10), 0);
+	if (argc > 2)
+		binlog_set_console_level(simple_strtoul(argv[2], NULL, 10));
+
+	return 0;
+}
+
+static int do_binlog_filter(cmd_tbl_t *cmdtp, int flag, int argc,
+			    char * const argv[])
+{
+	if (argc < 2)
+		return CMD_RET_USAGE;
+	binlog_set_filter(-1, simple_strtoul(argv[1], NULL, 16));
+
+	return 0;
+}
+
+static cmd_tbl_t cmd_binlog_sub[] = {
+	U_BOOT_CMD_MKENT(show, 3, 1, do_binlog_show, "", ""),
+	U_BOOT_CMD_MKENT(clear, 1, 0, do_binlog_clear, "", ""),
+	U_BOOT_CMD_MKENT(info, 1, 1, do_binlog_info, "", ""),
+	U_BOOT_CMD_MKENT(level, 3, 0, do_binlog_level, "", ""),
+	U_BOOT_CMD_MKENT(filter, 2, 0, do_binlog_filter, "", ""),
+};
+
+/*
+ * Process a binlog sub-command
+ */
+static int do_binlog(cmd_tbl_t *cmdtp, int flag, int argc,
+		     char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* Strip off leading 'binlog' command argument */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], cmd_binlog_sub, ARRAY_SIZE(cmd_binlog_sub));
+
+	if (c)
+		return c->cmd(cmdtp, flag, argc, argv);
+	else
+		return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(binlog, 4, 1, do_binlog,
+	"binary log buffer",
+	"show [<level> [<subsys_mask>]] - format and print recorded messages\n"
+	"binlog clear                   - discard all messages\n"
+	"binlog info                    - show buffer usage and settings\n"
+	"binlog level <level> [<conlevel>]\n"
+	"                               - set record (and console) level\n"
+	"binlog filter <subsys_mask>    - set subsystems to record (hex)"
+);
@@ -436,11 +436,13 @@ static int bootm_load_os(bootm_headers_t *images, unsigned long *load_end,
 	}
 #endif /* CONFIG_LZMA */
 #ifdef CONFIG_LZO
-	case IH_COMP_LZO:
+	case IH_COMP_LZO: {
+		size_t size = unc_len;
+
 		printf("   Uncompressing %s ... ", type_name);
 
-		ret = lzop_decompress(image_buf, image_len, load_buf,
-				      &unc_len);
+		ret = lzop_decompress(image_buf, image_len, load_buf, &size);
+		unc_len = size;
 		if (ret != LZO_E_OK) {
 			printf("LZO: uncompress or overwrite error %d "
 			      "- must RESET board to recover\n", ret);
@@ -451,13 +453,14 @@ static int bootm_load_os(bootm_headers_t *images, unsigned long *load_end,
 
 		*load_end = load + unc_len;
 		break;
+	}
 #endif /* CONFIG_LZO */
 	default:
 		printf("Unimplemented compression type %d\n", comp);
 		return BOOTM_ERR_UNIMPLEMENTED;
 	}
 
-	flush_cache(load, (*load_end - load) * sizeof(ulong));
+	flush_cache(load, *load_end - load);
 
 	puts("OK\n");
 	debug("   kernel loaded at 0x%08lx, end = 0x%08lx\n", load, *load_end);
@@ -526,7 +529,9 @@ static int boot_selected_os(int argc, char * const argv[], int state,
 		bootm_start_standalone(argc, argv);
 		return 0;
 	}
+	bootstage_start(BOOTSTAGE_ID_ACCUM_PREBOOT_OS, "arch_preboot_os");
 	arch_preboot_os();
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_PREBOOT_OS);
 	boot_fn(state, argc, argv, images);
 	if (state == BOOTM_STATE_OS_FAKE_GO) /* We expect to return */
 		return 0;
@@ -553,9 +558,11 @@ static ulong bootm_disable_interrupts(void)
 	 * recover from any failures any more...
 	 */
 	iflag = disable_interrupts();
-#ifdef CONFIG_NETCONSOLE
-	/* Stop the ethernet stack if NetConsole could have left it up */
-	eth_halt();
+#if defined(CONFIG_NETCONSOLE) || defined(CONFIG_NET_KEEP_LINK)
+	/* Stop the ethernet stack if NetConsole or NetLoop left it up */
+	bootstage_start(BOOTSTAGE_ID_ACCUM_ETH_HALT, "eth_halt");
+	net_quiesce();
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_ETH_HALT);
 #endif
 
 #if defined(CONFIG_CMD_USB)
@@ -568,7 +575,9 @@ static ulong bootm_disable_interrupts(void)
 	 * updated every 1 ms within the HCCA structure in SDRAM! For more
 	 * details see the OpenHCI specification.
 	 */
+	bootstage_start(BOOTSTAGE_ID_ACCUM_USB_STOP, "usb_stop");
 	usb_stop();
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_USB_STOP);
 #endif
 	return iflag;
 }
@@ -628,7 +637,9 @@ static int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc,
 		ulong load_end;
 
 		iflag = bootm_disable_interrupts();
+		bootstage_start(BOOTSTAGE_ID_ACCUM_LOAD_OS, "load_os");
 		ret = bootm_load_os(images, &load_end, 0);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_LOAD_OS);
 		if (ret == 0)
 			lmb_reserve(&images->lmb, images->os.load,
 				    (load_end - images->os.load));
@@ -684,8 +695,11 @@ static int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc,
 		ret = boot_fn(BOOTM_STATE_OS_CMDLINE, argc, argv, images);
 	if (!ret && (states & BOOTM_STATE_OS_BD_T))
 		ret = boot_fn(BOOTM_STATE_OS_BD_T, argc, argv, images);
-	if (!ret && (states & BOOTM_STATE_OS_PREP))
+	if (!ret && (states & BOOTM_STATE_OS_PREP)) {
+		bootstage_start(BOOTSTAGE_ID_ACCUM_OS_PREP, "os_prep");
 		ret = boot_fn(BOOTM_STATE_OS_PREP, argc, argv, images);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_OS_PREP);
+	}
 
 #ifdef CONFIG_TRACE
 	/* Pretend to run the OS, then run a user command */
@@ -1796,6 +1810,10 @@ static int bootz_start(cmd_tbl_t *cmdtp, int flag, int argc,
 		return 1;
 
 	lmb_reserve(&images->lmb, images->ep, zi_end - zi_start);
+#ifdef CONFIG_BOOTM_FLUSH_RANGES
+	/* As bootm_load_os(), since the final flush may skip the kernel */
+	flush_cache(images->ep, zi_end - zi_start);
+#endif
 
 	/*
 	 * Handle the BOOTM_STATE_FINDOTHER state ourselves as we do not
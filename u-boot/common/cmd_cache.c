@@ -52,9 +52,25 @@ void __weak flush_dcache_all(void)
 	/* please define arch specific flush_dcache_all */
 }
 
+void __weak dcache_print_stats(int reset)
+{
+	puts("No arch specific dcache_print_stats available!\n");
+}
+
+int __weak dcache_calibrate(void)
+{
+	puts("No arch specific dcache_calibrate available!\n");
+	return -1;
+}
+
 int do_dcache(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	switch (argc) {
+	case 3:			/* stats reset */
+		if (parse_argv(argv[1]) != 3 || strcmp(argv[2], "reset"))
+			return CMD_RET_USAGE;
+		dcache_print_stats(1);
+		break;
 	case 2:			/* on / off */
 		switch (parse_argv(argv[1])) {
 		case 0:
@@ -66,6 +82,13 @@ int do_dcache(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		case 2:
 			flush_dcache_all();
 			break;
+		case 3:
+			dcache_print_stats(0);
+			break;
+		case 4:
+			if (dcache_calibrate())
+				return CMD_RET_FAILURE;
+			break;
 		}
 		break;
 	case 1:			/* get status */
@@ -80,7 +103,11 @@ int do_dcache(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 static int parse_argv(const char *s)
 {
-	if (strcmp(s, "flush") == 0)
+	if (strcmp(s, "calibrate") == 0)
+		return 4;
+	else if (strcmp(s, "stats") == 0)
+		return 3;
+	else if (strcmp(s, "flush") == 0)
 		return 2;
 	else if (strcmp(s, "on") == 0)
 		return 1;
@@ -99,8 +126,12 @@ U_BOOT_CMD(
 );
 
 U_BOOT_CMD(
-	dcache,   2,   1,     do_dcache,
+	dcache,   3,   1,     do_dcache,
 	"enable or disable data cache",
 	"[on, off, flush]\n"
-	"    - enable, disable, or flush data (writethrough) cache"
+	"    - enable, disable, or flush data (writethrough) cache\n"
+	"dcache stats [reset]\n"
+	"    - show (and reset) cache maintenance statistics\n"
+	"dcache calibrate\n"
+	"    - measure the range size above which the whole cache is flushed"
 );
@@ -124,6 +124,7 @@ int do_bootelf(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		addr = load_elf_image_shdr(addr);
 
 	printf("## Starting application at 0x%08lx ...\n", addr);
+	net_quiesce();
 
 	/*
 	 * pass address parameter as argv[0] (aka command name),
@@ -261,6 +262,7 @@ int do_bootvx(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	printf("## Using bootline (@ 0x%lx): %s\n", bootaddr,
 			(char *) bootaddr);
 	printf("## Starting vxWorks at 0x%08lx ...\n", addr);
+	net_quiesce();
 
 	dcache_disable();
 	((void (*)(int)) addr) (0);
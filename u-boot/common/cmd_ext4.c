@@ -37,6 +37,7 @@
 #include <linux/stat.h>
 #include <malloc.h>
 #include <fs.h>
+#include <asm/io.h>
 
 #if defined(CONFIG_CMD_USB) && defined(CONFIG_USB_STORAGE)
 #include <usb.h>
@@ -61,6 +62,7 @@ int do_ext4_write(cmd_tbl_t *cmdtp, int flag, int argc,
 	int dev, part;
 	unsigned long ram_address;
 	unsigned long file_size;
+	unsigned char *buf;
 	disk_partition_t info;
 	block_dev_desc_t *dev_desc;
 
@@ -92,10 +94,13 @@ int do_ext4_write(cmd_tbl_t *cmdtp, int flag, int argc,
 	}
 
 	/* start write */
-	if (ext4fs_write(filename, (unsigned char *)ram_address, file_size)) {
+	buf = map_sysmem(ram_address, file_size);
+	if (ext4fs_write(filename, buf, file_size)) {
 		printf("** Error ext4fs_write() **\n");
+		unmap_sysmem(buf);
 		goto fail;
 	}
+	unmap_sysmem(buf);
 	ext4fs_close();
 
 	return 0;
@@ -16,6 +16,7 @@
 #include <part.h>
 #include <fat.h>
 #include <fs.h>
+#include <asm/io.h>
 
 int do_fat_fsload (cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
@@ -90,6 +91,7 @@ static int do_fat_fswrite(cmd_tbl_t *cmdtp, int flag,
 	long size;
 	unsigned long addr;
 	unsigned long count;
+	void *buf;
 	block_dev_desc_t *dev_desc = NULL;
 	disk_partition_t info;
 	int dev = 0;
@@ -112,7 +114,9 @@ static int do_fat_fswrite(cmd_tbl_t *cmdtp, int flag,
 	addr = simple_strtoul(argv[3], NULL, 16);
 	count = simple_strtoul(argv[5], NULL, 16);
 
-	size = file_fat_write(argv[4], (void *)addr, count);
+	buf = map_sysmem(addr, count);
+	size = file_fat_write(argv[4], buf, count);
+	unmap_sysmem(buf);
 	if (size == -1) {
 		printf("\n** Unable to write \"%s\" from %s %d:%d **\n",
 			argv[4], argv[1], dev, part);
@@ -121,6 +125,10 @@ static int do_fat_fswrite(cmd_tbl_t *cmdtp, int flag,
 
 	printf("%ld bytes written\n", size);
 
+	/* The disk filled up and the file was truncated */
+	if (size < count)
+		return 1;
+
 	return 0;
 }
 
@@ -51,3 +51,32 @@ U_BOOT_CMD(
 	"    - List files in directory 'directory' of partition 'part' on\n"
 	"      device type 'interface' instance 'dev'."
 );
+
+#ifdef CONFIG_FS_DENTRY_CACHE
+static int do_dentries(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char * const argv[])
+{
+	if (argc > 2)
+		return CMD_RET_USAGE;
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "flush"))
+			return CMD_RET_USAGE;
+		dentry_cache_invalidate(NULL);
+		dentry_cache_reset_stats();
+		return 0;
+	}
+	dentry_cache_show();
+
+	return 0;
+}
+
+U_BOOT_CMD(
+	dentries,	2,	1,	do_dentries,
+	"show or flush the filesystem directory lookup cache",
+	"\n"
+	"    - show how full the cache is, and its hits since the last flush\n"
+	"dentries flush\n"
+	"    - drop all entries and reset the statistics"
+);
+#endif
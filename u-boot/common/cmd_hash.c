@@ -41,18 +41,20 @@ static int do_hash(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 #ifdef CONFIG_HASH_VERIFY
 U_BOOT_CMD(
-	hash,	6,	1,	do_hash,
+	hash,	6 + HASH_STREAM_MAXARGS,	1,	do_hash,
 	"compute hash message digest",
 	"algorithm address count [[*]sum_dest]\n"
 		"    - compute message digest [save to env var / *address]\n"
 	"hash -v algorithm address count [*]sum\n"
 		"    - verify hash of memory area with env var / *address"
+	HASH_STREAM_HELP
 );
 #else
 U_BOOT_CMD(
-	hash,	5,	1,	do_hash,
+	hash,	5 + HASH_STREAM_MAXARGS,	1,	do_hash,
 	"compute message digest",
 	"algorithm address count [[*]sum_dest]\n"
 		"    - compute message digest [save to env var / *address]"
+	HASH_STREAM_HELP
 );
 #endif
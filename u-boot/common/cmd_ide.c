@@ -13,6 +13,7 @@
 #include <config.h>
 #include <watchdog.h>
 #include <command.h>
+#include <fs.h>
 #include <image.h>
 #include <asm/byteorder.h>
 #include <asm/io.h>
@@ -231,6 +232,7 @@ int do_ide(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
 				curr_device, blk, cnt);
 #endif
 			n = ide_write(curr_device, blk, cnt, (ulong *) addr);
+			fs_invalidate_dev(&ide_dev_desc[curr_device]);
 
 			printf("%ld blocks written: %s\n",
 				n, (n == cnt) ? "OK" : "ERROR");
@@ -1172,18 +1172,20 @@ U_BOOT_CMD(
 #ifndef CONFIG_CRC32_VERIFY
 
 U_BOOT_CMD(
-	crc32,	4,	1,	do_mem_crc,
+	crc32,	4 + HASH_STREAM_MAXARGS,	1,	do_mem_crc,
 	"checksum calculation",
 	"address count [addr]\n    - compute CRC32 checksum [save at addr]"
+	HASH_STREAM_HELP
 );
 
 #else	/* CONFIG_CRC32_VERIFY */
 
 U_BOOT_CMD(
-	crc32,	5,	1,	do_mem_crc,
+	crc32,	5 + HASH_STREAM_MAXARGS,	1,	do_mem_crc,
 	"checksum calculation",
 	"address count [addr]\n    - compute CRC32 checksum [save at addr]\n"
 	"-v address count crc\n    - verify crc of memory area"
+	HASH_STREAM_HELP
 );
 
 #endif	/* CONFIG_CRC32_VERIFY */
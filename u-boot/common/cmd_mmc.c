@@ -7,6 +7,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <fs.h>
 #include <mmc.h>
 
 static int curr_device = -1;
@@ -396,6 +397,9 @@ static int do_mmcops(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		default:
 			BUG();
 		}
+		/* Filesystems on it may have been changed */
+		if (state != MMC_READ)
+			fs_invalidate_dev(&mmc->block_dev);
 
 		printf("%d blocks %s: %s\n",
 				n, argv[1], (n == cnt) ? "OK" : "ERROR");
@@ -25,21 +25,62 @@ U_BOOT_CMD(
 	"[loadAddress] [[hostIPaddr:]bootfilename]"
 );
 
+#ifdef CONFIG_TFTP_MULTI
+/* Load addr:file pairs, all at once */
+static int tftpb_multi(int argc, char * const argv[])
+{
+	struct tftp_multi_file files[TFTP_MULTI_MAX];
+	int i, count = argc / 2;
+
+	if (count > TFTP_MULTI_MAX) {
+		printf("At most %d files at once\n", TFTP_MULTI_MAX);
+		return CMD_RET_FAILURE;
+	}
+	for (i = 0; i < count; i++) {
+		files[i].addr = simple_strtoul(argv[2 * i], NULL, 16);
+		files[i].name = argv[2 * i + 1];
+	}
+
+	if (tftp_multi(files, count) < 0)
+		return CMD_RET_FAILURE;
+
+	for (i = 0; i < count; i++)
+		flush_cache(files[i].addr, files[i].size);
+
+	return CMD_RET_SUCCESS;
+}
+#endif
+
 int do_tftpb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	int ret;
 
 	bootstage_mark_name(BOOTSTAGE_KERNELREAD_START, "tftp_start");
+#ifdef CONFIG_TFTP_MULTI
+	if (argc >= 5 && argc % 2)
+		ret = tftpb_multi(argc - 1, argv + 1);
+	else
+#endif
 	ret = netboot_common(TFTPGET, cmdtp, argc, argv);
 	bootstage_mark_name(BOOTSTAGE_KERNELREAD_STOP, "tftp_done");
 	return ret;
 }
 
+#ifdef CONFIG_TFTP_MULTI
+U_BOOT_CMD(
+	tftpboot,	1 + 2 * TFTP_MULTI_MAX,	1,	do_tftpb,
+	"boot image via network using TFTP protocol",
+	"[loadAddress] [[hostIPaddr:]bootfilename]\n"
+	"tftpboot addr1 file1 addr2 file2 ...\n"
+	"    - load several files from the server at once"
+);
+#else
 U_BOOT_CMD(
 	tftpboot,	3,	1,	do_tftpb,
 	"boot image via network using TFTP protocol",
 	"[loadAddress] [[hostIPaddr:]bootfilename]"
 );
+#endif
 
 #ifdef CONFIG_CMD_TFTPPUT
 int do_tftpput(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
@@ -73,6 +114,39 @@ U_BOOT_CMD(
 );
 #endif
 
+#ifdef CONFIG_CMD_UDP_FLASH
+static int do_udpflash(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char * const argv[])
+{
+	if (argc > 1)
+		load_addr = simple_strtoul(argv[1], NULL, 16);
+	if (NetLoop(UDPFLASH) < 0)
+		return CMD_RET_FAILURE;
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	udpflash,	2,	1,	do_udpflash,
+	"take download, flash and erase commands from tools/udpflash",
+	"[loadAddress]\n"
+	"Wait for the host tool and carry out its commands until it sends\n"
+	"'continue' or Ctrl-C is pressed. Downloads go to loadAddress."
+);
+#endif
+
+#ifdef CONFIG_CMD_WGET
+static int do_wget(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	return netboot_common(WGET, cmdtp, argc, argv);
+}
+
+U_BOOT_CMD(
+	wget,	3,	1,	do_wget,
+	"boot image via network using HTTP protocol",
+	"[loadAddress] [[hostIPaddr:]path]"
+);
+#endif
 
 #ifdef CONFIG_CMD_RARP
 int do_rarpb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
@@ -415,6 +489,64 @@ U_BOOT_CMD(
 
 #endif	/* CONFIG_CMD_DNS */
 
+static int do_net(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	if (argc == 2 && !strcmp(argv[1], "down")) {
+		net_down();
+		return 0;
+	}
+#ifdef CONFIG_NET_STATS
+	if (argc >= 2 && !strcmp(argv[1], "stats")) {
+		if (argc == 2) {
+			net_stats_print();
+			return 0;
+		}
+		if (argc == 3 && !strcmp(argv[2], "reset")) {
+			net_stats_reset();
+			return 0;
+		}
+	}
+#endif
+
+	return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(
+	net,	3,	1,	do_net,
+	"network device control",
+	"down\n"
+	"    - halt the network device and forget ARP entries"
+#ifdef CONFIG_NET_STATS
+	"\nnet stats [reset]\n"
+	"    - show or clear the packet counters"
+#endif
+);
+
+#if defined(CONFIG_CMD_ARP)
+static int do_arp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	if (argc == 1) {
+		arp_cache_print();
+		return 0;
+	}
+	if (argc != 2 || strcmp(argv[1], "flush"))
+		return CMD_RET_USAGE;
+
+	arp_cache_flush();
+
+	return 0;
+}
+
+U_BOOT_CMD(
+	arp,	2,	1,	do_arp,
+	"show or flush the ARP cache",
+	"\n"
+	"    - show remembered ethernet addresses and their time to live\n"
+	"arp flush\n"
+	"    - forget all remembered addresses"
+);
+#endif	/* CONFIG_CMD_ARP */
+
 #if defined(CONFIG_CMD_LINK_LOCAL)
 static int do_link_local(cmd_tbl_t *cmdtp, int flag, int argc,
 			char * const argv[])
@@ -90,8 +90,9 @@ static int env_print(char *name, int flag)
 		hsearch_r(e, FIND, &ep, &env_htab, flag);
 		if (ep == NULL)
 			return 0;
-		len = printf("%s=%s\n", ep->key, ep->data);
-		return len;
+		/* printf() returns 0 if the binary log takes the output */
+		printf("%s=%s\n", ep->key, ep->data);
+		return strlen(ep->key) + strlen(ep->data) + 2;
 	}
 
 	/* print whole list */
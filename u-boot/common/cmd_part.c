@@ -20,12 +20,21 @@
 #include <config.h>
 #include <command.h>
 #include <part.h>
+#include <malloc.h>
 #include <vsprintf.h>
+#include <asm/io.h>
 
 #ifndef CONFIG_PARTITION_UUIDS
 #error CONFIG_PARTITION_UUIDS must be enabled for CONFIG_CMD_PART to be enabled
 #endif
 
+/*
+ * Bytes passed to each block_read() by part load. The drivers split this
+ * into transfers of the most blocks the controller takes (b_max for MMC),
+ * so only checking for Ctrl-C and the watchdog happen in between.
+ */
+#define PART_LOAD_CHUNK		(8 << 20)
+
 int do_part_uuid(int argc, char * const argv[])
 {
 	int part;
@@ -66,6 +75,96 @@ int do_part_list(int argc, char * const argv[])
 	return 0;
 }
 
+/*
+ * part load <interface> <dev> <name> <addr> [offset] [size]
+ *
+ * Whole blocks are read straight to addr; only a partial last block goes
+ * through a bounce buffer, so nothing past addr + size is written.
+ */
+int do_part_load(int argc, char * const argv[])
+{
+	block_dev_desc_t *dev_desc;
+	disk_partition_t info;
+	ulong addr, offset = 0, size = 0;
+	ulong blksz, time;
+	u64 part_bytes;
+	lbaint_t start, count, per_read;
+	int ret = 0;
+	char *buf;
+	void *tail;
+
+	if (argc < 4 || argc > 6)
+		return CMD_RET_USAGE;
+
+	if (get_device(argv[0], argv[1], &dev_desc) < 0)
+		return 1;
+	if (get_partition_info_by_name_or_num(dev_desc, argv[2], &info) < 0)
+		return 1;
+
+	addr = simple_strtoul(argv[3], NULL, 16);
+	if (argc > 4)
+		offset = simple_strtoul(argv[4], NULL, 16);
+	if (argc > 5)
+		size = simple_strtoul(argv[5], NULL, 16);
+
+	blksz = dev_desc->blksz;
+	part_bytes = (u64)info.size * blksz;
+	if (offset % blksz) {
+		printf("** Offset must be a multiple of %lu bytes **\n", blksz);
+		return 1;
+	}
+	if (offset >= part_bytes || size > part_bytes - offset) {
+		puts("** Read outside partition **\n");
+		return 1;
+	}
+	if (!size) {
+		if (part_bytes - offset > (ulong)~0UL) {
+			puts("** Partition too large, give a size **\n");
+			return 1;
+		}
+		size = part_bytes - offset;
+	}
+
+	start = info.start + offset / blksz;
+	count = size / blksz;
+	per_read = max(PART_LOAD_CHUNK / blksz, 1UL);
+	buf = map_sysmem(addr, size);
+
+	time = get_timer(0);
+	ret = dev_read_blocks(dev_desc, start, count, per_read, buf, NULL,
+			      NULL);
+	if (!ret && size % blksz) {
+		tail = memalign(ARCH_DMA_MINALIGN, blksz);
+		if (!tail) {
+			ret = -1;
+		} else {
+			ret = dev_read_blocks(dev_desc, start + count, 1, 1,
+					      tail, NULL, NULL);
+			if (!ret)
+				memcpy(buf + count * blksz, tail, size % blksz);
+			free(tail);
+		}
+	}
+	time = get_timer(time);
+	unmap_sysmem(buf);
+	if (ret)
+		return 1;
+
+	printf("%lu bytes read in %lu ms", size, time);
+	if (time > 0) {
+		puts(" (");
+		print_size(size / time * 1000, "/s");
+		puts(")");
+	}
+	puts("\n");
+
+	/* So that bootm and friends find the image without an address */
+	load_addr = addr;
+	setenv_hex("filesize", size);
+
+	return 0;
+}
+
 int do_part(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	if (argc < 2)
@@ -75,17 +174,22 @@ int do_part(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		return do_part_uuid(argc - 2, argv + 2);
 	else if (!strcmp(argv[1], "list"))
 		return do_part_list(argc - 2, argv + 2);
+	else if (!strcmp(argv[1], "load"))
+		return do_part_load(argc - 2, argv + 2);
 
 	return CMD_RET_USAGE;
 }
 
 U_BOOT_CMD(
-	part,	5,	1,	do_part,
+	part,	8,	1,	do_part,
 	"disk partition related commands",
 	"uuid <interface> <dev>:<part>\n"
 	"    - print partition UUID\n"
 	"part uuid <interface> <dev>:<part> <varname>\n"
 	"    - set environment variable to partition UUID\n"
 	"part list <interface> <dev>\n"
-	"    - print a device's partition table"
+	"    - print a device's partition table\n"
+	"part load <interface> <dev> <name> <addr> [offset] [size]\n"
+	"    - read 'size' bytes (default: up to the end) starting 'offset'\n"
+	"      bytes into the partition called (or numbered) <name> to <addr>"
 );
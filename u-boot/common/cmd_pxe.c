@@ -319,6 +319,156 @@ static int pxe_ipaddr_paths(void *pxefile_addr_r)
 	return -ENOENT;
 }
 
+#ifdef CONFIG_TFTP_PROBE
+#ifndef CONFIG_PXE_MISS_TTL
+/* Seconds for which a config file the server lacks is not asked for */
+#define PXE_MISS_TTL	600
+#else
+#define PXE_MISS_TTL	CONFIG_PXE_MISS_TTL
+#endif
+
+#define PXE_MISS_ENTRIES	16
+
+/*
+ * Config files the server said it does not have, by crc32 of the path.
+ * This lives in RAM only, so it is empty again after a reset.
+ */
+static struct pxe_miss {
+	IPaddr_t server;		/* 0 if unused */
+	u32 crc;
+	ulong time;
+} pxe_miss[PXE_MISS_ENTRIES];
+
+static struct pxe_miss *pxe_miss_find(IPaddr_t server, u32 crc)
+{
+	struct pxe_miss *miss;
+	int i;
+
+	for (i = 0, miss = pxe_miss; i < PXE_MISS_ENTRIES; i++, miss++) {
+		if (miss->server != server || miss->crc != crc)
+			continue;
+		if (get_timer(miss->time) > PXE_MISS_TTL * CONFIG_SYS_HZ) {
+			miss->server = 0;
+			return NULL;
+		}
+		return miss;
+	}
+
+	return NULL;
+}
+
+static void pxe_miss_add(IPaddr_t server, u32 crc)
+{
+	struct pxe_miss *miss, *oldest = pxe_miss;
+	int i;
+
+	for (i = 0, miss = pxe_miss; i < PXE_MISS_ENTRIES; i++, miss++) {
+		if (!miss->server || (miss->server == server &&
+				      miss->crc == crc)) {
+			oldest = miss;
+			break;
+		}
+		if (miss->time < oldest->time)
+			oldest = miss;
+	}
+	oldest->server = server;
+	oldest->crc = crc;
+	oldest->time = get_timer(0);
+}
+
+struct pxe_probe {
+	char prefix[MAX_TFTP_PATH_LEN + 1];	/* bootfile path + dir */
+	char path[TFTP_PROBE_MAX][MAX_TFTP_PATH_LEN + 1];
+	const char *names[TFTP_PROBE_MAX];
+	u32 crc[TFTP_PROBE_MAX];
+	int count;
+	IPaddr_t server;
+};
+
+/* Add a candidate config file, unless the server is known to lack it */
+static void pxe_probe_add(struct pxe_probe *probe, const char *file)
+{
+	char *path = probe->path[probe->count];
+	u32 crc;
+
+	if (probe->count == TFTP_PROBE_MAX)
+		return;
+	if (strlen(probe->prefix) + strlen(file) > MAX_TFTP_PATH_LEN) {
+		printf("path (%s%s) too long, skipping\n", probe->prefix, file);
+		return;
+	}
+	sprintf(path, "%s%s", probe->prefix, file);
+	crc = crc32(0, (uchar *)path, strlen(path));
+	if (pxe_miss_find(probe->server, crc)) {
+		debug("skipping %s, not on server\n", path);
+		return;
+	}
+	probe->names[probe->count] = path;
+	probe->crc[probe->count] = crc;
+	probe->count++;
+}
+
+/*
+ * Asks for all the config files pxe_uuid_path(), pxe_mac_path(),
+ * pxe_ipaddr_paths() and pxe_default_paths would try, at once, and then
+ * fetches the first one the server has.
+ *
+ * Returns 1 on success, -ETIMEDOUT if the server did not answer for some
+ * files, or another value < 0 on error.
+ */
+static int pxe_probe_paths(void *pxefile_addr_r)
+{
+	struct pxe_probe *probe;
+	u8 result[TFTP_PROBE_MAX];
+	char mac_str[21];
+	char ip_addr[9];
+	char *uuid_str;
+	int i, err;
+
+	probe = malloc(sizeof(*probe));
+	if (!probe)
+		return -ENOMEM;
+	probe->count = 0;
+	probe->server = getenv_IPaddr("serverip");
+
+	err = get_bootfile_path(PXELINUX_DIR, probe->prefix,
+				sizeof(probe->prefix));
+	if (err < 0)
+		goto out;
+	if (strlen(probe->prefix) + strlen(PXELINUX_DIR) > MAX_TFTP_PATH_LEN) {
+		err = -ENAMETOOLONG;
+		goto out;
+	}
+	strcat(probe->prefix, PXELINUX_DIR);
+
+	uuid_str = getenv("pxeuuid");
+	if (uuid_str)
+		pxe_probe_add(probe, uuid_str);
+	if (format_mac_pxe(mac_str, sizeof(mac_str)) > 0)
+		pxe_probe_add(probe, mac_str);
+	sprintf(ip_addr, "%08X", ntohl(NetOurIP));
+	for (i = 7; i >= 0; i--) {
+		pxe_probe_add(probe, ip_addr);
+		ip_addr[i] = '\0';
+	}
+	for (i = 0; pxe_default_paths[i]; i++)
+		pxe_probe_add(probe, pxe_default_paths[i]);
+
+	err = tftp_probe(probe->names, probe->count, result);
+	for (i = 0; i < probe->count; i++) {
+		if (result[i] == TFTP_PROBE_MISSING)
+			pxe_miss_add(probe->server, probe->crc[i]);
+	}
+	if (err >= 0)
+		err = get_pxelinux_path(probe->names[err] +
+					strlen(probe->prefix), pxefile_addr_r);
+out:
+	free(probe);
+
+	return err;
+}
+#endif /* CONFIG_TFTP_PROBE */
+
 /*
  * Entry point for the 'pxe get' command.
  * This Follows pxelinux's rules to download a config file from a tftp server.
@@ -355,6 +505,19 @@ do_pxe_get(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	if (err < 0)
 		return 1;
 
+#ifdef CONFIG_TFTP_PROBE
+	err = pxe_probe_paths((void *)pxefile_addr_r);
+	if (err > 0) {
+		printf("Config file found\n");
+		return 0;
+	}
+	if (err != -ETIMEDOUT) {
+		printf("Config file not found\n");
+		return 1;
+	}
+	/* The server did not answer for some files, ask one at a time */
+#endif
+
 	/*
 	 * Keep trying paths until we successfully get a file we're looking
 	 * for.
@@ -6,6 +6,7 @@
 
 #include <common.h>
 #include <fs.h>
+#include <part.h>
 
 static int do_sandbox_load(cmd_tbl_t *cmdtp, int flag, int argc,
 			   char * const argv[])
@@ -25,10 +26,38 @@ static int do_sandbox_save(cmd_tbl_t *cmdtp, int flag, int argc,
 	return do_save(cmdtp, flag, argc, argv, FS_TYPE_SANDBOX, 16);
 }
 
+#ifdef CONFIG_SANDBOX_BLOCK
+static int do_sandbox_bind(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	int dev;
+
+	if (argc < 2 || argc > 3)
+		return CMD_RET_USAGE;
+	dev = simple_strtoul(argv[1], NULL, 10);
+	if (host_dev_bind(dev, argc == 3 ? argv[2] : NULL))
+		return CMD_RET_FAILURE;
+
+	return 0;
+}
+
+static int do_sandbox_info(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	host_dev_show();
+
+	return 0;
+}
+#endif
+
 static cmd_tbl_t cmd_sandbox_sub[] = {
 	U_BOOT_CMD_MKENT(load, 7, 0, do_sandbox_load, "", ""),
 	U_BOOT_CMD_MKENT(ls, 3, 0, do_sandbox_ls, "", ""),
 	U_BOOT_CMD_MKENT(save, 6, 0, do_sandbox_save, "", ""),
+#ifdef CONFIG_SANDBOX_BLOCK
+	U_BOOT_CMD_MKENT(bind, 3, 0, do_sandbox_bind, "", ""),
+	U_BOOT_CMD_MKENT(info, 1, 0, do_sandbox_info, "", ""),
+#endif
 };
 
 static int do_sandbox(cmd_tbl_t *cmdtp, int flag, int argc,
@@ -57,4 +86,12 @@ U_BOOT_CMD(
 	"sb ls host <filename>                      - list files on host\n"
 	"sb save host <dev> <filename> <addr> <bytes> [<offset>] - "
 		"save a file to host\n"
+#ifdef CONFIG_SANDBOX_BLOCK
+	"sb bind <dev> [<filename>]                 - "
+		"make a host file block device 'hostfile <dev>'\n"
+	"sb info                                    - show host file block "
+		"devices and\n"
+	"                                             blocks read/written "
+		"since last shown\n"
+#endif
 );
@@ -12,6 +12,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <fs.h>
 #include <part.h>
 #include <sata.h>
 
@@ -169,6 +170,7 @@ static int do_sata(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 				sata_curr_device, blk, cnt);
 
 			n = sata_write(sata_curr_device, blk, cnt, (u32 *)addr);
+			fs_invalidate_dev(&sata_dev_desc[sata_curr_device]);
 
 			printf("%ld blocks written: %s\n",
 				n, (n == cnt) ? "OK" : "ERROR");
@@ -10,6 +10,7 @@
  */
 #include <common.h>
 #include <command.h>
+#include <fs.h>
 #include <asm/processor.h>
 #include <scsi.h>
 #include <image.h>
@@ -340,6 +341,7 @@ int do_scsi (cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 				       scsi_curr_dev, blk, cnt);
 				n = scsi_write(scsi_curr_dev, blk, cnt,
 					       (ulong *)addr);
+				fs_invalidate_dev(&scsi_dev_desc[scsi_curr_dev]);
 				printf("%ld blocks written: %s\n", n,
 				       (n == cnt) ? "OK" : "ERROR");
 				return 0;
@@ -37,18 +37,20 @@ int do_sha1sum(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 #ifdef CONFIG_SHA1SUM_VERIFY
 U_BOOT_CMD(
-	sha1sum,	5,	1,	do_sha1sum,
+	sha1sum,	5 + HASH_STREAM_MAXARGS,	1,	do_sha1sum,
 	"compute SHA1 message digest",
 	"address count [[*]sum]\n"
 		"    - compute SHA1 message digest [save to sum]\n"
 	"sha1sum -v address count [*]sum\n"
 		"    - verify sha1sum of memory area"
+	HASH_STREAM_HELP
 );
 #else
 U_BOOT_CMD(
-	sha1sum,	4,	1,	do_sha1sum,
+	sha1sum,	4 + HASH_STREAM_MAXARGS,	1,	do_sha1sum,
 	"compute SHA1 message digest",
 	"address count [[*]sum]\n"
 		"    - compute SHA1 message digest [save to sum]"
+	HASH_STREAM_HELP
 );
 #endif
@@ -0,0 +1,64 @@
+/*
+ * SquashFS commands
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <fs.h>
+#include <squashfs.h>
+
+static int do_sqfs_load(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	return do_load(cmdtp, flag, argc, argv, FS_TYPE_SQUASHFS, 16);
+}
+
+U_BOOT_CMD(
+	sqfsload,	7,	0,	do_sqfs_load,
+	"load binary file from a SquashFS filesystem",
+	"<interface> [<dev[:part]>] <addr> <filename> [bytes [pos]]\n"
+	"    - Load binary file 'filename' from 'dev' on 'interface'\n"
+	"      to address 'addr' from SquashFS filesystem.\n"
+	"      'pos' gives the file position to start loading from.\n"
+	"      If 'pos' is omitted, 0 is used. 'pos' requires 'bytes'.\n"
+	"      'bytes' gives the size to load. If 'bytes' is 0 or omitted,\n"
+	"      the load stops on end of file.\n"
+	"      All numeric parameters are assumed to be hex."
+);
+
+static int do_sqfs_ls(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	return do_ls(cmdtp, flag, argc, argv, FS_TYPE_SQUASHFS);
+}
+
+U_BOOT_CMD(
+	sqfsls,	4,	1,	do_sqfs_ls,
+	"list files in a directory (default /)",
+	"<interface> [<dev[:part]>] [directory]\n"
+	"    - list files from 'dev' on 'interface' in a 'directory'"
+);
+
+static int do_sqfs_info(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	if (argc < 2 || argc > 3)
+		return CMD_RET_USAGE;
+
+	if (fs_set_blk_dev(argv[1], argc == 3 ? argv[2] : NULL,
+			   FS_TYPE_SQUASHFS))
+		return 1;
+	sqfs_info();
+
+	return 0;
+}
+
+U_BOOT_CMD(
+	sqfsinfo,	3,	1,	do_sqfs_info,
+	"print information about a SquashFS filesystem",
+	"<interface> [<dev[:part]>]\n"
+	"    - print information about the SquashFS filesystem on 'dev'\n"
+	"      on 'interface', and how its caches are doing"
+);
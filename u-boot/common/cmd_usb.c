@@ -12,6 +12,7 @@
 #include <command.h>
 #include <asm/byteorder.h>
 #include <asm/unaligned.h>
+#include <fs.h>
 #include <part.h>
 #include <usb.h>
 
@@ -609,6 +610,7 @@ static int do_usb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			stor_dev = usb_stor_get_dev(usb_stor_curr_dev);
 			n = stor_dev->block_write(usb_stor_curr_dev, blk, cnt,
 						(ulong *)addr);
+			fs_invalidate_dev(stor_dev);
 			printf("%ld blocks write: %s\n", n,
 				(n == cnt) ? "OK" : "ERROR");
 			if (n == cnt)
@@ -28,7 +28,7 @@ extern void cmd_yaffs_dev_ls(void);
 extern void cmd_yaffs_tracemask(unsigned set, unsigned mask);
 extern void cmd_yaffs_devconfig(char *mp, int flash_dev,
 				int start_block, int end_block);
-extern void cmd_yaffs_mount(char *mp);
+extern void cmd_yaffs_mount(char *mp, int read_only);
 extern void cmd_yaffs_umount(char *mp);
 extern void cmd_yaffs_read_file(char *fn);
 extern void cmd_yaffs_write_file(char *fn, char bval, int sizeOfFile);
@@ -89,15 +89,15 @@ int do_ymount(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
 {
 	char *mtpoint;
 
-	if (argc != 2) {
-		printf("Bad arguments: ymount mount_pt\n");
+	if (argc < 2 || argc > 3 || (argc == 3 && strcmp(argv[1], "-r"))) {
+		printf("Bad arguments: ymount [-r] mount_pt\n");
 		return -1;
 	}
 
-	mtpoint = argv[1];
+	mtpoint = argv[argc - 1];
 	printf("Mounting yaffs2 mount point %s\n", mtpoint);
 
-	cmd_yaffs_mount(mtpoint);
+	cmd_yaffs_mount(mtpoint, argc > 2);
 
 	return 0;
 }
@@ -290,8 +290,9 @@ U_BOOT_CMD(ydevconfig, 5, 0, do_ydevconfig,
 	   "configure yaffs mount point",
 	   "ydevconfig mtpoint mtd_id start_block end_block   configures a yaffs2 mount point");
 
-U_BOOT_CMD(ymount, 2, 0, do_ymount,
-	   "mount yaffs", "ymount mtpoint  mounts a yaffs2 mount point");
+U_BOOT_CMD(ymount, 3, 0, do_ymount,
+	   "mount yaffs",
+	   "ymount [-r] mtpoint  mounts a yaffs2 mount point, read-only with -r");
 
 U_BOOT_CMD(yumount, 2, 0, do_yumount,
 	   "unmount yaffs", "yunmount mtpoint  unmounts a yaffs2 mount point");
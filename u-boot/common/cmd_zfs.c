@@ -19,6 +19,7 @@
 #include <zfs_common.h>
 #include <linux/stat.h>
 #include <malloc.h>
+#include <asm/io.h>
 
 #if defined(CONFIG_CMD_USB) && defined(CONFIG_USB_STORAGE)
 #include <usb.h>
@@ -40,11 +41,12 @@ static int do_zfs_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]
 	ulong addr = 0;
 	disk_partition_t info;
 	block_dev_desc_t *dev_desc;
-	char buf[12];
 	unsigned long count;
 	const char *addr_str;
 	struct zfs_file zfile;
 	struct device_s vdev;
+	void *buf;
+	uint64_t ret;
 
 	if (argc < 3)
 		return CMD_RET_USAGE;
@@ -102,7 +104,10 @@ static int do_zfs_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]
 	if ((count < zfile.size) && (count != 0))
 		zfile.size = (uint64_t)count;
 
-	if (zfs_read(&zfile, (char *)addr, zfile.size) != zfile.size) {
+	buf = map_sysmem(addr, zfile.size);
+	ret = zfs_read(&zfile, buf, zfile.size);
+	unmap_sysmem(buf);
+	if (ret != zfile.size) {
 		printf("** Unable to read \"%s\" from %s %d:%d **\n",
 			   filename, argv[1], dev, part);
 		zfs_close(&zfile);
@@ -159,6 +164,24 @@ static int do_zfs_ls(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 }
 
 
+static int do_zfs_cache(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	if (argc > 2)
+		return CMD_RET_USAGE;
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "reset"))
+			return CMD_RET_USAGE;
+		zfs_reset_stats();
+		return 0;
+	}
+	zfs_show_stats();
+
+	return 0;
+}
+
+
 U_BOOT_CMD(zfsls, 4, 1, do_zfs_ls,
 		   "list files in a directory (default /)",
 		   "<interface> <dev[:part]> [directory]\n"
@@ -169,3 +192,10 @@ U_BOOT_CMD(zfsload, 6, 0, do_zfs_load,
 		   "<interface> <dev[:part]> [addr] [filename] [bytes]\n"
 		   "	  - load binary file '/DATASET/@/$dir/$file' from 'dev' on 'interface'\n"
 		   "		 to address 'addr' from ZFS filesystem");
+
+U_BOOT_CMD(zfscache, 2, 1, do_zfs_cache,
+		   "show ZFS metadata cache statistics",
+		   "\n"
+		   "	  - show metadata cache hits and the blocks read since the last reset\n"
+		   "zfscache reset\n"
+		   "	  - reset the statistics");
@@ -7,6 +7,7 @@
 
 #include <common.h>
 #include <stdarg.h>
+#include <binlog.h>
 #include <malloc.h>
 #include <serial.h>
 #include <stdio_dev.h>
@@ -461,19 +462,48 @@ void puts(const char *s)
 	}
 }
 
+/*
+ * Record output that would not be displayed right now in the binary log,
+ * which is much cheaper than formatting it. The pre-console buffer still
+ * needs the text, so that it stays in order with puts() output. Returns 0
+ * if printf() has nothing more to do; it then returns 0, as it does when
+ * there is no console, since the length is not known without formatting.
+ */
+static inline int console_binlog(const char *fmt, va_list args)
+{
+	if (gd->have_console && !(gd->flags & GD_FLG_SILENT))
+		return -1;
+
+	if (binlog_console(fmt, args))
+		return -1;
+
+#ifdef CONFIG_PRE_CONSOLE_BUFFER
+	if (!gd->have_console)
+		return -1;
+#endif
+
+	return 0;
+}
+
 int printf(const char *fmt, ...)
 {
 	va_list args;
 	uint i;
 	char printbuffer[CONFIG_SYS_PBSIZE];
 
+	va_start(args, fmt);
+	if (!console_binlog(fmt, args)) {
+		va_end(args);
+		return 0;
+	}
+
 #ifndef CONFIG_PRE_CONSOLE_BUFFER
-	if (!gd->have_console)
+	if (!gd->have_console) {
+		va_end(args);
 		return 0;
+	}
 #endif
 
-	va_start(args, fmt);
-
 	/* For this to work, printbuffer must be larger than
 	 * anything we ever want to print.
 	 */
@@ -490,6 +520,9 @@ int vprintf(const char *fmt, va_list args)
 	uint i;
 	char printbuffer[CONFIG_SYS_PBSIZE];
 
+	if (!console_binlog(fmt, args))
+		return 0;
+
 #ifndef CONFIG_PRE_CONSOLE_BUFFER
 	if (!gd->have_console)
 		return 0;
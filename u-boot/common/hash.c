@@ -12,13 +12,128 @@
 
 #include <common.h>
 #include <command.h>
+#include <div64.h>
 #include <hw_sha.h>
 #include <hash.h>
 #include <sha1.h>
 #include <sha256.h>
+#include <fs.h>
+#include <malloc.h>
+#include <part.h>
+#include <watchdog.h>
 #include <asm/io.h>
 #include <asm/errno.h>
 
+#ifdef CONFIG_HASH_STREAM
+#ifndef CONFIG_HASH_STREAM_BUF_SIZE
+#define CONFIG_HASH_STREAM_BUF_SIZE	(128 << 10)
+#endif
+
+#ifdef CONFIG_CMD_SHA1SUM
+static int hash_init_sha1(struct hash_algo *algo, void **ctxp)
+{
+	sha1_context *ctx = malloc(sizeof(sha1_context));
+
+	if (!ctx)
+		return -ENOMEM;
+	sha1_starts(ctx);
+	*ctxp = ctx;
+	return 0;
+}
+
+static int hash_update_sha1(struct hash_algo *algo, void *ctx,
+			    const void *buf, unsigned int size, int is_last)
+{
+	sha1_update((sha1_context *)ctx, buf, size);
+	return 0;
+}
+
+static int hash_finish_sha1(struct hash_algo *algo, void *ctx,
+			    void *dest_buf, int size)
+{
+	int ret = -ENOSPC;
+
+	if (size >= algo->digest_size) {
+		sha1_finish((sha1_context *)ctx, dest_buf);
+		ret = 0;
+	}
+	free(ctx);
+	return ret;
+}
+#endif
+
+#ifdef CONFIG_SHA256
+static int hash_init_sha256(struct hash_algo *algo, void **ctxp)
+{
+	sha256_context *ctx = malloc(sizeof(sha256_context));
+
+	if (!ctx)
+		return -ENOMEM;
+	sha256_starts(ctx);
+	*ctxp = ctx;
+	return 0;
+}
+
+static int hash_update_sha256(struct hash_algo *algo, void *ctx,
+			      const void *buf, unsigned int size, int is_last)
+{
+	sha256_update((sha256_context *)ctx, buf, size);
+	return 0;
+}
+
+static int hash_finish_sha256(struct hash_algo *algo, void *ctx,
+			      void *dest_buf, int size)
+{
+	int ret = -ENOSPC;
+
+	if (size >= algo->digest_size) {
+		sha256_finish((sha256_context *)ctx, dest_buf);
+		ret = 0;
+	}
+	free(ctx);
+	return ret;
+}
+#endif
+
+static int hash_init_crc32(struct hash_algo *algo, void **ctxp)
+{
+	uint32_t *ctx = malloc(sizeof(uint32_t));
+
+	if (!ctx)
+		return -ENOMEM;
+	*ctx = 0;
+	*ctxp = ctx;
+	return 0;
+}
+
+static int hash_update_crc32(struct hash_algo *algo, void *ctx,
+			     const void *buf, unsigned int size, int is_last)
+{
+	*(uint32_t *)ctx = crc32(*(uint32_t *)ctx, buf, size);
+	return 0;
+}
+
+static int hash_finish_crc32(struct hash_algo *algo, void *ctx,
+			     void *dest_buf, int size)
+{
+	uint32_t crc = htonl(*(uint32_t *)ctx);
+	int ret = -ENOSPC;
+
+	/* Big endian, as crc32_wd_buf() gives it */
+	if (size >= algo->digest_size) {
+		memcpy(dest_buf, &crc, sizeof(crc));
+		ret = 0;
+	}
+	free(ctx);
+	return ret;
+}
+
+#define HASH_STREAM_OPS(name) \
+	hash_init_##name, hash_update_##name, hash_finish_##name
+#else
+#define HASH_STREAM_OPS(name)	NULL, NULL, NULL
+#endif /* CONFIG_HASH_STREAM */
+
 /*
  * These are the hash algorithms we support. Chips which support accelerated
  * crypto could perhaps add named version of these algorithms here. Note that
@@ -53,6 +168,7 @@ static struct hash_algo hash_algo[] = {
 		SHA1_SUM_LEN,
 		sha1_csum_wd,
 		CHUNKSZ_SHA1,
+		HASH_STREAM_OPS(sha1),
 	},
 #define MULTI_HASH
 #endif
@@ -62,6 +178,7 @@ static struct hash_algo hash_algo[] = {
 		SHA256_SUM_LEN,
 		sha256_csum_wd,
 		CHUNKSZ_SHA256,
+		HASH_STREAM_OPS(sha256),
 	},
 #define MULTI_HASH
 #endif
@@ -70,10 +187,12 @@ static struct hash_algo hash_algo[] = {
 		4,
 		crc32_wd_buf,
 		CHUNKSZ_CRC32,
+		HASH_STREAM_OPS(crc32),
 	},
 };
 
-#if defined(CONFIG_HASH_VERIFY) || defined(CONFIG_CMD_HASH)
+#if defined(CONFIG_HASH_VERIFY) || defined(CONFIG_CMD_HASH) || \
+	defined(CONFIG_HASH_STREAM)
 #define MULTI_HASH
 #endif
 
@@ -146,25 +265,26 @@ static void store_result(struct hash_algo *algo, const u8 *sum,
  *			Otherwise we assume it is an environment variable, and
  *			look up its value (it must contain a hex digest).
  * @vsum:		Returns binary digest value (algo->digest_size bytes)
- * @allow_env_vars:	non-zero to permit storing the result to an environment
- *			variable. If 0 then verify_str is assumed to be an
- *			address, and the * prefix is not expected.
+ * @allow_addr:		non-zero to permit reading the hash from an
+ *			address given with the * prefix. If 0 then verify_str
+ *			is never taken as an address.
  * @return 0 if ok, non-zero on error
  */
 static int parse_verify_sum(struct hash_algo *algo, char *verify_str, u8 *vsum,
-			    int allow_env_vars)
+			    int allow_addr)
 {
-	int env_var = 0;
+	int use_addr = 0;
 
-	/* See comment above in store_result() */
-	if (allow_env_vars) {
-		if (*verify_str == '*')
-			verify_str++;
-		else
-			env_var = 1;
+	/*
+	 * Unlike store_result(), only the * prefix makes this an address:
+	 * crc32 -v, which does not allow env vars, takes the sum itself.
+	 */
+	if (allow_addr && *verify_str == '*') {
+		verify_str++;
+		use_addr = 1;
 	}
 
-	if (env_var) {
+	if (use_addr) {
 		ulong addr;
 		void *buf;
 
@@ -216,16 +336,220 @@ static struct hash_algo *find_hash_algo(const char *name)
 	return NULL;
 }
 
-static void show_hash(struct hash_algo *algo, ulong addr, ulong len,
-		      u8 *output)
+static void show_hash(struct hash_algo *algo, const char *what, u8 *output)
 {
 	int i;
 
-	printf("%s for %08lx ... %08lx ==> ", algo->name, addr, addr + len - 1);
+	printf("%s for %s ==> ", algo->name, what);
 	for (i = 0; i < algo->digest_size; i++)
 		printf("%02x", output[i]);
 }
 
+#ifdef CONFIG_HASH_STREAM
+/* Hardware hashes need the whole buffer at once, so use the software one */
+static struct hash_algo *find_stream_algo(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(hash_algo); i++) {
+		if (!strcmp(name, hash_algo[i].name) && hash_algo[i].hash_init)
+			return &hash_algo[i];
+	}
+
+	return NULL;
+}
+
+static int hash_stream_update(struct hash_algo *algo, void *ctx,
+			      const u8 *buf, unsigned int len)
+{
+	unsigned int chunk;
+	int ret;
+
+	while (len) {
+		chunk = min(len, (unsigned int)algo->chunk_size);
+		ret = algo->hash_update(algo, ctx, buf, chunk, 0);
+		if (ret)
+			return ret;
+		buf += chunk;
+		len -= chunk;
+		WATCHDOG_RESET();
+	}
+
+	return 0;
+}
+
+struct hash_stream_blk {
+	struct hash_algo *algo;
+	void *ctx;
+	ulong blksz;
+	u64 *bytes;
+};
+
+static int hash_stream_piece(void *priv, void *buf, lbaint_t n)
+{
+	struct hash_stream_blk *hs = priv;
+	int ret;
+
+	ret = hash_stream_update(hs->algo, hs->ctx, buf, n * hs->blksz);
+	if (!ret)
+		*hs->bytes += (u64)n * hs->blksz;
+
+	return ret;
+}
+
+static int hash_stream_blocks(struct hash_algo *algo, void *ctx,
+			      block_dev_desc_t *dev_desc, lbaint_t start,
+			      lbaint_t count, void *buf, u64 *bytes)
+{
+	lbaint_t per_read = CONFIG_HASH_STREAM_BUF_SIZE / dev_desc->blksz;
+	struct hash_stream_blk hs = {
+		.algo = algo,
+		.ctx = ctx,
+		.blksz = dev_desc->blksz,
+		.bytes = bytes,
+	};
+
+	if (!per_read || start + count > dev_desc->lba ||
+	    start + count < start) {
+		puts("** Block range outside device **\n");
+		return -ERANGE;
+	}
+
+	return dev_read_blocks(dev_desc, start, count, per_read, buf,
+			       hash_stream_piece, &hs);
+}
+
+static int hash_stream_file(struct hash_algo *algo, void *ctx,
+			    const char *filename, void *buf, u64 *bytes)
+{
+	struct fs_file *file;
+	int len, ret = 0;
+
+	file = fs_open(filename);
+	if (!file) {
+		printf("** File not found %s **\n", filename);
+		return -ENOENT;
+	}
+
+	while ((len = fs_read_handle(file, buf,
+				     CONFIG_HASH_STREAM_BUF_SIZE)) > 0) {
+		ret = hash_stream_update(algo, ctx, buf, len);
+		if (ret)
+			break;
+		*bytes += len;
+		if (ctrlc()) {
+			puts("\nAbort\n");
+			ret = -EINTR;
+			break;
+		}
+	}
+	if (len < 0) {
+		printf("** Error reading %s **\n", filename);
+		ret = -EIO;
+	}
+	fs_close(file);
+
+	return ret;
+}
+
+/*
+ * Hash the block range, partition or file given by argv, reading it a
+ * buffer at a time, and describe what was hashed in "what". Returns the
+ * number of arguments used, -EINVAL if they are not understood, or another
+ * -ve error.
+ */
+static int hash_stream(struct hash_algo *algo, int argc, char * const argv[],
+		       u8 *output, char *what, int what_len)
+{
+	block_dev_desc_t *dev_desc = NULL;
+	disk_partition_t info;
+	lbaint_t start = 0, count = 0;
+	int used, ret;
+	ulong time;
+	u64 bytes = 0;
+	void *ctx;
+	void *buf;
+
+	if (!strcmp(argv[0], "-b"))
+		used = 5;
+	else if (!strcmp(argv[0], "-p") || !strcmp(argv[0], "-f"))
+		used = 4;
+	else
+		return -EINVAL;
+	if (argc < used)
+		return -EINVAL;
+
+	algo = find_stream_algo(algo->name);
+	if (!algo) {
+		puts("Hash cannot be computed in pieces\n");
+		return -EPROTONOSUPPORT;
+	}
+
+	/* Find what to read before the buffers are allocated */
+	switch (argv[0][1]) {
+	case 'b':
+		if (get_device(argv[1], argv[2], &dev_desc) < 0)
+			return -ENODEV;
+		start = simple_strtoul(argv[3], NULL, 16);
+		count = simple_strtoul(argv[4], NULL, 16);
+		snprintf(what, what_len, "%s %s blocks " LBAF " ... " LBAF,
+			 argv[1], argv[2], start, start + count - 1);
+		break;
+	case 'p':
+		if (get_device(argv[1], argv[2], &dev_desc) < 0)
+			return -ENODEV;
+		if (get_partition_info_by_name_or_num(dev_desc, argv[3],
+						      &info) < 0)
+			return -ENOENT;
+		start = info.start;
+		count = info.size;
+		snprintf(what, what_len, "%s %s:%s", argv[1], argv[2],
+			 info.name);
+		break;
+	default:
+		if (fs_set_blk_dev(argv[1], argv[2], FS_TYPE_ANY))
+			return -ENODEV;
+		snprintf(what, what_len, "%s %s %s", argv[1], argv[2],
+			 argv[3]);
+		break;
+	}
+
+	buf = memalign(ARCH_DMA_MINALIGN, CONFIG_HASH_STREAM_BUF_SIZE);
+	if (!buf)
+		return -ENOMEM;
+	ret = algo->hash_init(algo, &ctx);
+	if (ret) {
+		free(buf);
+		return ret;
+	}
+
+	time = get_timer(0);
+	if (argv[0][1] == 'f')
+		ret = hash_stream_file(algo, ctx, argv[3], buf, &bytes);
+	else
+		ret = hash_stream_blocks(algo, ctx, dev_desc, start, count,
+					 buf, &bytes);
+	if (!ret)
+		ret = algo->hash_update(algo, ctx, buf, 0, 1);
+	time = get_timer(time);
+	free(buf);
+	if (algo->hash_finish(algo, ctx, output, HASH_MAX_DIGEST_SIZE) && !ret)
+		ret = -EIO;
+	if (ret)
+		return ret;
+
+	printf("%llu bytes hashed in %lu ms", bytes, time);
+	if (time > 0) {
+		puts(" (");
+		print_size(lldiv(bytes, time) * 1000, "/s");
+		puts(")");
+	}
+	puts("\n");
+
+	return used;
+}
+#endif /* CONFIG_HASH_STREAM */
+
 int hash_block(const char *algo_name, const void *data, unsigned int len,
 	       uint8_t *output, int *output_size)
 {
@@ -256,13 +580,11 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 	if (argc < 2)
 		return CMD_RET_USAGE;
 
-	addr = simple_strtoul(*argv++, NULL, 16);
-	len = simple_strtoul(*argv++, NULL, 16);
-
 	if (multi_hash()) {
 		struct hash_algo *algo;
 		u8 output[HASH_MAX_DIGEST_SIZE];
 		u8 vsum[HASH_MAX_DIGEST_SIZE];
+		char what[80];
 		void *buf;
 
 		algo = find_hash_algo(algo_name);
@@ -270,16 +592,36 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 			printf("Unknown hash algorithm '%s'\n", algo_name);
 			return CMD_RET_USAGE;
 		}
-		argc -= 2;
 
 		if (algo->digest_size > HASH_MAX_DIGEST_SIZE) {
 			puts("HASH_MAX_DIGEST_SIZE exceeded\n");
 			return 1;
 		}
 
-		buf = map_sysmem(addr, len);
-		algo->hash_func_ws(buf, len, output, algo->chunk_size);
-		unmap_sysmem(buf);
+#ifdef CONFIG_HASH_STREAM
+		if (**argv == '-') {
+			int used;
+
+			used = hash_stream(algo, argc, argv, output, what,
+					   sizeof(what));
+			if (used == -EINVAL)
+				return CMD_RET_USAGE;
+			if (used < 0)
+				return 1;
+			argc -= used;
+			argv += used;
+		} else
+#endif
+		{
+			addr = simple_strtoul(*argv++, NULL, 16);
+			len = simple_strtoul(*argv++, NULL, 16);
+			argc -= 2;
+
+			buf = map_sysmem(addr, len);
+			algo->hash_func_ws(buf, len, output, algo->chunk_size);
+			unmap_sysmem(buf);
+			sprintf(what, "%08lx ... %08lx", addr, addr + len - 1);
+		}
 
 		/* Try to avoid code bloat when verify is not needed */
 #ifdef CONFIG_HASH_VERIFY
@@ -298,7 +640,7 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 			if (memcmp(output, vsum, algo->digest_size) != 0) {
 				int i;
 
-				show_hash(algo, addr, len, output);
+				show_hash(algo, what, output);
 				printf(" != ");
 				for (i = 0; i < algo->digest_size; i++)
 					printf("%02x", vsum[i]);
@@ -306,7 +648,7 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 				return 1;
 			}
 		} else {
-			show_hash(algo, addr, len, output);
+			show_hash(algo, what, output);
 			printf("\n");
 
 			if (argc) {
@@ -320,6 +662,8 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 		ulong crc;
 		ulong *ptr;
 
+		addr = simple_strtoul(*argv++, NULL, 16);
+		len = simple_strtoul(*argv++, NULL, 16);
 		crc = crc32_wd(0, (const uchar *)addr, len, CHUNKSZ_CRC32);
 
 		printf("CRC32 for %08lx ... %08lx ==> %08lx\n",
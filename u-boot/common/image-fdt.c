@@ -10,6 +10,7 @@
  */
 
 #include <common.h>
+#include <binlog.h>
 #include <fdt_support.h>
 #include <errno.h>
 #include <image.h>
@@ -119,6 +120,7 @@ int boot_relocate_fdt(struct lmb *lmb, char **of_flat_tree, ulong *of_size)
 	if (*of_size == 0)
 		return 0;
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FDT_RELOC, "fdt_relocate");
 	if (fdt_check_header(fdt_blob) != 0) {
 		fdt_error("image is not a fdt");
 		goto error;
@@ -189,9 +191,11 @@ int boot_relocate_fdt(struct lmb *lmb, char **of_flat_tree, ulong *of_size)
 	*of_size = of_len;
 
 	set_working_fdt_addr(*of_flat_tree);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FDT_RELOC);
 	return 0;
 
 error:
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FDT_RELOC);
 	return 1;
 }
 
@@ -466,6 +470,7 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 	if (IMAAGE_OF_BOARD_SETUP)
 		ft_board_setup(blob, gd->bd);
 	fdt_fixup_ethernet(blob);
+	binlog_fdt_add_report(blob);
 
 	/* Delete the old LMB reservation */
 	lmb_free(lmb, (phys_addr_t)(u32)(uintptr_t)blob,
@@ -0,0 +1,237 @@
+/*
+ * Android sparse images
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * Expands a sparse image as it arrives, so that it can be written while
+ * it is still being downloaded. The image is fed in pieces of any size;
+ * headers split between pieces are put together in the stream state.
+ */
+
+#include <common.h>
+#include <sparse_format.h>
+#include <asm/unaligned.h>
+#include <linux/compat.h>
+
+enum {
+	SS_FILE_HDR,
+	SS_CHUNK_HDR,
+	SS_RAW,
+	SS_FILL,
+	SS_SKIP,		/* header padding or checksum */
+	SS_DONE,
+	SS_ERROR,
+};
+
+/* Words of fill pattern written at a time */
+#define FILL_WORDS	256
+
+int is_sparse_image(const void *buf)
+{
+	return get_unaligned_le32(buf) == SPARSE_HEADER_MAGIC;
+}
+
+void sparse_stream_init(struct sparse_stream *ss, sparse_write_f *write,
+			void *priv)
+{
+	memset(ss, 0, sizeof(*ss));
+	ss->write = write;
+	ss->priv = priv;
+	ss->state = SS_FILE_HDR;
+	ss->buf_want = sizeof(struct sparse_header);
+}
+
+static int sparse_error(struct sparse_stream *ss, const char *msg)
+{
+	printf("Sparse image: %s\n", msg);
+	ss->state = SS_ERROR;
+
+	return -1;
+}
+
+/* Go on to the next chunk, if there is one */
+static void sparse_next_chunk(struct sparse_stream *ss)
+{
+	ss->buf_len = 0;
+	if (ss->chunks_left) {
+		ss->state = SS_CHUNK_HDR;
+		ss->buf_want = ss->hdr.chunk_hdr_sz;
+	} else {
+		ss->state = SS_DONE;
+	}
+}
+
+static int sparse_file_hdr(struct sparse_stream *ss)
+{
+	struct sparse_header *hdr = &ss->hdr;
+	const uchar *p = ss->buf;
+
+	hdr->magic = get_unaligned_le32(p);
+	hdr->major_version = get_unaligned_le16(p + 4);
+	hdr->minor_version = get_unaligned_le16(p + 6);
+	hdr->file_hdr_sz = get_unaligned_le16(p + 8);
+	hdr->chunk_hdr_sz = get_unaligned_le16(p + 10);
+	hdr->blk_sz = get_unaligned_le32(p + 12);
+	hdr->total_blks = get_unaligned_le32(p + 16);
+	hdr->total_chunks = get_unaligned_le32(p + 20);
+	hdr->image_checksum = get_unaligned_le32(p + 24);
+
+	if (hdr->magic != SPARSE_HEADER_MAGIC ||
+	    hdr->major_version != SPARSE_MAJOR_VERSION)
+		return sparse_error(ss, "bad header");
+	if (hdr->file_hdr_sz < sizeof(struct sparse_header) ||
+	    hdr->chunk_hdr_sz < sizeof(struct chunk_header) ||
+	    hdr->chunk_hdr_sz > sizeof(ss->buf) ||
+	    !hdr->blk_sz || hdr->blk_sz % 4)
+		return sparse_error(ss, "unsupported header");
+
+	debug("sparse: %u blocks of %u in %u chunks\n", hdr->total_blks,
+	      hdr->blk_sz, hdr->total_chunks);
+	ss->chunks_left = hdr->total_chunks;
+	ss->remain = hdr->file_hdr_sz - sizeof(struct sparse_header);
+	if (ss->remain) {
+		ss->state = SS_SKIP;
+		return 0;
+	}
+	sparse_next_chunk(ss);
+
+	return 0;
+}
+
+static int sparse_chunk_hdr(struct sparse_stream *ss)
+{
+	struct sparse_header *hdr = &ss->hdr;
+	const uchar *p = ss->buf;
+	u32 chunk_sz, total_sz;
+	u64 out_len, data_len;
+
+	ss->chunk_type = get_unaligned_le16(p);
+	chunk_sz = get_unaligned_le32(p + 4);
+	total_sz = get_unaligned_le32(p + 8);
+	if (total_sz < hdr->chunk_hdr_sz)
+		return sparse_error(ss, "bad chunk size");
+	data_len = total_sz - hdr->chunk_hdr_sz;
+	out_len = (u64)chunk_sz * hdr->blk_sz;
+	if (ss->offset + out_len > (u64)hdr->total_blks * hdr->blk_sz)
+		return sparse_error(ss, "chunk goes past the end");
+	ss->chunks_left--;
+
+	switch (ss->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if (data_len != out_len)
+			return sparse_error(ss, "bad raw chunk");
+		ss->state = SS_RAW;
+		ss->remain = data_len;
+		if (!data_len)
+			sparse_next_chunk(ss);
+		break;
+	case CHUNK_TYPE_FILL:
+		if (data_len != sizeof(u32))
+			return sparse_error(ss, "bad fill chunk");
+		ss->state = SS_FILL;
+		ss->remain = out_len;
+		ss->buf_len = 0;
+		ss->buf_want = sizeof(u32);
+		break;
+	case CHUNK_TYPE_DONT_CARE:
+		if (data_len)
+			return sparse_error(ss, "bad don't-care chunk");
+		ss->offset += out_len;
+		sparse_next_chunk(ss);
+		break;
+	case CHUNK_TYPE_CRC32:
+		ss->state = SS_SKIP;
+		ss->remain = data_len;
+		if (!data_len)
+			sparse_next_chunk(ss);
+		break;
+	default:
+		return sparse_error(ss, "unknown chunk type");
+	}
+
+	return 0;
+}
+
+static int sparse_fill(struct sparse_stream *ss)
+{
+	u32 pattern[FILL_WORDS];
+	u32 value = get_unaligned_le32(ss->buf);
+	ulong len;
+	int i;
+
+	for (i = 0; i < FILL_WORDS; i++)
+		pattern[i] = cpu_to_le32(value);
+	while (ss->remain) {
+		len = min_t(u64, ss->remain, sizeof(pattern));
+		if (ss->write(ss, ss->offset, pattern, len))
+			return sparse_error(ss, "write failed");
+		ss->offset += len;
+		ss->remain -= len;
+	}
+	sparse_next_chunk(ss);
+
+	return 0;
+}
+
+int sparse_stream_feed(struct sparse_stream *ss, const void *data, ulong len)
+{
+	const uchar *p = data;
+	ulong n;
+	int ret = 0;
+
+	while (len && !ret) {
+		switch (ss->state) {
+		case SS_FILE_HDR:
+		case SS_CHUNK_HDR:
+		case SS_FILL:
+			/* put the header (or fill value) together */
+			n = min_t(ulong, len, ss->buf_want - ss->buf_len);
+			memcpy(ss->buf + ss->buf_len, p, n);
+			ss->buf_len += n;
+			p += n;
+			len -= n;
+			if (ss->buf_len < ss->buf_want)
+				break;
+			if (ss->state == SS_FILE_HDR)
+				ret = sparse_file_hdr(ss);
+			else if (ss->state == SS_CHUNK_HDR)
+				ret = sparse_chunk_hdr(ss);
+			else
+				ret = sparse_fill(ss);
+			break;
+		case SS_RAW:
+			n = min_t(u64, len, ss->remain);
+			if (ss->write(ss, ss->offset, p, n))
+				return sparse_error(ss, "write failed");
+			ss->offset += n;
+			ss->remain -= n;
+			p += n;
+			len -= n;
+			if (!ss->remain)
+				sparse_next_chunk(ss);
+			break;
+		case SS_SKIP:
+			n = min_t(u64, len, ss->remain);
+			ss->remain -= n;
+			p += n;
+			len -= n;
+			if (!ss->remain)
+				sparse_next_chunk(ss);
+			break;
+		case SS_DONE:
+			/* anything after the last chunk is ignored */
+			return 0;
+		default:
+			return -1;
+		}
+	}
+
+	return ret;
+}
+
+int sparse_stream_done(struct sparse_stream *ss)
+{
+	return ss->state == SS_DONE;
+}
@@ -1165,7 +1165,9 @@ int image_setup_linux(bootm_headers_t *images)
 	}
 
 	if (IMAGE_ENABLE_OF_LIBFDT && of_size) {
+		bootstage_start(BOOTSTAGE_ID_ACCUM_FDT_FIXUP, "fdt_fixup");
 		ret = image_setup_libfdt(images, *of_flat_tree, of_size, lmb);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_FDT_FIXUP);
 		if (ret)
 			return ret;
 	}
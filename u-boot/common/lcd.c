@@ -28,6 +28,7 @@
 #include <watchdog.h>
 
 #include <splash.h>
+#include <memattr.h>
 
 #if defined(CONFIG_CPU_PXA25X) || defined(CONFIG_CPU_PXA27X) || \
 	defined(CONFIG_CPU_MONAHANS)
@@ -401,6 +402,12 @@ int drv_lcd_init(void)
 
 	lcd_base = (void *) gd->fb_base;
 
+#ifdef CONFIG_LCD_WRITECOMBINE
+	/* CPU writes are merged and go straight to memory, no flush needed */
+	mem_attr_set_region((ulong)lcd_base, lcd_get_size(&lcd_line_length),
+			    MEM_ATTR_WRITECOMBINE);
+#endif
+
 	lcd_init(lcd_base);		/* LCD initialization */
 
 	/* Device initialization */
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <environment.h>
+#include <exports.h>
+#include <memattr.h>
+#include <linux/ctype.h>
+
+#ifdef CONFIG_SYS_ARM_CACHE_WRITETHROUGH
+#define MEM_ATTR_DEFAULT	MEM_ATTR_WRITETHROUGH
+#else
+#define MEM_ATTR_DEFAULT	MEM_ATTR_WRITEBACK
+#endif
+
+static struct mem_attr_map mem_attr_map = {
+	.def_attr	= MEM_ATTR_DEFAULT,
+};
+
+static const char * const mem_attr_names[MEM_ATTR_COUNT] = {
+	"off",
+	"wt",
+	"wb",
+	"wc",
+};
+
+const char *mem_attr_name(int attr)
+{
+	if (attr < 0 || attr >= MEM_ATTR_COUNT)
+		return "?";
+
+	return mem_attr_names[attr];
+}
+
+int mem_attr_lookup(const char *name)
+{
+	int len, attr;
+
+	for (len = 0; name[len] && name[len] != ',' && !isspace(name[len]);)
+		len++;
+	for (attr = 0; attr < MEM_ATTR_COUNT; attr++) {
+		if (strlen(mem_attr_names[attr]) == len &&
+		    !strncmp(name, mem_attr_names[attr], len))
+			return attr;
+	}
+
+	return -1;
+}
+
+/*
+ * ustrtoul() which always steps over a K, M or G suffix. ustrtoul() only
+ * does that when "i" or "iB" follows, leaving "16M" at the 'M'.
+ */
+static ulong mem_attr_strtoul(const char *str, char **endp, uint base)
+{
+	ulong val = ustrtoul(str, endp, base);
+
+	if (**endp && strchr("KkMG", **endp))
+		(*endp)++;
+
+	return val;
+}
+
+/* Sizes are decimal unless they start with 0x, like "16M" */
+static ulong mem_attr_strtosize(const char *str, char **endp)
+{
+	return mem_attr_strtoul(str, endp,
+			str[0] == '0' && tolower(str[1]) == 'x' ? 16 : 10);
+}
+
+int mem_attr_parse(const char *str, struct mem_attr_map *map, int flags)
+{
+	struct mem_attr_region *reg;
+	char *end;
+	int attr;
+
+	while (*str) {
+		if (*str == ',' || isspace(*str)) {
+			str++;
+			continue;
+		}
+		if (map->count == CONFIG_MEM_ATTR_MAX_REGIONS)
+			return -1;
+		reg = &map->region[map->count];
+
+		reg->start = mem_attr_strtoul(str, &end, 16);
+		if (end == str || *end != ':')
+			return -1;
+		str = end + 1;
+		reg->size = mem_attr_strtosize(str, &end);
+		if (end == str || *end != ':')
+			return -1;
+		str = end + 1;
+		attr = mem_attr_lookup(str);
+		if (attr < 0)
+			return -1;
+		reg->attr = attr;
+		reg->flags = flags;
+		map->count++;
+
+		while (*str && *str != ',' && !isspace(*str))
+			str++;
+	}
+
+	return 0;
+}
+
+void mem_attr_build_table(const struct mem_attr_map *map, ulong base,
+			  uint shift, uint count, u8 *table)
+{
+	const struct mem_attr_region *reg;
+	ulong first, last, end, base_blk;
+	int i;
+
+	memset(table, map->def_attr, count);
+	if (!count)
+		return;
+
+	base_blk = base >> shift;
+	for (i = 0, reg = map->region; i < map->count; i++, reg++) {
+		if (!reg->size)
+			continue;
+
+		/*
+		 * Only blocks wholly inside the region are changed, since a
+		 * partly covered one may hold other things, e.g. U-Boot just
+		 * above the framebuffer. Work in blocks, inclusive, to avoid
+		 * overflow at the top.
+		 */
+		first = reg->start >> shift;
+		if (reg->start & ((1UL << shift) - 1))
+			first++;
+		end = reg->start + reg->size;
+		if (end > reg->start)
+			end >>= shift;
+		else
+			end = 1UL << (sizeof(ulong) * 8 - shift);
+		if (end <= first)
+			continue;
+		last = end - 1;
+		if (last < base_blk || first > base_blk + count - 1)
+			continue;
+		if (first < base_blk)
+			first = base_blk;
+		if (last > base_blk + count - 1)
+			last = base_blk + count - 1;
+		memset(table + first - base_blk, reg->attr, last - first + 1);
+	}
+}
+
+struct mem_attr_map *mem_attr_get_map(void)
+{
+	return &mem_attr_map;
+}
+
+__weak void mem_attr_apply(ulong start, ulong size)
+{
+}
+
+int mem_attr_set_region(ulong start, ulong size, enum mem_attr attr)
+{
+	struct mem_attr_map *map = &mem_attr_map;
+	struct mem_attr_region *reg;
+	int i;
+
+	for (i = 0, reg = map->region; i < map->count; i++, reg++) {
+		if (reg->start == start && reg->size == size)
+			break;
+	}
+	if (i == CONFIG_MEM_ATTR_MAX_REGIONS)
+		return -1;
+	if (i == map->count)
+		map->count++;
+	reg->start = start;
+	reg->size = size;
+	reg->attr = attr;
+	reg->flags = 0;
+	mem_attr_apply(start, size);
+
+	return 0;
+}
+
+/*
+ * Regions from the environment replace any earlier ones from the
+ * environment, but leave regions set up by code (e.g. the LCD driver).
+ */
+static int on_memattr(const char *name, const char *value, enum env_op op,
+	int flags)
+{
+	struct mem_attr_map *map = &mem_attr_map;
+	struct mem_attr_map new_map;
+	int i;
+
+	new_map.def_attr = map->def_attr;
+	new_map.count = 0;
+	for (i = 0; i < map->count; i++) {
+		if (!(map->region[i].flags & MEM_ATTR_FROM_ENV))
+			new_map.region[new_map.count++] = map->region[i];
+	}
+
+	if (op != env_op_delete && value &&
+	    mem_attr_parse(value, &new_map, MEM_ATTR_FROM_ENV)) {
+		printf("## Invalid memattr '%s'\n", value);
+		return 1;
+	}
+
+	*map = new_map;
+	mem_attr_apply(0, ~0UL);
+
+	return 0;
+}
+U_BOOT_ENV_CALLBACK(memattr, on_memattr);
+
+#ifdef CONFIG_CMD_MEMATTR
+static int do_memattr(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	struct mem_attr_map *map = &mem_attr_map;
+	struct mem_attr_region *reg;
+	ulong start, size;
+	char *end;
+	int i, attr;
+
+	if (argc == 1) {
+		printf("Default: %s\n", mem_attr_name(map->def_attr));
+		for (i = 0, reg = map->region; i < map->count; i++, reg++) {
+			printf("%08lx-%08lx %-3s %s\n", reg->start,
+			       reg->start + reg->size - 1,
+			       mem_attr_name(reg->attr),
+			       reg->flags & MEM_ATTR_FROM_ENV ? "env" : "");
+		}
+		return 0;
+	}
+	if (argc != 4)
+		return CMD_RET_USAGE;
+
+	start = mem_attr_strtoul(argv[1], &end, 16);
+	if (end == argv[1] || *end)
+		return CMD_RET_USAGE;
+	size = mem_attr_strtosize(argv[2], &end);
+	if (end == argv[2] || *end)
+		return CMD_RET_USAGE;
+	attr = mem_attr_lookup(argv[3]);
+	if (attr < 0 || argv[3][strlen(mem_attr_name(attr))])
+		return CMD_RET_USAGE;
+	if (mem_attr_set_region(start, size, attr)) {
+		puts("Too many regions\n");
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+U_BOOT_CMD(
+	memattr,	4,	0,	do_memattr,
+	"show or change memory caching attributes",
+	"\n"
+	"    - show the memory attribute map\n"
+	"memattr <start> <size> off|wt|wb|wc\n"
+	"    - map a region uncached, write-through, write-back or\n"
+	"      write-combined"
+);
+#endif
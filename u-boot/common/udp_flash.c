@@ -0,0 +1,570 @@
+/*
+ * Flashing over UDP
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * The protocol engine: it takes packets from the host and hands back
+ * replies, and knows nothing of the network (see net/udp_flash.c). The
+ * protocol itself is described in include/udp_flash.h.
+ *
+ * Data for a target is gathered in a staging buffer and written out a
+ * chunk at a time, padded to whole blocks or pages. The host is answered
+ * before each packet is stored, so while a chunk is being written the
+ * next packet is already on its way; an error found in the meantime is
+ * reported in the reply to the following packet.
+ */
+
+#include <common.h>
+#include <div64.h>
+#include <fs.h>
+#include <malloc.h>
+#include <part.h>
+#include <sparse_format.h>
+#include <udp_flash.h>
+#include <asm/io.h>
+#include <asm/unaligned.h>
+#include <linux/compat.h>
+#ifdef CONFIG_CMD_NAND
+#include <nand.h>
+#endif
+#ifdef CONFIG_CMD_MTDPARTS
+#include <jffs2/load_kernel.h>
+#endif
+
+/* Largest download into RAM */
+#ifndef CONFIG_UDP_FLASH_BUF_SIZE
+#define CONFIG_UDP_FLASH_BUF_SIZE	(32 << 20)
+#endif
+/* Bytes gathered before each write to the target */
+#ifndef CONFIG_UDP_FLASH_CHUNK
+#define CONFIG_UDP_FLASH_CHUNK		(1 << 20)
+#endif
+/* Bytes per progress hash */
+#define UF_HASH_BYTES			(1 << 20)
+
+enum uf_target_type {
+	UF_TARGET_BLOCK,
+	UF_TARGET_NAND,
+	UF_TARGET_MEM,
+};
+
+struct uf_target {
+	enum uf_target_type type;
+	u64 size;			/* bytes we may write */
+	ulong align;			/* writes are a multiple of this */
+	uchar pad;			/* byte to pad the last write with */
+	block_dev_desc_t *dev;
+	lbaint_t start;			/* first block of the partition */
+#ifdef CONFIG_CMD_NAND
+	nand_info_t *nand;
+	loff_t nand_off;		/* start of the region */
+	loff_t nand_pos;		/* where the next write goes */
+#endif
+	ulong addr;
+};
+
+enum uf_state {
+	UF_IDLE,
+	UF_DOWNLOAD,			/* data goes into RAM */
+	UF_WRITE,			/* data goes to uf_target */
+};
+
+static udp_flash_reply_f *uf_reply;
+static int uf_session;			/* a start packet has been seen */
+static u16 uf_seq;			/* of the last packet acted on */
+static uchar uf_last[UDP_FLASH_HDR_SIZE + 64];
+static unsigned uf_last_len;
+
+static enum uf_state uf_state;
+static ulong uf_size;			/* bytes expected in the data phase */
+static ulong uf_got;			/* bytes received so far */
+static ulong uf_next_hash;
+static int uf_error;			/* a write failed during the data phase */
+static ulong uf_downloaded;		/* bytes held in RAM for flash: */
+
+static struct uf_target uf_target;
+static int uf_sparse;			/* data is a sparse image */
+static struct sparse_stream uf_ss;
+
+static uchar *uf_stage;
+static ulong uf_stage_len;
+static u64 uf_stage_off;		/* target offset of uf_stage[0] */
+
+static void uf_send(u16 seq, const char *msg)
+{
+	struct udp_flash_hdr *hdr = (struct udp_flash_hdr *)uf_last;
+	unsigned len = strlen(msg);
+
+	if (len > sizeof(uf_last) - UDP_FLASH_HDR_SIZE)
+		len = sizeof(uf_last) - UDP_FLASH_HDR_SIZE;
+	hdr->type = UDP_FLASH_REPLY;
+	hdr->flags = 0;
+	put_unaligned_be16(seq, hdr->seq);
+	memcpy(uf_last + UDP_FLASH_HDR_SIZE, msg, len);
+	uf_last_len = UDP_FLASH_HDR_SIZE + len;
+	uf_reply(uf_last, uf_last_len);
+}
+
+static int uf_target_parse(const char *spec)
+{
+	struct uf_target *t = &uf_target;
+	char iface[16];
+	const char *arg;
+	int len;
+	disk_partition_t info;
+
+	arg = strchr(spec, ' ');
+	if (!arg)
+		return -1;
+	len = arg - spec;
+	if (len >= sizeof(iface))
+		return -1;
+	memcpy(iface, spec, len);
+	iface[len] = '\0';
+	while (*arg == ' ')
+		arg++;
+
+	memset(t, 0, sizeof(*t));
+	if (!strcmp(iface, "mem")) {
+		t->type = UF_TARGET_MEM;
+		t->addr = simple_strtoul(arg, NULL, 16);
+		t->size = (u64)-1;
+		t->align = 1;
+		return 0;
+	}
+#ifdef CONFIG_CMD_NAND
+	if (!strcmp(iface, "nand")) {
+		char *end;
+# ifdef CONFIG_CMD_MTDPARTS
+		struct mtd_device *mdev;
+		struct part_info *part;
+		u8 pnum;
+
+		if (!mtdparts_init() &&
+		    !find_dev_and_part(arg, &mdev, &pnum, &part)) {
+			if (mdev->id->type != MTD_DEV_TYPE_NAND)
+				return -1;
+			t->nand = &nand_info[mdev->id->num];
+			t->nand_off = part->offset;
+			t->size = part->size;
+		} else
+# endif
+		{
+			t->nand_off = simple_strtoull(arg, &end, 16);
+			if (end == arg || *end != ' ')
+				return -1;
+			t->size = simple_strtoull(end + 1, NULL, 16);
+			t->nand = &nand_info[nand_curr_device];
+		}
+		if (!t->nand->name || !t->size ||
+		    t->nand_off & (t->nand->erasesize - 1) ||
+		    t->nand_off + t->size > t->nand->size)
+			return -1;
+		t->type = UF_TARGET_NAND;
+		t->align = t->nand->writesize;
+		t->pad = 0xff;
+		t->nand_pos = t->nand_off;
+		return 0;
+	}
+#endif
+	if (get_device_and_partition(iface, arg, &t->dev, &info, 1) < 0)
+		return -1;
+	if (!t->dev->block_write)
+		return -1;
+	t->type = UF_TARGET_BLOCK;
+	t->start = info.start;
+	t->size = (u64)info.size * info.blksz;
+	t->align = info.blksz;
+
+	return 0;
+}
+
+static int uf_target_write(u64 off, const void *buf, ulong len)
+{
+	struct uf_target *t = &uf_target;
+
+	if (off + len > t->size || off != lldiv(off, t->align) * t->align)
+		return -1;
+	switch (t->type) {
+	case UF_TARGET_BLOCK: {
+		lbaint_t blk = t->start + lldiv(off, t->align);
+		lbaint_t cnt = len / t->align;
+
+		fs_invalidate_dev(t->dev);
+		if (t->dev->block_write(t->dev->dev, blk, cnt, buf) != cnt)
+			return -1;
+		break;
+	}
+#ifdef CONFIG_CMD_NAND
+	case UF_TARGET_NAND: {
+		nand_erase_options_t opts;
+		loff_t end = t->nand_off + t->size;
+		size_t wlen = len, actual;
+
+		/* writes are in order and start on an erase block */
+		memset(&opts, 0, sizeof(opts));
+		opts.offset = t->nand_pos;
+		opts.length = roundup(len, t->nand->erasesize);
+		opts.quiet = 1;
+		opts.spread = 1;
+		opts.lim = end - t->nand_pos;
+		if (nand_erase_opts(t->nand, &opts))
+			return -1;
+		if (nand_write_skip_bad(t->nand, t->nand_pos, &wlen, &actual,
+					end - t->nand_pos, (u_char *)buf, 0))
+			return -1;
+		t->nand_pos += actual;
+		break;
+	}
+#endif
+	case UF_TARGET_MEM: {
+		void *dst = map_sysmem(t->addr + off, len);
+
+		if (dst != buf)
+			memmove(dst, buf, len);
+		unmap_sysmem(dst);
+		break;
+	}
+	default:
+		return -1;
+	}
+
+	return 0;
+}
+
+static int uf_stage_flush(void)
+{
+	struct uf_target *t = &uf_target;
+	ulong len = roundup(uf_stage_len, t->align);
+	int ret;
+
+	if (!uf_stage_len)
+		return 0;
+	memset(uf_stage + uf_stage_len, t->pad, len - uf_stage_len);
+	ret = uf_target_write(uf_stage_off, uf_stage, len);
+	uf_stage_off += uf_stage_len;
+	uf_stage_len = 0;
+
+	return ret;
+}
+
+/* Add bytes for offset @off of the target, writing out when needed */
+static int uf_stage_add(u64 off, const void *data, ulong len)
+{
+	const uchar *p = data;
+	ulong n;
+
+	if (off != uf_stage_off + uf_stage_len) {
+		/* a sparse image skipped some blocks */
+		if (uf_stage_flush())
+			return -1;
+		if (uf_target.type == UF_TARGET_NAND)
+			return -1;
+		uf_stage_off = off;
+	}
+	while (len) {
+		n = min_t(ulong, len, CONFIG_UDP_FLASH_CHUNK - uf_stage_len);
+		memcpy(uf_stage + uf_stage_len, p, n);
+		uf_stage_len += n;
+		p += n;
+		len -= n;
+		if (uf_stage_len == CONFIG_UDP_FLASH_CHUNK && uf_stage_flush())
+			return -1;
+	}
+
+	return 0;
+}
+
+static int uf_sparse_write(struct sparse_stream *ss, u64 offset,
+			   const void *buf, ulong len)
+{
+	return uf_stage_add(offset, buf, len);
+}
+
+static void uf_output_start(void)
+{
+	uf_stage_len = 0;
+	uf_stage_off = 0;
+	uf_sparse = 0;
+}
+
+/* Take the next @len bytes for the target */
+static int uf_output(const uchar *data, ulong len, int first)
+{
+	if (first && len >= sizeof(u32) && is_sparse_image(data)) {
+		if (uf_target.type == UF_TARGET_NAND) {
+			puts("Sparse images need a block device\n");
+			return -1;
+		}
+		uf_sparse = 1;
+		sparse_stream_init(&uf_ss, uf_sparse_write, NULL);
+	}
+	if (uf_sparse)
+		return sparse_stream_feed(&uf_ss, data, len);
+
+	return uf_stage_add(uf_stage_off + uf_stage_len, data, len);
+}
+
+static int uf_output_done(void)
+{
+	if (uf_stage_flush())
+		return -1;
+	if (uf_sparse && !sparse_stream_done(&uf_ss)) {
+		puts("Sparse image is cut short\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static void uf_progress(void)
+{
+	while (uf_got >= uf_next_hash) {
+		putc('#');
+		uf_next_hash += UF_HASH_BYTES;
+	}
+}
+
+static int uf_cmd_flash(u16 seq, const char *spec)
+{
+	const uchar *buf;
+	int ret;
+
+	if (!uf_downloaded) {
+		uf_send(seq, "FAILnothing downloaded");
+		return 0;
+	}
+	if (uf_target_parse(spec)) {
+		uf_send(seq, "FAILbad target");
+		return 0;
+	}
+	printf("Flashing %lu bytes to %s\n", uf_downloaded, spec);
+	buf = map_sysmem(load_addr, uf_downloaded);
+	uf_output_start();
+	ret = uf_output(buf, uf_downloaded, 1);
+	if (!ret)
+		ret = uf_output_done();
+	unmap_sysmem(buf);
+	uf_send(seq, ret ? "FAILwrite failed" : "OKAY");
+
+	return 0;
+}
+
+static int uf_cmd_erase(u16 seq, const char *spec)
+{
+	struct uf_target *t = &uf_target;
+	int ret = -1;
+
+	if (uf_target_parse(spec)) {
+		uf_send(seq, "FAILbad target");
+		return 0;
+	}
+	printf("Erasing %s\n", spec);
+	switch (t->type) {
+	case UF_TARGET_BLOCK:
+		if (!t->dev->block_erase) {
+			uf_send(seq, "FAILerase not supported");
+			return 0;
+		}
+		ret = t->dev->block_erase(t->dev->dev, t->start,
+				lldiv(t->size, t->align)) !=
+			lldiv(t->size, t->align);
+		break;
+#ifdef CONFIG_CMD_NAND
+	case UF_TARGET_NAND: {
+		nand_erase_options_t opts;
+
+		memset(&opts, 0, sizeof(opts));
+		opts.offset = t->nand_off;
+		opts.length = t->size;
+		opts.quiet = 1;
+		ret = nand_erase_opts(t->nand, &opts);
+		break;
+	}
+#endif
+	default:
+		uf_send(seq, "FAILerase not supported");
+		return 0;
+	}
+	uf_send(seq, ret ? "FAILerase failed" : "OKAY");
+
+	return 0;
+}
+
+/* Start a data phase; @size is hex */
+static void uf_data_start(u16 seq, enum uf_state state, const char *size)
+{
+	char msg[24];
+
+	uf_size = simple_strtoul(size, NULL, 16);
+	if (!uf_size) {
+		uf_send(seq, "FAILno data");
+		return;
+	}
+	uf_got = 0;
+	uf_next_hash = UF_HASH_BYTES;
+	uf_error = 0;
+	uf_state = state;
+	sprintf(msg, "DATA%08lx", uf_size);
+	uf_send(seq, msg);
+}
+
+static int uf_command(u16 seq, const char *cmd)
+{
+	const char *arg;
+	char msg[16];
+
+	if (!strncmp(cmd, "getvar:", 7)) {
+		arg = cmd + 7;
+		if (!strcmp(arg, "version")) {
+			uf_send(seq, "OKAY" UDP_FLASH_VERSION);
+		} else if (!strcmp(arg, "max-download-size")) {
+			sprintf(msg, "OKAY%08x", CONFIG_UDP_FLASH_BUF_SIZE);
+			uf_send(seq, msg);
+		} else {
+			uf_send(seq, "FAILunknown variable");
+		}
+	} else if (!strncmp(cmd, "download:", 9)) {
+		uf_downloaded = 0;
+		if (simple_strtoul(cmd + 9, NULL, 16) >
+		    CONFIG_UDP_FLASH_BUF_SIZE) {
+			uf_send(seq, "FAILdata too large");
+			return 0;
+		}
+		printf("Downloading %s bytes\n", cmd + 9);
+		uf_data_start(seq, UF_DOWNLOAD, cmd + 9);
+	} else if (!strncmp(cmd, "flash:", 6)) {
+		return uf_cmd_flash(seq, cmd + 6);
+	} else if (!strncmp(cmd, "write:", 6)) {
+		arg = strchr(cmd + 6, ':');
+		if (!arg || uf_target_parse(arg + 1)) {
+			uf_send(seq, "FAILbad target");
+			return 0;
+		}
+		printf("Writing to %s\n", arg + 1);
+		uf_output_start();
+		uf_data_start(seq, UF_WRITE, cmd + 6);
+	} else if (!strncmp(cmd, "erase:", 6)) {
+		return uf_cmd_erase(seq, cmd + 6);
+	} else if (!strcmp(cmd, "continue")) {
+		uf_send(seq, "OKAY");
+		return 1;
+	} else if (!strcmp(cmd, "reboot")) {
+		uf_send(seq, "OKAY");
+		return 2;
+	} else {
+		uf_send(seq, "FAILunknown command");
+	}
+
+	return 0;
+}
+
+static void uf_data(u16 seq, const uchar *data, unsigned len)
+{
+	int last;
+	int first = !uf_got;
+
+	if (uf_state == UF_IDLE) {
+		uf_send(seq, "FAILno transfer");
+		return;
+	}
+	if (len > uf_size - uf_got) {
+		uf_state = UF_IDLE;
+		uf_send(seq, "FAILtoo much data");
+		return;
+	}
+	uf_got += len;
+	last = uf_got == uf_size;
+	/* let the host carry on while we store this */
+	if (!last) {
+		uf_send(seq, uf_error ? "FAILwrite failed" : "");
+		if (uf_error)
+			uf_state = UF_IDLE;
+	}
+	if (uf_state == UF_IDLE)
+		return;
+
+	if (uf_state == UF_DOWNLOAD)
+		memcpy(map_sysmem(load_addr + uf_got - len, len), data, len);
+	else if (!uf_error && uf_output(data, len, first))
+		uf_error = 1;
+	uf_progress();
+	if (!last)
+		return;
+
+	putc('\n');
+	if (uf_state == UF_DOWNLOAD) {
+		uf_downloaded = uf_size;
+		setenv_hex("filesize", uf_size);
+	} else if (!uf_error && uf_output_done()) {
+		uf_error = 1;
+	}
+	uf_state = UF_IDLE;
+	uf_send(seq, uf_error ? "FAILwrite failed" : "OKAY");
+}
+
+int udp_flash_init(udp_flash_reply_f *reply)
+{
+	if (!uf_stage) {
+		uf_stage = malloc(CONFIG_UDP_FLASH_CHUNK);
+		if (!uf_stage) {
+			puts("udpflash: out of memory\n");
+			return -1;
+		}
+	}
+	uf_reply = reply;
+	uf_session = 0;
+	uf_state = UF_IDLE;
+
+	return 0;
+}
+
+int udp_flash_packet(const uchar *pkt, unsigned len)
+{
+	const struct udp_flash_hdr *hdr = (const struct udp_flash_hdr *)pkt;
+	char cmd[UDP_FLASH_MAX_DATA + 1];
+	u16 seq;
+
+	if (len < UDP_FLASH_HDR_SIZE)
+		return 0;
+	seq = get_unaligned_be16(hdr->seq);
+	len -= UDP_FLASH_HDR_SIZE;
+	pkt += UDP_FLASH_HDR_SIZE;
+
+	if (uf_session && seq == uf_seq) {
+		/* our reply was lost */
+		uf_reply(uf_last, uf_last_len);
+		return 0;
+	}
+	if (hdr->flags & UDP_FLASH_F_START) {
+		uf_session = 1;
+		uf_state = UF_IDLE;
+	} else if (!uf_session || seq != (u16)(uf_seq + 1)) {
+		/* stale, or ahead of a packet we never saw: the host resends */
+		return 0;
+	}
+	uf_seq = seq;
+
+	switch (hdr->type) {
+	case UDP_FLASH_CMD:
+		if (uf_state != UF_IDLE) {
+			puts("\nTransfer abandoned\n");
+			uf_state = UF_IDLE;
+		}
+		if (len > UDP_FLASH_MAX_DATA)
+			len = UDP_FLASH_MAX_DATA;
+		memcpy(cmd, pkt, len);
+		cmd[len] = '\0';
+		return uf_command(seq, cmd);
+	case UDP_FLASH_DATA:
+		uf_data(seq, pkt, len);
+		break;
+	default:
+		uf_send(seq, "FAILbad packet");
+		break;
+	}
+
+	return 0;
+}
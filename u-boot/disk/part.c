@@ -7,9 +7,11 @@
 
 #include <common.h>
 #include <command.h>
+#include <fs.h>
 #include <ide.h>
 #include <malloc.h>
 #include <part.h>
+#include <watchdog.h>
 
 #undef	PART_DEBUG
 
@@ -42,6 +44,9 @@ static const struct block_drvr block_drvr[] = {
 #endif
 #if defined(CONFIG_SYSTEMACE)
 	{ .name = "ace", .get_dev = systemace_get_dev, },
+#endif
+#if defined(CONFIG_SANDBOX_BLOCK)
+	{ .name = "hostfile", .get_dev = host_get_dev, },
 #endif
 	{ },
 };
@@ -216,6 +221,9 @@ void dev_print (block_dev_desc_t *dev_desc)
 
 void init_part (block_dev_desc_t * dev_desc)
 {
+	/* Filesystems mounted from the old media are gone */
+	fs_invalidate_dev(dev_desc);
+
 #ifdef CONFIG_ISO_PARTITION
 	if (test_part_iso(dev_desc) == 0) {
 		dev_desc->part_type = PART_TYPE_ISO;
@@ -626,3 +634,98 @@ cleanup:
 	free(dup_str);
 	return ret;
 }
+
+/*
+ * Find the partition called "name" on dev_desc. GPT partitions are matched
+ * on their label; other tables on the name get_partition_info() gives them.
+ * Returns the partition number, or -1 if there is none of that name.
+ */
+int get_partition_info_by_name(block_dev_desc_t *dev_desc, const char *name,
+			       disk_partition_t *info)
+{
+	int p;
+
+#ifdef CONFIG_EFI_PARTITION
+	if (dev_desc->part_type == PART_TYPE_EFI) {
+#ifdef CONFIG_PARTITION_UUIDS
+		info->uuid[0] = 0;
+#endif
+		p = get_partition_info_efi_by_name(dev_desc, name, info);
+		goto found;
+	}
+#endif
+	for (p = 1; p <= MAX_SEARCH_PARTITIONS; p++) {
+		if (get_partition_info(dev_desc, p, info))
+			continue;
+		if (!strncmp((char *)info->name, name, sizeof(info->name)))
+			goto found;
+	}
+	p = -1;
+found:
+	if (p > 0)
+		dev_desc->log2blksz = LOG2(dev_desc->blksz);
+	return p;
+}
+
+/*
+ * Find the partition called "str" on dev_desc or, if there is none, the
+ * partition with that (hex) number. Returns the partition number, or -1
+ * after printing an error.
+ */
+int get_partition_info_by_name_or_num(block_dev_desc_t *dev_desc,
+				      const char *str, disk_partition_t *info)
+{
+	char *ep;
+	int part;
+
+	part = get_partition_info_by_name(dev_desc, str, info);
+	if (part >= 0)
+		return part;
+
+	part = simple_strtoul(str, &ep, 16);
+	if (*ep || part <= 0 || get_partition_info(dev_desc, part, info)) {
+		printf("** No partition %s **\n", str);
+		return -1;
+	}
+
+	return part;
+}
+
+/*
+ * Read count blocks from start, passing at most per_read blocks to each
+ * block_read() and checking for Ctrl-C in between. Without a callback the
+ * blocks are stored one after the other from buf. With one, each piece is
+ * read to buf and handed to fn, and a non-zero return from fn ends the read
+ * and is passed back. Returns 0, or -1 on a read error or Ctrl-C.
+ */
+int dev_read_blocks(block_dev_desc_t *dev_desc, lbaint_t start,
+		    lbaint_t count, lbaint_t per_read, void *buf,
+		    int (*fn)(void *priv, void *buf, lbaint_t n), void *priv)
+{
+	lbaint_t n;
+	int ret;
+
+	while (count) {
+		n = min(count, per_read);
+		if (dev_desc->block_read(dev_desc->dev, start, n, buf) != n) {
+			printf("** Read error at block " LBAF " **\n", start);
+			return -1;
+		}
+		if (fn) {
+			ret = fn(priv, buf, n);
+			if (ret)
+				return ret;
+		} else {
+			buf += n * dev_desc->blksz;
+		}
+		start += n;
+		count -= n;
+		WATCHDOG_RESET();
+		if (ctrlc()) {
+			puts("\nAbort\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
@@ -17,6 +17,7 @@
 #include <asm/unaligned.h>
 #include <common.h>
 #include <command.h>
+#include <fs.h>
 #include <ide.h>
 #include <malloc.h>
 #include <part_efi.h>
@@ -92,6 +93,27 @@ static inline int is_bootable(gpt_entry *p)
 			sizeof(efi_guid_t));
 }
 
+static void pte_to_info(block_dev_desc_t *dev_desc, gpt_entry *pte,
+			disk_partition_t *info)
+{
+	/* The ulong casting limits the maximum disk size to 2 TB */
+	info->start = (u64)le64_to_cpu(pte->starting_lba);
+	/* The ending LBA is inclusive, to calculate size, add 1 to it */
+	info->size = ((u64)le64_to_cpu(pte->ending_lba) + 1)
+		     - info->start;
+	info->blksz = dev_desc->blksz;
+
+	sprintf((char *)info->name, "%s", print_efiname(pte));
+	sprintf((char *)info->type, "U-Boot");
+	info->bootable = is_bootable(pte);
+#ifdef CONFIG_PARTITION_UUIDS
+	uuid_string(pte->unique_partition_guid.b, info->uuid);
+#endif
+
+	debug("%s: start 0x" LBAF ", size 0x" LBAF ", name %s", __func__,
+	      info->start, info->size, info->name);
+}
+
 #ifdef CONFIG_EFI_PARTITION
 /*
  * Public Functions (include/part.h)
@@ -169,29 +191,41 @@ int get_partition_info_efi(block_dev_desc_t * dev_desc, int part,
 		return -1;
 	}
 
-	/* The ulong casting limits the maximum disk size to 2 TB */
-	info->start = (u64)le64_to_cpu(gpt_pte[part - 1].starting_lba);
-	/* The ending LBA is inclusive, to calculate size, add 1 to it */
-	info->size = ((u64)le64_to_cpu(gpt_pte[part - 1].ending_lba) + 1)
-		     - info->start;
-	info->blksz = dev_desc->blksz;
-
-	sprintf((char *)info->name, "%s",
-			print_efiname(&gpt_pte[part - 1]));
-	sprintf((char *)info->type, "U-Boot");
-	info->bootable = is_bootable(&gpt_pte[part - 1]);
-#ifdef CONFIG_PARTITION_UUIDS
-	uuid_string(gpt_pte[part - 1].unique_partition_guid.b, info->uuid);
-#endif
-
-	debug("%s: start 0x" LBAF ", size 0x" LBAF ", name %s", __func__,
-	      info->start, info->size, info->name);
+	pte_to_info(dev_desc, &gpt_pte[part - 1], info);
 
 	/* Remember to free pte */
 	free(gpt_pte);
 	return 0;
 }
 
+int get_partition_info_efi_by_name(block_dev_desc_t *dev_desc,
+				   const char *name, disk_partition_t *info)
+{
+	ALLOC_CACHE_ALIGN_BUFFER_PAD(gpt_header, gpt_head, 1, dev_desc->blksz);
+	gpt_entry *gpt_pte = NULL;
+	int i, part = -1;
+
+	if (is_gpt_valid(dev_desc, GPT_PRIMARY_PARTITION_TABLE_LBA,
+			 gpt_head, &gpt_pte) != 1) {
+		printf("%s: *** ERROR: Invalid GPT ***\n", __func__);
+		return -1;
+	}
+
+	/* One read of the table, rather than one per partition number */
+	for (i = 0; i < le32_to_cpu(gpt_head->num_partition_entries); i++) {
+		if (!is_pte_valid(&gpt_pte[i]))
+			continue;
+		if (!strcmp(print_efiname(&gpt_pte[i]), name)) {
+			pte_to_info(dev_desc, &gpt_pte[i], info);
+			part = i + 1;
+			break;
+		}
+	}
+
+	free(gpt_pte);
+	return part;
+}
+
 int test_part_efi(block_dev_desc_t * dev_desc)
 {
 	ALLOC_CACHE_ALIGN_BUFFER_PAD(legacy_mbr, legacymbr, 1, dev_desc->blksz);
@@ -301,6 +335,9 @@ int write_gpt_table(block_dev_desc_t *dev_desc,
 	u64 val;
 
 	debug("max lba: %x\n", (u32) dev_desc->lba);
+	/* The partitions the filesystems were mounted from are changing */
+	fs_invalidate_dev(dev_desc);
+
 	/* Setup the Protective MBR */
 	if (set_protective_mbr(dev_desc) < 0)
 		goto err;
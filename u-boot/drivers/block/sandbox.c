@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * Block devices backed by files on the host, so that filesystem code can
+ * be run against real images under sandbox. Bind a file with
+ * 'sb bind <dev> <file>', then use it as interface "hostfile".
+ */
+
+#include <common.h>
+#include <fs.h>
+#include <malloc.h>
+#include <os.h>
+#include <part.h>
+
+#ifndef CONFIG_SANDBOX_BLOCK_DEVS
+#define CONFIG_SANDBOX_BLOCK_DEVS	4
+#endif
+
+#define SANDBOX_BLK_SZ		512
+
+struct host_block_dev {
+	block_dev_desc_t blk_dev;
+	char *filename;
+	int fd;
+	ulong blks_read;	/* since bound, or last shown */
+	ulong blks_written;
+};
+
+static struct host_block_dev host_devices[CONFIG_SANDBOX_BLOCK_DEVS];
+
+static struct host_block_dev *find_host_device(int dev)
+{
+	if (dev < 0 || dev >= CONFIG_SANDBOX_BLOCK_DEVS)
+		return NULL;
+
+	return host_devices[dev].filename ? &host_devices[dev] : NULL;
+}
+
+static unsigned long host_block_read(int dev, lbaint_t start,
+				     lbaint_t blkcnt, void *buffer)
+{
+	struct host_block_dev *host_dev = find_host_device(dev);
+	ssize_t len = blkcnt * SANDBOX_BLK_SZ;
+
+	if (!host_dev)
+		return 0;
+	if (os_lseek(host_dev->fd, (off_t)start * SANDBOX_BLK_SZ,
+		     OS_SEEK_SET) < 0)
+		return 0;
+	if (os_read(host_dev->fd, buffer, len) != len)
+		return 0;
+	host_dev->blks_read += blkcnt;
+
+	return blkcnt;
+}
+
+static unsigned long host_block_write(int dev, lbaint_t start,
+				      lbaint_t blkcnt, const void *buffer)
+{
+	struct host_block_dev *host_dev = find_host_device(dev);
+	ssize_t len = blkcnt * SANDBOX_BLK_SZ;
+
+	if (!host_dev)
+		return 0;
+	if (os_lseek(host_dev->fd, (off_t)start * SANDBOX_BLK_SZ,
+		     OS_SEEK_SET) < 0)
+		return 0;
+	if (os_write(host_dev->fd, buffer, len) != len)
+		return 0;
+	host_dev->blks_written += blkcnt;
+
+	return blkcnt;
+}
+
+int host_dev_bind(int dev, const char *filename)
+{
+	struct host_block_dev *host_dev;
+	block_dev_desc_t *blk_dev;
+	off_t size;
+	int fd;
+
+	if (dev < 0 || dev >= CONFIG_SANDBOX_BLOCK_DEVS)
+		return -1;
+	host_dev = &host_devices[dev];
+	if (host_dev->filename) {
+		fs_invalidate_dev(&host_dev->blk_dev);
+		os_close(host_dev->fd);
+		free(host_dev->filename);
+		host_dev->filename = NULL;
+	}
+	if (!filename)
+		return 0;
+
+	fd = os_open(filename, OS_O_RDWR);
+	if (fd < 0) {
+		printf("Cannot open '%s'\n", filename);
+		return -1;
+	}
+	size = os_lseek(fd, 0, OS_SEEK_END);
+	if (size < SANDBOX_BLK_SZ) {
+		printf("'%s' is too small\n", filename);
+		os_close(fd);
+		return -1;
+	}
+	host_dev->filename = strdup(filename);
+	if (!host_dev->filename) {
+		os_close(fd);
+		return -1;
+	}
+	host_dev->fd = fd;
+	host_dev->blks_read = 0;
+	host_dev->blks_written = 0;
+
+	blk_dev = &host_dev->blk_dev;
+	memset(blk_dev, 0, sizeof(*blk_dev));
+	blk_dev->if_type = IF_TYPE_UNKNOWN;
+	blk_dev->dev = dev;
+	blk_dev->part_type = PART_TYPE_UNKNOWN;
+	blk_dev->type = DEV_TYPE_HARDDISK;
+	blk_dev->blksz = SANDBOX_BLK_SZ;
+	blk_dev->log2blksz = LOG2(SANDBOX_BLK_SZ);
+	blk_dev->lba = size / SANDBOX_BLK_SZ;
+	blk_dev->block_read = host_block_read;
+	blk_dev->block_write = host_block_write;
+	blk_dev->priv = host_dev;
+	init_part(blk_dev);
+
+	return 0;
+}
+
+block_dev_desc_t *host_get_dev(int dev)
+{
+	struct host_block_dev *host_dev = find_host_device(dev);
+
+	return host_dev ? &host_dev->blk_dev : NULL;
+}
+
+void host_dev_show(void)
+{
+	struct host_block_dev *host_dev;
+	int dev;
+
+	for (dev = 0; dev < CONFIG_SANDBOX_BLOCK_DEVS; dev++) {
+		host_dev = find_host_device(dev);
+		if (!host_dev)
+			continue;
+		printf("hostfile %d: %s, %lu blocks, %lu read, %lu written\n",
+		       dev, host_dev->filename, (ulong)host_dev->blk_dev.lba,
+		       host_dev->blks_read, host_dev->blks_written);
+		host_dev->blks_read = 0;
+		host_dev->blks_written = 0;
+	}
+}
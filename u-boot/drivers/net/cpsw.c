@@ -862,6 +862,27 @@ static int cpsw_init(struct eth_device *dev, bd_t *bis)
 	return 0;
 }
 
+#ifdef CONFIG_MCAST_TFTP
+/* Join or leave a multicast group: pass its frames to the host port */
+static int cpsw_mcast(struct eth_device *dev, const u8 *enetaddr, u8 set)
+{
+	struct cpsw_priv *priv = dev->priv;
+	u32 ale_entry[ALE_ENTRY_WORDS] = {0, 0, 0};
+	int idx;
+
+	if (set)
+		return cpsw_ale_add_mcast(priv, (u8 *)enetaddr,
+					  1 << priv->host_port);
+
+	/* writing an empty entry frees it */
+	idx = cpsw_ale_match_addr(priv, (u8 *)enetaddr);
+	if (idx >= 0)
+		cpsw_ale_write(priv, idx, ale_entry);
+
+	return 0;
+}
+#endif
+
 static void cpsw_halt(struct eth_device *dev)
 {
 	struct cpsw_priv	*priv = dev->priv;
@@ -1004,6 +1025,9 @@ int cpsw_register(struct cpsw_platform_data *data)
 	dev->halt	= cpsw_halt;
 	dev->send	= cpsw_send;
 	dev->recv	= cpsw_recv;
+#ifdef CONFIG_MCAST_TFTP
+	dev->mcast	= cpsw_mcast;
+#endif
 	dev->priv	= priv;
 
 	eth_register(dev);
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * Directory lookup cache shared by the filesystem drivers. An entry maps
+ * a name in a directory (inode number or first cluster, whatever the
+ * driver uses) of a partition to the driver's own record of what it found
+ * there, or to the fact that the name does not exist. Once a path has
+ * been looked up, doing it again does not read the disk.
+ */
+
+#include <common.h>
+#include <fs.h>
+
+#ifndef CONFIG_FS_DENTRY_CACHE_ENTRIES
+#define CONFIG_FS_DENTRY_CACHE_ENTRIES	64
+#endif
+
+struct dentry {
+	block_dev_desc_t *dev_desc;	/* NULL if unused */
+	lbaint_t part_start;
+	ulong dir;
+	char name[DENTRY_NAME_LEN];
+	int len;			/* of data, -1 if the name is absent */
+	ulong last_used;
+	u8 data[DENTRY_DATA_LEN];
+};
+
+static struct dentry dentries[CONFIG_FS_DENTRY_CACHE_ENTRIES];
+static ulong dentry_clock;
+static ulong dentry_lookups, dentry_hits, dentry_negative_hits;
+
+static struct dentry *dentry_find(block_dev_desc_t *dev_desc,
+				  lbaint_t part_start, ulong dir,
+				  const char *name)
+{
+	struct dentry *dent;
+	int i;
+
+	for (i = 0, dent = dentries; i < CONFIG_FS_DENTRY_CACHE_ENTRIES;
+			i++, dent++) {
+		if (dent->dev_desc == dev_desc && dent->dir == dir &&
+		    dent->part_start == part_start && !strcmp(dent->name, name))
+			return dent;
+	}
+
+	return NULL;
+}
+
+int dentry_cache_lookup(block_dev_desc_t *dev_desc, lbaint_t part_start,
+			ulong dir, const char *name, void *data, int len)
+{
+	struct dentry *dent;
+
+	if (!dev_desc)
+		return -1;
+
+	dentry_lookups++;
+	dent = dentry_find(dev_desc, part_start, dir, name);
+	if (!dent || (dent->len >= 0 && dent->len != len))
+		return -1;
+
+	dent->last_used = ++dentry_clock;
+	if (dent->len < 0) {
+		dentry_negative_hits++;
+		return 0;
+	}
+	memcpy(data, dent->data, len);
+	dentry_hits++;
+
+	return 1;
+}
+
+void dentry_cache_add(block_dev_desc_t *dev_desc, lbaint_t part_start,
+		      ulong dir, const char *name, const void *data, int len)
+{
+	struct dentry *dent, *oldest = dentries;
+	int i;
+
+	if (!dev_desc || strlen(name) >= DENTRY_NAME_LEN ||
+	    len > DENTRY_DATA_LEN)
+		return;
+
+	dent = dentry_find(dev_desc, part_start, dir, name);
+	if (!dent) {
+		for (i = 0, dent = dentries;
+				i < CONFIG_FS_DENTRY_CACHE_ENTRIES;
+				i++, dent++) {
+			if (!dent->dev_desc)
+				break;
+			if (dent->last_used < oldest->last_used)
+				oldest = dent;
+		}
+		if (i == CONFIG_FS_DENTRY_CACHE_ENTRIES)
+			dent = oldest;
+	}
+
+	dent->dev_desc = dev_desc;
+	dent->part_start = part_start;
+	dent->dir = dir;
+	strcpy(dent->name, name);
+	dent->last_used = ++dentry_clock;
+	if (data) {
+		memcpy(dent->data, data, len);
+		dent->len = len;
+	} else {
+		dent->len = -1;
+	}
+}
+
+void dentry_cache_invalidate(block_dev_desc_t *dev_desc)
+{
+	struct dentry *dent;
+	int i;
+
+	for (i = 0, dent = dentries; i < CONFIG_FS_DENTRY_CACHE_ENTRIES;
+			i++, dent++) {
+		if (!dev_desc || dent->dev_desc == dev_desc)
+			dent->dev_desc = NULL;
+	}
+}
+
+void dentry_cache_show(void)
+{
+	int i, used = 0, negative = 0;
+
+	for (i = 0; i < CONFIG_FS_DENTRY_CACHE_ENTRIES; i++) {
+		if (!dentries[i].dev_desc)
+			continue;
+		used++;
+		if (dentries[i].len < 0)
+			negative++;
+	}
+	printf("Dentry cache: %d of %d entries used, %d negative\n", used,
+	       CONFIG_FS_DENTRY_CACHE_ENTRIES, negative);
+	printf("%lu lookups, %lu hits, %lu negative hits, %lu misses\n",
+	       dentry_lookups, dentry_hits, dentry_negative_hits,
+	       dentry_lookups - dentry_hits - dentry_negative_hits);
+}
+
+void dentry_cache_reset_stats(void)
+{
+	dentry_lookups = 0;
+	dentry_hits = 0;
+	dentry_negative_hits = 0;
+}
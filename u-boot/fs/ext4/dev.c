@@ -45,6 +45,13 @@ void ext4fs_set_blk_dev(block_dev_desc_t *rbdd, disk_partition_t *info)
 		get_fs()->dev_desc->log2blksz;
 }
 
+/* Tell whether the filesystem on 'info' of 'rbdd' is the one mounted */
+int ext4fs_mounted(block_dev_desc_t *rbdd, disk_partition_t *info)
+{
+	return ext4fs_root && ext4fs_block_dev_desc == rbdd &&
+		part_offset == info->start;
+}
+
 int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf)
 {
 	unsigned block_len;
@@ -22,6 +22,7 @@
 #include <common.h>
 #include <ext_common.h>
 #include <ext4fs.h>
+#include <fs.h>
 #include <malloc.h>
 #include <stddef.h>
 #include <linux/stat.h>
@@ -184,6 +185,11 @@ static int _get_new_blk_no(unsigned char *buffer)
 	return -1;
 }
 
+static inline void ext4fs_bmap_dirty(int index, int flag)
+{
+	get_fs()->bmap_flags[index] |= flag;
+}
+
 int ext4fs_set_block_bmap(long int blockno, unsigned char *buffer, int index)
 {
 	int i, remainder, status;
@@ -193,6 +199,9 @@ int ext4fs_set_block_bmap(long int blockno, unsigned char *buffer, int index)
 	remainder = blockno % 8;
 	int blocksize = EXT2_BLOCK_SIZE(ext4fs_root);
 
+	if (!buffer)
+		return -1;
+
 	i = i - (index * blocksize);
 	if (blocksize != 1024) {
 		ptr = ptr + i;
@@ -202,6 +211,7 @@ int ext4fs_set_block_bmap(long int blockno, unsigned char *buffer, int index)
 			return -1;
 
 		*ptr = *ptr | operand;
+		ext4fs_bmap_dirty(index, EXT4_BMAP_BLK_DIRTY);
 		return 0;
 	} else {
 		if (remainder == 0) {
@@ -216,6 +226,7 @@ int ext4fs_set_block_bmap(long int blockno, unsigned char *buffer, int index)
 			return -1;
 
 		*ptr = *ptr | operand;
+		ext4fs_bmap_dirty(index, EXT4_BMAP_BLK_DIRTY);
 		return 0;
 	}
 }
@@ -229,13 +240,18 @@ void ext4fs_reset_block_bmap(long int blockno, unsigned char *buffer, int index)
 	remainder = blockno % 8;
 	int blocksize = EXT2_BLOCK_SIZE(ext4fs_root);
 
+	if (!buffer)
+		return;
+
 	i = i - (index * blocksize);
 	if (blocksize != 1024) {
 		ptr = ptr + i;
 		operand = (1 << remainder);
 		status = *ptr & operand;
-		if (status)
+		if (status) {
 			*ptr = *ptr & ~(operand);
+			ext4fs_bmap_dirty(index, EXT4_BMAP_BLK_DIRTY);
+		}
 	} else {
 		if (remainder == 0) {
 			ptr = ptr + i - 1;
@@ -245,8 +261,10 @@ void ext4fs_reset_block_bmap(long int blockno, unsigned char *buffer, int index)
 			operand = (1 << (remainder - 1));
 		}
 		status = *ptr & operand;
-		if (status)
+		if (status) {
 			*ptr = *ptr & ~(operand);
+			ext4fs_bmap_dirty(index, EXT4_BMAP_BLK_DIRTY);
+		}
 	}
 }
 
@@ -256,6 +274,8 @@ int ext4fs_set_inode_bmap(int inode_no, unsigned char *buffer, int index)
 	unsigned char *ptr = buffer;
 	unsigned char operand;
 
+	if (!buffer)
+		return -1;
 	inode_no -= (index * ext4fs_root->sblock.inodes_per_group);
 	i = inode_no / 8;
 	remainder = inode_no % 8;
@@ -271,6 +291,7 @@ int ext4fs_set_inode_bmap(int inode_no, unsigned char *buffer, int index)
 		return -1;
 
 	*ptr = *ptr | operand;
+	ext4fs_bmap_dirty(index, EXT4_BMAP_INODE_DIRTY);
 
 	return 0;
 }
@@ -281,6 +302,8 @@ void ext4fs_reset_inode_bmap(int inode_no, unsigned char *buffer, int index)
 	unsigned char *ptr = buffer;
 	unsigned char operand;
 
+	if (!buffer)
+		return;
 	inode_no -= (index * ext4fs_root->sblock.inodes_per_group);
 	i = inode_no / 8;
 	remainder = inode_no % 8;
@@ -292,8 +315,54 @@ void ext4fs_reset_inode_bmap(int inode_no, unsigned char *buffer, int index)
 		operand = (1 << (remainder - 1));
 	}
 	status = *ptr & operand;
-	if (status)
+	if (status) {
 		*ptr = *ptr & ~(operand);
+		ext4fs_bmap_dirty(index, EXT4_BMAP_INODE_DIRTY);
+	}
+}
+
+/*
+ * Bitmaps are read when their group is first touched, not all at once in
+ * ext4fs_init(): a small write touches only a group or two. A bitmap the
+ * group descriptor marks uninitialised is not read; it starts out clear.
+ */
+static unsigned char *ext4fs_load_bmap(unsigned char **bmaps, int index,
+				       uint32_t blkno, int uninit)
+{
+	struct ext_filesystem *fs = get_fs();
+	unsigned char *buf = bmaps[index];
+
+	if (buf)
+		return buf;
+	buf = memalign(ARCH_DMA_MINALIGN, fs->blksz);
+	if (!buf)
+		return NULL;
+	if (uninit) {
+		memset(buf, '\0', fs->blksz);
+	} else if (!ext4fs_devread((lbaint_t)blkno * fs->sect_perblk, 0,
+				   fs->blksz, (char *)buf)) {
+		free(buf);
+		return NULL;
+	}
+	bmaps[index] = buf;
+
+	return buf;
+}
+
+unsigned char *ext4fs_blk_bmap(int index)
+{
+	struct ext_filesystem *fs = get_fs();
+
+	return ext4fs_load_bmap(fs->blk_bmaps, index, fs->bgd[index].block_id,
+				fs->bgd[index].bg_flags & EXT4_BG_BLOCK_UNINIT);
+}
+
+unsigned char *ext4fs_inode_bmap(int index)
+{
+	struct ext_filesystem *fs = get_fs();
+
+	return ext4fs_load_bmap(fs->inode_bmaps, index, fs->bgd[index].inode_id,
+				fs->bgd[index].bg_flags & EXT4_BG_INODE_UNINIT);
 }
 
 int ext4fs_checksum_update(unsigned int i)
@@ -849,8 +918,10 @@ long int ext4fs_get_new_blk_no(void)
 {
 	short i;
 	short status;
+	int n;
 	int remainder;
 	unsigned int bg_idx;
+	unsigned char *bmap;
 	static int prev_bg_bitmap_index = -1;
 	unsigned int blk_per_grp = ext4fs_root->sblock.blocks_per_group;
 	struct ext_filesystem *fs = get_fs();
@@ -861,8 +932,15 @@ long int ext4fs_get_new_blk_no(void)
 	struct ext2_block_group *bgd = (struct ext2_block_group *)fs->gdtable;
 
 	if (fs->first_pass_bbmap == 0) {
-		for (i = 0; i < fs->no_blkgrp; i++) {
+		/* groups whose bitmap is already in memory are tried first */
+		for (n = 0; n < 2 * fs->no_blkgrp; n++) {
+			i = n % fs->no_blkgrp;
+			if ((n < fs->no_blkgrp) != (fs->blk_bmaps[i] != NULL))
+				continue;
 			if (bgd[i].free_blocks) {
+				bmap = ext4fs_blk_bmap(i);
+				if (!bmap)
+					goto fail;
 				if (bgd[i].bg_flags & EXT4_BG_BLOCK_UNINIT) {
 					put_ext4(((uint64_t) (bgd[i].block_id *
 							      fs->blksz)),
@@ -870,14 +948,13 @@ long int ext4fs_get_new_blk_no(void)
 					bgd[i].bg_flags =
 					    bgd[i].
 					    bg_flags & ~EXT4_BG_BLOCK_UNINIT;
-					memcpy(fs->blk_bmaps[i], zero_buffer,
-					       fs->blksz);
+					memcpy(bmap, zero_buffer, fs->blksz);
 				}
-				fs->curr_blkno =
-				    _get_new_blk_no(fs->blk_bmaps[i]);
+				fs->curr_blkno = _get_new_blk_no(bmap);
 				if (fs->curr_blkno == -1)
 					/* if block bitmap is completely fill */
 					continue;
+				ext4fs_bmap_dirty(i, EXT4_BMAP_BLK_DIRTY);
 				fs->curr_blkno = fs->curr_blkno +
 						(i * fs->blksz * 8);
 				fs->first_pass_bbmap++;
@@ -927,17 +1004,19 @@ restart:
 			goto restart;
 		}
 
+		bmap = ext4fs_blk_bmap(bg_idx);
+		if (!bmap)
+			goto fail;
 		if (bgd[bg_idx].bg_flags & EXT4_BG_BLOCK_UNINIT) {
 			memset(zero_buffer, '\0', fs->blksz);
 			put_ext4(((uint64_t) (bgd[bg_idx].block_id *
 					fs->blksz)), zero_buffer, fs->blksz);
-			memcpy(fs->blk_bmaps[bg_idx], zero_buffer, fs->blksz);
+			memcpy(bmap, zero_buffer, fs->blksz);
 			bgd[bg_idx].bg_flags = bgd[bg_idx].bg_flags &
 						~EXT4_BG_BLOCK_UNINIT;
 		}
 
-		if (ext4fs_set_block_bmap(fs->curr_blkno, fs->blk_bmaps[bg_idx],
-				   bg_idx) != 0) {
+		if (ext4fs_set_block_bmap(fs->curr_blkno, bmap, bg_idx) != 0) {
 			debug("going for restart for the block no %ld %u\n",
 			      fs->curr_blkno, bg_idx);
 			goto restart;
@@ -973,11 +1052,173 @@ fail:
 	return -1;
 }
 
+/* Length of the free run starting at bit @bit of a block bitmap */
+static unsigned int ext4fs_free_run(const unsigned char *bmap,
+				    unsigned int bit, unsigned int nbits,
+				    unsigned int want)
+{
+	unsigned int len = 0;
+
+	while (bit + len < nbits && len < want) {
+		if (!((bit + len) & 7) && bit + len + 8 <= nbits &&
+		    !bmap[(bit + len) >> 3]) {
+			len += 8;
+			continue;
+		}
+		if (bmap[(bit + len) >> 3] & (1 << ((bit + len) & 7)))
+			break;
+		len++;
+	}
+
+	return min(len, want);
+}
+
+/*
+ * Find free blocks in a block bitmap, from bit @from on: the first run of
+ * @want or more, or failing that the longest run.
+ *
+ * @return length of the run (at most @want), with its first bit in @start
+ */
+static unsigned int ext4fs_find_free_run(const unsigned char *bmap,
+					 unsigned int from, unsigned int nbits,
+					 unsigned int want, unsigned int *start)
+{
+	unsigned int bit, len, best = 0;
+
+	for (bit = from; bit < nbits && best < want; ) {
+		if (!(bit & 7) && bmap[bit >> 3] == 0xff) {
+			bit += 8;
+			continue;
+		}
+		len = ext4fs_free_run(bmap, bit, nbits, want);
+		if (len > best) {
+			best = len;
+			*start = bit;
+		}
+		bit += len + 1;
+	}
+
+	return best;
+}
+
+/*
+ * Allocate up to @want contiguous blocks from one block group. The run
+ * carries on from the last block allocated if it can, so that a file
+ * written in several calls stays in one piece. Otherwise the first run
+ * of @want, or of EXT4_GOOD_RUN blocks, is taken, looking first in groups
+ * whose bitmaps are already in memory; failing that, the longest run in
+ * any group.
+ *
+ * @return first block of the run, with its length in @got, or -1 if the
+ * filesystem is full
+ */
+long int ext4fs_get_new_blk_range(unsigned int want, unsigned int *got)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext2_block_group *bgd = fs->bgd;
+	uint32_t blk_per_grp = ext4fs_root->sblock.blocks_per_group;
+	uint32_t first_blk = ext4fs_root->sblock.first_data_block;
+	uint32_t total_blks = ext4fs_root->sblock.total_blocks;
+	unsigned int i, bit, len, nbits, from, pass;
+	unsigned int good = min(want, (unsigned)EXT4_GOOD_RUN);
+	unsigned int best = 0, best_bit = 0, best_grp = 0;
+	long int goal_grp = -1;
+	unsigned char *bmap;
+	char *journal_buffer;
+	int n;
+
+	if (fs->first_pass_bbmap && fs->curr_blkno + 1 < total_blks)
+		goal_grp = (fs->curr_blkno + 1 - first_blk) / blk_per_grp;
+
+	for (n = -1; n < 2 * (int)fs->no_blkgrp; n++) {
+		pass = n < 0 ? 0 : n / fs->no_blkgrp;
+		if (n < 0) {
+			if (goal_grp < 0)
+				continue;
+			i = goal_grp;
+			from = fs->curr_blkno + 1 - first_blk - i * blk_per_grp;
+		} else {
+			i = n % fs->no_blkgrp;
+			if (!pass != (fs->blk_bmaps[i] != NULL))
+				continue;
+			from = 0;
+		}
+		if (!bgd[i].free_blocks)
+			continue;
+		bmap = ext4fs_blk_bmap(i);
+		if (!bmap)
+			return -1;
+		nbits = min(blk_per_grp, total_blks - first_blk -
+			    i * blk_per_grp);
+
+		if (n < 0) {
+			/* carry on from the last block if it is free */
+			bit = from;
+			len = ext4fs_free_run(bmap, from, nbits, want);
+			if (len)
+				goto found;
+			continue;
+		}
+		len = ext4fs_find_free_run(bmap, 0, nbits, good, &bit);
+		if (len >= good)
+			goto found;
+		if (len > best) {
+			best = len;
+			best_bit = bit;
+			best_grp = i;
+		}
+	}
+	if (!best)
+		return -1;
+	/* nothing long enough anywhere: make do with the longest run */
+	i = best_grp;
+	bit = best_bit;
+	bmap = ext4fs_blk_bmap(i);
+	if (!bmap)
+		return -1;
+	nbits = min(blk_per_grp, total_blks - first_blk - i * blk_per_grp);
+
+found:
+	/* a run of @good may carry on for the whole of @want */
+	len = ext4fs_free_run(bmap, bit, nbits, want);
+
+	/* journal the bitmap as it was before this transaction */
+	if (!(fs->bmap_flags[i] & EXT4_BMAP_BLK_DIRTY) &&
+	    !(bgd[i].bg_flags & EXT4_BG_BLOCK_UNINIT)) {
+		journal_buffer = zalloc(fs->blksz);
+		if (!journal_buffer)
+			return -1;
+		if (!ext4fs_devread((lbaint_t)bgd[i].block_id *
+				    fs->sect_perblk, 0, fs->blksz,
+				    journal_buffer) ||
+		    ext4fs_log_journal(journal_buffer, bgd[i].block_id)) {
+			free(journal_buffer);
+			return -1;
+		}
+		free(journal_buffer);
+	}
+	bgd[i].bg_flags &= ~EXT4_BG_BLOCK_UNINIT;
+	ext4fs_bmap_dirty(i, EXT4_BMAP_BLK_DIRTY);
+
+	for (from = bit; from < bit + len; from++)
+		bmap[from >> 3] |= 1 << (from & 7);
+	bgd[i].free_blocks -= len;
+	fs->sb->free_blocks -= len;
+
+	*got = len;
+	fs->curr_blkno = first_blk + i * blk_per_grp + bit + len - 1;
+	fs->first_pass_bbmap++;
+
+	return first_blk + i * blk_per_grp + bit;
+}
+
 int ext4fs_get_new_inode_no(void)
 {
 	short i;
 	short status;
+	int n;
 	unsigned int ibmap_idx;
+	unsigned char *bmap;
 	static int prev_inode_bitmap_index = -1;
 	unsigned int inodes_per_grp = ext4fs_root->sblock.inodes_per_group;
 	struct ext_filesystem *fs = get_fs();
@@ -988,8 +1229,15 @@ int ext4fs_get_new_inode_no(void)
 	struct ext2_block_group *bgd = (struct ext2_block_group *)fs->gdtable;
 
 	if (fs->first_pass_ibmap == 0) {
-		for (i = 0; i < fs->no_blkgrp; i++) {
+		/* groups whose bitmap is already in memory are tried first */
+		for (n = 0; n < 2 * fs->no_blkgrp; n++) {
+			i = n % fs->no_blkgrp;
+			if ((n < fs->no_blkgrp) != (fs->inode_bmaps[i] != NULL))
+				continue;
 			if (bgd[i].free_inodes) {
+				bmap = ext4fs_inode_bmap(i);
+				if (!bmap)
+					goto fail;
 				if (bgd[i].bg_itable_unused !=
 						bgd[i].free_inodes)
 					bgd[i].bg_itable_unused =
@@ -1001,14 +1249,13 @@ int ext4fs_get_new_inode_no(void)
 						 zero_buffer, fs->blksz);
 					bgd[i].bg_flags = bgd[i].bg_flags &
 							~EXT4_BG_INODE_UNINIT;
-					memcpy(fs->inode_bmaps[i],
-					       zero_buffer, fs->blksz);
+					memcpy(bmap, zero_buffer, fs->blksz);
 				}
-				fs->curr_inode_no =
-				    _get_new_inode_no(fs->inode_bmaps[i]);
+				fs->curr_inode_no = _get_new_inode_no(bmap);
 				if (fs->curr_inode_no == -1)
 					/* if block bitmap is completely fill */
 					continue;
+				ext4fs_bmap_dirty(i, EXT4_BMAP_INODE_DIRTY);
 				fs->curr_inode_no = fs->curr_inode_no +
 							(i * inodes_per_grp);
 				fs->first_pass_ibmap++;
@@ -1035,6 +1282,11 @@ restart:
 		fs->curr_inode_no++;
 		/* get the blockbitmap index respective to blockno */
 		ibmap_idx = fs->curr_inode_no / inodes_per_grp;
+		if (ibmap_idx >= fs->no_blkgrp)
+			goto fail;
+		bmap = ext4fs_inode_bmap(ibmap_idx);
+		if (!bmap)
+			goto fail;
 		if (bgd[ibmap_idx].bg_flags & EXT4_BG_INODE_UNINIT) {
 			memset(zero_buffer, '\0', fs->blksz);
 			put_ext4(((uint64_t) (bgd[ibmap_idx].inode_id *
@@ -1042,12 +1294,10 @@ restart:
 				 fs->blksz);
 			bgd[ibmap_idx].bg_flags =
 			    bgd[ibmap_idx].bg_flags & ~EXT4_BG_INODE_UNINIT;
-			memcpy(fs->inode_bmaps[ibmap_idx], zero_buffer,
-				fs->blksz);
+			memcpy(bmap, zero_buffer, fs->blksz);
 		}
 
-		if (ext4fs_set_inode_bmap(fs->curr_inode_no,
-					  fs->inode_bmaps[ibmap_idx],
+		if (ext4fs_set_inode_bmap(fs->curr_inode_no, bmap,
 					  ibmap_idx) != 0) {
 			debug("going for restart for the block no %d %u\n",
 			      fs->curr_inode_no, ibmap_idx);
@@ -1405,6 +1655,107 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 	*total_no_of_block += no_blks_reqd;
 }
 
+/*
+ * Allocate @total_remaining_blocks blocks for an extent-mapped file, in
+ * as few runs as the bitmaps allow. Up to four extents fit in the inode;
+ * more go in leaf blocks indexed from the inode, a tree of depth one. The
+ * leaf blocks are added to @total_no_of_block.
+ *
+ * @return 0 if ok, -1 if the filesystem is full or the file would need a
+ * deeper tree
+ */
+int ext4fs_allocate_extents(struct ext2_inode *file_inode,
+			    unsigned int total_remaining_blocks,
+			    unsigned int *total_no_of_block)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext4_extent_header *eh =
+		(struct ext4_extent_header *)file_inode->b.blocks.dir_blocks;
+	struct ext4_extent_idx *idx = (struct ext4_extent_idx *)(eh + 1);
+	unsigned int per_leaf = (fs->blksz - sizeof(*eh)) /
+				sizeof(struct ext4_extent);
+	unsigned int max_exts = EXT4_EXT_ROOT_ENTRIES * per_leaf;
+	struct ext4_extent *ext, *last = NULL;
+	unsigned int count = 0, fileblock = 0, len, n, leaves, i;
+	struct ext4_extent_header *leaf = NULL;
+	long int blknr, prev_end = -1;
+	int ret = -1;
+
+	ext = malloc(max_exts * sizeof(*ext));
+	if (!ext)
+		return -1;
+	while (total_remaining_blocks) {
+		n = min(total_remaining_blocks, (unsigned)EXT4_EXT_MAX_LEN);
+		blknr = ext4fs_get_new_blk_range(n, &len);
+		if (blknr == -1) {
+			printf("no block left to assign\n");
+			goto out;
+		}
+		debug("EXT %u: %ld +%u\n", fileblock, blknr, len);
+		if (last && blknr == prev_end &&
+		    le16_to_cpu(last->ee_len) + len <= EXT4_EXT_MAX_LEN) {
+			last->ee_len = cpu_to_le16(le16_to_cpu(last->ee_len) +
+						   len);
+		} else {
+			if (count == max_exts) {
+				printf("file too fragmented\n");
+				goto out;
+			}
+			last = &ext[count++];
+			last->ee_block = cpu_to_le32(fileblock);
+			last->ee_len = cpu_to_le16(len);
+			last->ee_start_hi = cpu_to_le16((uint64_t)blknr >> 32);
+			last->ee_start_lo = cpu_to_le32(blknr);
+		}
+		prev_end = blknr + len;
+		fileblock += len;
+		total_remaining_blocks -= len;
+	}
+
+	memset(eh, '\0', sizeof(file_inode->b.blocks));
+	eh->eh_magic = cpu_to_le16(EXT4_EXT_MAGIC);
+	eh->eh_max = cpu_to_le16(EXT4_EXT_ROOT_ENTRIES);
+	if (count <= EXT4_EXT_ROOT_ENTRIES) {
+		eh->eh_entries = cpu_to_le16(count);
+		memcpy(eh + 1, ext, count * sizeof(*ext));
+		ret = 0;
+		goto out;
+	}
+
+	/* too many for the inode: move them out to leaf blocks */
+	leaf = zalloc(fs->blksz);
+	if (!leaf)
+		goto out;
+	leaves = DIV_ROUND_UP(count, per_leaf);
+	eh->eh_entries = cpu_to_le16(leaves);
+	eh->eh_depth = cpu_to_le16(1);
+	for (i = 0; i < leaves; i++) {
+		n = min(count - i * per_leaf, per_leaf);
+		blknr = ext4fs_get_new_blk_no();
+		if (blknr == -1) {
+			printf("no block left to assign\n");
+			goto out;
+		}
+		(*total_no_of_block)++;
+		memset(leaf, '\0', fs->blksz);
+		leaf->eh_magic = cpu_to_le16(EXT4_EXT_MAGIC);
+		leaf->eh_entries = cpu_to_le16(n);
+		leaf->eh_max = cpu_to_le16(per_leaf);
+		memcpy(leaf + 1, &ext[i * per_leaf], n * sizeof(*ext));
+		put_ext4((uint64_t)blknr * fs->blksz, leaf, fs->blksz);
+
+		idx[i].ei_block = ext[i * per_leaf].ee_block;
+		idx[i].ei_leaf_lo = cpu_to_le32(blknr);
+		idx[i].ei_leaf_hi = cpu_to_le16((uint64_t)blknr >> 32);
+	}
+	ret = 0;
+out:
+	free(leaf);
+	free(ext);
+
+	return ret;
+}
+
 #endif
 
 static struct ext4_extent_header *ext4fs_get_extent_block
@@ -1414,7 +1765,6 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 {
 	struct ext4_extent_idx *index;
 	unsigned long long block;
-	struct ext_filesystem *fs = get_fs();
 	int i;
 
 	while (1) {
@@ -1430,7 +1780,7 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 			i++;
 			if (i >= le16_to_cpu(ext_block->eh_entries))
 				break;
-		} while (fileblock > le32_to_cpu(index[i].ei_block));
+		} while (fileblock >= le32_to_cpu(index[i].ei_block));
 
 		if (--i < 0)
 			return 0;
@@ -1438,8 +1788,8 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 		block = le16_to_cpu(index[i].ei_leaf_hi);
 		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
 
-		if (ext4fs_devread((lbaint_t)block << log2_blksz, 0, fs->blksz,
-				   buf))
+		if (ext4fs_devread((lbaint_t)block << log2_blksz, 0,
+				   EXT2_BLOCK_SIZE(data), buf))
 			ext_block = (struct ext4_extent_header *)buf;
 		else
 			return 0;
@@ -1873,17 +2223,44 @@ void ext4fs_close(void)
 	}
 }
 
+/* What the dentry cache keeps for a name found in a directory */
+struct ext4_dentry {
+	int ino;
+	int type;
+};
+
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 				struct ext2fs_node **fnode, int *ftype)
 {
 	unsigned int fpos = 0;
 	int status;
 	struct ext2fs_node *diro = (struct ext2fs_node *) dir;
+	int lookup = (name != NULL) && (fnode != NULL) && (ftype != NULL);
+	struct ext4_dentry dent;
 
 #ifdef DEBUG
 	if (name != NULL)
 		printf("Iterate dir %s\n", name);
 #endif /* of DEBUG */
+	if (lookup) {
+		status = dentry_cache_lookup(get_fs()->dev_desc, part_offset,
+					     diro->ino, name, &dent,
+					     sizeof(dent));
+		if (status == 0)
+			return 0;
+		if (status > 0) {
+			struct ext2fs_node *fdiro;
+
+			fdiro = zalloc(sizeof(struct ext2fs_node));
+			if (!fdiro)
+				return 0;
+			fdiro->data = diro->data;
+			fdiro->ino = dent.ino;
+			*ftype = dent.type;
+			*fnode = fdiro;
+			return 1;
+		}
+	}
 	if (!diro->inode_read) {
 		status = ext4fs_read_inode(diro->data, diro->ino, &diro->inode);
 		if (status == 0)
@@ -1957,9 +2334,14 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 #ifdef DEBUG
 			printf("iterate >%s<\n", filename);
 #endif /* of DEBUG */
-			if ((name != NULL) && (fnode != NULL)
-			    && (ftype != NULL)) {
+			if (lookup) {
 				if (strcmp(filename, name) == 0) {
+					dent.ino = fdiro->ino;
+					dent.type = type;
+					dentry_cache_add(get_fs()->dev_desc,
+							 part_offset, diro->ino,
+							 name, &dent,
+							 sizeof(dent));
 					*ftype = type;
 					*fnode = fdiro;
 					return 1;
@@ -1998,6 +2380,9 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 		}
 		fpos += __le16_to_cpu(dirent.direntlen);
 	}
+	if (lookup)
+		dentry_cache_add(get_fs()->dev_desc, part_offset, diro->ino,
+				 name, NULL, 0);
 	return 0;
 }
 
@@ -2158,33 +2543,15 @@ int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 
 int ext4fs_open(const char *filename)
 {
-	struct ext2fs_node *fdiro = NULL;
-	int status;
-	int len;
-
-	if (ext4fs_root == NULL)
-		return -1;
+	void *file;
+	loff_t len;
 
 	ext4fs_file = NULL;
-	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
-				  FILETYPE_REG);
-	if (status == 0)
-		goto fail;
-
-	if (!fdiro->inode_read) {
-		status = ext4fs_read_inode(fdiro->data, fdiro->ino,
-				&fdiro->inode);
-		if (status == 0)
-			goto fail;
-	}
-	len = __le32_to_cpu(fdiro->inode.size);
-	ext4fs_file = fdiro;
+	if (ext4_open_file(filename, &file, &len))
+		return -1;
+	ext4fs_file = file;
 
 	return len;
-fail:
-	ext4fs_free_node(fdiro, &ext4fs_root->diropen);
-
-	return -1;
 }
 
 int ext4fs_mount(unsigned part_length)
@@ -2192,6 +2559,11 @@ int ext4fs_mount(unsigned part_length)
 	struct ext2_data *data;
 	int status;
 	struct ext_filesystem *fs = get_fs();
+
+	/* Drop what is left of an earlier mount, the fs layer keeps them */
+	if (ext4fs_root != NULL)
+		ext4fs_close();
+
 	data = zalloc(SUPERBLOCK_SIZE);
 	if (!data)
 		return 0;
@@ -41,6 +41,13 @@
 #define SUPERBLOCK_SIZE	1024
 #define F_FILE			1
 
+/* Flags in ext_filesystem.bmap_flags */
+#define EXT4_BMAP_BLK_DIRTY	(1 << 0)
+#define EXT4_BMAP_INODE_DIRTY	(1 << 1)
+
+/* A free run this long is worth taking without looking further */
+#define EXT4_GOOD_RUN		1024
+
 static inline void *zalloc(size_t size)
 {
 	void *p = memalign(ARCH_DMA_MINALIGN, size);
@@ -63,16 +70,22 @@ int ext4fs_checksum_update(unsigned int i);
 int ext4fs_get_parent_inode_num(const char *dirname, char *dname, int flags);
 void ext4fs_update_parent_dentry(char *filename, int *p_ino, int file_type);
 long int ext4fs_get_new_blk_no(void);
+long int ext4fs_get_new_blk_range(unsigned int want, unsigned int *got);
 int ext4fs_get_new_inode_no(void);
 void ext4fs_reset_block_bmap(long int blockno, unsigned char *buffer,
 					int index);
 int ext4fs_set_block_bmap(long int blockno, unsigned char *buffer, int index);
 int ext4fs_set_inode_bmap(int inode_no, unsigned char *buffer, int index);
 void ext4fs_reset_inode_bmap(int inode_no, unsigned char *buffer, int index);
+unsigned char *ext4fs_blk_bmap(int index);
+unsigned char *ext4fs_inode_bmap(int index);
 int ext4fs_iget(int inode_no, struct ext2_inode *inode);
 void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 				unsigned int total_remaining_blocks,
 				unsigned int *total_no_of_block);
+int ext4fs_allocate_extents(struct ext2_inode *file_inode,
+			    unsigned int total_remaining_blocks,
+			    unsigned int *total_no_of_block);
 void put_ext4(uint64_t off, void *buf, uint32_t size);
 #endif
 #endif
@@ -25,6 +25,7 @@
 #include <common.h>
 #include <linux/stat.h>
 #include <div64.h>
+#include <fs.h>
 #include "ext4_common.h"
 
 static void ext4fs_update(void)
@@ -37,18 +38,21 @@ static void ext4fs_update(void)
 	put_ext4((uint64_t)(SUPERBLOCK_SIZE),
 		 (struct ext2_sblock *)fs->sb, (uint32_t)SUPERBLOCK_SIZE);
 
-	/* update block groups */
+	/* update block groups, writing back only the bitmaps changed */
 	for (i = 0; i < fs->no_blkgrp; i++) {
 		fs->bgd[i].bg_checksum = ext4fs_checksum_update(i);
-		put_ext4((uint64_t)(fs->bgd[i].block_id * fs->blksz),
-			 fs->blk_bmaps[i], fs->blksz);
+		if (fs->bmap_flags[i] & EXT4_BMAP_BLK_DIRTY)
+			put_ext4((uint64_t)(fs->bgd[i].block_id * fs->blksz),
+				 fs->blk_bmaps[i], fs->blksz);
 	}
 
 	/* update inode table groups */
 	for (i = 0; i < fs->no_blkgrp; i++) {
-		put_ext4((uint64_t) (fs->bgd[i].inode_id * fs->blksz),
-			 fs->inode_bmaps[i], fs->blksz);
+		if (fs->bmap_flags[i] & EXT4_BMAP_INODE_DIRTY)
+			put_ext4((uint64_t)(fs->bgd[i].inode_id * fs->blksz),
+				 fs->inode_bmaps[i], fs->blksz);
 	}
+	memset(fs->bmap_flags, 0, fs->no_blkgrp);
 
 	/* update the block group descriptor table */
 	put_ext4((uint64_t)(fs->gdtable_blkno * fs->blksz),
@@ -124,7 +128,7 @@ static void delete_single_indirect_block(struct ext2_inode *inode)
 			if (!remainder)
 				bg_idx--;
 		}
-		ext4fs_reset_block_bmap(blknr, fs->blk_bmaps[bg_idx], bg_idx);
+		ext4fs_reset_block_bmap(blknr, ext4fs_blk_bmap(bg_idx), bg_idx);
 		bgd[bg_idx].free_blocks++;
 		fs->sb->free_blocks++;
 		/* journal backup */
@@ -190,7 +194,7 @@ static void delete_double_indirect_block(struct ext2_inode *inode)
 					bg_idx--;
 			}
 			ext4fs_reset_block_bmap(*di_buffer,
-					fs->blk_bmaps[bg_idx], bg_idx);
+					ext4fs_blk_bmap(bg_idx), bg_idx);
 			di_buffer++;
 			bgd[bg_idx].free_blocks++;
 			fs->sb->free_blocks++;
@@ -221,7 +225,7 @@ static void delete_double_indirect_block(struct ext2_inode *inode)
 			if (!remainder)
 				bg_idx--;
 		}
-		ext4fs_reset_block_bmap(blknr, fs->blk_bmaps[bg_idx], bg_idx);
+		ext4fs_reset_block_bmap(blknr, ext4fs_blk_bmap(bg_idx), bg_idx);
 		bgd[bg_idx].free_blocks++;
 		fs->sb->free_blocks++;
 		/* journal backup */
@@ -304,7 +308,7 @@ static void delete_triple_indirect_block(struct ext2_inode *inode)
 				}
 
 				ext4fs_reset_block_bmap(*tip_buffer,
-							fs->blk_bmaps[bg_idx],
+							ext4fs_blk_bmap(bg_idx),
 							bg_idx);
 
 				tip_buffer++;
@@ -346,7 +350,8 @@ static void delete_triple_indirect_block(struct ext2_inode *inode)
 					bg_idx--;
 			}
 			ext4fs_reset_block_bmap(*tigp_buffer,
-						fs->blk_bmaps[bg_idx], bg_idx);
+						ext4fs_blk_bmap(bg_idx),
+						bg_idx);
 
 			tigp_buffer++;
 			bgd[bg_idx].free_blocks++;
@@ -379,7 +384,7 @@ static void delete_triple_indirect_block(struct ext2_inode *inode)
 			if (!remainder)
 				bg_idx--;
 		}
-		ext4fs_reset_block_bmap(blknr, fs->blk_bmaps[bg_idx], bg_idx);
+		ext4fs_reset_block_bmap(blknr, ext4fs_blk_bmap(bg_idx), bg_idx);
 		bgd[bg_idx].free_blocks++;
 		fs->sb->free_blocks++;
 		/* journal backup */
@@ -404,6 +409,89 @@ fail:
 	free(journal_buffer);
 }
 
+/* Free @count blocks from @blknr on, journaling each bitmap first touched */
+static int ext4fs_free_blocks(long int blknr, unsigned int count,
+			      char *journal_buffer)
+{
+	struct ext_filesystem *fs = get_fs();
+	uint32_t blk_per_grp = ext4fs_root->sblock.blocks_per_group;
+	uint32_t first_blk = ext4fs_root->sblock.first_data_block;
+	int bg_idx;
+
+	for (; count; count--, blknr++) {
+		bg_idx = (blknr - first_blk) / blk_per_grp;
+		if (bg_idx >= fs->no_blkgrp)
+			return -1;
+		if (!(fs->bmap_flags[bg_idx] & EXT4_BMAP_BLK_DIRTY)) {
+			if (!ext4fs_devread((lbaint_t)fs->bgd[bg_idx].block_id *
+					    fs->sect_perblk, 0, fs->blksz,
+					    journal_buffer))
+				return -1;
+			if (ext4fs_log_journal(journal_buffer,
+					       fs->bgd[bg_idx].block_id))
+				return -1;
+		}
+		ext4fs_reset_block_bmap(blknr, ext4fs_blk_bmap(bg_idx), bg_idx);
+		fs->bgd[bg_idx].free_blocks++;
+		fs->sb->free_blocks++;
+	}
+
+	return 0;
+}
+
+/*
+ * Free the blocks of an extent tree a run at a time, rather than looking
+ * up each block of the file, and free the tree's own blocks too.
+ */
+static int ext4fs_free_extent_tree(struct ext4_extent_header *eh,
+				   char *journal_buffer)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext4_extent *ext = (struct ext4_extent *)(eh + 1);
+	struct ext4_extent_idx *idx = (struct ext4_extent_idx *)(eh + 1);
+	unsigned int len;
+	long int blknr;
+	char *buf;
+	int i, ret = 0;
+
+	if (le16_to_cpu(eh->eh_magic) != EXT4_EXT_MAGIC)
+		return -1;
+	if (!eh->eh_depth) {
+		for (i = 0; i < le16_to_cpu(eh->eh_entries); i++) {
+			/* uninitialised extents have the top bit set */
+			len = le16_to_cpu(ext[i].ee_len);
+			if (len > EXT4_EXT_MAX_LEN)
+				len -= EXT4_EXT_MAX_LEN;
+			blknr = ((uint64_t)le16_to_cpu(ext[i].ee_start_hi) <<
+				 32) + le32_to_cpu(ext[i].ee_start_lo);
+			debug("EXT4_EXTENTS releasing %ld +%u\n", blknr, len);
+			if (ext4fs_free_blocks(blknr, len, journal_buffer))
+				return -1;
+		}
+		return 0;
+	}
+
+	buf = zalloc(fs->blksz);
+	if (!buf)
+		return -ENOMEM;
+	for (i = 0; i < le16_to_cpu(eh->eh_entries) && !ret; i++) {
+		blknr = ((uint64_t)le16_to_cpu(idx[i].ei_leaf_hi) << 32) +
+			le32_to_cpu(idx[i].ei_leaf_lo);
+		if (!ext4fs_devread((lbaint_t)blknr * fs->sect_perblk, 0,
+				    fs->blksz, buf)) {
+			ret = -1;
+			break;
+		}
+		ret = ext4fs_free_extent_tree((struct ext4_extent_header *)buf,
+					      journal_buffer);
+		if (!ret)
+			ret = ext4fs_free_blocks(blknr, 1, journal_buffer);
+	}
+	free(buf);
+
+	return ret;
+}
+
 static int ext4fs_delete_file(int inodeno)
 {
 	struct ext2_inode inode;
@@ -441,52 +529,10 @@ static int ext4fs_delete_file(int inodeno)
 		no_blocks++;
 
 	if (le32_to_cpu(inode.flags) & EXT4_EXTENTS_FL) {
-		struct ext2fs_node *node_inode =
-		    zalloc(sizeof(struct ext2fs_node));
-		if (!node_inode)
+		if (ext4fs_free_extent_tree((struct ext4_extent_header *)
+					    inode.b.blocks.dir_blocks,
+					    journal_buffer))
 			goto fail;
-		node_inode->data = ext4fs_root;
-		node_inode->ino = inodeno;
-		node_inode->inode_read = 0;
-		memcpy(&(node_inode->inode), &inode, sizeof(struct ext2_inode));
-
-		for (i = 0; i < no_blocks; i++) {
-			blknr = read_allocated_block(&(node_inode->inode), i);
-			if (fs->blksz != 1024) {
-				bg_idx = blknr / blk_per_grp;
-			} else {
-				bg_idx = blknr / blk_per_grp;
-				remainder = blknr % blk_per_grp;
-				if (!remainder)
-					bg_idx--;
-			}
-			ext4fs_reset_block_bmap(blknr, fs->blk_bmaps[bg_idx],
-						bg_idx);
-			debug("EXT4_EXTENTS Block releasing %ld: %d\n",
-			      blknr, bg_idx);
-
-			bgd[bg_idx].free_blocks++;
-			fs->sb->free_blocks++;
-
-			/* journal backup */
-			if (prev_bg_bmap_idx != bg_idx) {
-				status =
-				    ext4fs_devread((lbaint_t)
-						   bgd[bg_idx].block_id *
-						   fs->sect_perblk, 0,
-						   fs->blksz, journal_buffer);
-				if (status == 0)
-					goto fail;
-				if (ext4fs_log_journal(journal_buffer,
-							bgd[bg_idx].block_id))
-					goto fail;
-				prev_bg_bmap_idx = bg_idx;
-			}
-		}
-		if (node_inode) {
-			free(node_inode);
-			node_inode = NULL;
-		}
 	} else {
 
 		delete_single_indirect_block(&inode);
@@ -507,7 +553,7 @@ static int ext4fs_delete_file(int inodeno)
 				if (!remainder)
 					bg_idx--;
 			}
-			ext4fs_reset_block_bmap(blknr, fs->blk_bmaps[bg_idx],
+			ext4fs_reset_block_bmap(blknr, ext4fs_blk_bmap(bg_idx),
 						bg_idx);
 			debug("ActualB releasing %ld: %d\n", blknr, bg_idx);
 
@@ -566,7 +612,8 @@ static int ext4fs_delete_file(int inodeno)
 
 	/* update the respective inode bitmaps */
 	inodeno++;
-	ext4fs_reset_inode_bmap(inodeno, fs->inode_bmaps[ibmap_idx], ibmap_idx);
+	ext4fs_reset_inode_bmap(inodeno, ext4fs_inode_bmap(ibmap_idx),
+				ibmap_idx);
 	bgd[ibmap_idx].free_inodes++;
 	fs->sb->free_inodes++;
 	/* journal backup */
@@ -599,7 +646,6 @@ fail:
 
 int ext4fs_init(void)
 {
-	short status;
 	int i;
 	unsigned int real_free_blocks = 0;
 	struct ext_filesystem *fs = get_fs();
@@ -634,43 +680,12 @@ int ext4fs_init(void)
 	}
 	fs->bgd = (struct ext2_block_group *)fs->gdtable;
 
-	/* load all the available bitmap block of the partition */
-	fs->blk_bmaps = zalloc(fs->no_blkgrp * sizeof(char *));
-	if (!fs->blk_bmaps)
-		goto fail;
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		fs->blk_bmaps[i] = zalloc(fs->blksz);
-		if (!fs->blk_bmaps[i])
-			goto fail;
-	}
-
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		status =
-		    ext4fs_devread((lbaint_t)fs->bgd[i].block_id *
-				   fs->sect_perblk, 0,
-				   fs->blksz, (char *)fs->blk_bmaps[i]);
-		if (status == 0)
-			goto fail;
-	}
-
-	/* load all the available inode bitmap of the partition */
-	fs->inode_bmaps = zalloc(fs->no_blkgrp * sizeof(unsigned char *));
-	if (!fs->inode_bmaps)
+	/* bitmaps are read as groups are touched (see ext4fs_blk_bmap()) */
+	fs->blk_bmaps = calloc(fs->no_blkgrp, sizeof(unsigned char *));
+	fs->inode_bmaps = calloc(fs->no_blkgrp, sizeof(unsigned char *));
+	fs->bmap_flags = calloc(fs->no_blkgrp, 1);
+	if (!fs->blk_bmaps || !fs->inode_bmaps || !fs->bmap_flags)
 		goto fail;
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		fs->inode_bmaps[i] = zalloc(fs->blksz);
-		if (!fs->inode_bmaps[i])
-			goto fail;
-	}
-
-	for (i = 0; i < fs->no_blkgrp; i++) {
-		status = ext4fs_devread((lbaint_t)fs->bgd[i].inode_id *
-					fs->sect_perblk,
-					0, fs->blksz,
-					(char *)fs->inode_bmaps[i]);
-		if (status == 0)
-			goto fail;
-	}
 
 	/*
 	 * check filesystem consistency with free blocks of file system
@@ -740,7 +755,8 @@ void ext4fs_deinit(void)
 		free(fs->inode_bmaps);
 		fs->inode_bmaps = NULL;
 	}
-
+	free(fs->bmap_flags);
+	fs->bmap_flags = NULL;
 
 	free(fs->gdtable);
 	fs->gdtable = NULL;
@@ -834,6 +850,75 @@ static int ext4fs_write_file(struct ext2_inode *file_inode,
 	return len;
 }
 
+/* Write the data of the extents in one leaf, one put_ext4() each */
+static void ext4fs_write_leaf(struct ext4_extent_header *eh, char *buf,
+			      unsigned int len, char *tail)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext4_extent *ext = (struct ext4_extent *)(eh + 1);
+	uint64_t start;
+	unsigned int off, size, whole;
+	int i;
+
+	for (i = 0; i < le16_to_cpu(eh->eh_entries); i++) {
+		off = le32_to_cpu(ext[i].ee_block) * fs->blksz;
+		if (off >= len)
+			break;
+		start = ((uint64_t)le16_to_cpu(ext[i].ee_start_hi) << 32) +
+			le32_to_cpu(ext[i].ee_start_lo);
+		start *= fs->blksz;
+		size = min(len - off, le16_to_cpu(ext[i].ee_len) * fs->blksz);
+		whole = size & ~(fs->blksz - 1);
+		if (whole)
+			put_ext4(start, buf + off, whole);
+		/* pad the last block rather than read past the buffer */
+		if (size > whole) {
+			memset(tail, '\0', fs->blksz);
+			memcpy(tail, buf + off + whole, size - whole);
+			put_ext4(start + whole, tail, fs->blksz);
+		}
+	}
+}
+
+/* Write the contents of an extent-mapped file, extent by extent */
+static int ext4fs_write_extents(struct ext2_inode *file_inode, char *buf,
+				unsigned int len)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext4_extent_header *eh =
+		(struct ext4_extent_header *)file_inode->b.blocks.dir_blocks;
+	struct ext4_extent_idx *idx = (struct ext4_extent_idx *)(eh + 1);
+	char *tail = zalloc(fs->blksz);
+	char *leaf = zalloc(fs->blksz);
+	long int blknr;
+	int i, ret = 0;
+
+	if (!tail || !leaf) {
+		ret = -ENOMEM;
+		goto fail;
+	}
+	if (!eh->eh_depth) {
+		ext4fs_write_leaf(eh, buf, len, tail);
+		goto fail;
+	}
+	for (i = 0; i < le16_to_cpu(eh->eh_entries); i++) {
+		blknr = ((uint64_t)le16_to_cpu(idx[i].ei_leaf_hi) << 32) +
+			le32_to_cpu(idx[i].ei_leaf_lo);
+		if (!ext4fs_devread((lbaint_t)blknr * fs->sect_perblk, 0,
+				    fs->blksz, leaf)) {
+			ret = -1;
+			break;
+		}
+		ext4fs_write_leaf((struct ext4_extent_header *)leaf, buf, len,
+				  tail);
+	}
+fail:
+	free(leaf);
+	free(tail);
+
+	return ret;
+}
+
 int ext4fs_write(const char *fname, unsigned char *buffer,
 					unsigned long sizebytes)
 {
@@ -859,6 +944,7 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	ALLOC_CACHE_ALIGN_BUFFER(char, filename, 256);
 	memset(filename, 0x00, sizeof(filename));
 
+	dentry_cache_invalidate(fs->dev_desc);
 	g_parent_inode = zalloc(sizeof(struct ext2_inode));
 	if (!g_parent_inode)
 		goto fail;
@@ -914,9 +1000,16 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	file_inode->nlinks = 1;
 	file_inode->size = sizebytes;
 
-	/* Allocate data blocks */
-	ext4fs_allocate_blocks(file_inode, blocks_remaining,
-			       &blks_reqd_for_file);
+	/* Allocate data blocks, in extents if the filesystem has them */
+	if (sblock->feature_incompat & EXT4_FEATURE_INCOMPAT_EXTENTS) {
+		file_inode->flags = cpu_to_le32(EXT4_EXTENTS_FL);
+		if (ext4fs_allocate_extents(file_inode, blocks_remaining,
+					    &blks_reqd_for_file))
+			goto fail;
+	} else {
+		ext4fs_allocate_blocks(file_inode, blocks_remaining,
+				       &blks_reqd_for_file);
+	}
 	file_inode->blockcnt = (blks_reqd_for_file * fs->blksz) >>
 		fs->dev_desc->log2blksz;
 
@@ -938,7 +1031,13 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	if (ext4fs_put_metadata(temp_ptr, itable_blkno))
 		goto fail;
 	/* copy the file content into data blocks */
-	if (ext4fs_write_file(file_inode, 0, sizebytes, (char *)buffer) == -1) {
+	if (file_inode->flags & cpu_to_le32(EXT4_EXTENTS_FL))
+		ret = ext4fs_write_extents(file_inode, (char *)buffer,
+					   sizebytes);
+	else
+		ret = ext4fs_write_file(file_inode, 0, sizebytes,
+					(char *)buffer);
+	if (ret < 0) {
 		printf("Error in copying content\n");
 		goto fail;
 	}
@@ -195,18 +195,66 @@ int ext4fs_probe(block_dev_desc_t *fs_dev_desc,
 	return 0;
 }
 
-int ext4_read_file(const char *filename, void *buf, int offset, int len)
+int ext4_open_file(const char *filename, void **filep, loff_t *sizep)
 {
-	int file_len;
-	int len_read;
+	struct ext2fs_node *fdiro = NULL;
+	int status;
 
-	if (offset != 0) {
-		printf("** Cannot support non-zero offset **\n");
+	if (ext4fs_root == NULL)
 		return -1;
+
+	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
+				  FILETYPE_REG);
+	if (status == 0)
+		goto fail;
+
+	if (!fdiro->inode_read) {
+		status = ext4fs_read_inode(fdiro->data, fdiro->ino,
+				&fdiro->inode);
+		if (status == 0)
+			goto fail;
 	}
+	*filep = fdiro;
+	*sizep = __le32_to_cpu(fdiro->inode.size);
+
+	return 0;
+fail:
+	ext4fs_free_node(fdiro, &ext4fs_root->diropen);
+
+	return -1;
+}
+
+int ext4_read_file_at(void *filep, loff_t pos, void *buf, int len)
+{
+	struct ext2fs_node *node = filep;
+	loff_t filesize = __le32_to_cpu(node->inode.size);
+
+	if (ext4fs_root == NULL)
+		return -1;
+	if (pos >= filesize || len <= 0)
+		return 0;
+	if (len > filesize - pos)
+		len = filesize - pos;
+
+	/* The filesystem may have been mounted again since the open */
+	node->data = ext4fs_root;
+
+	return ext4fs_read_file(node, pos, len, buf);
+}
+
+void ext4_close_file(void *filep)
+{
+	/* Only regular files are opened, never the root's own node */
+	free(filep);
+}
+
+int ext4_read_file(const char *filename, void *buf, int offset, int len)
+{
+	void *file;
+	loff_t file_len;
+	int len_read;
 
-	file_len = ext4fs_open(filename);
-	if (file_len < 0) {
+	if (ext4_open_file(filename, &file, &file_len)) {
 		printf("** File not found %s **\n", filename);
 		return -1;
 	}
@@ -214,7 +262,8 @@ int ext4_read_file(const char *filename, void *buf, int offset, int len)
 	if (len == 0)
 		len = file_len;
 
-	len_read = ext4fs_read(buf, len);
+	len_read = ext4_read_file_at(file, offset, buf, len);
+	ext4_close_file(file);
 
 	return len_read;
 }
@@ -13,6 +13,7 @@
 #include <config.h>
 #include <exports.h>
 #include <fat.h>
+#include <fs.h>
 #include <asm/byteorder.h>
 #include <part.h>
 #include <malloc.h>
@@ -579,11 +580,21 @@ static dir_entry *get_dentfromdir(fsdata *mydata, int startsect,
 				  int dols)
 {
 	__u16 prevcksum = 0xffff;
-	__u32 curclust = START(retdent);
+	__u32 dirclust = START(retdent);
+	__u32 curclust = dirclust;
 	int files = 0, dirs = 0;
+	int cached;
 
 	debug("get_dentfromdir: %s\n", filename);
 
+	if (!dols) {
+		cached = dentry_cache_lookup(cur_dev, cur_part_info.start,
+					     dirclust, filename, retdent,
+					     sizeof(dir_entry));
+		if (cached >= 0)
+			return cached ? retdent : NULL;
+	}
+
 	while (1) {
 		dir_entry *dentptr;
 
@@ -657,6 +668,11 @@ static dir_entry *get_dentfromdir(fsdata *mydata, int startsect,
 				if (dols) {
 					printf("\n%d file(s), %d dir(s)\n\n",
 						files, dirs);
+				} else {
+					dentry_cache_add(cur_dev,
+							 cur_part_info.start,
+							 dirclust, filename,
+							 NULL, 0);
 				}
 				debug("Dentname == NULL - %d\n", i);
 				return NULL;
@@ -711,6 +727,8 @@ static dir_entry *get_dentfromdir(fsdata *mydata, int startsect,
 			}
 
 			memcpy(retdent, dentptr, sizeof(dir_entry));
+			dentry_cache_add(cur_dev, cur_part_info.start, dirclust,
+					 filename, retdent, sizeof(dir_entry));
 
 			debug("DentName: %s", s_name);
 			debug(", start: 0x%x", START(dentptr));
@@ -806,15 +824,19 @@ exit:
 __u8 do_fat_read_at_block[MAX_CLUSTSIZE]
 	__aligned(ARCH_DMA_MINALIGN);
 
-long
-do_fat_read_at(const char *filename, unsigned long pos, void *buffer,
-	       unsigned long maxsize, int dols)
+/*
+ * Set up 'mydata' for the current device and look up 'filename', or list
+ * it when 'dols' is set.
+ * Return 1 with the entry copied to 'retdent' and mydata->fatbuf still
+ * allocated, 0 when a directory was listed, or -1 on errors.
+ */
+static long
+fat_lookup(fsdata *mydata, const char *filename, dir_entry *retdent, int dols)
 {
 	char fnamecopy[2048];
 	boot_sector bs;
 	volume_info volinfo;
-	fsdata datablock;
-	fsdata *mydata = &datablock;
+	dir_entry dent;
 	dir_entry *dentptr = NULL;
 	__u16 prevcksum = 0xffff;
 	char *subname = "";
@@ -824,7 +846,9 @@ do_fat_read_at(const char *filename, unsigned long pos, void *buffer,
 	long ret = -1;
 	int firsttime;
 	__u32 root_cluster = 0;
+	__u32 rootdir;
 	int rootdir_size = 0;
+	int cached;
 	int j;
 
 	if (read_bootsectandvi(&bs, &volinfo, &mydata->fatsize)) {
@@ -910,6 +934,22 @@ do_fat_read_at(const char *filename, unsigned long pos, void *buffer,
 		isdir = 1;
 	}
 
+	/* The root directory is cached as cluster 0 on FAT12/16 */
+	rootdir = root_cluster;
+	if (dols != LS_ROOT) {
+		cached = dentry_cache_lookup(cur_dev, cur_part_info.start,
+					     rootdir, fnamecopy, &dent,
+					     sizeof(dent));
+		if (cached == 0)
+			goto exit;
+		if (cached > 0) {
+			dentptr = &dent;
+			if (isdir && !(dentptr->attr & ATTR_DIR))
+				goto exit;
+			goto rootdir_done;
+		}
+	}
+
 	j = 0;
 	while (1) {
 		int i;
@@ -1000,6 +1040,11 @@ do_fat_read_at(const char *filename, unsigned long pos, void *buffer,
 					printf("\n%d file(s), %d dir(s)\n\n",
 						files, dirs);
 					ret = 0;
+				} else {
+					dentry_cache_add(cur_dev,
+							 cur_part_info.start,
+							 rootdir, fnamecopy,
+							 NULL, 0);
 				}
 				goto exit;
 			}
@@ -1052,6 +1097,9 @@ do_fat_read_at(const char *filename, unsigned long pos, void *buffer,
 				continue;
 			}
 
+			dentry_cache_add(cur_dev, cur_part_info.start, rootdir,
+					 fnamecopy, dentptr, sizeof(dir_entry));
+
 			if (isdir && !(dentptr->attr & ATTR_DIR))
 				goto exit;
 
@@ -1103,6 +1151,9 @@ do_fat_read_at(const char *filename, unsigned long pos, void *buffer,
 				printf("\n%d file(s), %d dir(s)\n\n",
 				       files, dirs);
 				ret = 0;
+			} else {
+				dentry_cache_add(cur_dev, cur_part_info.start,
+						 rootdir, fnamecopy, NULL, 0);
 			}
 			goto exit;
 		}
@@ -1114,7 +1165,6 @@ rootdir_done:
 	while (isdir) {
 		int startsect = mydata->data_begin
 			+ START(dentptr) * mydata->clust_size;
-		dir_entry dent;
 		char *nextname = NULL;
 
 		dent = *dentptr;
@@ -1152,14 +1202,34 @@ rootdir_done:
 			subname = nextname;
 	}
 
-	ret = get_contents(mydata, dentptr, pos, buffer, maxsize);
-	debug("Size: %d, got: %ld\n", FAT2CPU32(dentptr->size), ret);
+	*retdent = *dentptr;
+	return 1;
 
 exit:
 	free(mydata->fatbuf);
 	return ret;
 }
 
+long
+do_fat_read_at(const char *filename, unsigned long pos, void *buffer,
+	       unsigned long maxsize, int dols)
+{
+	fsdata datablock;
+	fsdata *mydata = &datablock;
+	dir_entry dent;
+	long ret;
+
+	ret = fat_lookup(mydata, filename, &dent, dols);
+	if (ret != 1)
+		return ret;
+
+	ret = get_contents(mydata, &dent, pos, buffer, maxsize);
+	debug("Size: %d, got: %ld\n", FAT2CPU32(dent.size), ret);
+
+	free(mydata->fatbuf);
+	return ret;
+}
+
 long
 do_fat_read(const char *filename, void *buffer, unsigned long maxsize, int dols)
 {
@@ -1258,6 +1328,90 @@ int fat_read_file(const char *filename, void *buf, int offset, int len)
 	return len_read;
 }
 
+/*
+ * An open file keeps the filesystem data set up by the lookup, and the
+ * cluster reached by the last read so that reading on from there does
+ * not walk the cluster chain from the start again.
+ */
+struct fat_file {
+	fsdata data;
+	dir_entry dent;
+	__u32 clust;			/* cluster holding byte 'clust_pos' */
+	unsigned long clust_pos;
+};
+
+int fat_open_file(const char *filename, void **filep, loff_t *sizep)
+{
+	struct fat_file *file;
+	fsdata *mydata;
+
+	file = malloc(sizeof(*file));
+	if (!file)
+		return -1;
+	mydata = &file->data;
+
+	if (fat_lookup(mydata, filename, &file->dent, LS_NO) != 1) {
+		free(file);
+		return -1;
+	}
+
+	file->clust = START(&file->dent);
+	file->clust_pos = 0;
+	*filep = file;
+	*sizep = FAT2CPU32(file->dent.size);
+
+	return 0;
+}
+
+int fat_read_file_at(void *filep, loff_t pos, void *buf, int len)
+{
+	struct fat_file *file = filep;
+	fsdata *mydata = &file->data;
+	unsigned long bytesperclust = mydata->clust_size * mydata->sect_size;
+	unsigned long filesize = FAT2CPU32(file->dent.size);
+	dir_entry dent;
+
+	if (pos >= filesize || len <= 0)
+		return 0;
+
+	if (pos < file->clust_pos) {
+		file->clust = START(&file->dent);
+		file->clust_pos = 0;
+	}
+	while (pos - file->clust_pos >= bytesperclust) {
+		file->clust = get_fatent(mydata, file->clust);
+		if (CHECK_CLUST(file->clust, mydata->fatsize)) {
+			debug("Invalid FAT entry\n");
+			file->clust = START(&file->dent);
+			file->clust_pos = 0;
+			return -1;
+		}
+		file->clust_pos += bytesperclust;
+	}
+
+	/* Read from what is left of the file from that cluster on */
+	dent = file->dent;
+	dent.start = cpu_to_le16(file->clust & 0xffff);
+	dent.starthi = cpu_to_le16(file->clust >> 16);
+	dent.size = cpu_to_le32(filesize - file->clust_pos);
+
+	return get_contents(mydata, &dent, pos - file->clust_pos, buf, len);
+}
+
+void fat_close_file(void *filep)
+{
+	struct fat_file *file = filep;
+
+	free(file->data.fatbuf);
+	free(file);
+}
+
+int fat_mounted(block_dev_desc_t *dev_desc, disk_partition_t *info)
+{
+	return cur_dev && cur_dev == dev_desc &&
+		cur_part_info.start == info->start;
+}
+
 void fat_close(void)
 {
 }
@@ -56,8 +56,11 @@ static void set_name(dir_entry *dirent, const char *filename)
 	len = strlen(filename);
 	if (len == 0)
 		return;
+	if (len >= VFAT_MAXLEN_BYTES)
+		len = VFAT_MAXLEN_BYTES - 1;
 
 	memcpy(s_name, filename, len);
+	s_name[len] = '\0';
 	uppercase(s_name, len);
 
 	period = strchr(s_name, '.');
@@ -94,20 +97,30 @@ static void set_name(dir_entry *dirent, const char *filename)
 }
 
 static __u8 num_of_fats;
+
+/* Number of FAT sectors held in buffer 'bufnum' */
+static int fat_buffer_blocks(fsdata *mydata, __u32 bufnum)
+{
+	__u32 left = mydata->fatlength - bufnum * FATBUFBLOCKS;
+
+	return left < FATBUFBLOCKS ? left : FATBUFBLOCKS;
+}
+
 /*
- * Write fat buffer into block device
+ * Write fat buffer into block device, if it was changed since it
+ * was read
  */
 static int flush_fat_buffer(fsdata *mydata)
 {
-	int getsize = FATBUFBLOCKS;
-	__u32 fatlength = mydata->fatlength;
+	int getsize;
 	__u8 *bufptr = mydata->fatbuf;
 	__u32 startblock = mydata->fatbufnum * FATBUFBLOCKS;
 
-	startblock += mydata->fat_sect;
+	if (mydata->fatbufnum == -1 || !mydata->fatbuf_dirty)
+		return 0;
 
-	if (getsize > fatlength)
-		getsize = fatlength;
+	startblock += mydata->fat_sect;
+	getsize = fat_buffer_blocks(mydata, mydata->fatbufnum);
 
 	/* Write FAT buf */
 	if (disk_write(startblock, getsize, bufptr) < 0) {
@@ -123,6 +136,7 @@ static int flush_fat_buffer(fsdata *mydata)
 			return -1;
 		}
 	}
+	mydata->fatbuf_dirty = 0;
 
 	return 0;
 }
@@ -163,22 +177,15 @@ static __u32 get_fatent_value(fsdata *mydata, __u32 entry)
 
 	/* Read a new block of FAT entries into the cache. */
 	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
+		int getsize = fat_buffer_blocks(mydata, bufnum);
 		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
 		__u32 startblock = bufnum * FATBUFBLOCKS;
 
-		if (getsize > fatlength)
-			getsize = fatlength;
-
-		fatlength *= mydata->sect_size;	/* We want it in bytes now */
 		startblock += mydata->fat_sect;	/* Offset from start of disk */
 
 		/* Write back the fatbuf to the disk */
-		if (mydata->fatbufnum != -1) {
-			if (flush_fat_buffer(mydata) < 0)
-				return -1;
-		}
+		if (flush_fat_buffer(mydata) < 0)
+			return -1;
 
 		if (disk_read(startblock, getsize, bufptr) < 0) {
 			debug("Error reading FAT blocks\n");
@@ -474,21 +481,14 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 
 	/* Read a new block of FAT entries into the cache. */
 	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
+		int getsize = fat_buffer_blocks(mydata, bufnum);
 		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
 		__u32 startblock = bufnum * FATBUFBLOCKS;
 
-		fatlength *= mydata->sect_size;
 		startblock += mydata->fat_sect;
 
-		if (getsize > fatlength)
-			getsize = fatlength;
-
-		if (mydata->fatbufnum != -1) {
-			if (flush_fat_buffer(mydata) < 0)
-				return -1;
-		}
+		if (flush_fat_buffer(mydata) < 0)
+			return -1;
 
 		if (disk_read(startblock, getsize, bufptr) < 0) {
 			debug("Error reading FAT blocks\n");
@@ -508,31 +508,11 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 	default:
 		return -1;
 	}
+	mydata->fatbuf_dirty = 1;
 
 	return 0;
 }
 
-/*
- * Determine the entry value at index 'entry' in a FAT (16/32) table
- */
-static __u32 determine_fatent(fsdata *mydata, __u32 entry)
-{
-	__u32 next_fat, next_entry = entry + 1;
-
-	while (1) {
-		next_fat = get_fatent_value(mydata, next_entry);
-		if (next_fat == 0) {
-			set_fatent_value(mydata, entry, next_entry);
-			break;
-		}
-		next_entry++;
-	}
-	debug("FAT%d: entry: %08x, entry_value: %04x\n",
-	       mydata->fatsize, entry, next_entry);
-
-	return next_entry;
-}
-
 /*
  * Write at most 'size' bytes from 'buffer' into the specified cluster.
  * Return 0 on success, -1 otherwise.
@@ -576,20 +556,51 @@ set_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer,
 }
 
 /*
- * Find the first empty cluster
+ * Free cluster bookkeeping. clust_count is one past the last cluster of
+ * the partition. next_free is where the search for a free cluster
+ * starts; it is kept across writes to the same partition and, on FAT32,
+ * in the FSInfo sector, as is the count of free clusters (FSINFO_UNKNOWN
+ * when we do not know it). Both FSInfo values are only hints, which other
+ * systems may have left stale, so they never cause a write to be refused.
+ */
+static __u32 clust_count;
+static __u32 next_free;
+static __u32 free_clusters;
+static block_dev_desc_t *next_free_dev;
+static lbaint_t next_free_part;
+
+static void count_clusters(__u32 nr, int freed)
+{
+	if (free_clusters == FSINFO_UNKNOWN)
+		return;
+	/* A count which does not add up was stale; stop tracking it */
+	if (freed && free_clusters + nr <= clust_count - 2)
+		free_clusters += nr;
+	else if (!freed && nr <= free_clusters)
+		free_clusters -= nr;
+	else
+		free_clusters = FSINFO_UNKNOWN;
+}
+
+/*
+ * Find the first empty cluster at or after next_free, wrapping around
+ * at the end of the FAT. Return -1 if there is none.
  */
 static int find_empty_cluster(fsdata *mydata)
 {
-	__u32 fat_val, entry = 3;
+	__u32 fat_val, entry = next_free, n;
 
-	while (1) {
+	for (n = 2; n < clust_count; n++, entry++) {
+		if (entry < 2 || entry >= clust_count)
+			entry = 2;
 		fat_val = get_fatent_value(mydata, entry);
-		if (fat_val == 0)
-			break;
-		entry++;
+		if (fat_val == 0) {
+			next_free = entry;
+			return entry;
+		}
 	}
 
-	return entry;
+	return -1;
 }
 
 /*
@@ -606,6 +617,11 @@ static void flush_dir_table(fsdata *mydata, dir_entry **dentptr)
 		return;
 	}
 	dir_newclust = find_empty_cluster(mydata);
+	if (dir_newclust < 0) {
+		printf("error: no free cluster for directory\n");
+		return;
+	}
+	count_clusters(1, 0);
 	set_fatent_value(mydata, dir_curclust, dir_newclust);
 	if (mydata->fatsize == 32)
 		set_fatent_value(mydata, dir_newclust, 0xffffff8);
@@ -624,36 +640,35 @@ static void flush_dir_table(fsdata *mydata, dir_entry **dentptr)
 }
 
 /*
- * Set empty cluster from 'entry' to the end of a file
+ * Set empty cluster from 'entry' to the end of a file. The FAT buffer
+ * is left for the caller to flush.
  */
 static int clear_fatent(fsdata *mydata, __u32 entry)
 {
 	__u32 fat_val;
 
-	while (1) {
+	while (!CHECK_CLUST(entry, mydata->fatsize) && entry < clust_count) {
 		fat_val = get_fatent_value(mydata, entry);
-		if (fat_val != 0)
-			set_fatent_value(mydata, entry, 0);
-		else
-			break;
-
-		if (fat_val == 0xfffffff || fat_val == 0xffff)
+		if (fat_val == 0)
 			break;
+		if (set_fatent_value(mydata, entry, 0) < 0)
+			return -1;
+		count_clusters(1, 1);
+		if (entry < next_free)
+			next_free = entry;
 
 		entry = fat_val;
 	}
 
-	/* Flush fat buffer */
-	if (flush_fat_buffer(mydata) < 0)
-		return -1;
-
 	return 0;
 }
 
 /*
  * Write at most 'maxsize' bytes from 'buffer' into
- * the file associated with 'dentptr'
- * Return the number of bytes read or -1 on fatal errors.
+ * the file associated with 'dentptr', whose first cluster must be free.
+ * Clusters are taken in runs of free ones, each chained in the FAT and
+ * written in one go. If the partition fills up, the file is cut short.
+ * Return the number of bytes written or -1 on fatal errors.
  */
 static int
 set_contents(fsdata *mydata, dir_entry *dentptr, __u8 *buffer,
@@ -662,8 +677,10 @@ set_contents(fsdata *mydata, dir_entry *dentptr, __u8 *buffer,
 	unsigned long filesize = FAT2CPU32(dentptr->size), gotsize = 0;
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
 	__u32 curclust = START(dentptr);
-	__u32 endclust = 0, newclust = 0;
+	__u32 endclust;
+	__u32 eoc = mydata->fatsize == 32 ? 0xfffffff : 0xffff;
 	unsigned long actsize;
+	int newclust;
 
 	debug("Filesize: %ld bytes\n", filesize);
 
@@ -672,69 +689,47 @@ set_contents(fsdata *mydata, dir_entry *dentptr, __u8 *buffer,
 
 	debug("%ld bytes\n", filesize);
 
-	actsize = bytesperclust;
-	endclust = curclust;
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = determine_fatent(mydata, endclust);
-
-			if ((newclust - 1) != endclust)
-				goto getit;
-
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				debug("Invalid FAT entry\n");
-				return gotsize;
-			}
-			endclust = newclust;
+	while (1) {
+		/* Take the free clusters following curclust, as needed */
+		endclust = curclust;
+		actsize = bytesperclust;
+		while (actsize < filesize && endclust + 1 < clust_count &&
+		       get_fatent_value(mydata, endclust + 1) == 0) {
+			set_fatent_value(mydata, endclust, endclust + 1);
+			endclust++;
 			actsize += bytesperclust;
 		}
-		/* actsize >= file size */
-		actsize -= bytesperclust;
-		/* set remaining clusters */
-		if (set_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		/* Mark end of file in FAT, until we find more clusters */
+		set_fatent_value(mydata, endclust, eoc);
+		count_clusters(endclust - curclust + 1, 0);
+		next_free = endclust + 1;
+		debug("clusters %u-%u\n", curclust, endclust);
+
+		if (actsize > filesize)
+			actsize = filesize;
+		if (actsize && set_cluster(mydata, curclust, buffer,
+					   actsize) != 0) {
 			debug("error: writing cluster\n");
 			return -1;
 		}
-
-		/* set remaining bytes */
-		gotsize += (int)actsize;
+		gotsize += actsize;
 		filesize -= actsize;
 		buffer += actsize;
-		actsize = filesize;
+		if (!filesize)
+			break;
 
-		if (set_cluster(mydata, endclust, buffer, (int)actsize) != 0) {
-			debug("error: writing cluster\n");
-			return -1;
+		newclust = find_empty_cluster(mydata);
+		if (newclust < 0) {
+			printf("Error: no space left, %lu bytes written\n",
+			       gotsize);
+			dentptr->size = cpu_to_le32(gotsize);
+			break;
 		}
-		gotsize += actsize;
-
-		/* Mark end of file in FAT */
-		if (mydata->fatsize == 16)
-			newclust = 0xffff;
-		else if (mydata->fatsize == 32)
-			newclust = 0xfffffff;
 		set_fatent_value(mydata, endclust, newclust);
+		curclust = newclust;
+	}
 
-		return gotsize;
-getit:
-		if (set_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			debug("error: writing cluster\n");
-			return -1;
-		}
-		gotsize += (int)actsize;
-		filesize -= actsize;
-		buffer += actsize;
-
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return gotsize;
-		}
-		actsize = bytesperclust;
-		curclust = endclust = newclust;
-	} while (1);
+	return gotsize;
 }
 
 /*
@@ -755,26 +750,16 @@ static void fill_dentry(fsdata *mydata, dir_entry *dentptr,
 }
 
 /*
- * Check whether adding a file makes the file system to
- * exceed the size of the block device
+ * Check whether 'size' bytes could fit in the partition at all. The
+ * FSInfo free count is only advisory, so it is not used here;
+ * set_contents() stops when it really runs out of clusters.
  * Return -1 when overflow occurs, otherwise return 0
  */
-static int check_overflow(fsdata *mydata, __u32 clustnum, unsigned long size)
+static int check_overflow(fsdata *mydata, unsigned long size)
 {
-	__u32 startsect, sect_num;
-
-	if (clustnum > 0) {
-		startsect = mydata->data_begin +
-				clustnum * mydata->clust_size;
-	} else {
-		startsect = mydata->rootdir_sect;
-	}
-
-	sect_num = size / mydata->sect_size;
-	if (size % mydata->sect_size)
-		sect_num++;
+	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
 
-	if (startsect + sect_num > cur_part_info.start + total_sector)
+	if (DIV_ROUND_UP(size, bytesperclust) > clust_count - 2)
 		return -1;
 
 	return 0;
@@ -894,6 +879,64 @@ static dir_entry *find_directory_entry(fsdata *mydata, int startsect,
 	return NULL;
 }
 
+/*
+ * Take the free cluster count and search hint from the FAT32 FSInfo
+ * sector, when it has them. Return 0 if there is an FSInfo sector.
+ */
+static int read_fsinfo(fsdata *mydata, __u16 info_sector)
+{
+	fsinfo_sector *fsinfo;
+	__u32 val;
+	int ret = -1;
+
+	fsinfo = memalign(ARCH_DMA_MINALIGN, mydata->sect_size);
+	if (fsinfo == NULL)
+		return -1;
+	if (disk_read(info_sector, 1, fsinfo) < 0 ||
+	    FAT2CPU32(fsinfo->lead_sig) != FSINFO_LEAD_SIG ||
+	    FAT2CPU32(fsinfo->struc_sig) != FSINFO_STRUC_SIG) {
+		debug("No FSInfo sector\n");
+		goto exit;
+	}
+
+	val = FAT2CPU32(fsinfo->free_count);
+	if (val <= clust_count - 2)
+		free_clusters = val;
+	val = FAT2CPU32(fsinfo->next_free);
+	if (val >= 2 && val < clust_count)
+		next_free = val;
+	debug("FSInfo: %u free clusters, next %u\n", free_clusters, next_free);
+	ret = 0;
+exit:
+	free(fsinfo);
+	return ret;
+}
+
+/*
+ * Store the free cluster count, which may be FSINFO_UNKNOWN, and search
+ * hint in the FSInfo sector
+ */
+static int write_fsinfo(fsdata *mydata, __u16 info_sector)
+{
+	fsinfo_sector *fsinfo;
+	int ret = -1;
+
+	fsinfo = memalign(ARCH_DMA_MINALIGN, mydata->sect_size);
+	if (fsinfo == NULL)
+		return -1;
+	if (disk_read(info_sector, 1, fsinfo) < 0 ||
+	    FAT2CPU32(fsinfo->lead_sig) != FSINFO_LEAD_SIG ||
+	    FAT2CPU32(fsinfo->struc_sig) != FSINFO_STRUC_SIG)
+		goto exit;
+
+	fsinfo->free_count = cpu_to_le32(free_clusters);
+	fsinfo->next_free = cpu_to_le32(next_free);
+	ret = disk_write(info_sector, 1, fsinfo);
+exit:
+	free(fsinfo);
+	return ret < 0 ? -1 : 0;
+}
+
 static int do_fat_write(const char *filename, void *buffer,
 	unsigned long size)
 {
@@ -908,8 +951,10 @@ static int do_fat_write(const char *filename, void *buffer,
 	int ret = -1, name_len;
 	char l_filename[VFAT_MAXLEN_BYTES];
 	int write_size = size;
+	int have_fsinfo = 0;
 
 	dir_curclust = 0;
+	dentry_cache_invalidate(cur_dev);
 
 	if (read_bootsectandvi(&bs, &volinfo, &mydata->fatsize)) {
 		debug("error: reading boot sector\n");
@@ -949,7 +994,26 @@ static int do_fat_write(const char *filename, void *buffer,
 					(mydata->clust_size * 2);
 	}
 
+	clust_count = (total_sector - mydata->data_begin) / mydata->clust_size;
+	if (clust_count > mydata->fatlength * mydata->sect_size * 8 /
+			  mydata->fatsize)
+		clust_count = mydata->fatlength * mydata->sect_size * 8 /
+			      mydata->fatsize;
+
+	/* The search hint is only good for the partition it came from */
+	if (next_free_dev != cur_dev ||
+	    next_free_part != cur_part_info.start) {
+		next_free_dev = cur_dev;
+		next_free_part = cur_part_info.start;
+		next_free = 2;
+	}
+	free_clusters = FSINFO_UNKNOWN;
+	if (mydata->fatsize == 32 && bs.info_sector &&
+	    bs.info_sector < bs.reserved)
+		have_fsinfo = !read_fsinfo(mydata, bs.info_sector);
+
 	mydata->fatbufnum = -1;
+	mydata->fatbuf_dirty = 0;
 	mydata->fatbuf = malloc(FATBUFSIZE);
 	if (mydata->fatbuf == NULL) {
 		debug("Error: allocating memory\n");
@@ -984,7 +1048,20 @@ static int do_fat_write(const char *filename, void *buffer,
 			start_cluster |=
 				(FAT2CPU16(retdent->starthi) << 16);
 
-		ret = check_overflow(mydata, start_cluster, size);
+		/* An empty file may have no cluster yet */
+		if (start_cluster < 2) {
+			ret = start_cluster = find_empty_cluster(mydata);
+			if (ret < 0) {
+				printf("Error: finding empty cluster\n");
+				goto exit;
+			}
+			retdent->start = cpu_to_le16(start_cluster & 0xffff);
+			if (mydata->fatsize == 32)
+				retdent->starthi =
+					cpu_to_le16(start_cluster >> 16);
+		}
+
+		ret = check_overflow(mydata, size);
 		if (ret) {
 			printf("Error: %ld overflow\n", size);
 			goto exit;
@@ -1030,7 +1107,7 @@ static int do_fat_write(const char *filename, void *buffer,
 			goto exit;
 		}
 
-		ret = check_overflow(mydata, start_cluster, size);
+		ret = check_overflow(mydata, size);
 		if (ret) {
 			printf("Error: %ld overflow\n", size);
 			goto exit;
@@ -1065,6 +1142,10 @@ static int do_fat_write(const char *filename, void *buffer,
 		}
 	}
 
+	/* A count we lost track of is marked unknown rather than left */
+	if (have_fsinfo && write_fsinfo(mydata, bs.info_sector) < 0)
+		printf("Warning: cannot update FSInfo sector\n");
+
 exit:
 	free(mydata->fatbuf);
 	return ret < 0 ? ret : write_size;
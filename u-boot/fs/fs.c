@@ -21,13 +21,47 @@
 #include <fat.h>
 #include <fs.h>
 #include <sandboxfs.h>
+#include <squashfs.h>
+#include <malloc.h>
 #include <asm/io.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
-static block_dev_desc_t *fs_dev_desc;
-static disk_partition_t fs_partition;
-static int fs_type = FS_TYPE_ANY;
+#ifndef CONFIG_FS_MOUNT_CACHE
+#define CONFIG_FS_MOUNT_CACHE	4
+#endif
+
+#define FS_MOUNT_KEY_LEN	32
+
+/*
+ * A partition that a filesystem was found on. It is remembered under the
+ * interface and device/partition string used to select it, so that the
+ * next command on the same partition neither looks up the partition nor
+ * probes for the filesystem type again. Each filesystem driver has a
+ * single mounted filesystem of its own, so only one mount per type is
+ * live in its driver at a time; the others are mounted again when used.
+ */
+struct fs_mount {
+	char key[FS_MOUNT_KEY_LEN];	/* "<ifname> <dev_part_str>" or "" */
+	block_dev_desc_t *dev_desc;
+	disk_partition_t partition;
+	int fstype;			/* FS_TYPE_ANY when unused */
+	ulong last_used;
+	uint generation;		/* changes when dropped */
+};
+
+struct fs_file {
+	struct fs_mount *mount;
+	uint generation;		/* of the mount when opened */
+	int fstype;
+	void *priv;			/* filesystem driver's open file */
+	loff_t pos;
+	loff_t size;
+};
+
+static struct fs_mount fs_mounts[CONFIG_FS_MOUNT_CACHE];
+static struct fs_mount *fs_cur;
+static ulong fs_mount_clock;
 
 static inline int fs_probe_unsupported(block_dev_desc_t *fs_dev_desc,
 				      disk_partition_t *fs_partition)
@@ -57,6 +91,28 @@ static inline void fs_close_unsupported(void)
 {
 }
 
+static inline int fs_open_unsupported(const char *filename, void **filep,
+				      loff_t *sizep)
+{
+	return -1;
+}
+
+static inline int fs_read_at_unsupported(void *filep, loff_t pos, void *buf,
+					 int len)
+{
+	return -1;
+}
+
+static inline void fs_close_file_unsupported(void *filep)
+{
+}
+
+static inline int fs_mounted_unsupported(block_dev_desc_t *fs_dev_desc,
+					 disk_partition_t *fs_partition)
+{
+	return 0;
+}
+
 struct fstype_info {
 	int fstype;
 	int (*probe)(block_dev_desc_t *fs_dev_desc,
@@ -65,6 +121,13 @@ struct fstype_info {
 	int (*read)(const char *filename, void *buf, int offset, int len);
 	int (*write)(const char *filename, void *buf, int offset, int len);
 	void (*close)(void);
+	int (*open_file)(const char *filename, void **filep, loff_t *sizep);
+	int (*read_at)(void *filep, loff_t pos, void *buf, int len);
+	void (*close_file)(void *filep);
+	/* Whether the driver still has this partition mounted */
+	int (*mounted)(block_dev_desc_t *fs_dev_desc,
+		       disk_partition_t *fs_partition);
+	struct fs_mount *live;		/* mount we last probed the driver on */
 };
 
 static struct fstype_info fstypes[] = {
@@ -75,6 +138,10 @@ static struct fstype_info fstypes[] = {
 		.close = fat_close,
 		.ls = file_fat_ls,
 		.read = fat_read_file,
+		.open_file = fat_open_file,
+		.read_at = fat_read_file_at,
+		.close_file = fat_close_file,
+		.mounted = fat_mounted,
 	},
 #endif
 #ifdef CONFIG_FS_EXT4
@@ -84,6 +151,23 @@ static struct fstype_info fstypes[] = {
 		.close = ext4fs_close,
 		.ls = ext4fs_ls,
 		.read = ext4_read_file,
+		.open_file = ext4_open_file,
+		.read_at = ext4_read_file_at,
+		.close_file = ext4_close_file,
+		.mounted = ext4fs_mounted,
+	},
+#endif
+#ifdef CONFIG_FS_SQUASHFS
+	{
+		.fstype = FS_TYPE_SQUASHFS,
+		.probe = sqfs_probe,
+		.close = sqfs_close,
+		.ls = sqfs_ls,
+		.read = sqfs_read_file,
+		.open_file = sqfs_open_file,
+		.read_at = sqfs_read_file_at,
+		.close_file = sqfs_close_file,
+		.mounted = sqfs_mounted,
 	},
 #endif
 #ifdef CONFIG_SANDBOX
@@ -94,6 +178,10 @@ static struct fstype_info fstypes[] = {
 		.ls = sandbox_fs_ls,
 		.read = fs_read_sandbox,
 		.write = fs_write_sandbox,
+		.open_file = sandbox_fs_open_file,
+		.read_at = sandbox_fs_read_file_at,
+		.close_file = sandbox_fs_close_file,
+		.mounted = sandbox_fs_mounted,
 	},
 #endif
 	{
@@ -103,6 +191,10 @@ static struct fstype_info fstypes[] = {
 		.ls = fs_ls_unsupported,
 		.read = fs_read_unsupported,
 		.write = fs_write_unsupported,
+		.open_file = fs_open_unsupported,
+		.read_at = fs_read_at_unsupported,
+		.close_file = fs_close_file_unsupported,
+		.mounted = fs_mounted_unsupported,
 	},
 };
 
@@ -120,9 +212,92 @@ static struct fstype_info *fs_get_info(int fstype)
 	return info;
 }
 
+static struct fstype_info *fs_cur_info(void)
+{
+	return fs_get_info(fs_cur ? fs_cur->fstype : FS_TYPE_ANY);
+}
+
+/* Forget a mount, unmounting it if it is live in its driver */
+static void fs_drop_mount(struct fs_mount *mount)
+{
+	struct fstype_info *info = fs_get_info(mount->fstype);
+
+	if (info->live == mount) {
+		info->close();
+		info->live = NULL;
+	}
+	if (fs_cur == mount)
+		fs_cur = NULL;
+	mount->key[0] = '\0';
+	mount->fstype = FS_TYPE_ANY;
+	mount->generation++;
+}
+
+/* Make sure the driver for 'mount' has it mounted, probing it again if not */
+static int fs_activate(struct fs_mount *mount)
+{
+	struct fstype_info *info = fs_get_info(mount->fstype);
+
+	mount->last_used = ++fs_mount_clock;
+	if (info->live == mount &&
+	    info->mounted(mount->dev_desc, &mount->partition))
+		return 0;
+
+	/*
+	 * Another mount of this type was used since, or a command outside
+	 * the fs layer (fatwrite, ext4write) used the driver directly.
+	 */
+	if (info->live)
+		info->close();
+	info->live = NULL;
+	if (info->probe(mount->dev_desc, &mount->partition))
+		return -1;
+	info->live = mount;
+
+	return 0;
+}
+
+static int fs_mount_key(char *key, const char *ifname,
+			const char *dev_part_str)
+{
+	/* Resolved the same way as in get_device_and_partition() */
+	if (!strcmp(ifname, "host"))
+		dev_part_str = "";
+	else if (!dev_part_str || !*dev_part_str || !strcmp(dev_part_str, "-"))
+		dev_part_str = getenv("bootdevice");
+	if (!dev_part_str ||
+	    strlen(ifname) + strlen(dev_part_str) + 2 > FS_MOUNT_KEY_LEN)
+		return -1;
+	sprintf(key, "%s %s", ifname, dev_part_str);
+
+	return 0;
+}
+
+/* Find a free slot, or make one by dropping the least recently used */
+static struct fs_mount *fs_new_mount(void)
+{
+	struct fs_mount *mount, *oldest = fs_mounts;
+	int i;
+
+	for (i = 0, mount = fs_mounts; i < CONFIG_FS_MOUNT_CACHE;
+			i++, mount++) {
+		if (mount->fstype == FS_TYPE_ANY)
+			return mount;
+		if (mount->last_used < oldest->last_used)
+			oldest = mount;
+	}
+	fs_drop_mount(oldest);
+
+	return oldest;
+}
+
 int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 {
 	struct fstype_info *info;
+	struct fs_mount *mount;
+	block_dev_desc_t *dev_desc;
+	disk_partition_t partition;
+	char key[FS_MOUNT_KEY_LEN];
 	int part, i;
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
 	static int relocated;
@@ -135,23 +310,58 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 			info->ls += gd->reloc_off;
 			info->read += gd->reloc_off;
 			info->write += gd->reloc_off;
+			info->open_file += gd->reloc_off;
+			info->read_at += gd->reloc_off;
+			info->close_file += gd->reloc_off;
+			info->mounted += gd->reloc_off;
 		}
 		relocated = 1;
 	}
 #endif
 
-	part = get_device_and_partition(ifname, dev_part_str, &fs_dev_desc,
-					&fs_partition, 1);
+	fs_cur = NULL;
+	if (fs_mount_key(key, ifname, dev_part_str))
+		key[0] = '\0';
+
+	for (i = 0, mount = fs_mounts; key[0] && i < CONFIG_FS_MOUNT_CACHE;
+			i++, mount++) {
+		if (mount->fstype == FS_TYPE_ANY || strcmp(mount->key, key))
+			continue;
+		if (fstype != FS_TYPE_ANY && fstype != mount->fstype)
+			continue;
+		if (!fs_activate(mount)) {
+			fs_cur = mount;
+			return 0;
+		}
+		fs_drop_mount(mount);
+		break;
+	}
+
+	part = get_device_and_partition(ifname, dev_part_str, &dev_desc,
+					&partition, 1);
 	if (part < 0)
 		return -1;
 
+	mount = fs_new_mount();
+	mount->dev_desc = dev_desc;
+	mount->partition = partition;
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
 				fstype != info->fstype)
 			continue;
 
-		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
+		/* Probing replaces whatever the driver had mounted */
+		if (info->live)
+			info->close();
+		info->live = NULL;
+		if (!info->probe(mount->dev_desc, &mount->partition)) {
+			if (info->fstype == FS_TYPE_ANY)
+				break;
+			strcpy(mount->key, key);
+			mount->fstype = info->fstype;
+			mount->last_used = ++fs_mount_clock;
+			info->live = mount;
+			fs_cur = mount;
 			return 0;
 		}
 	}
@@ -159,35 +369,117 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	return -1;
 }
 
-static void fs_close(void)
+void fs_invalidate_dev(block_dev_desc_t *dev_desc)
 {
-	struct fstype_info *info = fs_get_info(fs_type);
+	struct fs_mount *mount;
+	int i;
 
-	info->close();
+	for (i = 0, mount = fs_mounts; i < CONFIG_FS_MOUNT_CACHE;
+			i++, mount++) {
+		if (mount->fstype != FS_TYPE_ANY && mount->dev_desc == dev_desc)
+			fs_drop_mount(mount);
+	}
+	dentry_cache_invalidate(dev_desc);
+}
 
-	fs_type = FS_TYPE_ANY;
+struct fs_file *fs_open(const char *filename)
+{
+	struct fstype_info *info = fs_cur_info();
+	struct fs_file *file;
+
+	if (!fs_cur || fs_activate(fs_cur))
+		return NULL;
+
+	file = malloc(sizeof(*file));
+	if (!file)
+		return NULL;
+	if (info->open_file(filename, &file->priv, &file->size)) {
+		free(file);
+		return NULL;
+	}
+	file->mount = fs_cur;
+	file->generation = fs_cur->generation;
+	file->fstype = fs_cur->fstype;
+	file->pos = 0;
+
+	return file;
 }
 
-int fs_ls(const char *dirname)
+int fs_read_handle(struct fs_file *file, void *buf, int len)
 {
+	struct fstype_info *info = fs_get_info(file->fstype);
 	int ret;
 
-	struct fstype_info *info = fs_get_info(fs_type);
-
-	ret = info->ls(dirname);
+	if (file->generation != file->mount->generation) {
+		printf("** Filesystem of open file was unmounted **\n");
+		return -1;
+	}
+	if (fs_activate(file->mount))
+		return -1;
 
-	fs_type = FS_TYPE_ANY;
-	fs_close();
+	ret = info->read_at(file->priv, file->pos, buf, len);
+	if (ret > 0)
+		file->pos += ret;
 
 	return ret;
 }
 
+loff_t fs_lseek(struct fs_file *file, loff_t offset, int whence)
+{
+	loff_t pos;
+
+	switch (whence) {
+	case FS_SEEK_SET:
+		pos = offset;
+		break;
+	case FS_SEEK_CUR:
+		pos = file->pos + offset;
+		break;
+	case FS_SEEK_END:
+		pos = file->size + offset;
+		break;
+	default:
+		return -1;
+	}
+	if (pos < 0)
+		return -1;
+	file->pos = pos;
+
+	return pos;
+}
+
+loff_t fs_size(struct fs_file *file)
+{
+	return file->size;
+}
+
+void fs_close(struct fs_file *file)
+{
+	struct fstype_info *info = fs_get_info(file->fstype);
+
+	info->close_file(file->priv);
+	free(file);
+}
+
+int fs_ls(const char *dirname)
+{
+	struct fstype_info *info = fs_cur_info();
+
+	if (fs_cur && fs_activate(fs_cur))
+		return -1;
+
+	return info->ls(dirname);
+}
+
 int fs_read(const char *filename, ulong addr, int offset, int len)
 {
-	struct fstype_info *info = fs_get_info(fs_type);
+	struct fstype_info *info = fs_cur_info();
 	void *buf;
 	int ret;
 
+	if (fs_cur && fs_activate(fs_cur))
+		return -1;
+
 	/*
 	 * We don't actually know how many bytes are being read, since len==0
 	 * means read the whole file.
@@ -201,17 +493,19 @@ int fs_read(const char *filename, ulong addr, int offset, int len)
 		printf("** Unable to read file %s **\n", filename);
 		ret = -1;
 	}
-	fs_close();
 
 	return ret;
 }
 
 int fs_write(const char *filename, ulong addr, int offset, int len)
 {
-	struct fstype_info *info = fs_get_info(fs_type);
+	struct fstype_info *info = fs_cur_info();
 	void *buf;
 	int ret;
 
+	if (fs_cur && fs_activate(fs_cur))
+		return -1;
+
 	/*
 	 * We don't actually know how many bytes are being read, since len==0
 	 * means read the whole file.
@@ -225,7 +519,6 @@ int fs_write(const char *filename, ulong addr, int offset, int len)
 		printf("** Unable to write file %s **\n", filename);
 		ret = -1;
 	}
-	fs_close();
 
 	return ret;
 }
@@ -72,6 +72,46 @@ int sandbox_fs_ls(const char *dirname)
 	return 0;
 }
 
+/* Open files are host file descriptors */
+int sandbox_fs_open_file(const char *filename, void **filep, loff_t *sizep)
+{
+	off_t size;
+	int fd;
+
+	fd = os_open(filename, OS_O_RDONLY);
+	if (fd < 0)
+		return -1;
+	size = os_lseek(fd, 0, OS_SEEK_END);
+	if (size < 0) {
+		os_close(fd);
+		return -1;
+	}
+	*filep = (void *)(uintptr_t)fd;
+	*sizep = size;
+
+	return 0;
+}
+
+int sandbox_fs_read_file_at(void *filep, loff_t pos, void *buf, int len)
+{
+	int fd = (uintptr_t)filep;
+
+	if (os_lseek(fd, pos, OS_SEEK_SET) < 0)
+		return -1;
+
+	return os_read(fd, buf, len);
+}
+
+void sandbox_fs_close_file(void *filep)
+{
+	os_close((uintptr_t)filep);
+}
+
+int sandbox_fs_mounted(block_dev_desc_t *rbdd, disk_partition_t *info)
+{
+	return 1;
+}
+
 void sandbox_fs_close(void)
 {
 }
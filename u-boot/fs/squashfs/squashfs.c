@@ -0,0 +1,989 @@
+/*
+ * SquashFS 4.0 read support
+ *
+ * Inodes and directories are read through a small cache of uncompressed
+ * metadata blocks. File data is read a block at a time: blocks a read
+ * covers entirely are decompressed straight into the destination, and
+ * only fragments and blocks read in part go through the block cache.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <fs.h>
+#include <malloc.h>
+#include <squashfs.h>
+#include <asm/unaligned.h>
+#include <linux/lzo.h>
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+#include <lzma/LzmaTools.h>
+#include <u-boot/zlib.h>
+#include "squashfs_fs.h"
+
+#ifndef CONFIG_SQUASHFS_META_CACHE
+#define CONFIG_SQUASHFS_META_CACHE	8
+#endif
+
+#ifndef CONFIG_SQUASHFS_BLOCK_CACHE
+#define CONFIG_SQUASHFS_BLOCK_CACHE	2
+#endif
+
+#define SQFS_MAX_DEPTH		32	/* directories in a path */
+#define SQFS_MAX_SYMLINKS	8	/* symbolic links followed in a path */
+#define SQFS_MAX_LINK_LEN	4096
+
+/* An uncompressed block, found by where it starts on disk */
+struct sqfs_cache_entry {
+	u64 start;
+	u64 next;		/* metadata only: where the next block starts */
+	int len;		/* 0 when unused */
+	ulong last_used;
+	u8 *data;
+};
+
+/* A position in the inode or directory table */
+struct sqfs_meta_pos {
+	u64 block;		/* of the metadata block on disk */
+	u32 offset;		/* in the block once uncompressed */
+};
+
+struct sqfs_inode {
+	int type;		/* SQFS_*_TYPE, extended types as basic ones */
+	u32 ino;
+	u64 size;
+	u64 start_block;	/* files: first data block */
+	u32 fragment;		/* files: fragment of the tail end */
+	u32 frag_offset;
+	/* Directory listing, block list of a file or target of a link */
+	struct sqfs_meta_pos data;
+};
+
+struct sqfs_dir {
+	struct sqfs_meta_pos pos;
+	u32 left;		/* bytes of the listing not read yet */
+	u32 count;		/* entries left under the current header */
+	u32 start_block;	/* of the inodes under the current header */
+};
+
+/* What the dentry cache keeps for a name found in a directory */
+struct sqfs_dentry {
+	u64 ref;
+	int type;
+};
+
+struct sqfs_file {
+	u64 size;
+	u32 nblocks;		/* not counting the fragment */
+	u32 fragment;
+	u32 frag_offset;
+	u64 *starts;		/* on disk, of each block */
+	u32 *sizes;		/* on disk, of each block, as in the block list */
+};
+
+struct sqfs_info {
+	block_dev_desc_t *dev_desc;
+	lbaint_t part_start;
+	u32 block_size;
+	int block_log;
+	int compression;
+	u32 inodes;
+	u32 fragments;
+	u64 bytes_used;
+	u64 root_inode;
+	u64 inode_table;
+	u64 dir_table;
+	u64 *frag_index;	/* metadata blocks of the fragment table */
+	u8 *cbuf;		/* compressed blocks are read into this */
+	z_stream zs;
+	int zs_ready;
+	ulong clock;
+	struct sqfs_cache_entry meta[CONFIG_SQUASHFS_META_CACHE];
+	struct sqfs_cache_entry blocks[CONFIG_SQUASHFS_BLOCK_CACHE];
+	ulong meta_hits, meta_misses;
+	ulong block_hits, block_misses;
+	ulong direct;		/* blocks read straight into the destination */
+};
+
+static struct sqfs_info *sqfs;
+
+static const char *sqfs_comp_name(int comp)
+{
+	switch (comp) {
+	case SQFS_COMP_GZIP:
+		return "gzip";
+	case SQFS_COMP_LZMA:
+		return "lzma";
+	case SQFS_COMP_LZO:
+		return "lzo";
+	case SQFS_COMP_XZ:
+		return "xz";
+	default:
+		return "unknown";
+	}
+}
+
+static int sqfs_comp_supported(int comp)
+{
+	switch (comp) {
+	case SQFS_COMP_GZIP:
+#ifdef CONFIG_LZMA
+	case SQFS_COMP_LZMA:
+#endif
+#ifdef CONFIG_LZO
+	case SQFS_COMP_LZO:
+#endif
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* Read 'len' bytes at byte 'pos' of the filesystem */
+static int sqfs_disk_read(u64 pos, u32 len, void *buf)
+{
+	block_dev_desc_t *dev_desc = sqfs->dev_desc;
+	int log2blksz = dev_desc->log2blksz;
+	lbaint_t sector = sqfs->part_start + (pos >> log2blksz);
+	u32 offset = pos & (dev_desc->blksz - 1);
+	ALLOC_CACHE_ALIGN_BUFFER(u8, sec_buf, dev_desc->blksz);
+	u8 *dst = buf;
+	lbaint_t count;
+	u32 n;
+
+	if (pos + len > sqfs->bytes_used) {
+		printf("** SquashFS: read outside filesystem at %llu **\n",
+		       pos);
+		return -1;
+	}
+
+	if (offset) {
+		if (dev_desc->block_read(dev_desc->dev, sector, 1,
+					 sec_buf) != 1)
+			goto err;
+		n = min(len, (u32)dev_desc->blksz - offset);
+		memcpy(dst, sec_buf + offset, n);
+		dst += n;
+		len -= n;
+		sector++;
+	}
+
+	count = len >> log2blksz;
+	if (count) {
+		if (dev_desc->block_read(dev_desc->dev, sector, count,
+					 dst) != count)
+			goto err;
+		dst += count << log2blksz;
+		len -= count << log2blksz;
+		sector += count;
+	}
+
+	if (len) {
+		if (dev_desc->block_read(dev_desc->dev, sector, 1,
+					 sec_buf) != 1)
+			goto err;
+		memcpy(dst, sec_buf, len);
+	}
+
+	return 0;
+
+err:
+	printf("** SquashFS: read error at %llu **\n", pos);
+	return -1;
+}
+
+/*
+ * Decompress 'srclen' bytes at 'src' into at most 'dstlen' bytes at 'dst'.
+ *
+ * Returns the uncompressed length, or -1 on error.
+ */
+static int sqfs_decompress(void *dst, u32 dstlen, void *src, u32 srclen)
+{
+	switch (sqfs->compression) {
+	case SQFS_COMP_GZIP: {
+		z_stream *zs = &sqfs->zs;
+
+		if (inflateReset(zs) != Z_OK)
+			return -1;
+		zs->next_in = src;
+		zs->avail_in = srclen;
+		zs->next_out = dst;
+		zs->avail_out = dstlen;
+		if (inflate(zs, Z_FINISH) != Z_STREAM_END)
+			return -1;
+		return zs->total_out;
+	}
+#ifdef CONFIG_LZO
+	case SQFS_COMP_LZO: {
+		size_t len = dstlen;
+
+		if (lzo1x_decompress_safe(src, srclen, dst, &len) != LZO_E_OK)
+			return -1;
+		return len;
+	}
+#endif
+#ifdef CONFIG_LZMA
+	case SQFS_COMP_LZMA: {
+		SizeT len;
+
+		/* The decoder writes as much as the header says, so check it */
+		if (srclen < LZMA_PROPS_SIZE + sizeof(u64) ||
+		    get_unaligned_le64((u8 *)src + LZMA_PROPS_SIZE) > dstlen)
+			return -1;
+		if (lzmaBuffToBuffDecompress(dst, &len, src, srclen) != SZ_OK)
+			return -1;
+		return len;
+	}
+#endif
+	default:
+		return -1;
+	}
+}
+
+/*
+ * Find the block starting at 'start' in 'cache', or the entry to load it
+ * into: an unused one or else the least recently used.
+ */
+static struct sqfs_cache_entry *sqfs_cache_find(struct sqfs_cache_entry *cache,
+						int entries, u64 start,
+						int *hit)
+{
+	struct sqfs_cache_entry *entry, *victim = cache;
+	int i;
+
+	for (i = 0, entry = cache; i < entries; i++, entry++) {
+		if (entry->len && entry->start == start) {
+			entry->last_used = ++sqfs->clock;
+			*hit = 1;
+			return entry;
+		}
+		if (!entry->len ||
+		    (victim->len && entry->last_used < victim->last_used))
+			victim = entry;
+	}
+
+	victim->start = start;
+	victim->len = 0;
+	victim->last_used = ++sqfs->clock;
+	*hit = 0;
+
+	return victim;
+}
+
+static struct sqfs_cache_entry *sqfs_meta_get(u64 start)
+{
+	struct sqfs_cache_entry *entry;
+	u32 len, size;
+	u16 header;
+	int hit, ret;
+
+	entry = sqfs_cache_find(sqfs->meta, CONFIG_SQUASHFS_META_CACHE, start,
+				&hit);
+	if (hit) {
+		sqfs->meta_hits++;
+		return entry;
+	}
+	sqfs->meta_misses++;
+
+	/* Read the header and the most the block can be in one go */
+	if (start + 2 > sqfs->bytes_used)
+		goto err;
+	len = min((u64)2 + SQFS_METADATA_SIZE, sqfs->bytes_used - start);
+	if (sqfs_disk_read(start, len, sqfs->cbuf))
+		return NULL;
+
+	header = get_unaligned_le16(sqfs->cbuf);
+	size = SQFS_META_SIZE(header);
+	if (!size || size > SQFS_METADATA_SIZE || size + 2 > len)
+		goto err;
+	if (header & SQFS_META_UNCOMPRESSED) {
+		memcpy(entry->data, sqfs->cbuf + 2, size);
+		ret = size;
+	} else {
+		ret = sqfs_decompress(entry->data, SQFS_METADATA_SIZE,
+				      sqfs->cbuf + 2, size);
+		if (ret <= 0)
+			goto err;
+	}
+	entry->len = ret;
+	entry->next = start + 2 + size;
+
+	return entry;
+
+err:
+	printf("** SquashFS: bad metadata block at %llu **\n", start);
+	return NULL;
+}
+
+/* Read 'len' bytes at 'pos', or skip them if 'buf' is NULL, and move on */
+static int sqfs_meta_read(struct sqfs_meta_pos *pos, void *buf, u32 len)
+{
+	struct sqfs_cache_entry *entry;
+	u8 *dst = buf;
+	u32 n;
+
+	while (len) {
+		entry = sqfs_meta_get(pos->block);
+		if (!entry)
+			return -1;
+		if (pos->offset >= entry->len) {
+			pos->offset -= entry->len;
+			pos->block = entry->next;
+			continue;
+		}
+		n = min(len, entry->len - pos->offset);
+		if (dst) {
+			memcpy(dst, entry->data + pos->offset, n);
+			dst += n;
+		}
+		pos->offset += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/*
+ * Read the data or fragment block at 'start', of 'size' on disk as given
+ * in a block list or the fragment table, into at most 'len' bytes at 'dst'.
+ *
+ * Returns the uncompressed length, or -1 on error.
+ */
+static int sqfs_read_block(u64 start, u32 size, void *dst, u32 len)
+{
+	u32 disk_size = SQFS_BLOCK_SIZE(size);
+	int ret;
+
+	if (disk_size > sqfs->block_size)
+		goto err;
+
+	if (size & SQFS_BLOCK_UNCOMPRESSED) {
+		if (disk_size > len)
+			goto err;
+		if (sqfs_disk_read(start, disk_size, dst))
+			return -1;
+		return disk_size;
+	}
+
+	if (sqfs_disk_read(start, disk_size, sqfs->cbuf))
+		return -1;
+	ret = sqfs_decompress(dst, len, sqfs->cbuf, disk_size);
+	if (ret < 0)
+		goto err;
+
+	return ret;
+
+err:
+	printf("** SquashFS: bad data block at %llu **\n", start);
+	return -1;
+}
+
+static struct sqfs_cache_entry *sqfs_block_get(u64 start, u32 size)
+{
+	struct sqfs_cache_entry *entry;
+	int hit, ret;
+
+	entry = sqfs_cache_find(sqfs->blocks, CONFIG_SQUASHFS_BLOCK_CACHE,
+				start, &hit);
+	if (hit) {
+		sqfs->block_hits++;
+		return entry;
+	}
+	sqfs->block_misses++;
+
+	if (!entry->data) {
+		entry->data = malloc(sqfs->block_size);
+		if (!entry->data)
+			return NULL;
+	}
+	ret = sqfs_read_block(start, size, entry->data, sqfs->block_size);
+	if (ret <= 0)
+		return NULL;
+	entry->len = ret;
+
+	return entry;
+}
+
+static int sqfs_read_inode(u64 ref, struct sqfs_inode *inode)
+{
+	struct sqfs_meta_pos pos;
+	union {
+		struct squashfs_base_inode base;
+		struct squashfs_dir_inode dir;
+		struct squashfs_ldir_inode ldir;
+		struct squashfs_reg_inode reg;
+		struct squashfs_lreg_inode lreg;
+		struct squashfs_symlink_inode symlink;
+	} in;
+	u8 *rest = (u8 *)&in + sizeof(in.base);
+	int type;
+
+	pos.block = sqfs->inode_table + SQFS_INODE_BLK(ref);
+	pos.offset = SQFS_INODE_OFFSET(ref);
+	if (sqfs_meta_read(&pos, &in.base, sizeof(in.base)))
+		return -1;
+
+	type = le16_to_cpu(in.base.inode_type);
+	memset(inode, '\0', sizeof(*inode));
+	inode->type = type;
+	inode->ino = le32_to_cpu(in.base.inode_number);
+
+	switch (type) {
+	case SQFS_DIR_TYPE:
+		if (sqfs_meta_read(&pos, rest,
+				   sizeof(in.dir) - sizeof(in.base)))
+			return -1;
+		inode->size = le16_to_cpu(in.dir.file_size);
+		inode->data.block = sqfs->dir_table +
+			le32_to_cpu(in.dir.start_block);
+		inode->data.offset = le16_to_cpu(in.dir.offset);
+		break;
+	case SQFS_LDIR_TYPE:
+		if (sqfs_meta_read(&pos, rest,
+				   sizeof(in.ldir) - sizeof(in.base)))
+			return -1;
+		inode->type = SQFS_DIR_TYPE;
+		inode->size = le32_to_cpu(in.ldir.file_size);
+		inode->data.block = sqfs->dir_table +
+			le32_to_cpu(in.ldir.start_block);
+		inode->data.offset = le16_to_cpu(in.ldir.offset);
+		break;
+	case SQFS_REG_TYPE:
+		if (sqfs_meta_read(&pos, rest,
+				   sizeof(in.reg) - sizeof(in.base)))
+			return -1;
+		inode->size = le32_to_cpu(in.reg.file_size);
+		inode->start_block = le32_to_cpu(in.reg.start_block);
+		inode->fragment = le32_to_cpu(in.reg.fragment);
+		inode->frag_offset = le32_to_cpu(in.reg.offset);
+		inode->data = pos;
+		break;
+	case SQFS_LREG_TYPE:
+		if (sqfs_meta_read(&pos, rest,
+				   sizeof(in.lreg) - sizeof(in.base)))
+			return -1;
+		inode->type = SQFS_REG_TYPE;
+		inode->size = le64_to_cpu(in.lreg.file_size);
+		inode->start_block = le64_to_cpu(in.lreg.start_block);
+		inode->fragment = le32_to_cpu(in.lreg.fragment);
+		inode->frag_offset = le32_to_cpu(in.lreg.offset);
+		inode->data = pos;
+		break;
+	case SQFS_SYMLINK_TYPE:
+	case SQFS_LSYMLINK_TYPE:
+		if (sqfs_meta_read(&pos, rest,
+				   sizeof(in.symlink) - sizeof(in.base)))
+			return -1;
+		inode->type = SQFS_SYMLINK_TYPE;
+		inode->size = le32_to_cpu(in.symlink.symlink_size);
+		inode->data = pos;
+		break;
+	}
+
+	return 0;
+}
+
+static void sqfs_opendir(struct sqfs_inode *inode, struct sqfs_dir *dir)
+{
+	dir->pos = inode->data;
+	/* The size counts the "." and ".." entries that are not stored */
+	dir->left = inode->size > 3 ? inode->size - 3 : 0;
+	dir->count = 0;
+}
+
+/*
+ * Read the next entry of 'dir', its name into 'name' of SQFS_NAME_LEN + 1
+ * bytes.
+ *
+ * Returns 1 for an entry, 0 at the end of the directory or -1 on error.
+ */
+static int sqfs_readdir(struct sqfs_dir *dir, char *name, u64 *ref,
+			int *type)
+{
+	struct squashfs_dir_header header;
+	struct squashfs_dir_entry entry;
+	u32 size;
+
+	if (!dir->count) {
+		if (dir->left < sizeof(header))
+			return 0;
+		if (sqfs_meta_read(&dir->pos, &header, sizeof(header)))
+			return -1;
+		dir->left -= sizeof(header);
+		dir->count = le32_to_cpu(header.count) + 1;
+		dir->start_block = le32_to_cpu(header.start_block);
+		if (dir->count > SQFS_DIR_COUNT)
+			goto err;
+	}
+
+	if (dir->left < sizeof(entry))
+		goto err;
+	if (sqfs_meta_read(&dir->pos, &entry, sizeof(entry)))
+		return -1;
+	size = le16_to_cpu(entry.size) + 1;
+	if (size > SQFS_NAME_LEN || dir->left < sizeof(entry) + size)
+		goto err;
+	if (sqfs_meta_read(&dir->pos, name, size))
+		return -1;
+	name[size] = '\0';
+	dir->left -= sizeof(entry) + size;
+	dir->count--;
+
+	*ref = ((u64)dir->start_block << 16) | le16_to_cpu(entry.offset);
+	*type = le16_to_cpu(entry.type);
+
+	return 1;
+
+err:
+	printf("** SquashFS: bad directory **\n");
+	return -1;
+}
+
+/*
+ * Look for 'name' in the directory 'dir'.
+ *
+ * Returns 1 if found, with its inode reference and type, 0 if not found or
+ * -1 on error.
+ */
+static int sqfs_dir_lookup(struct sqfs_inode *dir, const char *name,
+			   u64 *ref, int *type)
+{
+	char entry_name[SQFS_NAME_LEN + 1];
+	struct sqfs_dentry dentry;
+	struct sqfs_dir iter;
+	int ret, cmp;
+
+	ret = dentry_cache_lookup(sqfs->dev_desc, sqfs->part_start, dir->ino,
+				  name, &dentry, sizeof(dentry));
+	if (ret == 1) {
+		*ref = dentry.ref;
+		*type = dentry.type;
+		return 1;
+	} else if (ret == 0) {
+		return 0;
+	}
+
+	sqfs_opendir(dir, &iter);
+	while ((ret = sqfs_readdir(&iter, entry_name, ref, type)) == 1) {
+		cmp = strcmp(entry_name, name);
+		if (!cmp) {
+			dentry.ref = *ref;
+			dentry.type = *type;
+			dentry_cache_add(sqfs->dev_desc, sqfs->part_start,
+					 dir->ino, name, &dentry,
+					 sizeof(dentry));
+			return 1;
+		}
+		/* Entries are sorted by name */
+		if (cmp > 0)
+			break;
+	}
+	if (ret < 0)
+		return -1;
+
+	dentry_cache_add(sqfs->dev_desc, sqfs->part_start, dir->ino, name,
+			 NULL, 0);
+
+	return 0;
+}
+
+/* Look up 'path' from the root, following symbolic links on the way */
+static int sqfs_lookup(const char *path, struct sqfs_inode *inode)
+{
+	u64 parents[SQFS_MAX_DEPTH];
+	char *work, *p, *name, *link;
+	int depth = 0, links = 0, type, ret = -1;
+	u64 ref = sqfs->root_inode;
+
+	work = strdup(path);
+	if (!work)
+		return -1;
+	if (sqfs_read_inode(ref, inode))
+		goto out;
+
+	p = work;
+	for (;;) {
+		while (*p == '/')
+			p++;
+		if (!*p)
+			break;
+		name = p;
+		while (*p && *p != '/')
+			p++;
+		if (*p)
+			*p++ = '\0';
+
+		if (!strcmp(name, "."))
+			continue;
+		if (!strcmp(name, "..")) {
+			ref = depth ? parents[--depth] : sqfs->root_inode;
+			if (sqfs_read_inode(ref, inode))
+				goto out;
+			continue;
+		}
+
+		if (inode->type != SQFS_DIR_TYPE || depth == SQFS_MAX_DEPTH)
+			goto out;
+		parents[depth++] = ref;
+		if (sqfs_dir_lookup(inode, name, &ref, &type) != 1 ||
+		    sqfs_read_inode(ref, inode))
+			goto out;
+		if (inode->type != SQFS_SYMLINK_TYPE)
+			continue;
+
+		/* Carry on from the link's directory with its target */
+		if (++links > SQFS_MAX_SYMLINKS || inode->size > SQFS_MAX_LINK_LEN)
+			goto out;
+		link = malloc(inode->size + strlen(p) + 2);
+		if (!link)
+			goto out;
+		if (sqfs_meta_read(&inode->data, link, inode->size)) {
+			free(link);
+			goto out;
+		}
+		link[inode->size] = '/';
+		strcpy(link + inode->size + 1, p);
+		free(work);
+		work = p = link;
+
+		ref = parents[--depth];
+		if (*p == '/') {
+			ref = sqfs->root_inode;
+			depth = 0;
+		}
+		if (sqfs_read_inode(ref, inode))
+			goto out;
+	}
+	ret = 0;
+
+out:
+	free(work);
+	return ret;
+}
+
+int sqfs_ls(const char *dirname)
+{
+	char name[SQFS_NAME_LEN + 1];
+	struct sqfs_inode inode;
+	struct sqfs_dir dir;
+	int ret, type;
+	u64 ref;
+
+	if (sqfs_lookup(dirname, &inode) || inode.type != SQFS_DIR_TYPE) {
+		printf("** Can not find directory. **\n");
+		return -1;
+	}
+
+	sqfs_opendir(&inode, &dir);
+	while ((ret = sqfs_readdir(&dir, name, &ref, &type)) == 1) {
+		if (sqfs_read_inode(ref, &inode))
+			return -1;
+		switch (inode.type) {
+		case SQFS_DIR_TYPE:
+			printf("<DIR> ");
+			break;
+		case SQFS_SYMLINK_TYPE:
+			printf("<SYM> ");
+			break;
+		case SQFS_REG_TYPE:
+			printf("      ");
+			break;
+		default:
+			printf("< ? > ");
+			break;
+		}
+		printf("%10llu %s\n", inode.size, name);
+	}
+
+	return ret;
+}
+
+int sqfs_open_file(const char *filename, void **filep, loff_t *sizep)
+{
+	struct sqfs_inode inode;
+	struct sqfs_file *file;
+	u64 nblocks, start;
+	u32 i;
+
+	if (sqfs_lookup(filename, &inode)) {
+		printf("** File not found %s **\n", filename);
+		return -1;
+	}
+	if (inode.type != SQFS_REG_TYPE) {
+		printf("** %s is not a regular file **\n", filename);
+		return -1;
+	}
+
+	nblocks = inode.size >> sqfs->block_log;
+	if (inode.fragment == SQFS_INVALID_FRAG &&
+	    inode.size & (sqfs->block_size - 1))
+		nblocks++;
+	if (nblocks > (u32)-1 / (sizeof(u64) + sizeof(u32)))
+		return -1;
+
+	file = malloc(sizeof(*file) + nblocks * (sizeof(u64) + sizeof(u32)));
+	if (!file)
+		return -1;
+	file->size = inode.size;
+	file->nblocks = nblocks;
+	file->fragment = inode.fragment;
+	file->frag_offset = inode.frag_offset;
+	file->starts = (u64 *)(file + 1);
+	file->sizes = (u32 *)(file->starts + nblocks);
+
+	/* The blocks follow each other on disk, from the first one */
+	if (sqfs_meta_read(&inode.data, file->sizes, nblocks * sizeof(u32))) {
+		free(file);
+		return -1;
+	}
+	start = inode.start_block;
+	for (i = 0; i < nblocks; i++) {
+		file->sizes[i] = le32_to_cpu(file->sizes[i]);
+		file->starts[i] = start;
+		start += SQFS_BLOCK_SIZE(file->sizes[i]);
+	}
+
+	*filep = file;
+	*sizep = file->size;
+
+	return 0;
+}
+
+static int sqfs_frag_entry(u32 fragment, u64 *start, u32 *size)
+{
+	struct squashfs_fragment_entry entry;
+	struct sqfs_meta_pos pos;
+
+	if (fragment >= sqfs->fragments) {
+		printf("** SquashFS: bad fragment %u **\n", fragment);
+		return -1;
+	}
+	pos.block = sqfs->frag_index[fragment / SQFS_FRAGS_PER_META];
+	pos.offset = fragment % SQFS_FRAGS_PER_META * sizeof(entry);
+	if (sqfs_meta_read(&pos, &entry, sizeof(entry)))
+		return -1;
+	*start = le64_to_cpu(entry.start_block);
+	*size = le32_to_cpu(entry.size);
+
+	return 0;
+}
+
+int sqfs_read_file_at(void *filep, loff_t pos, void *buf, int len)
+{
+	struct sqfs_file *file = filep;
+	struct sqfs_cache_entry *entry;
+	u8 *dst = buf;
+	u32 block, offset, block_len, n, size;
+	u64 start;
+
+	if (pos < 0 || len < 0)
+		return -1;
+	if (pos >= file->size)
+		return 0;
+	if (len > file->size - pos)
+		len = file->size - pos;
+
+	while (len) {
+		block = pos >> sqfs->block_log;
+		offset = pos & (sqfs->block_size - 1);
+
+		if (block >= file->nblocks) {
+			/* The tail end of the file, in a fragment block */
+			if (sqfs_frag_entry(file->fragment, &start, &size))
+				return -1;
+			entry = sqfs_block_get(start, size);
+			if (!entry)
+				return -1;
+			if (file->frag_offset + offset + len > entry->len) {
+				printf("** SquashFS: bad fragment %u **\n",
+				       file->fragment);
+				return -1;
+			}
+			memcpy(dst, entry->data + file->frag_offset + offset,
+			       len);
+			dst += len;
+			break;
+		}
+
+		block_len = min((u64)sqfs->block_size,
+				file->size - ((u64)block << sqfs->block_log));
+		n = min((u32)len, block_len - offset);
+		size = file->sizes[block];
+		start = file->starts[block];
+
+		if (!size) {
+			/* Sparse */
+			memset(dst, '\0', n);
+		} else if (n == block_len) {
+			if (sqfs_read_block(start, size, dst, block_len) !=
+					block_len)
+				return -1;
+			sqfs->direct++;
+		} else if (size & SQFS_BLOCK_UNCOMPRESSED) {
+			if (sqfs_disk_read(start + offset, n, dst))
+				return -1;
+		} else {
+			entry = sqfs_block_get(start, size);
+			if (!entry || entry->len != block_len)
+				return -1;
+			memcpy(dst, entry->data + offset, n);
+		}
+		dst += n;
+		pos += n;
+		len -= n;
+	}
+
+	return dst - (u8 *)buf;
+}
+
+void sqfs_close_file(void *filep)
+{
+	free(filep);
+}
+
+int sqfs_read_file(const char *filename, void *buf, int offset, int len)
+{
+	void *file;
+	loff_t size;
+	int ret;
+
+	if (sqfs_open_file(filename, &file, &size))
+		return -1;
+	if (offset > size) {
+		sqfs_close_file(file);
+		return -1;
+	}
+	if (!len)
+		len = size - offset;
+	ret = sqfs_read_file_at(file, offset, buf, len);
+	sqfs_close_file(file);
+
+	return ret;
+}
+
+int sqfs_probe(block_dev_desc_t *fs_dev_desc, disk_partition_t *fs_partition)
+{
+	struct squashfs_super_block *sb;
+	ALLOC_CACHE_ALIGN_BUFFER(u8, buf, fs_dev_desc->blksz);
+	u32 block_log, comp, count, i;
+	u8 *meta;
+
+	sqfs_close();
+
+	if (fs_dev_desc->blksz < sizeof(*sb) ||
+	    fs_dev_desc->block_read(fs_dev_desc->dev, fs_partition->start, 1,
+				    buf) != 1)
+		return -1;
+	sb = (struct squashfs_super_block *)buf;
+	if (le32_to_cpu(sb->s_magic) != SQFS_MAGIC)
+		return -1;
+
+	block_log = le16_to_cpu(sb->block_log);
+	comp = le16_to_cpu(sb->compression);
+	if (le16_to_cpu(sb->s_major) != SQFS_MAJOR ||
+	    block_log < SQFS_MIN_BLOCK_LOG || block_log > SQFS_MAX_BLOCK_LOG ||
+	    le32_to_cpu(sb->block_size) != 1 << block_log ||
+	    le64_to_cpu(sb->bytes_used) >
+			(u64)fs_partition->size * fs_partition->blksz) {
+		printf("** SquashFS: bad superblock **\n");
+		return -1;
+	}
+	if (!sqfs_comp_supported(comp)) {
+		printf("** SquashFS: %s compression not supported **\n",
+		       sqfs_comp_name(comp));
+		return -1;
+	}
+
+	sqfs = calloc(1, sizeof(*sqfs));
+	if (!sqfs)
+		return -1;
+	sqfs->dev_desc = fs_dev_desc;
+	sqfs->part_start = fs_partition->start;
+	sqfs->block_size = 1 << block_log;
+	sqfs->block_log = block_log;
+	sqfs->compression = comp;
+	sqfs->inodes = le32_to_cpu(sb->inodes);
+	sqfs->fragments = le32_to_cpu(sb->fragments);
+	sqfs->bytes_used = le64_to_cpu(sb->bytes_used);
+	sqfs->root_inode = le64_to_cpu(sb->root_inode);
+	sqfs->inode_table = le64_to_cpu(sb->inode_table_start);
+	sqfs->dir_table = le64_to_cpu(sb->directory_table_start);
+
+	meta = malloc(CONFIG_SQUASHFS_META_CACHE * SQFS_METADATA_SIZE);
+	if (!meta)
+		goto err;
+	for (i = 0; i < CONFIG_SQUASHFS_META_CACHE; i++)
+		sqfs->meta[i].data = meta + i * SQFS_METADATA_SIZE;
+	sqfs->cbuf = malloc(max(sqfs->block_size,
+			    (u32)2 + SQFS_METADATA_SIZE));
+	if (!sqfs->cbuf)
+		goto err;
+
+	count = DIV_ROUND_UP(sqfs->fragments, SQFS_FRAGS_PER_META);
+	if (count) {
+		sqfs->frag_index = malloc(count * sizeof(u64));
+		if (!sqfs->frag_index ||
+		    sqfs_disk_read(le64_to_cpu(sb->fragment_table_start),
+				   count * sizeof(u64), sqfs->frag_index))
+			goto err;
+	}
+	for (i = 0; i < count; i++)
+		sqfs->frag_index[i] = le64_to_cpu(sqfs->frag_index[i]);
+
+	if (comp == SQFS_COMP_GZIP) {
+		sqfs->zs.zalloc = gzalloc;
+		sqfs->zs.zfree = gzfree;
+		if (inflateInit(&sqfs->zs) != Z_OK)
+			goto err;
+		sqfs->zs_ready = 1;
+	}
+
+	return 0;
+
+err:
+	sqfs_close();
+	return -1;
+}
+
+int sqfs_mounted(block_dev_desc_t *fs_dev_desc, disk_partition_t *fs_partition)
+{
+	return sqfs && sqfs->dev_desc == fs_dev_desc &&
+		sqfs->part_start == fs_partition->start;
+}
+
+void sqfs_close(void)
+{
+	int i;
+
+	if (!sqfs)
+		return;
+
+	if (sqfs->zs_ready)
+		inflateEnd(&sqfs->zs);
+	for (i = 0; i < CONFIG_SQUASHFS_BLOCK_CACHE; i++)
+		free(sqfs->blocks[i].data);
+	free(sqfs->meta[0].data);
+	free(sqfs->frag_index);
+	free(sqfs->cbuf);
+	free(sqfs);
+	sqfs = NULL;
+}
+
+void sqfs_info(void)
+{
+	if (!sqfs) {
+		printf("** No SquashFS mounted **\n");
+		return;
+	}
+
+	printf("SquashFS, %s compression, %u byte blocks\n",
+	       sqfs_comp_name(sqfs->compression), sqfs->block_size);
+	printf("%u inodes, %u fragments, %llu bytes\n", sqfs->inodes,
+	       sqfs->fragments, sqfs->bytes_used);
+	printf("Metadata cache: %d blocks, %lu hits, %lu misses\n",
+	       CONFIG_SQUASHFS_META_CACHE, sqfs->meta_hits, sqfs->meta_misses);
+	printf("Block cache: %d blocks, %lu hits, %lu misses\n",
+	       CONFIG_SQUASHFS_BLOCK_CACHE, sqfs->block_hits,
+	       sqfs->block_misses);
+	printf("Blocks read straight to memory: %lu\n", sqfs->direct);
+}
@@ -0,0 +1,163 @@
+/*
+ * SquashFS 4.0 on-disk format, as described by the Linux kernel's
+ * fs/squashfs/squashfs_fs.h. Everything is little endian.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __SQUASHFS_FS_H__
+#define __SQUASHFS_FS_H__
+
+#include <linux/types.h>
+
+#define SQFS_MAGIC		0x73717368	/* "hsqs" */
+#define SQFS_MAJOR		4
+
+#define SQFS_MIN_BLOCK_LOG	12
+#define SQFS_MAX_BLOCK_LOG	20
+
+/*
+ * Inodes and directories are kept in tables of metadata blocks, each of
+ * up to 8KiB before compression with a 16-bit header giving its size on
+ * disk.
+ */
+#define SQFS_METADATA_SIZE	8192
+#define SQFS_META_UNCOMPRESSED	(1 << 15)
+#define SQFS_META_SIZE(h)	((h) & ~SQFS_META_UNCOMPRESSED)
+
+/* Data and fragment block sizes, as in the block list of a file */
+#define SQFS_BLOCK_UNCOMPRESSED	(1 << 24)
+#define SQFS_BLOCK_SIZE(s)	((s) & ~SQFS_BLOCK_UNCOMPRESSED)
+
+#define SQFS_INVALID_FRAG	0xffffffff
+#define SQFS_FRAGS_PER_META	(SQFS_METADATA_SIZE / \
+				 sizeof(struct squashfs_fragment_entry))
+
+/*
+ * A reference to an inode: the position of its metadata block from the
+ * start of the inode table, and its offset in the block when uncompressed.
+ */
+#define SQFS_INODE_BLK(ref)	((u32)((ref) >> 16))
+#define SQFS_INODE_OFFSET(ref)	((u32)((ref) & 0xffff))
+
+#define SQFS_NAME_LEN		256
+#define SQFS_DIR_COUNT		256
+
+/* Compressors */
+#define SQFS_COMP_GZIP		1
+#define SQFS_COMP_LZMA		2
+#define SQFS_COMP_LZO		3
+#define SQFS_COMP_XZ		4
+
+/* Inode types */
+#define SQFS_DIR_TYPE		1
+#define SQFS_REG_TYPE		2
+#define SQFS_SYMLINK_TYPE	3
+#define SQFS_BLKDEV_TYPE	4
+#define SQFS_CHRDEV_TYPE	5
+#define SQFS_FIFO_TYPE		6
+#define SQFS_SOCKET_TYPE	7
+#define SQFS_LDIR_TYPE		8
+#define SQFS_LREG_TYPE		9
+#define SQFS_LSYMLINK_TYPE	10
+
+struct squashfs_super_block {
+	__le32 s_magic;
+	__le32 inodes;
+	__le32 mkfs_time;
+	__le32 block_size;
+	__le32 fragments;
+	__le16 compression;
+	__le16 block_log;
+	__le16 flags;
+	__le16 no_ids;
+	__le16 s_major;
+	__le16 s_minor;
+	__le64 root_inode;
+	__le64 bytes_used;
+	__le64 id_table_start;
+	__le64 xattr_id_table_start;
+	__le64 inode_table_start;
+	__le64 directory_table_start;
+	__le64 fragment_table_start;
+	__le64 lookup_table_start;
+};
+
+struct squashfs_base_inode {
+	__le16 inode_type;
+	__le16 mode;
+	__le16 uid;
+	__le16 guid;
+	__le32 mtime;
+	__le32 inode_number;
+};
+
+struct squashfs_dir_inode {
+	struct squashfs_base_inode base;
+	__le32 start_block;
+	__le32 nlink;
+	__le16 file_size;
+	__le16 offset;
+	__le32 parent_inode;
+};
+
+struct squashfs_ldir_inode {
+	struct squashfs_base_inode base;
+	__le32 nlink;
+	__le32 file_size;
+	__le32 start_block;
+	__le32 parent_inode;
+	__le16 i_count;
+	__le16 offset;
+	__le32 xattr;
+};
+
+/* Followed by the size of each block of the file */
+struct squashfs_reg_inode {
+	struct squashfs_base_inode base;
+	__le32 start_block;
+	__le32 fragment;
+	__le32 offset;
+	__le32 file_size;
+};
+
+struct squashfs_lreg_inode {
+	struct squashfs_base_inode base;
+	__le64 start_block;
+	__le64 file_size;
+	__le64 sparse;
+	__le32 nlink;
+	__le32 fragment;
+	__le32 offset;
+	__le32 xattr;
+};
+
+/* Followed by the target */
+struct squashfs_symlink_inode {
+	struct squashfs_base_inode base;
+	__le32 nlink;
+	__le32 symlink_size;
+};
+
+/* Followed by count + 1 entries for inodes in the same metadata block */
+struct squashfs_dir_header {
+	__le32 count;
+	__le32 start_block;
+	__le32 inode_number;
+};
+
+/* Followed by the name, of size + 1 characters */
+struct squashfs_dir_entry {
+	__le16 offset;
+	__le16 inode_number;	/* signed, relative to the header's */
+	__le16 type;
+	__le16 size;
+};
+
+struct squashfs_fragment_entry {
+	__le64 start_block;
+	__le32 size;
+	__le32 unused;
+};
+
+#endif
@@ -2342,6 +2342,11 @@ void yaffs_block_became_dirty(struct yaffs_dev *dev, int block_no)
 		dev->gc_pages_in_use = 0;
 	}
 
+	/* Leave the flash alone on a read-only mount. A read-write mount
+	 * finds the block dirty again and reclaims it. */
+	if (dev->read_only)
+		return;
+
 	if (!bi->needs_retiring) {
 		yaffs2_checkpt_invalidate(dev);
 		erased_ok = yaffs_erase_block(dev, block_no);
@@ -4898,7 +4903,8 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	yaffs_verify_blocks(dev);
 
 	/* Clean up any aborted checkpoint data */
-	if (!dev->is_checkpointed && dev->blocks_in_checkpt > 0)
+	if (!dev->read_only &&
+	    !dev->is_checkpointed && dev->blocks_in_checkpt > 0)
 		yaffs2_checkpt_invalidate(dev);
 
 	yaffs_trace(YAFFS_TRACE_TRACING,
@@ -262,10 +262,11 @@ void cmd_yaffs_dev_ls(void)
 		flash_dev =
 			((unsigned) dev->driver_context - (unsigned) nand_info)/
 				sizeof(nand_info[0]);
-		printf("%-10s %5d 0x%05x 0x%05x %s",
+		printf("%-10s %5d 0x%05x 0x%05x %s%s",
 			dev->param.name, flash_dev,
 			dev->param.start_block, dev->param.end_block,
-			dev->param.inband_tags ? "using inband tags, " : "");
+			dev->param.inband_tags ? "using inband tags, " : "",
+			dev->is_mounted && dev->read_only ? "read-only, " : "");
 
 		free_space = yaffs_freespace(dev->param.name);
 		if (free_space < 0)
@@ -330,12 +331,36 @@ void read_a_file(char *fn)
 	yaffs_close(h);
 }
 
-void cmd_yaffs_mount(char *mp)
+void cmd_yaffs_mount(char *mp, int read_only)
 {
-	int retval = yaffs_mount(mp);
-	if (retval < 0)
+	struct yaffs_dev *dev = yaffs_getdev(mp);
+	ulong start;
+	int retval;
+
+	if (dev) {
+		dev->tags_used = 0;
+		dev->summary_used = 0;
+	}
+
+	start = get_timer(0);
+	retval = yaffs_mount2(mp, read_only);
+	if (retval < 0) {
 		printf("Error mounting %s, return value: %d, %s\n", mp,
 			yaffsfs_GetError(), yaffs_error_str());
+		return;
+	}
+
+	/*
+	 * A checkpoint saved by the last read-write unmount avoids the scan,
+	 * otherwise block summaries save reading the tags of each chunk.
+	 */
+	if (dev->is_checkpointed)
+		printf("Restored from checkpoint");
+	else
+		printf("Scanned %u chunk tags from summaries, %u from chunks",
+			dev->summary_used, dev->tags_used);
+	printf(" in %lu ms%s\n", get_timer(start),
+		read_only ? ", read-only" : "");
 }
 
 
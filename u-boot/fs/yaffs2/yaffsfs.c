@@ -2619,7 +2619,9 @@ int yaffs_unmount2(const YCHAR *path, int force)
 		if (dev->is_mounted) {
 			int inUse;
 			yaffs_flush_whole_cache(dev);
-			yaffs_checkpoint_save(dev);
+			/* Saving erases the old checkpoint first */
+			if (!dev->read_only)
+				yaffs_checkpoint_save(dev);
 			inUse = yaffsfs_IsDevBusy(dev);
 			if (!inUse || force) {
 				if (inUse)
@@ -142,6 +142,31 @@ typedef struct dnode_end {
 	zfs_endian_t endian;
 } dnode_end_t;
 
+/*
+ * Verified, decompressed metadata blocks (indirect blocks, dnodes, ZAPs) are
+ * kept for the life of a mount, so walking from a dnode to each data block
+ * of a file reads and checksums its indirect blocks only once. At most this
+ * many blocks of up to SPA_MAXBLOCKSIZE are held.
+ */
+#ifndef CONFIG_ZFS_META_CACHE
+#define CONFIG_ZFS_META_CACHE	16
+#endif
+
+struct zfs_meta_block {
+	blkptr_t bp;		/* the block pointer it was read through */
+	void *buf;
+	size_t size;
+	unsigned long last_used;
+};
+
+/* Accounting for zfscache, kept across mounts until reset */
+static struct zfs_stats {
+	unsigned long meta_hits;
+	unsigned long meta_misses;
+	unsigned long blocks_read;	/* read and checksummed */
+	unsigned long long bytes_read;
+} zfs_stats;
+
 struct zfs_data {
 	/* cache for a file block of the currently zfs_open()-ed file */
 	char *file_buf;
@@ -174,6 +199,8 @@ struct zfs_data {
 	int (*userhook)(const char *, const struct zfs_dirhook_info *);
 	struct zfs_dirhook_info *dirinfo;
 
+	struct zfs_meta_block meta[CONFIG_ZFS_META_CACHE];
+	unsigned long meta_clock;
 };
 
 
@@ -345,7 +372,6 @@ vdev_uberblock_compare(uberblock_t *ub1, uberblock_t *ub2)
 static int
 uberblock_verify(uberblock_t *uber, int offset, struct zfs_data *data)
 {
-	int err;
 	zfs_endian_t endian = UNKNOWN_ENDIAN;
 	zio_cksum_t zc;
 
@@ -372,20 +398,31 @@ uberblock_verify(uberblock_t *uber, int offset, struct zfs_data *data)
 
 	memset(&zc, 0, sizeof(zc));
 	zc.zc_word[0] = cpu_to_zfs64(offset, endian);
-	err = zio_checksum_verify(zc, ZIO_CHECKSUM_LABEL, endian,
+	return zio_checksum_verify(zc, ZIO_CHECKSUM_LABEL, endian,
 							  (char *) uber, UBERBLOCK_SIZE(data->vdev_ashift));
+}
 
-	if (!err) {
-		/* Check that the data pointed by the rootbp is usable. */
-		void *osp = NULL;
-		size_t ospsize;
-		err = zio_read(&uber->ub_rootbp, endian, &osp, &ospsize, data);
-		free(osp);
+/*
+ * Check that the data pointed by the rootbp of a verified uberblock is
+ * usable. This reads a block, so it is only done for uberblocks which
+ * would replace the best one found so far.
+ */
+static int
+uberblock_check_rootbp(uberblock_t *uber, struct zfs_data *data)
+{
+	zfs_endian_t endian;
+	void *osp = NULL;
+	size_t ospsize;
+	int err;
 
-		if (!err && ospsize < OBJSET_PHYS_SIZE_V14) {
-			printf("uberblock rootbp points to invalid data\n");
-			return ZFS_ERR_BAD_FS;
-		}
+	endian = zfs_to_cpu64(uber->ub_magic, LITTLE_ENDIAN) == UBERBLOCK_MAGIC
+		? LITTLE_ENDIAN : BIG_ENDIAN;
+	err = zio_read(&uber->ub_rootbp, endian, &osp, &ospsize, data);
+	free(osp);
+
+	if (!err && ospsize < OBJSET_PHYS_SIZE_V14) {
+		printf("uberblock rootbp points to invalid data\n");
+		return ZFS_ERR_BAD_FS;
 	}
 
 	return err;
@@ -417,6 +454,8 @@ static uberblock_t *find_bestub(char *ub_array, struct zfs_data *data)
 			continue;
 
 		if (ubbest == NULL || vdev_uberblock_compare(ubnext, ubbest) > 0) {
+			if (uberblock_check_rootbp(ubnext, data))
+				continue;
 			ubbest = ubnext;
 			pickedub = i;
 		}
@@ -536,6 +575,8 @@ zio_read_data(blkptr_t *bp, zfs_endian_t endian, void *buf,
 			/*Check the underlying checksum before we rule this DVA as "good"*/
 			uint32_t checkalgo = (zfs_to_cpu64((bp)->blk_prop, endian) >> 40) & 0xff;
 
+			zfs_stats.blocks_read++;
+			zfs_stats.bytes_read += psize;
 			err = zio_checksum_verify(bp->blk_cksum, checkalgo, endian, buf, psize);
 			if (!err)
 				return ZFS_ERR_NONE;
@@ -620,10 +661,69 @@ zio_read(blkptr_t *bp, zfs_endian_t endian, void **buf,
 	return ZFS_ERR_NONE;
 }
 
+/*
+ * Read a metadata block through the mount's cache, reading and verifying it
+ * with zio_read() only if it is not there. The buffer returned belongs to
+ * the cache: it must not be freed, and is only valid until the next call.
+ */
+static int
+zio_read_meta(blkptr_t *bp, zfs_endian_t endian, void **buf,
+			  size_t *size, struct zfs_data *data)
+{
+	struct zfs_meta_block *mb, *victim = data->meta;
+	blkptr_t key = *bp;
+	size_t lsize;
+	int i, err;
+
+	for (i = 0, mb = data->meta; i < CONFIG_ZFS_META_CACHE; i++, mb++) {
+		if (mb->buf && !memcmp(&mb->bp, &key, sizeof(key))) {
+			mb->last_used = ++data->meta_clock;
+			zfs_stats.meta_hits++;
+			*buf = mb->buf;
+			if (size)
+				*size = mb->size;
+			return ZFS_ERR_NONE;
+		}
+		/* Replace an empty slot, or else the least recently used */
+		if (!victim->buf)
+			continue;
+		if (!mb->buf || mb->last_used < victim->last_used)
+			victim = mb;
+	}
+
+	zfs_stats.meta_misses++;
+	err = zio_read(&key, endian, buf, &lsize, data);
+	if (err)
+		return err;
+
+	free(victim->buf);
+	victim->bp = key;
+	victim->buf = *buf;
+	victim->size = lsize;
+	victim->last_used = ++data->meta_clock;
+	if (size)
+		*size = lsize;
+
+	return ZFS_ERR_NONE;
+}
+
+static void
+zio_meta_cache_free(struct zfs_data *data)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_ZFS_META_CACHE; i++) {
+		free(data->meta[i].buf);
+		data->meta[i].buf = NULL;
+	}
+}
+
 /*
  * Get the block from a block id.
  * push the block onto the stack.
  *
+ * The indirect blocks on the way, and the block itself unless it is file
+ * data, come through the metadata cache.
  */
 static int
 dmu_read(dnode_end_t *dn, uint64_t blkid, void **buf,
@@ -634,6 +734,7 @@ dmu_read(dnode_end_t *dn, uint64_t blkid, void **buf,
 	int epbs = dn->dn.dn_indblkshift - SPA_BLKPTRSHIFT;
 	blkptr_t *bp;
 	void *tmpbuf = 0;
+	size_t size;
 	zfs_endian_t endian;
 	int err = ZFS_ERR_NONE;
 
@@ -644,18 +745,14 @@ dmu_read(dnode_end_t *dn, uint64_t blkid, void **buf,
 	endian = dn->endian;
 	for (level = dn->dn.dn_nlevels - 1; level >= 0; level--) {
 		idx = (blkid >> (epbs * level)) & ((1 << epbs) - 1);
+		/* Copy it out, as the next read may evict bp_array */
 		*bp = bp_array[idx];
-		if (bp_array != dn->dn.dn_blkptr) {
-			free(bp_array);
-			bp_array = 0;
-		}
 
 		if (BP_IS_HOLE(bp)) {
-			size_t size = zfs_to_cpu16(dn->dn.dn_datablkszsec,
-											dn->endian)
-				<< SPA_MINBLOCKSHIFT;
+			size = zfs_to_cpu16(dn->dn.dn_datablkszsec,
+								dn->endian) << SPA_MINBLOCKSHIFT;
 			*buf = malloc(size);
-			if (*buf) {
+			if (!*buf) {
 				err = ZFS_ERR_OUT_OF_MEMORY;
 				break;
 			}
@@ -663,19 +760,27 @@ dmu_read(dnode_end_t *dn, uint64_t blkid, void **buf,
 			endian = (zfs_to_cpu64(bp->blk_prop, endian) >> 63) & 1;
 			break;
 		}
-		if (level == 0) {
+		if (level == 0 &&
+			dn->dn.dn_type == DMU_OT_PLAIN_FILE_CONTENTS) {
 			err = zio_read(bp, endian, buf, 0, data);
 			endian = (zfs_to_cpu64(bp->blk_prop, endian) >> 63) & 1;
 			break;
 		}
-		err = zio_read(bp, endian, &tmpbuf, 0, data);
+		err = zio_read_meta(bp, endian, &tmpbuf, &size, data);
 		endian = (zfs_to_cpu64(bp->blk_prop, endian) >> 63) & 1;
 		if (err)
 			break;
+		if (level == 0) {
+			/* The caller frees what it is given */
+			*buf = malloc(size);
+			if (!*buf)
+				err = ZFS_ERR_OUT_OF_MEMORY;
+			else
+				memcpy(*buf, tmpbuf, size);
+			break;
+		}
 		bp_array = tmpbuf;
 	}
-	if (bp_array != dn->dn.dn_blkptr)
-		free(bp_array);
 	if (endian_out)
 		*endian_out = endian;
 
@@ -1832,9 +1937,26 @@ zfs_unmount(struct zfs_data *data)
 	free(data->dnode_buf);
 	free(data->dnode_mdn);
 	free(data->file_buf);
+	zio_meta_cache_free(data);
 	free(data);
 }
 
+void
+zfs_show_stats(void)
+{
+	printf("Metadata cache: %lu hits, %lu misses (%d blocks)\n",
+		   zfs_stats.meta_hits, zfs_stats.meta_misses,
+		   CONFIG_ZFS_META_CACHE);
+	printf("%lu blocks, %llu bytes read and checksummed\n",
+		   zfs_stats.blocks_read, zfs_stats.bytes_read);
+}
+
+void
+zfs_reset_stats(void)
+{
+	memset(&zfs_stats, 0, sizeof(zfs_stats));
+}
+
 /*
  * zfs_mount() locates a valid uberblock of the root pool and read in its MOS
  * to the memory address MOS.
@@ -2105,7 +2227,7 @@ zfs_read(zfs_file_t file, char *buf, uint64_t len)
 		 * Find requested blkid and the offset within that block.
 		 */
 		uint64_t blkid = file->offset + red;
-		blkid = do_div(blkid, blksz);
+		do_div(blkid, blksz);
 		free(data->file_buf);
 		data->file_buf = 0;
 
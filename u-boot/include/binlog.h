@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __BINLOG_H
+#define __BINLOG_H
+
+#include <stdarg.h>
+
+/*
+ * Binary log buffer
+ *
+ * Messages are recorded as a pointer to their format string plus the raw
+ * argument values, and are only formatted when somebody looks at them
+ * (the 'binlog' command, the console once it is up, or the FDT passed to
+ * Linux). See doc/README.binlog for details.
+ */
+
+/* Log levels, with the same meaning as in Linux */
+enum binlog_level {
+	BINLOG_EMERG	= 0,
+	BINLOG_ALERT,
+	BINLOG_CRIT,
+	BINLOG_ERR,
+	BINLOG_WARNING,
+	BINLOG_NOTICE,
+	BINLOG_INFO,
+	BINLOG_DEBUG,
+
+	BINLOG_LEVEL_COUNT,
+};
+
+/* Subsystems, each of which can be filtered separately */
+enum binlog_subsys {
+	BINLOG_SUBSYS_CONSOLE	= 0,	/* printf() while console is silent */
+	BINLOG_SUBSYS_BOARD,
+	BINLOG_SUBSYS_BOOT,
+	BINLOG_SUBSYS_NET,
+	BINLOG_SUBSYS_FS,
+	BINLOG_SUBSYS_BLK,
+	BINLOG_SUBSYS_USB,
+	BINLOG_SUBSYS_ENV,
+
+	BINLOG_SUBSYS_COUNT,
+};
+
+#define BINLOG_SUBSYS_ALL	((1U << BINLOG_SUBSYS_COUNT) - 1)
+
+#ifndef CONFIG_BINLOG_LEVEL
+#define CONFIG_BINLOG_LEVEL		BINLOG_DEBUG
+#endif
+
+#ifndef CONFIG_BINLOG_CONSOLE_LEVEL
+#define CONFIG_BINLOG_CONSOLE_LEVEL	BINLOG_NOTICE
+#endif
+
+#if defined(CONFIG_BINLOG) && !defined(CONFIG_SPL_BUILD)
+
+/**
+ * binlog_vrecord() - Record a message in the binary log
+ *
+ * Only the format string pointer and the argument values are stored; %s
+ * arguments are copied (up to a limit) since they are often on the stack.
+ * The format string itself must stay valid, i.e. be a string literal.
+ *
+ * If the console is active and @level is below the console log level, the
+ * message is printed immediately as well.
+ *
+ * @subsys:	Subsystem the message belongs to (enum binlog_subsys)
+ * @level:	Message level (enum binlog_level)
+ * @fmt:	printf()-style format string
+ * @args:	Arguments for the format string
+ * @return 0 if recorded, -1 if filtered out or the log is disabled
+ */
+int binlog_vrecord(int subsys, int level, const char *fmt, va_list args);
+
+int binlog_record(int subsys, int level, const char *fmt, ...)
+		__attribute__ ((format (__printf__, 3, 4)));
+
+/**
+ * binlog_console() - Record a printf() that is not going to be displayed
+ *
+ * This is called by printf() when the console is silent or not yet
+ * available, so that the message costs a few stores instead of a full
+ * vsprintf(). Messages recorded before the console is up are only kept in
+ * the log; they are not printed once the console is ready. printf() returns
+ * 0 for a recorded message, so callers must not use its return value as
+ * the length of what was printed.
+ *
+ * @fmt:	printf()-style format string
+ * @args:	Arguments for the format string
+ * @return 0 if recorded, -1 if the log is disabled
+ */
+int binlog_console(const char *fmt, va_list args);
+
+/**
+ * binlog_relocate() - Adjust format pointers recorded before relocation
+ *
+ * @return 0 (always succeeds)
+ */
+int binlog_relocate(void);
+
+/**
+ * binlog_show() - Format and print the log contents
+ *
+ * @max_level:	Only show messages at this level or below
+ * @subsys_mask: Only show messages from these subsystems
+ */
+void binlog_show(int max_level, unsigned subsys_mask);
+
+/** binlog_clear() - Discard all recorded messages */
+void binlog_clear(void);
+
+/** binlog_info() - Print buffer usage and filter settings */
+void binlog_info(void);
+
+/**
+ * binlog_set_filter() - Set which messages are recorded
+ *
+ * @level:	Record messages at this level or below, -1 to leave unchanged
+ * @subsys_mask: Record messages from these subsystems, 0 to leave unchanged
+ */
+void binlog_set_filter(int level, unsigned subsys_mask);
+
+/**
+ * binlog_set_console_level() - Set the level for immediate console output
+ *
+ * @level:	Messages below this level are also printed when recorded
+ */
+void binlog_set_console_level(int level);
+
+/**
+ * binlog_fdt_add_report() - Add the formatted log to a device tree
+ *
+ * A root 'binlog' node is created with a 'text' property holding the most
+ * recent messages, formatted, up to CONFIG_BINLOG_FDT_SIZE bytes.
+ *
+ * @blob:	Device tree to update
+ * @return 0 if ok, -1 on error
+ */
+int binlog_fdt_add_report(void *blob);
+
+#define binlog(subsys, level, fmt, args...) \
+	binlog_record(subsys, level, fmt, ##args)
+
+#else
+
+static inline int binlog_console(const char *fmt, va_list args)
+{
+	return -1;
+}
+
+static inline int binlog_relocate(void)
+{
+	return 0;
+}
+
+static inline int binlog_fdt_add_report(void *blob)
+{
+	return 0;
+}
+
+#define binlog(subsys, level, fmt, args...) \
+	do { if ((level) < CONFIG_BINLOG_CONSOLE_LEVEL) \
+		printf(fmt, ##args); } while (0)
+
+#endif /* CONFIG_BINLOG && !CONFIG_SPL_BUILD */
+
+#endif /* __BINLOG_H */
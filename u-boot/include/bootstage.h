@@ -192,6 +192,16 @@ enum bootstage_id {
 
 	BOOTSTAGE_ID_ACCUM_LCD,
 
+	/* Handoff from 'bootm go' to the kernel */
+	BOOTSTAGE_ID_ACCUM_LOAD_OS,
+	BOOTSTAGE_ID_ACCUM_ETH_HALT,
+	BOOTSTAGE_ID_ACCUM_USB_STOP,
+	BOOTSTAGE_ID_ACCUM_FDT_RELOC,
+	BOOTSTAGE_ID_ACCUM_FDT_FIXUP,
+	BOOTSTAGE_ID_ACCUM_OS_PREP,
+	BOOTSTAGE_ID_ACCUM_PREBOOT_OS,
+	BOOTSTAGE_ID_ACCUM_CLEANUP,
+
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
 	BOOTSTAGE_ID_COUNT = BOOTSTAGE_ID_USER + CONFIG_BOOTSTAGE_USER_COUNT,
@@ -301,6 +311,20 @@ void bootstage_report(void);
  */
 int bootstage_fdt_add_report(void);
 
+/**
+ * Update a record already added to the device tree
+ *
+ * This allows activities after bootstage_fdt_add_report() to be timed,
+ * such as the final cache flush before starting the kernel. The device
+ * tree is changed in place, so this is safe with caches disabled. Only
+ * records which existed when the report was added can be updated: start
+ * an activity with bootstage_start() before adding the report.
+ *
+ * @param id	Bootstage ID to update
+ * @return 0 if ok, -ve on error
+ */
+int bootstage_fdt_update(enum bootstage_id id);
+
 /*
  * Stash bootstage data into memory
  *
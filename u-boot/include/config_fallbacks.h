@@ -42,6 +42,23 @@
 #define CONFIG_EXT4_WRITE
 #endif
 
+#if defined(CONFIG_CMD_SQUASHFS) && !defined(CONFIG_FS_SQUASHFS)
+#define CONFIG_FS_SQUASHFS
+#endif
+
+#if (defined(CONFIG_NET_KEEP_LINK) || defined(CONFIG_CMD_ARP)) && \
+						!defined(CONFIG_ARP_CACHE)
+#define CONFIG_ARP_CACHE
+#endif
+
+#if defined(CONFIG_CMD_WGET) && !defined(CONFIG_PROT_TCP)
+#define CONFIG_PROT_TCP
+#endif
+
+#if defined(CONFIG_CMD_UDP_FLASH) && !defined(CONFIG_UDP_FLASH)
+#define CONFIG_UDP_FLASH
+#endif
+
 /* Rather than repeat this expression each time, add a define for it */
 #if defined(CONFIG_CMD_IDE) || \
 	defined(CONFIG_CMD_SATA) || \
@@ -49,7 +66,8 @@
 	defined(CONFIG_CMD_USB) || \
 	defined(CONFIG_CMD_PART) || \
 	defined(CONFIG_MMC) || \
-	defined(CONFIG_SYSTEMACE)
+	defined(CONFIG_SYSTEMACE) || \
+	defined(CONFIG_SANDBOX_BLOCK)
 #define HAVE_BLOCK_DEVICE
 #endif
 
@@ -41,6 +41,7 @@
 #define CONFIG_INITRD_TAG
 
 #define CONFIG_SYS_CACHELINE_SIZE       64
+#define CONFIG_BOOTM_FLUSH_RANGES
 
 /* commands to include */
 #include <config_cmd_default.h>
@@ -475,6 +476,14 @@
 #define CONFIG_CMD_NET
 #define CONFIG_CMD_DHCP
 #define CONFIG_CMD_PING
+#define CONFIG_CMD_ARP
+#define CONFIG_CMD_WGET
+#define CONFIG_TFTP_MULTI
+#define CONFIG_TFTP_PROBE
+#define CONFIG_CMD_PXE
+#define CONFIG_MENU
+#define CONFIG_NET_STATS
+#define CONFIG_CMD_UDP_FLASH
 #define CONFIG_DRIVER_TI_CPSW
 #define CONFIG_MII
 #define CONFIG_BOOTP_DEFAULT
@@ -483,7 +492,11 @@
 #define CONFIG_BOOTP_SEND_HOSTNAME
 #define CONFIG_BOOTP_GATEWAY
 #define CONFIG_BOOTP_SUBNETMASK
+#define CONFIG_BOOTP_TIMEOUT		500
+#define CONFIG_DHCP_INIT_REBOOT
 #define CONFIG_NET_RETRY_COUNT         10
+#define CONFIG_NET_KEEP_LINK
+#define CONFIG_UDP_CHECKSUM
 #define CONFIG_NET_MULTI
 #define CONFIG_PHY_GIGE
 #define CONFIG_PHYLIB
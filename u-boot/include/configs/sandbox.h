@@ -31,12 +31,29 @@
 #define CONFIG_RSA
 #define CONFIG_CMD_FDT
 
+#define CONFIG_MEM_ATTR
+#define CONFIG_CMD_MEMATTR
+
+#define CONFIG_UDP_FLASH
+
 #define CONFIG_FS_FAT
 #define CONFIG_FS_EXT4
 #define CONFIG_EXT4_WRITE
+#define CONFIG_FAT_WRITE
 #define CONFIG_CMD_FAT
 #define CONFIG_CMD_EXT4
 #define CONFIG_CMD_EXT4_WRITE
+#define CONFIG_CMD_SQUASHFS
+#define CONFIG_LZMA
+#define CONFIG_LZO
+#define CONFIG_CMD_FS_GENERIC
+#define CONFIG_FS_DENTRY_CACHE
+#define CONFIG_SANDBOX_BLOCK
+#define CONFIG_DOS_PARTITION
+#define CONFIG_EFI_PARTITION
+#define CONFIG_PARTITION_UUIDS
+#define CONFIG_CMD_PART
+#define CONFIG_CMD_TIME
 
 #define CONFIG_SYS_VSNPRINTF
 
@@ -92,12 +109,16 @@
 /* include default commands */
 #include <config_cmd_default.h>
 
-/* We don't have networking support yet */
-#undef CONFIG_CMD_NET
+/*
+ * There is no network device yet, but the protocols build and the
+ * 'ut_wget' command tests HTTP over a fake one
+ */
 #undef CONFIG_CMD_NFS
+#define CONFIG_CMD_WGET
 
 #define CONFIG_CMD_HASH
 #define CONFIG_HASH_VERIFY
+#define CONFIG_HASH_STREAM
 #define CONFIG_SHA1
 #define CONFIG_SHA256
 
@@ -30,6 +30,8 @@
 
 #define EXT4_EXTENTS_FL		0x00080000 /* Inode uses extents */
 #define EXT4_EXT_MAGIC			0xf30a
+#define EXT4_EXT_ROOT_ENTRIES		4	/* extents in the inode */
+#define EXT4_EXT_MAX_LEN		32768	/* blocks in an extent */
 #define EXT4_FEATURE_RO_COMPAT_GDT_CSUM	0x0010
 #define EXT4_FEATURE_INCOMPAT_EXTENTS	0x0040
 #define EXT4_INDIRECT_BLOCKS		12
@@ -97,16 +99,19 @@ struct ext_filesystem {
 	struct ext2_block_group *bgd;
 	char *gdtable;
 
-	/* Block Bitmap Related */
+	/* Block Bitmap Related (NULL until the group is first touched) */
 	unsigned char **blk_bmaps;
 	long int curr_blkno;
 	uint16_t first_pass_bbmap;
 
-	/* Inode Bitmap Related */
+	/* Inode Bitmap Related (NULL until the group is first touched) */
 	unsigned char **inode_bmaps;
 	int curr_inode_no;
 	uint16_t first_pass_ibmap;
 
+	/* EXT4_BMAP_xxx_DIRTY flags of each group */
+	unsigned char *bmap_flags;
+
 	/* Journal Related */
 
 	/* Block Device Descriptor */
@@ -141,5 +146,9 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock);
 int ext4fs_probe(block_dev_desc_t *fs_dev_desc,
 		 disk_partition_t *fs_partition);
 int ext4_read_file(const char *filename, void *buf, int offset, int len);
+int ext4_open_file(const char *filename, void **filep, loff_t *sizep);
+int ext4_read_file_at(void *filep, loff_t pos, void *buf, int len);
+void ext4_close_file(void *filep);
+int ext4fs_mounted(block_dev_desc_t *rbdd, disk_partition_t *info);
 int ext4_read_superblock(char *buffer);
 #endif
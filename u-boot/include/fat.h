@@ -113,6 +113,22 @@ typedef struct boot_sector {
 	__u16	reserved2[6];	/* Unused */
 } boot_sector;
 
+/* FAT32 FSInfo sector, at sector 'info_sector' of the boot sector */
+#define FSINFO_LEAD_SIG		0x41615252
+#define FSINFO_STRUC_SIG	0x61417272
+#define FSINFO_TRAIL_SIG	0xaa550000
+#define FSINFO_UNKNOWN		0xffffffff
+
+typedef struct fsinfo_sector {
+	__u32	lead_sig;	/* FSINFO_LEAD_SIG */
+	__u8	reserved1[480];
+	__u32	struc_sig;	/* FSINFO_STRUC_SIG */
+	__u32	free_count;	/* Free clusters, or FSINFO_UNKNOWN */
+	__u32	next_free;	/* Where to look for free clusters */
+	__u8	reserved2[12];
+	__u32	trail_sig;	/* FSINFO_TRAIL_SIG */
+} fsinfo_sector;
+
 typedef struct volume_info
 {
 	__u8 drive_number;	/* BIOS drive number */
@@ -165,6 +181,7 @@ typedef struct {
 	__u16	clust_size;	/* Size of clusters in sectors */
 	int	data_begin;	/* The sector of the first cluster, can be negative */
 	int	fatbufnum;	/* Used by get_fatent, init to -1 */
+	int	fatbuf_dirty;	/* fatbuf changed since it was read */
 } fsdata;
 
 typedef int	(file_detectfs_func)(void);
@@ -197,5 +214,9 @@ int fat_register_device(block_dev_desc_t *dev_desc, int part_no);
 
 int file_fat_write(const char *filename, void *buffer, unsigned long maxsize);
 int fat_read_file(const char *filename, void *buf, int offset, int len);
+int fat_open_file(const char *filename, void **filep, loff_t *sizep);
+int fat_read_file_at(void *filep, loff_t pos, void *buf, int len);
+void fat_close_file(void *filep);
+int fat_mounted(block_dev_desc_t *dev_desc, disk_partition_t *info);
 void fat_close(void);
 #endif /* _FAT_H_ */
@@ -22,6 +22,14 @@
 #define FS_TYPE_FAT	1
 #define FS_TYPE_EXT	2
 #define FS_TYPE_SANDBOX	3
+#define FS_TYPE_SQUASHFS	4
+
+/* Values for "whence" in fs_lseek() */
+#define FS_SEEK_SET	0
+#define FS_SEEK_CUR	1
+#define FS_SEEK_END	2
+
+struct fs_file;
 
 /*
  * Tell the fs layer which block device an partition to use for future
@@ -35,6 +43,20 @@
  */
 int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype);
 
+/*
+ * The filesystems found by fs_set_blk_dev() stay mounted, and are found
+ * again by the same ifname and dev_part_str without probing. Forget those
+ * on "dev_desc", and what is cached about them, when its media, partition
+ * table or blocks may have been changed behind the filesystem drivers.
+ */
+#ifdef CONFIG_SPL_BUILD
+static inline void fs_invalidate_dev(block_dev_desc_t *dev_desc)
+{
+}
+#else
+void fs_invalidate_dev(block_dev_desc_t *dev_desc);
+#endif
+
 /*
  * Print the list of files on the partition previously set by fs_set_blk_dev(),
  * in directory "dirname".
@@ -54,6 +76,82 @@ int fs_ls(const char *dirname);
  */
 int fs_read(const char *filename, ulong addr, int offset, int len);
 
+/*
+ * Open file "filename" on the partition previously set by fs_set_blk_dev(),
+ * so that it can be read in pieces without looking it up again. The file
+ * stays usable after other partitions are selected.
+ *
+ * Returns the open file, or NULL if it cannot be found.
+ */
+struct fs_file *fs_open(const char *filename);
+
+/*
+ * Read up to "len" bytes from the current position of "file" into "buf",
+ * and move the position on by the number read.
+ *
+ * Returns the number of bytes read, 0 at the end of the file, or < 0 on
+ * error.
+ */
+int fs_read_handle(struct fs_file *file, void *buf, int len);
+
+/*
+ * Set the position of "file" to "offset" bytes from the start, the current
+ * position or the end, for "whence" FS_SEEK_SET, FS_SEEK_CUR or FS_SEEK_END.
+ *
+ * Returns the new position, or -1 on error.
+ */
+loff_t fs_lseek(struct fs_file *file, loff_t offset, int whence);
+
+/* Returns the size of "file" in bytes */
+loff_t fs_size(struct fs_file *file);
+
+/* Close "file", which must not be used afterwards */
+void fs_close(struct fs_file *file);
+
+/*
+ * Directory lookup cache for the filesystem drivers. Entries are keyed by
+ * the partition, the directory ("dir" is the driver's inode number or
+ * cluster for it) and the name looked up in it, and hold up to
+ * DENTRY_DATA_LEN bytes of the driver's own record for what was found.
+ *
+ * dentry_cache_lookup() returns 1 and copies the record to "data" if it
+ * is cached, 0 if the name is cached as absent, or -1 if it is not cached.
+ * dentry_cache_add() caches a record, or the name as absent if "data" is
+ * NULL; names of DENTRY_NAME_LEN or more are not cached.
+ * dentry_cache_invalidate() drops the entries for "dev_desc", or all of
+ * them if it is NULL; drivers call it before writing to a filesystem.
+ */
+#define DENTRY_NAME_LEN		32
+#define DENTRY_DATA_LEN		32
+
+#if defined(CONFIG_FS_DENTRY_CACHE) && !defined(CONFIG_SPL_BUILD)
+int dentry_cache_lookup(block_dev_desc_t *dev_desc, lbaint_t part_start,
+			ulong dir, const char *name, void *data, int len);
+void dentry_cache_add(block_dev_desc_t *dev_desc, lbaint_t part_start,
+		      ulong dir, const char *name, const void *data, int len);
+void dentry_cache_invalidate(block_dev_desc_t *dev_desc);
+void dentry_cache_show(void);
+void dentry_cache_reset_stats(void);
+#else
+static inline int dentry_cache_lookup(block_dev_desc_t *dev_desc,
+				      lbaint_t part_start, ulong dir,
+				      const char *name, void *data, int len)
+{
+	return -1;
+}
+
+static inline void dentry_cache_add(block_dev_desc_t *dev_desc,
+				    lbaint_t part_start, ulong dir,
+				    const char *name, const void *data,
+				    int len)
+{
+}
+
+static inline void dentry_cache_invalidate(block_dev_desc_t *dev_desc)
+{
+}
+#endif
+
 /*
  * Common implementation for various filesystem commands, optionally limited
  * to a specific filesystem type via the fstype parameter.
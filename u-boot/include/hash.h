@@ -27,6 +27,40 @@ struct hash_algo {
 	void (*hash_func_ws)(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 	int chunk_size;				/* Watchdog chunk size */
+	/**
+	 * hash_init: Create the context for hashing a stream of data
+	 *
+	 * These are NULL for algorithms which can only hash a buffer held
+	 * in memory as a whole, such as most hardware accelerators.
+	 *
+	 * @algo:	Hash algorithm
+	 * @ctxp:	Returns the context, which hash_finish() frees
+	 * @return 0 if ok, -ve on error
+	 */
+	int (*hash_init)(struct hash_algo *algo, void **ctxp);
+	/**
+	 * hash_update: Add data to a stream being hashed
+	 *
+	 * @algo:	Hash algorithm
+	 * @ctx:	Context from hash_init()
+	 * @buf:	Data to add
+	 * @size:	Length of data in bytes
+	 * @is_last:	Non-zero if this is the last data of the stream
+	 * @return 0 if ok, -ve on error
+	 */
+	int (*hash_update)(struct hash_algo *algo, void *ctx, const void *buf,
+			   unsigned int size, int is_last);
+	/**
+	 * hash_finish: Write out the digest of a stream and free the context
+	 *
+	 * @algo:	Hash algorithm
+	 * @ctx:	Context from hash_init()
+	 * @dest_buf:	Place to put the digest
+	 * @size:	Space at dest_buf, at least algo->digest_size bytes
+	 * @return 0 if ok, -ve on error
+	 */
+	int (*hash_finish)(struct hash_algo *algo, void *ctx, void *dest_buf,
+			   int size);
 };
 
 /*
@@ -35,6 +69,22 @@ struct hash_algo {
  */
 #define HASH_MAX_DIGEST_SIZE	32
 
+/*
+ * Extra arguments and help text for commands using hash_command(), for
+ * the sources CONFIG_HASH_STREAM allows in place of "address count".
+ */
+#ifdef CONFIG_HASH_STREAM
+#define HASH_STREAM_MAXARGS	3
+#define HASH_STREAM_HELP \
+	"\n    address count may be replaced by one of:\n" \
+	"    -b <interface> <dev> <start block> <block count>\n" \
+	"    -p <interface> <dev> <partition name or number>\n" \
+	"    -f <interface> <dev[:part]> <filename>"
+#else
+#define HASH_STREAM_MAXARGS	0
+#define HASH_STREAM_HELP	""
+#endif
+
 enum {
 	HASH_FLAG_VERIFY	= 1 << 0,	/* Enable verify mode */
 	HASH_FLAG_ENV		= 1 << 1,	/* Allow env vars */
@@ -45,6 +95,13 @@ enum {
  *
  * This common function is used to implement specific hash commands.
  *
+ * The data hashed is given by "address count", or with CONFIG_HASH_STREAM
+ * by one of these, which are read in pieces rather than loaded into memory:
+ *
+ *	-b <interface> <dev> <start block> <block count>
+ *	-p <interface> <dev> <partition name or number>
+ *	-f <interface> <dev[:part]> <filename>
+ *
  * @algo_name:		Hash algorithm being used (lower case!)
  * @flags:		Flags value (HASH_FLAG_...)
  * @cmdtp:		Pointer to command table entry
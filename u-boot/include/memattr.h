@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __MEMATTR_H
+#define __MEMATTR_H
+
+/*
+ * Memory attribute map
+ *
+ * A list of address ranges with the caching attribute each should be
+ * mapped with. The architecture applies the map to DRAM when it sets up
+ * the MMU and again whenever the map changes. Regions come from the
+ * 'memattr' environment variable and from code (e.g. the LCD framebuffer).
+ * See doc/README.memattr for details.
+ */
+
+enum mem_attr {
+	MEM_ATTR_OFF,			/* Uncached, strongly ordered */
+	MEM_ATTR_WRITETHROUGH,
+	MEM_ATTR_WRITEBACK,
+	MEM_ATTR_WRITECOMBINE,		/* Uncached, writes buffered */
+
+	MEM_ATTR_COUNT,
+};
+
+#ifndef CONFIG_MEM_ATTR_MAX_REGIONS
+#define CONFIG_MEM_ATTR_MAX_REGIONS	8
+#endif
+
+/* Flags for struct mem_attr_region */
+enum {
+	MEM_ATTR_FROM_ENV	= 1 << 0,	/* Replaced when 'memattr' changes */
+};
+
+struct mem_attr_region {
+	ulong start;
+	ulong size;
+	u8 attr;			/* enum mem_attr */
+	u8 flags;
+};
+
+/*
+ * Later regions take precedence over earlier ones. Memory not covered by
+ * any region is mapped with def_attr.
+ */
+struct mem_attr_map {
+	enum mem_attr def_attr;
+	int count;
+	struct mem_attr_region region[CONFIG_MEM_ATTR_MAX_REGIONS];
+};
+
+/**
+ * mem_attr_name() - Get the short name of an attribute
+ *
+ * @attr:	Attribute (enum mem_attr)
+ * @return name ("off", "wt", "wb" or "wc"), or "?" if invalid
+ */
+const char *mem_attr_name(int attr);
+
+/**
+ * mem_attr_lookup() - Find an attribute by name
+ *
+ * @name:	Name to look up, terminated by NUL, ',' or whitespace
+ * @return attribute (enum mem_attr), or -1 if not found
+ */
+int mem_attr_lookup(const char *name);
+
+/**
+ * mem_attr_parse() - Add the regions in a string to a map
+ *
+ * The string is a list of <start>:<size>:<attr> separated by commas or
+ * spaces. The start is hex; the size is decimal unless it starts with 0x.
+ * Both may have a K, M or G suffix.
+ *
+ * @str:	String to parse
+ * @map:	Map to append regions to
+ * @flags:	Flags for the new regions
+ * @return 0 if ok, -1 on a syntax error or if the map is full
+ */
+int mem_attr_parse(const char *str, struct mem_attr_map *map, int flags);
+
+/**
+ * mem_attr_build_table() - Work out the attribute of each block of memory
+ *
+ * Fills in one entry per (1 << @shift)-byte block, starting with the block
+ * containing @base. Only blocks wholly covered by a region take that
+ * region's attribute, i.e. regions are rounded inwards to whole blocks.
+ *
+ * @map:	Map to use
+ * @base:	Address of the first block
+ * @shift:	log2 of the block size
+ * @count:	Number of blocks
+ * @table:	Returns the attribute of each block (enum mem_attr)
+ */
+void mem_attr_build_table(const struct mem_attr_map *map, ulong base,
+			  uint shift, uint count, u8 *table);
+
+/**
+ * mem_attr_get_map() - Get the current memory attribute map
+ *
+ * @return pointer to the map
+ */
+struct mem_attr_map *mem_attr_get_map(void);
+
+/**
+ * mem_attr_set_region() - Map a region with a given attribute
+ *
+ * The region is added to the map (replacing an earlier one with the same
+ * start and size) and applied at once.
+ *
+ * @start:	Start address
+ * @size:	Size in bytes
+ * @attr:	Attribute to use (enum mem_attr)
+ * @return 0 if ok, -1 if the map is full
+ */
+int mem_attr_set_region(ulong start, ulong size, enum mem_attr attr);
+
+/**
+ * mem_attr_apply() - Update the MMU for part of the map (architecture hook)
+ *
+ * Called whenever the map changes. Nothing needs to be done if the MMU is
+ * not yet enabled, since the map is applied when it is set up.
+ *
+ * @start:	Start of changed area
+ * @size:	Size of changed area, ~0UL for everything
+ */
+void mem_attr_apply(ulong start, ulong size);
+
+#endif /* __MEMATTR_H */
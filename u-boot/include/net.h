@@ -78,6 +78,30 @@ enum eth_state_t {
 	ETH_STATE_ACTIVE
 };
 
+#ifdef CONFIG_NET_STATS
+/* Packet counters kept for each device, see 'net stats' */
+struct eth_stats {
+	ulong rx_packets;
+	ulong rx_bytes;
+	ulong rx_dropped;	/* not for us, or nothing to take it */
+	ulong rx_errors;	/* truncated or bad header */
+	ulong rx_csum;		/* bad IP or UDP checksum */
+	ulong rx_frags;		/* fragments dropped */
+	ulong tx_packets;
+	ulong tx_bytes;
+	ulong tx_errors;
+};
+
+/* Add to a counter of a device, which drivers can do too */
+#define eth_stat_add(dev, field, n)			\
+	do {						\
+		if (dev)				\
+			(dev)->stats.field += (n);	\
+	} while (0)
+#else
+#define eth_stat_add(dev, field, n)	do { } while (0)
+#endif
+
 struct eth_device {
 	char name[16];
 	unsigned char enetaddr[6];
@@ -89,12 +113,15 @@ struct eth_device {
 	int  (*recv) (struct eth_device *);
 	void (*halt) (struct eth_device *);
 #ifdef CONFIG_MCAST_TFTP
-	int (*mcast) (struct eth_device *, u32 ip, u8 set);
+	int (*mcast) (struct eth_device *, const u8 *enetaddr, u8 set);
 #endif
 	int  (*write_hwaddr) (struct eth_device *);
 	struct eth_device *next;
 	int index;
 	void *priv;
+#ifdef CONFIG_NET_STATS
+	struct eth_stats stats;
+#endif
 };
 
 extern int eth_initialize(bd_t *bis);	/* Initialize network subsystem */
@@ -437,7 +464,8 @@ extern int		NetRestartWrap;		/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL
+	TFTPSRV, TFTPPUT, LINKLOCAL, TFTPPROBE, WGET,
+	TFTPMULTI, UDPFLASH
 };
 
 /* from net/net.c */
@@ -503,6 +531,33 @@ extern void net_set_udp_header(uchar *pkt, IPaddr_t dest, int dport,
 extern int	NetCksumOk(uchar *, int);	/* Return true if cksum OK */
 extern uint	NetCksum(uchar *, int);		/* Calculate the checksum */
 
+/**
+ * net_csum_partial() - Add data to a one's complement checksum
+ *
+ * Sums 32 bits at a time, so it is much faster than adding up 16-bit
+ * words. The data may start on any address.
+ *
+ * @buf:	Data to add
+ * @len:	Length in bytes
+ * @sum:	Partial sum so far (0 to start)
+ * @return new partial sum; finish with net_csum_fold()
+ */
+uint net_csum_partial(const void *buf, int len, uint sum);
+
+/**
+ * net_csum_fold() - Fold a partial sum from net_csum_partial() to 16 bits
+ *
+ * The result is in the byte order of the data, like NetCksum(). A packet
+ * whose checksum field is included in the sum is valid if it is 0xffff.
+ */
+static inline ushort net_csum_fold(uint sum)
+{
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
 /* Callbacks */
 extern rxhand_f *net_get_udp_handler(void);	/* Get UDP RX packet handler */
 extern void net_set_udp_handler(rxhand_f *);	/* Set UDP RX packet handler */
@@ -545,6 +600,17 @@ static inline void NetSendPacket(uchar *pkt, int len)
 extern int NetSendUDPPacket(uchar *ether, IPaddr_t dest, int dport,
 			int sport, int payload_len);
 
+/*
+ * Send the IP packet built in NetTxPacket, doing ARP first if the
+ * destination MAC address is not known yet
+ *
+ * @param ether Destination MAC address, filled in by ARP if all zero
+ * @param dest IP address the packet is for
+ * @param len Length of the packet including the ethernet header
+ * @return 0 if sent, 1 if waiting for ARP
+ */
+int net_send_ip_packet(uchar *ether, IPaddr_t dest, int len);
+
 /* Processes a received packet */
 extern void NetReceive(uchar *, int);
 
@@ -565,6 +631,118 @@ static inline __attribute__((always_inline)) int eth_is_on_demand_init(void)
 #endif
 }
 
+#ifdef CONFIG_NET_KEEP_LINK
+/* Check whether the device should be left running between commands */
+int net_keep_link(void);
+#else
+static inline int net_keep_link(void)
+{
+	return 0;
+}
+#endif
+
+/* Halt the network device and forget resolved addresses */
+void net_down(void);
+
+/*
+ * Stop a device which netconsole or CONFIG_NET_KEEP_LINK left running, so
+ * that it cannot DMA into memory owned by the program about to be started.
+ * Called before handing over to an OS or application.
+ */
+static inline void net_quiesce(void)
+{
+#if defined(CONFIG_NETCONSOLE) || defined(CONFIG_NET_KEEP_LINK)
+	eth_halt();
+#endif
+}
+
+/* Protocol events counted for 'net stats' */
+enum net_stat {
+	NET_STAT_ARP_REQUESTS,		/* ARP requests sent */
+	NET_STAT_ARP_TIMEOUTS,		/* ARP requests not answered */
+	NET_STAT_BOOTP_TIMEOUTS,	/* BOOTP/DHCP requests sent again */
+	NET_STAT_TFTP_TIMEOUTS,		/* TFTP packets sent again */
+	NET_STAT_TFTP_DUPS,		/* TFTP blocks received twice */
+	NET_STAT_NFS_TIMEOUTS,		/* NFS requests sent again */
+	NET_STAT_TCP_RETRANS,		/* TCP segments sent again */
+	NET_STAT_RESTARTS,		/* transfers started again */
+
+	NET_STAT_COUNT
+};
+
+#ifdef CONFIG_NET_STATS
+extern ulong net_stats[NET_STAT_COUNT];
+
+#define net_stat_inc(stat)	(net_stats[stat]++)
+
+/* Print the counters of all devices and protocols */
+void net_stats_print(void);
+
+/* Clear all counters */
+void net_stats_reset(void);
+#else
+#define net_stat_inc(stat)	do { } while (0)
+#endif
+
+#ifdef CONFIG_TFTP_PROBE
+/* Most files tftp_probe() can look for at once */
+#define TFTP_PROBE_MAX		16
+
+enum tftp_probe_result {
+	TFTP_PROBE_UNKNOWN,		/* No answer */
+	TFTP_PROBE_FOUND,
+	TFTP_PROBE_MISSING,		/* File not found or access denied */
+};
+
+/**
+ * tftp_probe() - Find the first of several files on the TFTP server
+ *
+ * Requests all the files from 'serverip' at once and stops as soon as
+ * the first file which exists is known. Nothing is loaded.
+ *
+ * @names:	File names, most wanted first
+ * @count:	Number of names, at most TFTP_PROBE_MAX
+ * @result:	Returns enum tftp_probe_result for each name
+ * @return index of the first name found, -ENOENT if none exists,
+ *	-ETIMEDOUT if the server did not answer for some, or -EIO/-EINVAL
+ */
+int tftp_probe(const char * const names[], int count, u8 *result);
+#endif
+
+#ifdef CONFIG_TFTP_MULTI
+/* Most files tftp_multi() can fetch at once */
+#define TFTP_MULTI_MAX		8
+
+struct tftp_multi_file {
+	const char *name;		/* File name on the server */
+	ulong addr;			/* Where to load it */
+	ulong size;			/* Returns the size loaded */
+};
+
+/**
+ * tftp_multi() - Fetch several files from the TFTP server at once
+ *
+ * Runs one transfer per file, each from its own port, in a single
+ * NetLoop(). 'filesize' and 'fileaddr' are set for the last file.
+ *
+ * @files:	Files to fetch
+ * @count:	Number of files, at most TFTP_MULTI_MAX
+ * @return 0 if all were loaded, -1 on error
+ */
+int tftp_multi(struct tftp_multi_file *files, int count);
+#endif
+
+#ifdef CONFIG_ARP_CACHE
+/* Forget all remembered ethernet addresses */
+void arp_cache_flush(void);
+/* Show the ARP cache and unresolved addresses */
+void arp_cache_print(void);
+#else
+static inline void arp_cache_flush(void)
+{
+}
+#endif
+
 static inline void eth_set_last_protocol(int protocol)
 {
 #ifdef CONFIG_NETCONSOLE
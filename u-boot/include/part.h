@@ -102,6 +102,9 @@ block_dev_desc_t* usb_stor_get_dev(int dev);
 block_dev_desc_t* mmc_get_dev(int dev);
 block_dev_desc_t* systemace_get_dev(int dev);
 block_dev_desc_t* mg_disk_get_dev(int dev);
+block_dev_desc_t *host_get_dev(int dev);
+int host_dev_bind(int dev, const char *filename);
+void host_dev_show(void);
 
 /* disk/part.c */
 int get_partition_info (block_dev_desc_t * dev_desc, int part, disk_partition_t *info);
@@ -113,6 +116,13 @@ int get_device(const char *ifname, const char *dev_str,
 int get_device_and_partition(const char *ifname, const char *dev_part_str,
 			     block_dev_desc_t **dev_desc,
 			     disk_partition_t *info, int allow_whole_dev);
+int get_partition_info_by_name(block_dev_desc_t *dev_desc, const char *name,
+			       disk_partition_t *info);
+int get_partition_info_by_name_or_num(block_dev_desc_t *dev_desc,
+				      const char *str, disk_partition_t *info);
+int dev_read_blocks(block_dev_desc_t *dev_desc, lbaint_t start,
+		    lbaint_t count, lbaint_t per_read, void *buf,
+		    int (*fn)(void *priv, void *buf, lbaint_t n), void *priv);
 #else
 static inline block_dev_desc_t *get_dev(const char *ifname, int dev)
 { return NULL; }
@@ -123,6 +133,7 @@ static inline block_dev_desc_t* usb_stor_get_dev(int dev) { return NULL; }
 static inline block_dev_desc_t* mmc_get_dev(int dev) { return NULL; }
 static inline block_dev_desc_t* systemace_get_dev(int dev) { return NULL; }
 static inline block_dev_desc_t* mg_disk_get_dev(int dev) { return NULL; }
+static inline block_dev_desc_t *host_get_dev(int dev) { return NULL; }
 
 static inline int get_partition_info (block_dev_desc_t * dev_desc, int part,
 	disk_partition_t *info) { return -1; }
@@ -138,6 +149,19 @@ static inline int get_device_and_partition(const char *ifname,
 					   disk_partition_t *info,
 					   int allow_whole_dev)
 { *dev_desc = NULL; return -1; }
+static inline int get_partition_info_by_name(block_dev_desc_t *dev_desc,
+					     const char *name,
+					     disk_partition_t *info)
+{ return -1; }
+static inline int get_partition_info_by_name_or_num(block_dev_desc_t *dev_desc,
+						    const char *str,
+						    disk_partition_t *info)
+{ return -1; }
+static inline int dev_read_blocks(block_dev_desc_t *dev_desc, lbaint_t start,
+				  lbaint_t count, lbaint_t per_read, void *buf,
+				  int (*fn)(void *priv, void *buf, lbaint_t n),
+				  void *priv)
+{ return -1; }
 #endif
 
 #ifdef CONFIG_MAC_PARTITION
@@ -172,6 +196,8 @@ int   test_part_amiga (block_dev_desc_t *dev_desc);
 #include <part_efi.h>
 /* disk/part_efi.c */
 int get_partition_info_efi (block_dev_desc_t * dev_desc, int part, disk_partition_t *info);
+int get_partition_info_efi_by_name(block_dev_desc_t *dev_desc,
+				   const char *name, disk_partition_t *info);
 void print_part_efi (block_dev_desc_t *dev_desc);
 int   test_part_efi (block_dev_desc_t *dev_desc);
 
@@ -23,6 +23,10 @@ int sandbox_fs_set_blk_dev(block_dev_desc_t *rbdd, disk_partition_t *info);
 long sandbox_fs_read_at(const char *filename, unsigned long pos,
 			     void *buffer, unsigned long maxsize);
 
+int sandbox_fs_open_file(const char *filename, void **filep, loff_t *sizep);
+int sandbox_fs_read_file_at(void *filep, loff_t pos, void *buf, int len);
+void sandbox_fs_close_file(void *filep);
+int sandbox_fs_mounted(block_dev_desc_t *rbdd, disk_partition_t *info);
 void sandbox_fs_close(void);
 int sandbox_fs_ls(const char *dirname);
 int fs_read_sandbox(const char *filename, void *buf, int offset, int len);
@@ -0,0 +1,105 @@
+/*
+ * Android sparse images
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * A sparse image is a file header followed by chunks, each with a chunk
+ * header. A chunk covers a whole number of blocks of the output: raw
+ * data, a 32-bit value to fill with, or blocks to leave alone. All
+ * fields are little-endian.
+ */
+
+#ifndef __SPARSE_FORMAT_H__
+#define __SPARSE_FORMAT_H__
+
+#define SPARSE_HEADER_MAGIC	0xed26ff3a
+#define SPARSE_MAJOR_VERSION	1
+
+#define CHUNK_TYPE_RAW		0xcac1
+#define CHUNK_TYPE_FILL		0xcac2
+#define CHUNK_TYPE_DONT_CARE	0xcac3
+#define CHUNK_TYPE_CRC32	0xcac4
+
+struct sparse_header {
+	u32 magic;
+	u16 major_version;
+	u16 minor_version;
+	u16 file_hdr_sz;	/* 28 bytes for version 1.0 */
+	u16 chunk_hdr_sz;	/* 12 bytes for version 1.0 */
+	u32 blk_sz;		/* a multiple of 4 */
+	u32 total_blks;		/* blocks in the output */
+	u32 total_chunks;
+	u32 image_checksum;
+};
+
+struct chunk_header {
+	u16 chunk_type;
+	u16 reserved1;
+	u32 chunk_sz;		/* in blocks of the output */
+	u32 total_sz;		/* in bytes, with this header */
+};
+
+/*
+ * Output of a sparse stream. Writes come in order of offset, but blocks
+ * which the image leaves alone are skipped.
+ *
+ * @return 0 if ok, -1 on error
+ */
+struct sparse_stream;
+typedef int sparse_write_f(struct sparse_stream *ss, u64 offset,
+			   const void *buf, ulong len);
+
+/* State of a sparse image being expanded as it arrives */
+struct sparse_stream {
+	sparse_write_f *write;
+	void *priv;			/* for the caller */
+
+	int state;
+	struct sparse_header hdr;
+	u32 chunks_left;
+	u64 offset;			/* of the next output byte */
+	u64 remain;			/* bytes left of the current chunk */
+	u32 chunk_type;
+	uchar buf[32];			/* a header being put together */
+	unsigned buf_len, buf_want;
+};
+
+/**
+ * is_sparse_image() - Check for the sparse image magic number
+ *
+ * @buf:	Start of the image
+ * @return 1 if it is a sparse image, else 0
+ */
+int is_sparse_image(const void *buf);
+
+/**
+ * sparse_stream_init() - Prepare to expand a sparse image
+ *
+ * @ss:		Stream state
+ * @write:	Function to write the output
+ * @priv:	Anything the write function needs
+ */
+void sparse_stream_init(struct sparse_stream *ss, sparse_write_f *write,
+			void *priv);
+
+/**
+ * sparse_stream_feed() - Expand the next part of a sparse image
+ *
+ * @ss:		Stream state
+ * @data:	Next bytes of the image, in any amount
+ * @len:	Number of bytes
+ * @return 0 if ok, -1 if the image is bad or a write failed
+ */
+int sparse_stream_feed(struct sparse_stream *ss, const void *data, ulong len);
+
+/**
+ * sparse_stream_done() - Check that the whole image has been expanded
+ *
+ * @ss:		Stream state
+ * @return 1 if all chunks are done, else 0
+ */
+int sparse_stream_done(struct sparse_stream *ss);
+
+#endif /* __SPARSE_FORMAT_H__ */
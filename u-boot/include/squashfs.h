@@ -0,0 +1,24 @@
+/*
+ * SquashFS read support
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __SQUASHFS_H__
+#define __SQUASHFS_H__
+
+#include <part.h>
+
+int sqfs_probe(block_dev_desc_t *fs_dev_desc, disk_partition_t *fs_partition);
+int sqfs_mounted(block_dev_desc_t *fs_dev_desc,
+		 disk_partition_t *fs_partition);
+void sqfs_close(void);
+int sqfs_ls(const char *dirname);
+int sqfs_read_file(const char *filename, void *buf, int offset, int len);
+int sqfs_open_file(const char *filename, void **filep, loff_t *sizep);
+int sqfs_read_file_at(void *filep, loff_t pos, void *buf, int len);
+void sqfs_close_file(void *filep);
+/* Print what is mounted, and how well its caches are doing */
+void sqfs_info(void);
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * Flashing over UDP
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * The wire protocol is shared with the host tool, tools/udpflash.c.
+ *
+ * Every packet starts with a struct udp_flash_hdr. The host sends
+ * commands and data, one packet at a time, and U-Boot answers each with
+ * a reply carrying the same sequence number. The host sends a packet
+ * again if no reply comes; U-Boot answers a repeated packet with the
+ * reply it gave before, without acting on it twice. The first packet of
+ * a session has UDP_FLASH_F_START set.
+ *
+ * Commands are ASCII, and replies start with OKAY, FAIL or DATA as in
+ * fastboot:
+ *
+ *   getvar:<name>		version, max-download-size
+ *   download:<size>		load <size> (hex) bytes into RAM
+ *   flash:<target>		write what was downloaded to <target>
+ *   write:<size>:<target>	write <size> bytes to <target> as they arrive
+ *   erase:<target>
+ *   continue			leave the flashing loop
+ *   reboot
+ *
+ * download: and write: are answered with DATA<size>. The host then sends
+ * that many bytes in UDP_FLASH_DATA packets; each is answered with an
+ * empty reply, except the last, which gets OKAY or FAIL.
+ *
+ * A target is "<interface> <dev>[:<part>]" for a block device (e.g.
+ * "mmc 0:2"), "nand <partition>" or "nand <offset> <size>" for NAND, or
+ * "mem <address>" for RAM. Android sparse images are expanded when
+ * written to block devices and RAM.
+ */
+
+#ifndef __UDP_FLASH_H__
+#define __UDP_FLASH_H__
+
+#define UDP_FLASH_PORT		5554
+#define UDP_FLASH_VERSION	"1"
+
+/* Largest UDP payload that fits an Ethernet frame without fragments */
+#define UDP_FLASH_MAX_PACKET	1472
+#define UDP_FLASH_HDR_SIZE	4
+#define UDP_FLASH_MAX_DATA	(UDP_FLASH_MAX_PACKET - UDP_FLASH_HDR_SIZE)
+
+/* Packet types */
+#define UDP_FLASH_CMD		1	/* host: ASCII command */
+#define UDP_FLASH_DATA		2	/* host: data for download/write */
+#define UDP_FLASH_REPLY		3	/* U-Boot: answer to either */
+
+/* Flags */
+#define UDP_FLASH_F_START	0x01	/* first packet of a session */
+
+struct udp_flash_hdr {
+	unsigned char type;
+	unsigned char flags;
+	unsigned char seq[2];		/* big-endian */
+};
+
+#ifndef USE_HOSTCC
+/**
+ * udp_flash_reply_f - Send a reply to the host
+ *
+ * @pkt:	Reply, starting with a struct udp_flash_hdr
+ * @len:	Length of the reply
+ */
+typedef void udp_flash_reply_f(const uchar *pkt, unsigned len);
+
+/**
+ * udp_flash_init() - Start a new flashing session
+ *
+ * @reply:	Function to send replies with
+ * @return 0 if ok, -1 if out of memory
+ */
+int udp_flash_init(udp_flash_reply_f *reply);
+
+/**
+ * udp_flash_packet() - Act on a packet from the host
+ *
+ * The reply to a data packet is sent before its data is written, so that
+ * the host can send the next packet while the write goes on.
+ *
+ * @pkt:	Packet, starting with a struct udp_flash_hdr
+ * @len:	Length of the packet
+ * @return 0 to carry on, 1 if the host asked to leave ('continue'), or
+ * 2 if it asked for a reset ('reboot')
+ */
+int udp_flash_packet(const uchar *pkt, unsigned len);
+#endif
+
+#endif /* __UDP_FLASH_H__ */
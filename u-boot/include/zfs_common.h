@@ -100,5 +100,7 @@ int zfs_ls(device_t dev, const char *path,
 int zfs_devread(int sector, int byte_offset, int byte_len, char *buf);
 void zfs_set_blk_dev(block_dev_desc_t *rbdd, disk_partition_t *info);
 void zfs_unmount(struct zfs_data *data);
+void zfs_show_stats(void);
+void zfs_reset_stats(void);
 int lzjb_decompress(void *, void *, uint32_t, uint32_t);
 #endif
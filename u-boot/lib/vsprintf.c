@@ -193,103 +193,96 @@ static int skip_atoi(const char **s)
 	return i;
 }
 
-/* Decimal conversion is by far the most typical, and is used
- * for /proc and /sys data. This directly impacts e.g. top performance
- * with many processes running. We optimize it for speed
- * using code from
- * http://www.cs.uiowa.edu/~jones/bcd/decimal.html
- * (with permission from the author, Douglas W. Jones). */
-
-/* Formats correctly any integer in [0,99999].
- * Outputs from one to five digits depending on input.
- * On i386 gcc 4.1.2 -O2: ~250 bytes of code. */
-static char *put_dec_trunc(char *buf, unsigned q)
-{
-	unsigned d3, d2, d1, d0;
-	d1 = (q>>4) & 0xf;
-	d2 = (q>>8) & 0xf;
-	d3 = (q>>12);
-
-	d0 = 6*(d3 + d2 + d1) + (q & 0xf);
-	q = (d0 * 0xcd) >> 11;
-	d0 = d0 - 10*q;
-	*buf++ = d0 + '0'; /* least significant digit */
-	d1 = q + 9*d3 + 5*d2 + d1;
-	if (d1 != 0) {
-		q = (d1 * 0xcd) >> 11;
-		d1 = d1 - 10*q;
-		*buf++ = d1 + '0'; /* next digit */
-
-		d2 = q + 2*d2;
-		if ((d2 != 0) || (d3 != 0)) {
-			q = (d2 * 0xd) >> 7;
-			d2 = d2 - 10*q;
-			*buf++ = d2 + '0'; /* next digit */
-
-			d3 = q + 4*d3;
-			if (d3 != 0) {
-				q = (d3 * 0xcd) >> 11;
-				d3 = d3 - 10*q;
-				*buf++ = d3 + '0';  /* next digit */
-				if (q != 0)
-					*buf++ = q + '0'; /* most sign. digit */
-			}
-		}
-	}
+/*
+ * Decimal conversion is by far the most typical, so it is optimised for
+ * speed. Digits are produced two at a time from a table of digit pairs,
+ * and division by 100 is done with a multiply, so that 32-bit values need
+ * no division at all. Only values above 32 bits fall back to do_div(), once
+ * per nine digits, which matters on 32-bit CPUs where do_div() is a
+ * software routine.
+ *
+ * All of these write the digits in reverse order, least significant first.
+ */
+static const char dec_pairs[200] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+/* q / 100 for any 32-bit q, without a division instruction */
+static inline u32 div100(u32 q)
+{
+	return ((u64)q * 0x51eb851f) >> 37;
+}
+
+static inline char *put_dec_pair(char *buf, u32 r)
+{
+	*buf++ = dec_pairs[2 * r + 1];
+	*buf++ = dec_pairs[2 * r];
 	return buf;
 }
-/* Same with if's removed. Always emits five digits */
-static char *put_dec_full(char *buf, unsigned q)
+
+/* Formats any 32-bit value, with no leading zeroes */
+static char *put_dec_u32(char *buf, u32 q)
 {
-	/* BTW, if q is in [0,9999], 8-bit ints will be enough, */
-	/* but anyway, gcc produces better code with full-sized ints */
-	unsigned d3, d2, d1, d0;
-	d1 = (q>>4) & 0xf;
-	d2 = (q>>8) & 0xf;
-	d3 = (q>>12);
+	u32 d;
 
-	/*
-	 * Possible ways to approx. divide by 10
-	 * gcc -O2 replaces multiply with shifts and adds
-	 * (x * 0xcd) >> 11: 11001101 - shorter code than * 0x67 (on i386)
-	 * (x * 0x67) >> 10:  1100111
-	 * (x * 0x34) >> 9:    110100 - same
-	 * (x * 0x1a) >> 8:     11010 - same
-	 * (x * 0x0d) >> 7:      1101 - same, shortest code (on i386)
-	 */
+	while (q >= 100) {
+		d = div100(q);
+		buf = put_dec_pair(buf, q - d * 100);
+		q = d;
+	}
+	if (q >= 10)
+		return put_dec_pair(buf, q);
+	*buf++ = q + '0';
+	return buf;
+}
 
-	d0 = 6*(d3 + d2 + d1) + (q & 0xf);
-	q = (d0 * 0xcd) >> 11;
-	d0 = d0 - 10*q;
-	*buf++ = d0 + '0';
-	d1 = q + 9*d3 + 5*d2 + d1;
-		q = (d1 * 0xcd) >> 11;
-		d1 = d1 - 10*q;
-		*buf++ = d1 + '0';
-
-		d2 = q + 2*d2;
-			q = (d2 * 0xd) >> 7;
-			d2 = d2 - 10*q;
-			*buf++ = d2 + '0';
-
-			d3 = q + 4*d3;
-				q = (d3 * 0xcd) >> 11; /* - shorter code */
-				/* q = (d3 * 0x67) >> 10; - would also work */
-				d3 = d3 - 10*q;
-				*buf++ = d3 + '0';
-					*buf++ = q + '0';
+/* Formats a value below 10^9, always emitting nine digits */
+static char *put_dec_full9(char *buf, u32 q)
+{
+	u32 d;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		d = div100(q);
+		buf = put_dec_pair(buf, q - d * 100);
+		q = d;
+	}
+	*buf++ = q + '0';
 	return buf;
 }
+
 /* No inlining helps gcc to use registers better */
 static noinline char *put_dec(char *buf, u64 num)
 {
-	while (1) {
-		unsigned rem;
-		if (num < 100000)
-			return put_dec_trunc(buf, num);
-		rem = do_div(num, 100000);
-		buf = put_dec_full(buf, rem);
-	}
+	while (num >> 32)
+		buf = put_dec_full9(buf, do_div(num, 1000000000));
+	return put_dec_u32(buf, num);
+}
+
+/* Hex or octal, with a 32-bit loop when the value allows */
+static inline char *put_pow2(char *buf, u64 num, int shift, char locase)
+{
+	/* we are called with base 8 or 16, only, thus don't need "G..."  */
+	static const char digits[16] = "0123456789ABCDEF";
+	int mask = (1 << shift) - 1;
+	u32 q;
+
+	for (; num >> 32; num >>= shift)
+		*buf++ = digits[(u32)num & mask] | locase;
+	q = num;
+	do {
+		*buf++ = digits[q & mask] | locase;
+		q >>= shift;
+	} while (q);
+	return buf;
 }
 
 #define ZEROPAD	1		/* pad with zero */
@@ -317,9 +310,6 @@ static noinline char *put_dec(char *buf, u64 num)
 static char *number(char *buf, char *end, u64 num,
 		int base, int size, int precision, int type)
 {
-	/* we are called with base 8, 10 or 16, only, thus don't need "G..."  */
-	static const char digits[16] = "0123456789ABCDEF";
-
 	char tmp[66];
 	char sign;
 	char locase;
@@ -352,29 +342,10 @@ static char *number(char *buf, char *end, u64 num,
 	}
 
 	/* generate full string in tmp[], in reverse order */
-	i = 0;
-	if (num == 0)
-		tmp[i++] = '0';
-	/* Generic code, for any base:
-	else do {
-		tmp[i++] = (digits[do_div(num,base)] | locase);
-	} while (num != 0);
-	*/
-	else if (base != 10) { /* 8 or 16 */
-		int mask = base - 1;
-		int shift = 3;
-
-		if (base == 16)
-			shift = 4;
-
-		do {
-			tmp[i++] = (digits[((unsigned char)num) & mask]
-					| locase);
-			num >>= shift;
-		} while (num);
-	} else { /* base 10 */
+	if (base != 10) /* 8 or 16 */
+		i = put_pow2(tmp, num, base == 16 ? 4 : 3, locase) - tmp;
+	else
 		i = put_dec(tmp, num) - tmp;
-	}
 
 	/* printing 100 using %2d gives "100", not "00" */
 	if (i > precision)
@@ -433,6 +404,37 @@ static char *string(char *buf, char *end, char *s, int field_width,
 	return buf;
 }
 
+/* Equivalent to string() with no field width, precision or flags */
+static char *string_simple(char *buf, char *end, const char *s)
+{
+	if (s == NULL)
+		s = "<NULL>";
+
+	while (*s)
+		ADDCH(buf, *s++);
+	return buf;
+}
+
+/* Equivalent to number() for %d, %u and %x with no modifiers */
+static char *number_simple(char *buf, char *end, unsigned int num, char conv)
+{
+	char tmp[10];
+	int i;
+
+	if (conv == 'x') {
+		i = put_pow2(tmp, num, 4, SMALL) - tmp;
+	} else {
+		if (conv != 'u' && (int)num < 0) {
+			ADDCH(buf, '-');
+			num = -num;
+		}
+		i = put_dec_u32(tmp, num) - tmp;
+	}
+	while (--i >= 0)
+		ADDCH(buf, tmp[i]);
+	return buf;
+}
+
 #ifdef CONFIG_CMD_NET
 static char *mac_address_string(char *buf, char *end, u8 *addr, int field_width,
 				int precision, int flags)
@@ -483,7 +485,7 @@ static char *ip4_addr_string(char *buf, char *end, u8 *addr, int field_width,
 	int i, digits;
 
 	for (i = 0; i < 4; i++) {
-		digits = put_dec_trunc(temp, addr[i]) - temp;
+		digits = put_dec_u32(temp, addr[i]) - temp;
 		/* reverse the digits in the quad */
 		while (digits--)
 			*p++ = temp[digits];
@@ -592,6 +594,25 @@ static int vsnprintf_internal(char *buf, size_t size, const char *fmt,
 			continue;
 		}
 
+		/*
+		 * Fast path for the most common conversions, which have no
+		 * flags, width, precision or qualifier to deal with.
+		 */
+		switch (fmt[1]) {
+		case 's':
+			fmt++;
+			str = string_simple(str, end, va_arg(args, char *));
+			continue;
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'x':
+			fmt++;
+			str = number_simple(str, end, va_arg(args, unsigned int),
+					    *fmt);
+			continue;
+		}
+
 		/* process flags */
 		flags = 0;
 repeat:
@@ -750,6 +771,7 @@ repeat:
 		ADDCH(str, '\0');
 		if (str > end)
 			end[-1] = '\0';
+		--str;
 	}
 #else
 	*str = '\0';
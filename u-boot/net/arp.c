@@ -26,6 +26,49 @@
 # define ARP_TIMEOUT_COUNT	CONFIG_NET_RETRY_COUNT
 #endif
 
+#ifdef CONFIG_ARP_CACHE
+#ifndef	CONFIG_ARP_TTL
+/* Milliseconds for which a resolved address is remembered */
+# define ARP_TTL		60000UL
+#else
+# define ARP_TTL		CONFIG_ARP_TTL
+#endif
+
+#ifndef	CONFIG_ARP_CACHE_SIZE
+# define ARP_CACHE_SIZE		8
+#else
+# define ARP_CACHE_SIZE		CONFIG_ARP_CACHE_SIZE
+#endif
+
+#ifndef	CONFIG_ARP_QUEUE_SIZE
+/* Packets which can wait for an address to be resolved */
+# define ARP_QUEUE_SIZE		4
+#else
+# define ARP_QUEUE_SIZE		CONFIG_ARP_QUEUE_SIZE
+#endif
+
+struct arp_entry {
+	IPaddr_t ip;			/* 0 if unused */
+	uchar ether[ARP_HLEN];
+	ulong time;			/* get_timer() when last confirmed */
+};
+
+/* A packet waiting for the ethernet address of its next hop */
+struct arp_pending {
+	IPaddr_t ip;			/* Next hop, 0 if unused */
+	uchar *ether;			/* Sender's copy of the address */
+	uchar *pkt;
+	int len;
+	ulong queued;			/* get_timer() when queued */
+	ulong time;			/* get_timer() of the last request */
+	int tries;
+};
+
+static struct arp_entry arp_cache[ARP_CACHE_SIZE];
+static struct arp_pending arp_queue[ARP_QUEUE_SIZE];
+static uchar arp_queue_buf[ARP_QUEUE_SIZE][PKTSIZE_ALIGN + PKTALIGN];
+#endif
+
 IPaddr_t	NetArpWaitPacketIP;
 static IPaddr_t	NetArpWaitReplyIP;
 /* MAC address of waiting packet's destination */
@@ -37,6 +80,23 @@ int		NetArpWaitTry;
 static uchar   *NetArpTxPacket;	/* THE ARP transmit packet */
 static uchar	NetArpPacketBuf[PKTSIZE_ALIGN + PKTALIGN];
 
+#ifdef CONFIG_ARP_CACHE
+static void arp_queue_init(void)
+{
+	int i;
+
+	for (i = 0; i < ARP_QUEUE_SIZE; i++) {
+		arp_queue[i].ip = 0;
+		arp_queue[i].pkt = arp_queue_buf[i] + (PKTALIGN - 1);
+		arp_queue[i].pkt -= (ulong)arp_queue[i].pkt % PKTALIGN;
+	}
+}
+#else
+static inline void arp_queue_init(void)
+{
+}
+#endif
+
 void ArpInit(void)
 {
 	/* XXX problem with bss workaround */
@@ -46,6 +106,7 @@ void ArpInit(void)
 	NetArpWaitTxPacketSize = 0;
 	NetArpTxPacket = &NetArpPacketBuf[0] + (PKTALIGN - 1);
 	NetArpTxPacket -= (ulong)NetArpTxPacket % PKTALIGN;
+	arp_queue_init();
 }
 
 void arp_raw_request(IPaddr_t sourceIP, const uchar *targetEther,
@@ -56,6 +117,7 @@ void arp_raw_request(IPaddr_t sourceIP, const uchar *targetEther,
 	int eth_hdr_size;
 
 	debug_cond(DEBUG_DEV_PKT, "ARP broadcast %d\n", NetArpWaitTry);
+	net_stat_inc(NET_STAT_ARP_REQUESTS);
 
 	pkt = NetArpTxPacket;
 
@@ -78,35 +140,272 @@ void arp_raw_request(IPaddr_t sourceIP, const uchar *targetEther,
 	NetSendPacket(NetArpTxPacket, eth_hdr_size + ARP_HDR_SIZE);
 }
 
+/* Work out whose ethernet address we need to send to an IP address */
+static IPaddr_t arp_next_hop(IPaddr_t ip)
+{
+	if ((ip & NetOurSubnetMask) != (NetOurIP & NetOurSubnetMask) &&
+	    NetOurGatewayIP != 0)
+		return NetOurGatewayIP;
+
+	return ip;
+}
+
+static void arp_warn_gateway(IPaddr_t ip)
+{
+	if ((ip & NetOurSubnetMask) != (NetOurIP & NetOurSubnetMask) &&
+	    NetOurGatewayIP == 0)
+		puts("## Warning: gatewayip needed but not set\n");
+}
+
 void ArpRequest(void)
 {
-	if ((NetArpWaitPacketIP & NetOurSubnetMask) !=
-	    (NetOurIP & NetOurSubnetMask)) {
-		if (NetOurGatewayIP == 0) {
-			puts("## Warning: gatewayip needed but not set\n");
-			NetArpWaitReplyIP = NetArpWaitPacketIP;
-		} else {
-			NetArpWaitReplyIP = NetOurGatewayIP;
+	arp_warn_gateway(NetArpWaitPacketIP);
+	NetArpWaitReplyIP = arp_next_hop(NetArpWaitPacketIP);
+
+	arp_raw_request(NetOurIP, NetEtherNullAddr, NetArpWaitReplyIP);
+}
+
+#ifdef CONFIG_ARP_CACHE
+static struct arp_entry *arp_cache_find(IPaddr_t ip)
+{
+	struct arp_entry *ent;
+	int i;
+
+	for (i = 0, ent = arp_cache; i < ARP_CACHE_SIZE; i++, ent++) {
+		if (ent->ip && ent->ip == ip)
+			return ent;
+	}
+
+	return NULL;
+}
+
+int arp_cache_lookup(IPaddr_t ip, uchar *ether)
+{
+	struct arp_entry *ent;
+
+	ip = arp_next_hop(ip);
+	ent = arp_cache_find(ip);
+	if (!ent)
+		return 0;
+	if (get_timer(ent->time) > ARP_TTL) {
+		ent->ip = 0;
+		return 0;
+	}
+	debug_cond(DEBUG_DEV_PKT, "ARP cache hit for %pI4 (%pM)\n", &ip,
+		   ent->ether);
+	memcpy(ether, ent->ether, ARP_HLEN);
+
+	return 1;
+}
+
+/* Refresh an existing entry, e.g. from a gratuitous ARP */
+static void arp_cache_update(IPaddr_t ip, const uchar *ether)
+{
+	struct arp_entry *ent = arp_cache_find(ip);
+
+	if (ent) {
+		memcpy(ent->ether, ether, ARP_HLEN);
+		ent->time = get_timer(0);
+	}
+}
+
+/*
+ * Remember the ethernet address of a host. An existing entry is refreshed;
+ * otherwise a free or expired entry is used, or failing that the least
+ * recently confirmed one.
+ */
+static void arp_cache_add(IPaddr_t ip, const uchar *ether)
+{
+	struct arp_entry *ent, *victim;
+	ulong now = get_timer(0);
+	int i;
+
+	victim = arp_cache_find(ip);
+	for (i = 0, ent = arp_cache; !victim && i < ARP_CACHE_SIZE;
+	     i++, ent++) {
+		if (!ent->ip || now - ent->time > ARP_TTL)
+			victim = ent;
+	}
+	if (!victim) {
+		/* Replace the least recently confirmed entry */
+		victim = arp_cache;
+		for (i = 1, ent = arp_cache + 1; i < ARP_CACHE_SIZE; i++, ent++)
+			if (ent->time < victim->time)
+				victim = ent;
+	}
+	victim->ip = ip;
+	memcpy(victim->ether, ether, ARP_HLEN);
+	victim->time = now;
+}
+
+void arp_cache_flush(void)
+{
+	int i;
+
+	for (i = 0; i < ARP_CACHE_SIZE; i++)
+		arp_cache[i].ip = 0;
+}
+
+void arp_cache_print(void)
+{
+	struct arp_entry *ent;
+	ulong now = get_timer(0);
+	int i;
+
+	for (i = 0, ent = arp_cache; i < ARP_CACHE_SIZE; i++, ent++) {
+		if (!ent->ip || now - ent->time > ARP_TTL)
+			continue;
+		printf("%-15pI4  %pM  %lus\n", &ent->ip, ent->ether,
+		       (ARP_TTL - (now - ent->time)) / CONFIG_SYS_HZ);
+	}
+	for (i = 0; i < ARP_QUEUE_SIZE; i++) {
+		if (arp_queue[i].ip)
+			printf("%-15pI4  (incomplete)\n", &arp_queue[i].ip);
+	}
+}
+
+int arp_queue_pending(IPaddr_t ip)
+{
+	int i;
+
+	for (i = 0; i < ARP_QUEUE_SIZE; i++) {
+		if (arp_queue[i].ip && arp_queue[i].ip == ip)
+			return 1;
+	}
+
+	return 0;
+}
+
+void arp_queue_packet(IPaddr_t dest, uchar *ether, const uchar *pkt, int len)
+{
+	struct arp_pending *pend, *slot = NULL, *same = NULL;
+	IPaddr_t ip = arp_next_hop(dest);
+	ulong now = get_timer(0);
+	int i;
+
+	for (i = 0, pend = arp_queue; i < ARP_QUEUE_SIZE; i++, pend++) {
+		if (!pend->ip) {
+			slot = pend;
+			break;
 		}
-	} else {
-		NetArpWaitReplyIP = NetArpWaitPacketIP;
+		if (!slot || now - pend->queued > now - slot->queued)
+			slot = pend;
+	}
+	if (slot->ip) {
+		/* Make room by dropping the packet which has waited longest */
+		debug("ARP queue full, dropping packet for %pI4\n", &slot->ip);
+		slot->ip = 0;
+	}
+	for (i = 0, pend = arp_queue; i < ARP_QUEUE_SIZE; i++, pend++) {
+		if (pend->ip == ip)
+			same = pend;
 	}
 
-	arp_raw_request(NetOurIP, NetEtherNullAddr, NetArpWaitReplyIP);
+	slot->ip = ip;
+	slot->ether = ether == NetEtherNullAddr ? NULL : ether;
+	slot->len = len;
+	slot->queued = now;
+	memcpy(slot->pkt, pkt, len);
+	if (same) {
+		/* A request is already outstanding */
+		slot->time = same->time;
+		slot->tries = same->tries;
+		return;
+	}
+
+	slot->time = now;
+	slot->tries = 1;
+	arp_warn_gateway(dest);
+	arp_raw_request(NetOurIP, NetEtherNullAddr, ip);
+}
+
+/* Send the packets waiting for @ip, now that we know its address */
+static void arp_queue_send(IPaddr_t ip, const uchar *ether)
+{
+	struct arp_pending *pend;
+	int i;
+
+	for (i = 0, pend = arp_queue; i < ARP_QUEUE_SIZE; i++, pend++) {
+		if (!pend->ip || pend->ip != ip)
+			continue;
+		if (pend->ether)
+			memcpy(pend->ether, ether, ARP_HLEN);
+		memcpy(((struct ethernet_hdr *)pend->pkt)->et_dest, ether,
+		       ARP_HLEN);
+		NetSendPacket(pend->pkt, pend->len);
+		pend->ip = 0;
+	}
+}
+
+void arp_queue_flush(void)
+{
+	int i;
+
+	for (i = 0; i < ARP_QUEUE_SIZE; i++)
+		arp_queue[i].ip = 0;
+}
+
+static void arp_queue_timeout_check(ulong t)
+{
+	struct arp_pending *pend, *p;
+	IPaddr_t ip;
+	int i, j;
+
+	for (i = 0, pend = arp_queue; i < ARP_QUEUE_SIZE; i++, pend++) {
+		if (!pend->ip || t - pend->time <= ARP_TIMEOUT)
+			continue;
+
+		/* Retry once for all the packets waiting for this address */
+		ip = pend->ip;
+		if (pend->tries + 1 >= ARP_TIMEOUT_COUNT) {
+			for (j = 0, p = arp_queue; j < ARP_QUEUE_SIZE; j++, p++)
+				if (p->ip == ip)
+					p->ip = 0;
+			puts("\nARP Retry count exceeded; starting again\n");
+			NetStartAgain();
+			return;
+		}
+		for (j = 0, p = arp_queue; j < ARP_QUEUE_SIZE; j++, p++) {
+			if (p->ip == ip) {
+				p->tries++;
+				p->time = t;
+			}
+		}
+		arp_raw_request(NetOurIP, NetEtherNullAddr, ip);
+	}
+}
+#else
+static inline void arp_cache_update(IPaddr_t ip, const uchar *ether)
+{
+}
+
+static inline void arp_cache_add(IPaddr_t ip, const uchar *ether)
+{
+}
+
+static inline void arp_queue_send(IPaddr_t ip, const uchar *ether)
+{
+}
+
+static inline void arp_queue_timeout_check(ulong t)
+{
 }
+#endif
 
 void ArpTimeoutCheck(void)
 {
 	ulong t;
 
+	t = get_timer(0);
+	arp_queue_timeout_check(t);
+
 	if (!NetArpWaitPacketIP)
 		return;
 
-	t = get_timer(0);
-
 	/* check for arp timeout */
 	if ((t - NetArpWaitTimerStart) > ARP_TIMEOUT) {
 		NetArpWaitTry++;
+		net_stat_inc(NET_STAT_ARP_TIMEOUTS);
 
 		if (NetArpWaitTry >= ARP_TIMEOUT_COUNT) {
 			puts("\nARP Retry count exceeded; starting again\n");
@@ -154,11 +453,17 @@ void ArpReceive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 	if (NetOurIP == 0)
 		return;
 
+	/* Any ARP packet, e.g. a gratuitous one, confirms its sender */
+	arp_cache_update(NetReadIP(&arp->ar_spa), &arp->ar_sha);
+
 	if (NetReadIP(&arp->ar_tpa) != NetOurIP)
 		return;
 
 	switch (ntohs(arp->ar_op)) {
 	case ARPOP_REQUEST:
+		/* the sender will talk to us, so remember its address */
+		arp_cache_add(NetReadIP(&arp->ar_spa), &arp->ar_sha);
+
 		/* reply with our IP address */
 		debug_cond(DEBUG_DEV_PKT, "Got ARP REQUEST, return our IP\n");
 		pkt = (uchar *)et;
@@ -187,34 +492,36 @@ void ArpReceive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 		return;
 
 	case ARPOP_REPLY:		/* arp reply */
+		reply_ip_addr = NetReadIP(&arp->ar_spa);
+
 		/* are we waiting for a reply */
-		if (!NetArpWaitPacketIP)
+		if (!(NetArpWaitPacketIP && reply_ip_addr == NetArpWaitReplyIP) &&
+		    !arp_queue_pending(reply_ip_addr))
 			break;
 
+		debug_cond(DEBUG_DEV_PKT, "Got ARP REPLY, set eth addr (%pM)\n",
+			   arp->ar_data);
+
 #ifdef CONFIG_KEEP_SERVERADDR
-		if (NetServerIP == NetArpWaitPacketIP) {
+		if (arp_next_hop(NetServerIP) == reply_ip_addr) {
 			char buf[20];
 			sprintf(buf, "%pM", &arp->ar_sha);
 			setenv("serveraddr", buf);
 		}
 #endif
+		arp_cache_add(reply_ip_addr, &arp->ar_sha);
+		net_get_arp_handler()((uchar *)arp, 0, reply_ip_addr, 0, len);
 
-		reply_ip_addr = NetReadIP(&arp->ar_spa);
+		/* send the packets queued for this address */
+		arp_queue_send(reply_ip_addr, &arp->ar_sha);
 
 		/* matched waiting packet's address */
-		if (reply_ip_addr == NetArpWaitReplyIP) {
-			debug_cond(DEBUG_DEV_PKT,
-				"Got ARP REPLY, set eth addr (%pM)\n",
-				arp->ar_data);
-
+		if (NetArpWaitPacketIP && reply_ip_addr == NetArpWaitReplyIP) {
 			/* save address for later use */
 			if (NetArpWaitPacketMAC != NULL)
 				memcpy(NetArpWaitPacketMAC,
 				       &arp->ar_sha, ARP_HLEN);
 
-			net_get_arp_handler()((uchar *)arp, 0, reply_ip_addr,
-				0, len);
-
 			/* set the mac address in the waiting packet's header
 			   and transmit it */
 			memcpy(((struct ethernet_hdr *)NetTxPacket)->et_dest,
@@ -27,4 +27,51 @@ void arp_raw_request(IPaddr_t sourceIP, const uchar *targetEther,
 void ArpTimeoutCheck(void);
 void ArpReceive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len);
 
+#ifdef CONFIG_ARP_CACHE
+/**
+ * arp_cache_lookup() - Look up a remembered ethernet address
+ *
+ * @ip:		IP address to send to (the gateway is looked up if it is
+ *		not on our subnet)
+ * @ether:	Returns the ethernet address, if found
+ * @return 1 if found, 0 if an ARP request is needed
+ */
+int arp_cache_lookup(IPaddr_t ip, uchar *ether);
+
+/**
+ * arp_queue_packet() - Send a packet once its next hop is resolved
+ *
+ * A copy of the packet is kept, so the caller may reuse its buffer. An
+ * ARP request is sent unless one is already outstanding for the same
+ * next hop. If the queue is full, the packet which has waited longest
+ * is dropped to make room.
+ *
+ * @dest:	Destination IP address
+ * @ether:	If not NULL, set to the ethernet address once it is known
+ * @pkt:	Packet, starting with the ethernet header
+ * @len:	Packet length
+ */
+void arp_queue_packet(IPaddr_t dest, uchar *ether, const uchar *pkt, int len);
+
+/* Check whether packets are waiting for the address of @ip */
+int arp_queue_pending(IPaddr_t ip);
+
+/* Drop all waiting packets */
+void arp_queue_flush(void);
+#else
+static inline int arp_cache_lookup(IPaddr_t ip, uchar *ether)
+{
+	return 0;
+}
+
+static inline int arp_queue_pending(IPaddr_t ip)
+{
+	return 0;
+}
+
+static inline void arp_queue_flush(void)
+{
+}
+#endif
+
 #endif /* __ARP_H__ */
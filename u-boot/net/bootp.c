@@ -30,6 +30,34 @@
 # define TIMEOUT_COUNT	(CONFIG_NET_RETRY_COUNT)
 #endif
 
+/*
+ * With CONFIG_BOOTP_TIMEOUT, wait that many milliseconds for the first
+ * answer and double the wait for each try (RFC 2131 section 4.1), up to
+ * the fixed timeouts otherwise used. On a wired link the server answers
+ * in a few milliseconds, so a lost packet costs much less this way.
+ */
+#ifdef CONFIG_BOOTP_TIMEOUT
+static ulong bootp_timeout(ulong max)
+{
+	int shift = BootpTry > 1 ? min(BootpTry - 1, 8) : 0;
+
+	return min((ulong)CONFIG_BOOTP_TIMEOUT << shift, max);
+}
+#else
+#define bootp_timeout(max)	(max)
+#endif
+
+#ifdef CONFIG_DHCP_INIT_REBOOT
+/* REQUESTs for the previous address before falling back to DISCOVER */
+#define DHCP_REBOOT_TRIES	2
+/*
+ * Milliseconds to wait for an answer to each. This is not shortened by
+ * CONFIG_BOOTP_TIMEOUT: a server which does not know the lease stays
+ * silent, so each try must allow for a slow one.
+ */
+#define DHCP_REBOOT_TIMEOUT	1000UL
+#endif
+
 #define PORT_BOOTPS	67		/* BOOTP server UDP port */
 #define PORT_BOOTPC	68		/* BOOTP client UDP port */
 
@@ -44,6 +72,10 @@ int		BootpTry;
 static dhcp_state_t dhcp_state = INIT;
 static unsigned long dhcp_leasetime;
 static IPaddr_t NetDHCPServerIP;
+#ifdef CONFIG_DHCP_INIT_REBOOT
+static IPaddr_t dhcp_lease_ip;
+static int dhcp_reboot_try;
+#endif
 static void DhcpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			unsigned len);
 
@@ -327,6 +359,7 @@ BootpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 static void
 BootpTimeout(void)
 {
+	net_stat_inc(NET_STAT_BOOTP_TIMEOUTS);
 	if (BootpTry >= TIMEOUT_COUNT) {
 #ifdef CONFIG_BOOTP_MAY_FAIL
 		puts("\nRetry count exceeded\n");
@@ -597,6 +630,20 @@ static int BootpExtended(u8 *e)
 }
 #endif
 
+/*
+ *	Bootp ID is the lower 4 bytes of our ethernet address
+ *	plus the current time in ms.
+ */
+static void bootp_new_id(void)
+{
+	BootpID = ((ulong)NetOurEther[2] << 24)
+		| ((ulong)NetOurEther[3] << 16)
+		| ((ulong)NetOurEther[4] << 8)
+		| (ulong)NetOurEther[5];
+	BootpID += get_timer(0);
+	BootpID	 = htonl(BootpID);
+}
+
 void
 BootpRequest(void)
 {
@@ -667,16 +714,7 @@ BootpRequest(void)
 	extlen = BootpExtended((u8 *)bp->bp_vend);
 #endif
 
-	/*
-	 *	Bootp ID is the lower 4 bytes of our ethernet address
-	 *	plus the current time in ms.
-	 */
-	BootpID = ((ulong)NetOurEther[2] << 24)
-		| ((ulong)NetOurEther[3] << 16)
-		| ((ulong)NetOurEther[4] << 8)
-		| (ulong)NetOurEther[5];
-	BootpID += get_timer(0);
-	BootpID	 = htonl(BootpID);
+	bootp_new_id();
 	NetCopyLong(&bp->bp_id, &BootpID);
 
 	/*
@@ -686,7 +724,7 @@ BootpRequest(void)
 	iplen = BOOTP_HDR_SIZE - OPT_FIELD_SIZE + extlen;
 	pktlen = eth_hdr_size + IP_UDP_HDR_SIZE + iplen;
 	net_set_udp_header(iphdr, 0xFFFFFFFFL, PORT_BOOTPS, PORT_BOOTPC, iplen);
-	NetSetTimeout(SELECT_TIMEOUT, BootpTimeout);
+	NetSetTimeout(bootp_timeout(SELECT_TIMEOUT), BootpTimeout);
 
 #if defined(CONFIG_CMD_DHCP)
 	dhcp_state = SELECTING;
@@ -817,13 +855,17 @@ static int DhcpMessageType(unsigned char *popt)
 	return -1;
 }
 
-static void DhcpSendRequestPkt(struct Bootp_t *bp_offer)
+/*
+ * Send a DHCPREQUEST for @RequestedIP. @ServerID is the server whose
+ * offer we take, or 0 in the INIT-REBOOT state.
+ */
+static void DhcpSendRequestPkt(ulong *id, IPaddr_t ServerID,
+			       IPaddr_t RequestedIP)
 {
 	uchar *pkt, *iphdr;
 	struct Bootp_t *bp;
 	int pktlen, iplen, extlen;
 	int eth_hdr_size;
-	IPaddr_t OfferedIP;
 
 	debug("DhcpSendRequestPkt: Sending DHCPREQUEST\n");
 	pkt = NetTxPacket;
@@ -856,16 +898,10 @@ static void DhcpSendRequestPkt(struct Bootp_t *bp_offer)
 	 * ID is the id of the OFFER packet
 	 */
 
-	NetCopyLong(&bp->bp_id, &bp_offer->bp_id);
-
-	/*
-	 * Copy options from OFFER packet if present
-	 */
+	NetCopyLong(&bp->bp_id, id);
 
-	/* Copy offered IP into the parameters request list */
-	NetCopyIP(&OfferedIP, &bp_offer->bp_yiaddr);
-	extlen = DhcpExtended((u8 *)bp->bp_vend, DHCP_REQUEST,
-		NetDHCPServerIP, OfferedIP);
+	extlen = DhcpExtended((u8 *)bp->bp_vend, DHCP_REQUEST, ServerID,
+		RequestedIP);
 
 	iplen = BOOTP_HDR_SIZE - OPT_FIELD_SIZE + extlen;
 	pktlen = eth_hdr_size + IP_UDP_HDR_SIZE + iplen;
@@ -878,6 +914,19 @@ static void DhcpSendRequestPkt(struct Bootp_t *bp_offer)
 	NetSendPacket(NetTxPacket, pktlen);
 }
 
+#ifdef CONFIG_DHCP_INIT_REBOOT
+/* Remember the address, so that the next DHCP can ask for it directly */
+static void dhcp_save_lease(void)
+{
+	char tmp[22];
+
+	if (getenv_IPaddr("dhcpleaseip") == NetOurIP)
+		return;
+	ip_to_string(NetOurIP, tmp);
+	setenv("dhcpleaseip", tmp);
+}
+#endif
+
 /*
  *	Handle DHCP received packets.
  */
@@ -886,6 +935,8 @@ DhcpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 	    unsigned len)
 {
 	struct Bootp_t *bp = (struct Bootp_t *)pkt;
+	IPaddr_t OfferedIP;
+	int type;
 
 	debug("DHCPHandler: got packet: (src=%d, dst=%d, len=%d) state: %d\n",
 		src, dest, len, dhcp_state);
@@ -919,8 +970,10 @@ DhcpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 						htonl(BOOTP_VENDOR_MAGIC))
 				DhcpOptionsProcess((u8 *)&bp->bp_vend[4], bp);
 
-			NetSetTimeout(TIMEOUT, BootpTimeout);
-			DhcpSendRequestPkt(bp);
+			NetSetTimeout(bootp_timeout(TIMEOUT), BootpTimeout);
+			NetCopyIP(&OfferedIP, &bp->bp_yiaddr);
+			DhcpSendRequestPkt(&bp->bp_id, NetDHCPServerIP,
+					   OfferedIP);
 #ifdef CONFIG_SYS_BOOTFILE_PREFIX
 		}
 #endif	/* CONFIG_SYS_BOOTFILE_PREFIX */
@@ -928,9 +981,14 @@ DhcpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 		return;
 		break;
 	case REQUESTING:
-		debug("DHCP State: REQUESTING\n");
+#ifdef CONFIG_DHCP_INIT_REBOOT
+	case REBOOTING:
+#endif
+		debug("DHCP State: %s\n",
+		      dhcp_state == REQUESTING ? "REQUESTING" : "REBOOTING");
 
-		if (DhcpMessageType((u8 *)bp->bp_vend) == DHCP_ACK) {
+		type = DhcpMessageType((u8 *)bp->bp_vend);
+		if (type == DHCP_ACK) {
 			if (NetReadLong((ulong *)&bp->bp_vend[0]) ==
 						htonl(BOOTP_VENDOR_MAGIC))
 				DhcpOptionsProcess((u8 *)&bp->bp_vend[4], bp);
@@ -939,11 +997,23 @@ DhcpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			dhcp_state = BOUND;
 			printf("DHCP client bound to address %pI4\n",
 				&NetOurIP);
+#ifdef CONFIG_DHCP_INIT_REBOOT
+			dhcp_save_lease();
+#endif
 			bootstage_mark_name(BOOTSTAGE_ID_BOOTP_STOP,
 				"bootp_stop");
 
 			net_auto_load();
 			return;
+		} else if (type == DHCP_NAK) {
+			/* address refused: start again from DISCOVER */
+			puts("DHCP: request refused\n");
+#ifdef CONFIG_DHCP_INIT_REBOOT
+			if (dhcp_state == REBOOTING)
+				setenv("dhcpleaseip", NULL);
+#endif
+			BootpRequest();
+			return;
 		}
 		break;
 	case BOUND:
@@ -956,8 +1026,48 @@ DhcpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 
 }
 
+#ifdef CONFIG_DHCP_INIT_REBOOT
+static void DhcpRebootTimeout(void);
+
+/*
+ * INIT-REBOOT (RFC 2131 section 3.2): ask for the address we had before
+ * without looking for offers first. A server which knows the lease
+ * answers with an ACK at once.
+ */
+static void DhcpSendRebootRequest(void)
+{
+	printf("DHCP request for %pI4 %d\n", &dhcp_lease_ip,
+	       ++dhcp_reboot_try);
+	dhcp_state = REBOOTING;
+	bootp_new_id();
+	NetSetTimeout(DHCP_REBOOT_TIMEOUT, DhcpRebootTimeout);
+	net_set_udp_handler(DhcpHandler);
+	DhcpSendRequestPkt(&BootpID, 0, dhcp_lease_ip);
+}
+
+static void DhcpRebootTimeout(void)
+{
+	net_stat_inc(NET_STAT_BOOTP_TIMEOUTS);
+	if (dhcp_reboot_try < DHCP_REBOOT_TRIES) {
+		DhcpSendRebootRequest();
+		return;
+	}
+	/* no server knows the lease, so get a new one */
+	BootpRequest();
+}
+#endif
+
 void DhcpRequest(void)
 {
+#ifdef CONFIG_DHCP_INIT_REBOOT
+	dhcp_lease_ip = getenv_IPaddr("dhcpleaseip");
+	if (dhcp_lease_ip) {
+		bootstage_mark_name(BOOTSTAGE_ID_BOOTP_START, "bootp_start");
+		dhcp_reboot_try = 0;
+		DhcpSendRebootRequest();
+		return;
+	}
+#endif
 	BootpRequest();
 }
 #endif	/* CONFIG_CMD_DHCP */
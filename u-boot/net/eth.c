@@ -231,6 +231,9 @@ int eth_register(struct eth_device *dev)
 	dev->state = ETH_STATE_INIT;
 	dev->next  = eth_devices;
 	dev->index = index++;
+#ifdef CONFIG_NET_STATS
+	memset(&dev->stats, 0, sizeof(dev->stats));
+#endif
 
 	return 0;
 }
@@ -435,10 +438,20 @@ void eth_halt(void)
 
 int eth_send(void *packet, int length)
 {
+	int ret;
+
 	if (!eth_current)
 		return -1;
 
-	return eth_current->send(eth_current, packet, length);
+	ret = eth_current->send(eth_current, packet, length);
+	if (ret < 0) {
+		eth_stat_add(eth_current, tx_errors, 1);
+	} else {
+		eth_stat_add(eth_current, tx_packets, 1);
+		eth_stat_add(eth_current, tx_bytes, length);
+	}
+
+	return ret;
 }
 
 int eth_rx(void)
@@ -551,3 +564,57 @@ char *eth_get_name(void)
 {
 	return eth_current ? eth_current->name : "unknown";
 }
+
+#ifdef CONFIG_NET_STATS
+ulong net_stats[NET_STAT_COUNT];
+
+static const char * const net_stat_names[NET_STAT_COUNT] = {
+	[NET_STAT_ARP_REQUESTS]		= "arp requests",
+	[NET_STAT_ARP_TIMEOUTS]		= "arp timeouts",
+	[NET_STAT_BOOTP_TIMEOUTS]	= "bootp timeouts",
+	[NET_STAT_TFTP_TIMEOUTS]	= "tftp timeouts",
+	[NET_STAT_TFTP_DUPS]		= "tftp duplicates",
+	[NET_STAT_NFS_TIMEOUTS]		= "nfs timeouts",
+	[NET_STAT_TCP_RETRANS]		= "tcp retransmits",
+	[NET_STAT_RESTARTS]		= "restarts",
+};
+
+void net_stats_print(void)
+{
+	struct eth_device *dev = eth_devices;
+	struct eth_stats *st;
+	int i;
+
+	if (dev) {
+		do {
+			st = &dev->stats;
+			printf("%s%s:\n", dev->name,
+			       dev == eth_current ? " (active)" : "");
+			printf("  rx: %lu packets, %lu bytes, %lu dropped, "
+			       "%lu errors, %lu bad checksum, %lu fragments "
+			       "dropped\n", st->rx_packets, st->rx_bytes,
+			       st->rx_dropped, st->rx_errors, st->rx_csum,
+			       st->rx_frags);
+			printf("  tx: %lu packets, %lu bytes, %lu errors\n",
+			       st->tx_packets, st->tx_bytes, st->tx_errors);
+			dev = dev->next;
+		} while (dev != eth_devices);
+	}
+
+	for (i = 0; i < NET_STAT_COUNT; i++)
+		printf("%-16s %lu\n", net_stat_names[i], net_stats[i]);
+}
+
+void net_stats_reset(void)
+{
+	struct eth_device *dev = eth_devices;
+
+	if (dev) {
+		do {
+			memset(&dev->stats, 0, sizeof(dev->stats));
+			dev = dev->next;
+		} while (dev != eth_devices);
+	}
+	memset(net_stats, 0, sizeof(net_stats));
+}
+#endif
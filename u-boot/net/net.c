@@ -104,9 +104,21 @@
 #include "sntp.h"
 #endif
 #include "tftp.h"
+#ifdef CONFIG_PROT_TCP
+#include "tcp.h"
+#endif
+#ifdef CONFIG_CMD_WGET
+#include "wget.h"
+#endif
+#ifdef CONFIG_CMD_UDP_FLASH
+#include "udp_flash.h"
+#endif
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Count a received packet against the current device */
+#define rx_stat(field)	eth_stat_add(eth_get_dev(), field, 1)
+
 /** BOOTP EXTENTIONS **/
 
 /* Our subnet mask (0=unknown) */
@@ -281,12 +293,56 @@ static void net_clear_handlers(void)
 {
 	net_set_udp_handler(NULL);
 	net_set_arp_handler(NULL);
+#ifdef CONFIG_PROT_TCP
+	tcp_set_handler(NULL);
+#endif
 	NetSetTimeout(0, NULL);
 }
 
 static void net_cleanup_loop(void)
 {
 	net_clear_handlers();
+	/* drop packets still waiting for ARP */
+	arp_queue_flush();
+}
+
+#ifdef CONFIG_NET_KEEP_LINK
+/*
+ * Leave the device running after a successful transfer, so that the next
+ * command can use it without bringing up the link and resolving the
+ * server again. net_quiesce() halts it before booting an OS or program,
+ * and 'net down' halts it on request.
+ */
+int net_keep_link(void)
+{
+	return getenv_yesno("netkeeplink") != 0;
+}
+
+/* Check whether the device left running by the last NetLoop() is usable */
+static int net_link_is_up(void)
+{
+	struct eth_device *dev = eth_get_dev();
+	const char *act;
+
+	if (!net_keep_link() || !dev || dev->state != ETH_STATE_ACTIVE)
+		return 0;
+
+	/* 'ethact' may have changed since */
+	act = getenv("ethact");
+
+	return !act || !strcmp(act, dev->name);
+}
+#else
+static inline int net_link_is_up(void)
+{
+	return 0;
+}
+#endif
+
+void net_down(void)
+{
+	eth_halt();
+	arp_cache_flush();
 }
 
 void net_init(void)
@@ -331,7 +387,9 @@ int NetLoop(enum proto_t protocol)
 
 	bootstage_mark_name(BOOTSTAGE_ID_ETH_START, "eth_start");
 	net_init();
-	if (eth_is_on_demand_init() || protocol != NETCONS) {
+	if (net_link_is_up()) {
+		debug_cond(DEBUG_INT_STATE, "--- NetLoop link still up\n");
+	} else if (eth_is_on_demand_init() || protocol != NETCONS) {
 		eth_halt();
 		eth_set_current();
 		if (eth_init(bd) < 0) {
@@ -378,6 +436,26 @@ restart:
 			TftpStartServer();
 			break;
 #endif
+#ifdef CONFIG_TFTP_PROBE
+		case TFTPPROBE:
+			tftp_probe_start();
+			break;
+#endif
+#ifdef CONFIG_TFTP_MULTI
+		case TFTPMULTI:
+			tftp_multi_start();
+			break;
+#endif
+#ifdef CONFIG_CMD_WGET
+		case WGET:
+			wget_start();
+			break;
+#endif
+#ifdef CONFIG_CMD_UDP_FLASH
+		case UDPFLASH:
+			udp_flash_start();
+			break;
+#endif
 #if defined(CONFIG_CMD_DHCP)
 		case DHCP:
 			BootpTry = 0;
@@ -535,10 +613,10 @@ restart:
 				setenv_hex("filesize", NetBootFileXferSize);
 				setenv_hex("fileaddr", load_addr);
 			}
-			if (protocol != NETCONS)
-				eth_halt();
-			else
+			if (protocol == NETCONS)
 				eth_halt_state_only();
+			else if (!net_keep_link())
+				eth_halt();
 
 			eth_set_last_protocol(protocol);
 
@@ -581,6 +659,7 @@ void NetStartAgain(void)
 	int retry_forever = 0;
 	unsigned long retrycnt = 0;
 
+	net_stat_inc(NET_STAT_RESTARTS);
 	nretry = getenv("netretry");
 	if (nretry) {
 		if (!strcmp(nretry, "yes"))
@@ -702,6 +781,11 @@ int NetSendUDPPacket(uchar *ether, IPaddr_t dest, int dport, int sport,
 	if (dest == 0xFFFFFFFF)
 		ether = NetBcastAddr;
 
+	/* use an address resolved by an earlier command, if still valid */
+	if (ether != NetEtherNullAddr &&
+	    memcmp(ether, NetEtherNullAddr, 6) == 0)
+		arp_cache_lookup(dest, ether);
+
 	pkt = (uchar *)NetTxPacket;
 
 	eth_hdr_size = NetSetEther(pkt, ether, PROT_IP);
@@ -709,26 +793,37 @@ int NetSendUDPPacket(uchar *ether, IPaddr_t dest, int dport, int sport,
 	net_set_udp_header(pkt, dest, dport, sport, payload_len);
 	pkt_hdr_size = eth_hdr_size + IP_UDP_HDR_SIZE;
 
+	return net_send_ip_packet(ether, dest, pkt_hdr_size + payload_len);
+}
+
+int net_send_ip_packet(uchar *ether, IPaddr_t dest, int len)
+{
 	/* if MAC address was not discovered yet, do an ARP request */
 	if (memcmp(ether, NetEtherNullAddr, 6) == 0) {
 		debug_cond(DEBUG_DEV_PKT, "sending ARP for %pI4\n", &dest);
 
+#ifdef CONFIG_ARP_CACHE
+		/* keep a copy, so that NetTxPacket can be used meanwhile */
+		arp_queue_packet(dest, ether, NetTxPacket, len);
+		return 1;	/* waiting */
+#else
 		/* save the ip and eth addr for the packet to send after arp */
 		NetArpWaitPacketIP = dest;
 		NetArpWaitPacketMAC = ether;
 
 		/* size of the waiting packet */
-		NetArpWaitTxPacketSize = pkt_hdr_size + payload_len;
+		NetArpWaitTxPacketSize = len;
 
 		/* and do the ARP request */
 		NetArpWaitTry = 1;
 		NetArpWaitTimerStart = get_timer(0);
 		ArpRequest();
 		return 1;	/* waiting */
+#endif
 	} else {
-		debug_cond(DEBUG_DEV_PKT, "sending UDP to %pI4/%pM\n",
+		debug_cond(DEBUG_DEV_PKT, "sending IP to %pI4/%pM\n",
 			&dest, ether);
-		NetSendPacket(NetTxPacket, pkt_hdr_size + payload_len);
+		NetSendPacket(NetTxPacket, len);
 		return 0;	/* transmitted */
 	}
 }
@@ -783,8 +878,10 @@ static struct ip_udp_hdr *__NetDefragment(struct ip_udp_hdr *ip, int *lenp)
 	start = offset8 * 8;
 	len = ntohs(ip->ip_len) - IP_HDR_SIZE;
 
-	if (start + len > IP_MAXUDP) /* fragment extends too far */
+	if (start + len > IP_MAXUDP) { /* fragment extends too far */
+		rx_stat(rx_frags);
 		return NULL;
+	}
 
 	if (!total_len || localip->ip_id != ip->ip_id) {
 		/* new (or different) packet, reset structs */
@@ -808,6 +905,7 @@ static struct ip_udp_hdr *__NetDefragment(struct ip_udp_hdr *ip, int *lenp)
 	while (h->last_byte < start) {
 		if (!h->next_hole) {
 			/* no hole that far away */
+			rx_stat(rx_frags);
 			return NULL;
 		}
 		h = payload + h->next_hole;
@@ -816,6 +914,7 @@ static struct ip_udp_hdr *__NetDefragment(struct ip_udp_hdr *ip, int *lenp)
 	/* last fragment may be 1..7 bytes, the "+7" forces acceptance */
 	if (offset8 + ((len + 7) / 8) <= h - payload) {
 		/* no overlap with holes (dup fragment?) */
+		rx_stat(rx_frags);
 		return NULL;
 	}
 
@@ -901,6 +1000,7 @@ static inline struct ip_udp_hdr *NetDefragment(struct ip_udp_hdr *ip, int *lenp)
 	u16 ip_off = ntohs(ip->ip_off);
 	if (!(ip_off & (IP_OFFS | IP_FLAGS_MFRAG)))
 		return ip; /* not a fragment */
+	rx_stat(rx_frags);
 	return NULL;
 }
 #endif
@@ -955,10 +1055,14 @@ NetReceive(uchar *inpkt, int len)
 	NetRxPacket = inpkt;
 	NetRxPacketLen = len;
 	et = (struct ethernet_hdr *)inpkt;
+	rx_stat(rx_packets);
+	eth_stat_add(eth_get_dev(), rx_bytes, len);
 
 	/* too small packet? */
-	if (len < ETHER_HDR_SIZE)
+	if (len < ETHER_HDR_SIZE) {
+		rx_stat(rx_errors);
 		return;
+	}
 
 #ifdef CONFIG_API
 	if (push_packet) {
@@ -1003,16 +1107,20 @@ NetReceive(uchar *inpkt, int len)
 		debug_cond(DEBUG_NET_PKT, "VLAN packet received\n");
 
 		/* too small packet? */
-		if (len < VLAN_ETHER_HDR_SIZE)
+		if (len < VLAN_ETHER_HDR_SIZE) {
+			rx_stat(rx_errors);
 			return;
+		}
 
 		/* if no VLAN active */
 		if ((ntohs(NetOurVLAN) & VLAN_IDMASK) == VLAN_NONE
 #if defined(CONFIG_CMD_CDP)
 				&& iscdp == 0
 #endif
-				)
+				) {
+			rx_stat(rx_dropped);
 			return;
+		}
 
 		cti = ntohs(vet->vet_tag);
 		vlanid = cti & VLAN_IDMASK;
@@ -1035,8 +1143,10 @@ NetReceive(uchar *inpkt, int len)
 		if (vlanid == VLAN_NONE)
 			vlanid = (mynvlanid & VLAN_IDMASK);
 		/* not matched? */
-		if (vlanid != (myvlanid & VLAN_IDMASK))
+		if (vlanid != (myvlanid & VLAN_IDMASK)) {
+			rx_stat(rx_dropped);
 			return;
+		}
 	}
 
 	switch (eth_proto) {
@@ -1056,11 +1166,13 @@ NetReceive(uchar *inpkt, int len)
 		if (len < IP_UDP_HDR_SIZE) {
 			debug("len bad %d < %lu\n", len,
 				(ulong)IP_UDP_HDR_SIZE);
+			rx_stat(rx_errors);
 			return;
 		}
 		/* Check the packet length */
 		if (len < ntohs(ip->ip_len)) {
 			debug("len bad %d < %d\n", len, ntohs(ip->ip_len));
+			rx_stat(rx_errors);
 			return;
 		}
 		len = ntohs(ip->ip_len);
@@ -1068,14 +1180,19 @@ NetReceive(uchar *inpkt, int len)
 			len, ip->ip_hl_v & 0xff);
 
 		/* Can't deal with anything except IPv4 */
-		if ((ip->ip_hl_v & 0xf0) != 0x40)
+		if ((ip->ip_hl_v & 0xf0) != 0x40) {
+			rx_stat(rx_dropped);
 			return;
+		}
 		/* Can't deal with IP options (headers != 20 bytes) */
-		if ((ip->ip_hl_v & 0x0f) > 0x05)
+		if ((ip->ip_hl_v & 0x0f) > 0x05) {
+			rx_stat(rx_dropped);
 			return;
+		}
 		/* Check the Checksum of the header */
 		if (!NetCksumOk((uchar *)ip, IP_HDR_SIZE / 2)) {
 			debug("checksum bad\n");
+			rx_stat(rx_csum);
 			return;
 		}
 		/* If it is not for us, ignore it */
@@ -1084,7 +1201,10 @@ NetReceive(uchar *inpkt, int len)
 #ifdef CONFIG_MCAST_TFTP
 			if (Mcast_addr != dst_ip)
 #endif
+			{
+				rx_stat(rx_dropped);
 				return;
+			}
 		}
 		/* Read source IP address for later use */
 		src_ip = NetReadIP(&ip->ip_src);
@@ -1120,7 +1240,13 @@ NetReceive(uchar *inpkt, int len)
 		if (ip->ip_p == IPPROTO_ICMP) {
 			receive_icmp(ip, len, src_ip, et);
 			return;
+#ifdef CONFIG_PROT_TCP
+		} else if (ip->ip_p == IPPROTO_TCP) {
+			tcp_receive((struct ip_hdr *)ip, len);
+			return;
+#endif
 		} else if (ip->ip_p != IPPROTO_UDP) {	/* Only UDP packets */
+			rx_stat(rx_dropped);
 			return;
 		}
 
@@ -1130,41 +1256,22 @@ NetReceive(uchar *inpkt, int len)
 
 #ifdef CONFIG_UDP_CHECKSUM
 		if (ip->udp_xsum != 0) {
-			ulong   xsum;
-			ushort *sumptr;
-			ushort  sumlen;
-
-			xsum  = ip->ip_p;
-			xsum += (ntohs(ip->udp_len));
-			xsum += (ntohl(ip->ip_src) >> 16) & 0x0000ffff;
-			xsum += (ntohl(ip->ip_src) >>  0) & 0x0000ffff;
-			xsum += (ntohl(ip->ip_dst) >> 16) & 0x0000ffff;
-			xsum += (ntohl(ip->ip_dst) >>  0) & 0x0000ffff;
-
-			sumlen = ntohs(ip->udp_len);
-			sumptr = (ushort *) &(ip->udp_src);
-
-			while (sumlen > 1) {
-				ushort sumdata;
-
-				sumdata = *sumptr++;
-				xsum += ntohs(sumdata);
-				sumlen -= 2;
-			}
-			if (sumlen > 0) {
-				ushort sumdata;
+			int udp_len = ntohs(ip->udp_len);
+			uint xsum;
 
-				sumdata = *(unsigned char *) sumptr;
-				sumdata = (sumdata << 8) & 0xff00;
-				xsum += sumdata;
-			}
-			while ((xsum >> 16) != 0) {
-				xsum = (xsum & 0x0000ffff) +
-				       ((xsum >> 16) & 0x0000ffff);
+			if (udp_len < UDP_HDR_SIZE ||
+			    udp_len > len - IP_HDR_SIZE) {
+				rx_stat(rx_errors);
+				return;
 			}
-			if ((xsum != 0x00000000) && (xsum != 0x0000ffff)) {
-				printf(" UDP wrong checksum %08lx %08x\n",
-					xsum, ntohs(ip->udp_xsum));
+			/* pseudo header: addresses, protocol and UDP length */
+			xsum = net_csum_partial(&ip->ip_src, 8,
+						htons(IPPROTO_UDP) + ip->udp_len);
+			xsum = net_csum_partial(&ip->udp_src, udp_len, xsum);
+			if (net_csum_fold(xsum) != 0xffff) {
+				printf(" UDP wrong checksum %04x\n",
+				       ntohs(ip->udp_xsum));
+				rx_stat(rx_csum);
 				return;
 			}
 		}
@@ -1187,6 +1294,9 @@ NetReceive(uchar *inpkt, int len)
 				ntohs(ip->udp_src),
 				ntohs(ip->udp_len) - UDP_HDR_SIZE);
 		break;
+	default:
+		rx_stat(rx_dropped);
+		break;
 	}
 }
 
@@ -1226,6 +1336,9 @@ static int net_check_prereq(enum proto_t protocol)
 #endif
 	case TFTPGET:
 	case TFTPPUT:
+	case TFTPPROBE:
+	case TFTPMULTI:
+	case WGET:
 		if (NetServerIP == 0) {
 			puts("*** ERROR: `serverip' not set\n");
 			return 1;
@@ -1238,6 +1351,7 @@ common:
 
 	case NETCONS:
 	case TFTPSRV:
+	case UDPFLASH:
 		if (NetOurIP == 0) {
 			puts("*** ERROR: `ipaddr' not set\n");
 			return 1;
@@ -1288,15 +1402,74 @@ NetCksumOk(uchar *ptr, int len)
 unsigned
 NetCksum(uchar *ptr, int len)
 {
-	ulong	xsum;
-	ushort *p = (ushort *)ptr;
-
-	xsum = 0;
-	while (len-- > 0)
-		xsum += *p++;
-	xsum = (xsum & 0xffff) + (xsum >> 16);
-	xsum = (xsum & 0xffff) + (xsum >> 16);
-	return xsum & 0xffff;
+	return net_csum_fold(net_csum_partial(ptr, len * 2, 0));
+}
+
+uint net_csum_partial(const void *buf, int len, uint sum)
+{
+	const uchar *p = buf;
+	u64 acc = 0;
+	ushort w = 0;
+	uint res;
+	int odd = (ulong)p & 1;
+
+	if (len <= 0)
+		return sum;
+
+	/*
+	 * Starting on an odd address, sum the data as if it were shifted by
+	 * a byte and swap the result back at the end.
+	 */
+	if (odd) {
+		((uchar *)&w)[1] = *p++;
+		acc += w;
+		len--;
+	}
+	if (((ulong)p & 2) && len >= 2) {
+		acc += *(const ushort *)p;
+		p += 2;
+		len -= 2;
+	}
+
+	/* 32-bit words into a 64-bit sum: no carries to fold in the loop */
+	while (len >= 16) {
+		const u32 *q = (const u32 *)p;
+
+		acc += q[0];
+		acc += q[1];
+		acc += q[2];
+		acc += q[3];
+		p += 16;
+		len -= 16;
+	}
+	while (len >= 4) {
+		acc += *(const u32 *)p;
+		p += 4;
+		len -= 4;
+	}
+	if (len >= 2) {
+		acc += *(const ushort *)p;
+		p += 2;
+		len -= 2;
+	}
+	if (len) {
+		w = 0;
+		((uchar *)&w)[0] = *p;
+		acc += w;
+	}
+
+	acc = (acc & 0xffffffff) + (acc >> 32);
+	acc = (acc & 0xffffffff) + (acc >> 32);
+	res = net_csum_fold(acc);
+	if (odd)
+		res = ((res >> 8) | (res << 8)) & 0xffff;
+
+	/* add with end-around carry */
+	sum += res;
+	if (sum < res)
+		sum++;
+
+	return sum;
 }
 
 int
@@ -585,6 +585,7 @@ Interfaces of U-BOOT
 static void
 NfsTimeout(void)
 {
+	net_stat_inc(NET_STAT_NFS_TIMEOUTS);
 	if (++NfsTimeoutCount > NFS_RETRY_COUNT) {
 		puts("\nRetry count exceeded; starting again\n");
 		NetStartAgain();
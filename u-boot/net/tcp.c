@@ -0,0 +1,399 @@
+/*
+ * Minimal TCP client
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * Just enough TCP to fetch files over HTTP: one client connection at a
+ * time, in-order delivery only and a single buffer in flight on the send
+ * side. Data is handed to the handler as it arrives, so the receive window
+ * only needs to cover what the driver can buffer between two polls.
+ * Out-of-order segments are dropped and answered with a duplicate ack,
+ * which makes the peer fast-retransmit the missing one.
+ */
+
+#include <common.h>
+#include <net.h>
+#include <asm/unaligned.h>
+#include "arp.h"
+#include "tcp.h"
+
+/* Largest segment we can receive: an ethernet MTU less IP and TCP headers */
+#define TCP_MSS		(1500 - IP_HDR_SIZE - TCP_HDR_SIZE)
+
+/* Receive window, by default what the driver can buffer */
+#ifndef CONFIG_TCP_WINDOW
+#define CONFIG_TCP_WINDOW	(PKTBUFSRX * TCP_MSS)
+#endif
+/* no window scaling */
+#define TCP_WINDOW	min(CONFIG_TCP_WINDOW, 65535)
+
+/* Retransmit timeout in ms, doubled for each retry up to TCP_RTO_MAX */
+#define TCP_RTO_INIT	1000UL
+#define TCP_RTO_MAX	8000UL
+#ifndef CONFIG_NET_RETRY_COUNT
+#define TCP_RETRIES	6
+#else
+#define TCP_RETRIES	(CONFIG_NET_RETRY_COUNT + 1)
+#endif
+
+/* Give up if the peer sends nothing for this long (ms) */
+#ifndef CONFIG_TCP_IDLE_TIMEOUT
+#define CONFIG_TCP_IDLE_TIMEOUT	10000
+#endif
+
+#define seq_before(a, b)	((s32)((a) - (b)) < 0)
+#define seq_after(a, b)		seq_before(b, a)
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_CLOSE_WAIT,		/* peer has closed, we may still send */
+	TCP_FIN_WAIT,		/* we have closed */
+};
+
+static enum tcp_state tcp_state;
+static tcp_handler_f *tcp_handler;
+
+static IPaddr_t tcp_dest;
+static uchar tcp_ether[6];
+static int tcp_dport;
+static int tcp_sport;
+
+static u32 tcp_snd_una;		/* oldest unacknowledged sequence number */
+static u32 tcp_snd_nxt;		/* next sequence number to send */
+static u32 tcp_rcv_nxt;		/* next sequence number expected */
+static uint tcp_snd_mss;
+
+/* The one buffer in flight, resent until acked */
+static uchar tcp_tx_buf[TCP_TX_MAX];
+static int tcp_tx_len;
+static u32 tcp_tx_seq;
+
+static ulong tcp_rto;
+static int tcp_retries;
+static ulong tcp_last_rx;
+
+static ushort tcp_csum(IPaddr_t src, IPaddr_t dst, const uchar *seg, int len)
+{
+	uint sum;
+
+	/* pseudo header; src and dst are in network order like the data */
+	sum = (src & 0xffff) + (src >> 16) + (dst & 0xffff) + (dst >> 16);
+	sum += htons(IPPROTO_TCP) + htons(len);
+
+	return net_csum_fold(net_csum_partial(seg, len, sum));
+}
+
+static int tcp_send_segment(uchar flags, u32 seq, const uchar *data, int len)
+{
+	uchar *pkt = (uchar *)NetTxPacket;
+	struct ip_hdr *ip;
+	struct tcp_hdr *tcp;
+	int eth_hdr_size, hlen;
+
+	/* use an address resolved by an earlier command, if still valid */
+	if (memcmp(tcp_ether, NetEtherNullAddr, 6) == 0)
+		arp_cache_lookup(tcp_dest, tcp_ether);
+
+	eth_hdr_size = NetSetEther(pkt, tcp_ether, PROT_IP);
+	ip = (struct ip_hdr *)(pkt + eth_hdr_size);
+	tcp = (struct tcp_hdr *)((uchar *)ip + IP_HDR_SIZE);
+	hlen = TCP_HDR_SIZE;
+
+	tcp->tcp_src = htons(tcp_sport);
+	tcp->tcp_dst = htons(tcp_dport);
+	put_unaligned_be32(seq, &tcp->tcp_seq);
+	put_unaligned_be32(flags & TCP_ACK ? tcp_rcv_nxt : 0, &tcp->tcp_ack);
+	tcp->tcp_flags = flags;
+	tcp->tcp_win = htons(TCP_WINDOW);
+	tcp->tcp_urg = 0;
+	if (flags & TCP_SYN) {
+		uchar *opt = (uchar *)tcp + hlen;
+
+		/* maximum segment size */
+		opt[0] = 2;
+		opt[1] = 4;
+		opt[2] = TCP_MSS >> 8;
+		opt[3] = TCP_MSS & 0xff;
+		hlen += 4;
+	}
+	tcp->tcp_hlen = (hlen / 4) << 4;
+	if (len)
+		memcpy((uchar *)tcp + hlen, data, len);
+	tcp->tcp_xsum = 0;
+	tcp->tcp_xsum = ~tcp_csum(NetOurIP, tcp_dest, (uchar *)tcp,
+				  hlen + len);
+
+	net_set_ip_header((uchar *)ip, tcp_dest, NetOurIP);
+	ip->ip_len = htons(IP_HDR_SIZE + hlen + len);
+	ip->ip_p = IPPROTO_TCP;
+	ip->ip_sum = 0;
+	ip->ip_sum = ~NetCksum((uchar *)ip, IP_HDR_SIZE >> 1);
+
+	return net_send_ip_packet(tcp_ether, tcp_dest,
+				  eth_hdr_size + IP_HDR_SIZE + hlen + len);
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+}
+
+/* Resend whatever the peer has not acked yet */
+static void tcp_retransmit(void)
+{
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_send_segment(TCP_SYN, tcp_snd_una, NULL, 0);
+		return;
+	}
+	if (tcp_tx_len && seq_before(tcp_snd_una, tcp_tx_seq + tcp_tx_len))
+		tcp_send_segment(TCP_ACK | TCP_PSH, tcp_tx_seq, tcp_tx_buf,
+				 tcp_tx_len);
+	if (tcp_state == TCP_FIN_WAIT && tcp_snd_una != tcp_snd_nxt)
+		tcp_send_segment(TCP_FIN | TCP_ACK, tcp_snd_nxt - 1, NULL, 0);
+}
+
+static void tcp_notify(enum tcp_event ev, const uchar *data, unsigned len)
+{
+	if (tcp_handler)
+		tcp_handler(ev, data, len);
+}
+
+static void tcp_timeout(void)
+{
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	if (tcp_snd_una != tcp_snd_nxt) {
+		if (++tcp_retries > TCP_RETRIES) {
+			tcp_state = TCP_CLOSED;
+			tcp_notify(TCP_EV_TIMEOUT, NULL, 0);
+			return;
+		}
+		tcp_rto = min(tcp_rto * 2, TCP_RTO_MAX);
+		net_stat_inc(NET_STAT_TCP_RETRANS);
+		tcp_retransmit();
+	} else if (get_timer(tcp_last_rx) > CONFIG_TCP_IDLE_TIMEOUT) {
+		tcp_state = TCP_CLOSED;
+		tcp_notify(TCP_EV_TIMEOUT, NULL, 0);
+		return;
+	}
+	NetSetTimeout(tcp_rto, tcp_timeout);
+}
+
+/* (Re)start the timer, e.g. at the start of a NetLoop() */
+static void tcp_start_timer(void)
+{
+	tcp_rto = TCP_RTO_INIT;
+	tcp_retries = 0;
+	tcp_last_rx = get_timer(0);
+	NetSetTimeout(tcp_rto, tcp_timeout);
+}
+
+void tcp_set_handler(tcp_handler_f *f)
+{
+	tcp_handler = f;
+}
+
+void tcp_connect(IPaddr_t dest, int port)
+{
+	if (tcp_state != TCP_CLOSED)
+		tcp_abort();
+
+	tcp_dest = dest;
+	tcp_dport = port;
+	/* a new port each time, so that old segments are not mistaken */
+	if (!tcp_sport)
+		tcp_sport = 1024 + (get_timer(0) % 3072);
+	else
+		tcp_sport = 1024 + (tcp_sport - 1024 + 1) % 3072;
+	memset(tcp_ether, 0, 6);
+
+	tcp_snd_una = get_ticks() ^ (NetOurEther[4] << 24) ^
+		(NetOurEther[5] << 16);
+	tcp_snd_nxt = tcp_snd_una + 1;
+	tcp_rcv_nxt = 0;
+	tcp_snd_mss = TCP_TX_MAX;
+	tcp_tx_len = 0;
+	tcp_state = TCP_SYN_SENT;
+
+	debug("TCP connect %pI4:%d from port %d\n", &dest, port, tcp_sport);
+	tcp_send_segment(TCP_SYN, tcp_snd_una, NULL, 0);
+	tcp_start_timer();
+}
+
+int tcp_connected(IPaddr_t dest, int port)
+{
+	return tcp_state == TCP_ESTABLISHED && tcp_dest == dest &&
+		tcp_dport == port;
+}
+
+int tcp_send(const void *data, int len)
+{
+	if (tcp_state != TCP_ESTABLISHED && tcp_state != TCP_CLOSE_WAIT)
+		return -1;
+	if (tcp_snd_una != tcp_snd_nxt || len > tcp_snd_mss ||
+	    len > TCP_TX_MAX)
+		return -1;
+
+	memcpy(tcp_tx_buf, data, len);
+	tcp_tx_len = len;
+	tcp_tx_seq = tcp_snd_nxt;
+	tcp_snd_nxt += len;
+	tcp_send_segment(TCP_ACK | TCP_PSH, tcp_tx_seq, tcp_tx_buf, len);
+	tcp_start_timer();
+
+	return 0;
+}
+
+void tcp_close(void)
+{
+	if (tcp_state == TCP_ESTABLISHED) {
+		tcp_state = TCP_FIN_WAIT;
+	} else if (tcp_state == TCP_CLOSE_WAIT) {
+		/* nothing more will come, so don't wait for the ack */
+		tcp_state = TCP_CLOSED;
+	} else {
+		return;
+	}
+	tcp_send_segment(TCP_FIN | TCP_ACK, tcp_snd_nxt, NULL, 0);
+	tcp_snd_nxt++;
+}
+
+void tcp_abort(void)
+{
+	if (tcp_state != TCP_CLOSED && tcp_state != TCP_SYN_SENT)
+		tcp_send_segment(TCP_RST | TCP_ACK, tcp_snd_nxt, NULL, 0);
+	tcp_state = TCP_CLOSED;
+}
+
+static void tcp_parse_options(const uchar *opt, int len)
+{
+	while (len > 0) {
+		if (opt[0] == 0)		/* end of list */
+			break;
+		if (opt[0] == 1) {		/* no-op */
+			opt++;
+			len--;
+			continue;
+		}
+		if (len < 2 || opt[1] < 2 || opt[1] > len)
+			break;
+		if (opt[0] == 2 && opt[1] == 4)	/* maximum segment size */
+			tcp_snd_mss = (opt[2] << 8) | opt[3];
+		len -= opt[1];
+		opt += opt[1];
+	}
+}
+
+void tcp_receive(struct ip_hdr *ip, int len)
+{
+	struct tcp_hdr *tcp = (struct tcp_hdr *)((uchar *)ip + IP_HDR_SIZE);
+	IPaddr_t src = NetReadIP(&ip->ip_src);
+	u32 seq, ack;
+	uchar flags;
+	uchar *data;
+	int hlen, seg_len, fin;
+
+	len -= IP_HDR_SIZE;
+	if (len < TCP_HDR_SIZE || !tcp_handler || tcp_state == TCP_CLOSED)
+		return;
+	hlen = (tcp->tcp_hlen >> 4) * 4;
+	if (hlen < TCP_HDR_SIZE || hlen > len)
+		return;
+	if (src != tcp_dest || ntohs(tcp->tcp_src) != tcp_dport ||
+	    ntohs(tcp->tcp_dst) != tcp_sport)
+		return;
+	if (tcp_csum(src, NetReadIP(&ip->ip_dst), (uchar *)tcp, len) !=
+	    0xffff) {
+		debug("TCP bad checksum\n");
+		return;
+	}
+
+	flags = tcp->tcp_flags;
+	seq = get_unaligned_be32(&tcp->tcp_seq);
+	ack = get_unaligned_be32(&tcp->tcp_ack);
+	data = (uchar *)tcp + hlen;
+	seg_len = len - hlen;
+
+	if (tcp_state == TCP_SYN_SENT) {
+		if (!(flags & TCP_ACK) || ack != tcp_snd_nxt)
+			return;
+		if (flags & TCP_RST) {
+			tcp_state = TCP_CLOSED;
+			tcp_notify(TCP_EV_RESET, NULL, 0);
+			return;
+		}
+		if (!(flags & TCP_SYN))
+			return;
+		tcp_parse_options((uchar *)tcp + TCP_HDR_SIZE,
+				  hlen - TCP_HDR_SIZE);
+		tcp_snd_una = ack;
+		tcp_rcv_nxt = seq + 1;
+		tcp_state = TCP_ESTABLISHED;
+		tcp_send_ack();
+		tcp_start_timer();
+		debug("TCP connected, mss %u\n", tcp_snd_mss);
+		tcp_notify(TCP_EV_CONNECTED, NULL, 0);
+		return;
+	}
+
+	if (flags & TCP_RST) {
+		if (seq_before(seq, tcp_rcv_nxt) ||
+		    !seq_before(seq, tcp_rcv_nxt + TCP_WINDOW))
+			return;
+		tcp_state = TCP_CLOSED;
+		tcp_notify(TCP_EV_RESET, NULL, 0);
+		return;
+	}
+	tcp_last_rx = get_timer(0);
+
+	if ((flags & TCP_ACK) && seq_after(ack, tcp_snd_una) &&
+	    !seq_after(ack, tcp_snd_nxt)) {
+		tcp_snd_una = ack;
+		tcp_rto = TCP_RTO_INIT;
+		tcp_retries = 0;
+		if (!seq_before(ack, tcp_tx_seq + tcp_tx_len))
+			tcp_tx_len = 0;
+	}
+
+	/* a repeated SYN-ACK means that our ack got lost */
+	if (flags & TCP_SYN) {
+		tcp_send_ack();
+		return;
+	}
+
+	fin = flags & TCP_FIN;
+	if (!seg_len && !fin)
+		return;
+
+	if (seq != tcp_rcv_nxt) {
+		u32 skip = tcp_rcv_nxt - seq;
+
+		/* a retransmission overlapping what we have, or a gap */
+		if (seq_after(seq, tcp_rcv_nxt) || skip >= seg_len + fin) {
+			tcp_send_ack();
+			return;
+		}
+		data += skip;
+		seg_len -= skip;
+	}
+
+	tcp_rcv_nxt += seg_len + (fin ? 1 : 0);
+	tcp_send_ack();
+
+	if (seg_len) {
+		tcp_notify(TCP_EV_DATA, data, seg_len);
+		/* the handler may have dropped or replaced the connection */
+		if (tcp_state != TCP_ESTABLISHED && tcp_state != TCP_FIN_WAIT)
+			return;
+	}
+	if (fin) {
+		tcp_state = tcp_state == TCP_FIN_WAIT ? TCP_CLOSED :
+			TCP_CLOSE_WAIT;
+		tcp_notify(TCP_EV_CLOSED, NULL, 0);
+	}
+}
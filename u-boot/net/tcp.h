@@ -0,0 +1,120 @@
+/*
+ * Minimal TCP client
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+#include <common.h>
+#include <net.h>
+
+#define IPPROTO_TCP	6
+
+/*
+ *	TCP header (options follow, up to tcp_hlen)
+ */
+struct tcp_hdr {
+	ushort		tcp_src;	/* Source port			*/
+	ushort		tcp_dst;	/* Destination port		*/
+	u32		tcp_seq;	/* Sequence number, unaligned	*/
+	u32		tcp_ack;	/* Ack number, unaligned	*/
+	uchar		tcp_hlen;	/* Header length in words << 4	*/
+	uchar		tcp_flags;
+	ushort		tcp_win;	/* Receive window		*/
+	ushort		tcp_xsum;	/* Checksum			*/
+	ushort		tcp_urg;	/* Urgent pointer		*/
+} __attribute__((packed));
+
+#define TCP_HDR_SIZE	(sizeof(struct tcp_hdr))
+
+#define TCP_FIN		0x01
+#define TCP_SYN		0x02
+#define TCP_RST		0x04
+#define TCP_PSH		0x08
+#define TCP_ACK		0x10
+
+/* Largest buffer tcp_send() takes, the minimum MSS */
+#define TCP_TX_MAX	536
+
+/* Events passed to the handler set with tcp_set_handler() */
+enum tcp_event {
+	TCP_EV_CONNECTED,	/* Connection is established */
+	TCP_EV_DATA,		/* In-order data has arrived */
+	TCP_EV_CLOSED,		/* Peer has sent all its data (FIN) */
+	TCP_EV_RESET,		/* Peer has reset the connection */
+	TCP_EV_TIMEOUT,		/* Peer stopped answering */
+};
+
+/*
+ * Handler for connection events. @data and @len are only used with
+ * TCP_EV_DATA.
+ */
+typedef void tcp_handler_f(enum tcp_event ev, const uchar *data,
+			   unsigned len);
+
+/**
+ * tcp_set_handler() - Set the handler for the connection
+ *
+ * The handler is cleared at the end of each NetLoop(); segments arriving
+ * while no handler is set are dropped, and the peer resends them.
+ *
+ * @f:		Handler to call, or NULL
+ */
+void tcp_set_handler(tcp_handler_f *f);
+
+/**
+ * tcp_connect() - Open a connection, dropping any earlier one
+ *
+ * The handler is called with TCP_EV_CONNECTED once the peer answers.
+ *
+ * @dest:	Server IP address
+ * @port:	Server port
+ */
+void tcp_connect(IPaddr_t dest, int port);
+
+/**
+ * tcp_connected() - Check for an open connection to a server
+ *
+ * This lets a later NetLoop() carry on using the connection set up by an
+ * earlier one, as long as the link was kept up in between.
+ *
+ * @dest:	Server IP address
+ * @port:	Server port
+ * @return 1 if the connection is established, else 0
+ */
+int tcp_connected(IPaddr_t dest, int port);
+
+/**
+ * tcp_send() - Send data on the connection
+ *
+ * Only one buffer can be in flight. It is resent until the peer acks it.
+ *
+ * @data:	Data to send
+ * @len:	Length in bytes, at most TCP_TX_MAX
+ * @return 0 if ok, -1 if not connected, busy or too long
+ */
+int tcp_send(const void *data, int len);
+
+/**
+ * tcp_close() - Close our side of the connection (send FIN)
+ */
+void tcp_close(void);
+
+/**
+ * tcp_abort() - Reset the connection and forget it
+ */
+void tcp_abort(void);
+
+/**
+ * tcp_receive() - Handle a TCP segment from NetReceive()
+ *
+ * @ip:		IP header of the packet (without options)
+ * @len:	Length of the IP packet
+ */
+void tcp_receive(struct ip_hdr *ip, int len);
+
+#endif /* __TCP_H__ */
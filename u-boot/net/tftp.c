@@ -8,6 +8,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <errno.h>
 #include <net.h>
 #include "tftp.h"
 #include "bootp.h"
@@ -62,6 +63,7 @@ enum {
 	TFTP_ERR_UNEXPECTED_OPCODE   = 4,
 	TFTP_ERR_UNKNOWN_TRANSFER_ID  = 5,
 	TFTP_ERR_FILE_ALREADY_EXISTS = 6,
+	TFTP_ERR_BAD_OPTION          = 8,
 };
 
 static IPaddr_t TftpRemoteIP;
@@ -139,6 +141,10 @@ static uchar ProhibitMcast, MasterClient;
 static uchar Multicast;
 static int Mcast_port;
 static ulong TftpEndingBlock; /* can get 'last' block before done..*/
+/* Number of blocks in the file, if the server sent its size */
+static ulong McastBlocks;
+/* Number of different blocks we have */
+static ulong McastBlocksGot;
 
 static void parse_multicast_oack(char *pkt, int len);
 
@@ -152,29 +158,101 @@ mcast_cleanup(void)
 	Bitmap = NULL;
 	Mcast_addr = Multicast = Mcast_port = 0;
 	TftpEndingBlock = -1;
+	McastBlocks = McastBlocksGot = 0;
 }
 
-#endif	/* CONFIG_MCAST_TFTP */
+/*
+ * The bitmap has a bit for each block we have, counting from 0. These
+ * are plain word operations rather than the ext2 bitops, which are
+ * atomic (not needed here) and missing on some architectures.
+ */
+static inline int mcast_test_and_set_block(ulong block)
+{
+	unsigned *word = Bitmap + block / 32;
+	unsigned mask = 1U << (block % 32);
 
-static inline void
-store_block(int block, uchar *src, unsigned len)
+	if (*word & mask)
+		return 1;
+	*word |= mask;
+
+	return 0;
+}
+
+/* Find the first block from @start which we do not have */
+static ulong mcast_next_hole(ulong start)
 {
-	ulong offset = block * TftpBlkSize + TftpBlockWrapOffset;
-	ulong newsize = offset + len;
+	ulong words = Mapsize / sizeof(*Bitmap);
+	ulong i = start / 32;
+	unsigned w;
+
+	if (i >= words)
+		return Mapsize * 8;
+	/* ignore the blocks before start in the first word */
+	w = Bitmap[i] | ((1U << (start % 32)) - 1);
+	while (w == ~0U) {
+		if (++i >= words)
+			return Mapsize * 8;
+		w = Bitmap[i];
+	}
+
+	return i * 32 + ffs(~w) - 1;
+}
+
+/* Tell the server that we have the whole file, when not master client */
+static void mcast_send_done(void)
+{
+	__be16 *s;
+
+	s = (__be16 *)(NetTxPacket + NetEthHdrSize() + IP_UDP_HDR_SIZE);
+	s[0] = htons(TFTP_ACK);
+	s[1] = htons(McastBlocks);
+	NetSendUDPPacket(NetServerEther, TftpRemoteIP, TftpRemotePort,
+			 TftpOurPort, 4);
+}
+
+#endif	/* CONFIG_MCAST_TFTP */
+
 #ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
-	int i, rc = 0;
+/* Check whether a download to @addr goes straight into flash */
+static int tftp_addr_in_flash(ulong addr)
+{
+	int i;
 
 	for (i = 0; i < CONFIG_SYS_MAX_FLASH_BANKS; i++) {
 		/* start address in flash? */
 		if (flash_info[i].flash_id == FLASH_UNKNOWN)
 			continue;
-		if (load_addr + offset >= flash_info[i].start[0]) {
-			rc = 1;
-			break;
-		}
+		if (addr >= flash_info[i].start[0])
+			return 1;
 	}
 
-	if (rc) { /* Flash is destination for this packet */
+	return 0;
+}
+#endif
+
+static inline void
+store_block(int block, uchar *src, unsigned len)
+{
+	ulong offset = block * TftpBlkSize + TftpBlockWrapOffset;
+	ulong newsize = offset + len;
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
+	int rc;
+#endif
+
+#ifdef CONFIG_MCAST_TFTP
+	if (Multicast) {
+		/* too far for the bitmap: the master client finds out */
+		if (block >= Mapsize * 8)
+			return;
+		/* a block resent for another client, which we have */
+		if (mcast_test_and_set_block(block))
+			return;
+		McastBlocksGot++;
+	}
+#endif
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
+	if (tftp_addr_in_flash(load_addr + offset)) {
+		/* Flash is destination for this packet */
 		rc = flash_write((char *)src, (ulong)(load_addr+offset), len);
 		if (rc) {
 			flash_perror(rc);
@@ -186,10 +264,6 @@ store_block(int block, uchar *src, unsigned len)
 	{
 		(void)memcpy((void *)(load_addr + offset), src, len);
 	}
-#ifdef CONFIG_MCAST_TFTP
-	if (Multicast)
-		ext2_set_bit(block, Bitmap);
-#endif
 
 	if (NetBootFileXferSize < newsize)
 		NetBootFileXferSize = newsize;
@@ -361,14 +435,12 @@ TftpSend(void)
 				0, TftpBlkSizeOption, 0);
 #ifdef CONFIG_MCAST_TFTP
 		/* Check all preconditions before even trying the option */
-		if (!ProhibitMcast) {
-			Bitmap = malloc(Mapsize);
-			if (Bitmap && eth_get_dev()->mcast) {
-				free(Bitmap);
-				Bitmap = NULL;
-				pkt += sprintf((char *)pkt, "multicast%c%c",
-					0, 0);
-			}
+		if (!ProhibitMcast && eth_get_dev()->mcast) {
+			pkt += sprintf((char *)pkt, "multicast%c%c", 0, 0);
+#ifndef CONFIG_TFTP_TSIZE
+			/* the size tells us how big a bitmap we need */
+			pkt += sprintf((char *)pkt, "tsize%c0%c", 0, 0);
+#endif
 		}
 #endif /* CONFIG_MCAST_TFTP */
 		len = pkt - xp;
@@ -378,8 +450,7 @@ TftpSend(void)
 #ifdef CONFIG_MCAST_TFTP
 		/* My turn!  Start at where I need blocks I missed.*/
 		if (Multicast)
-			TftpBlock = ext2_find_next_zero_bit(Bitmap,
-							    (Mapsize*8), 0);
+			TftpBlock = mcast_next_hole(0);
 		/*..falling..*/
 #endif
 
@@ -589,6 +660,7 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			/*
 			 *	Same block again; ignore it.
 			 */
+			net_stat_inc(NET_STAT_TFTP_DUPS);
 			break;
 		}
 
@@ -611,10 +683,7 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 				TftpEndingBlock = TftpBlock;
 			} else if (MasterClient) {
 				TftpBlock = PrevBitmapHole =
-					ext2_find_next_zero_bit(
-						Bitmap,
-						(Mapsize*8),
-						PrevBitmapHole);
+					mcast_next_hole(PrevBitmapHole);
 				if (TftpBlock > ((Mapsize*8) - 1)) {
 					printf("tftpfile too big\n");
 					/* try to double it and retry */
@@ -631,7 +700,11 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 
 #ifdef CONFIG_MCAST_TFTP
 		if (Multicast) {
-			if (MasterClient && (TftpBlock >= TftpEndingBlock)) {
+			if ((McastBlocks && McastBlocksGot >= McastBlocks) ||
+			    (MasterClient && (TftpBlock >= TftpEndingBlock))) {
+				/* a master client has acked the end already */
+				if (!MasterClient)
+					mcast_send_done();
 				puts("\nMulticast tftp done\n");
 				mcast_cleanup();
 				net_set_state(NETLOOP_SUCCESS);
@@ -674,6 +747,7 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 static void
 TftpTimeout(void)
 {
+	net_stat_inc(NET_STAT_TFTP_TIMEOUTS);
 	if (++TftpTimeoutCount > TftpTimeoutCountMax) {
 		restart("Retry count exceeded");
 	} else {
@@ -820,6 +894,545 @@ void TftpStart(enum proto_t protocol)
 	TftpSend();
 }
 
+#ifdef CONFIG_TFTP_PROBE
+/*
+ * Probing asks the server for several files at once, each RRQ from its
+ * own port, to find out which exist. As soon as a file is known to exist
+ * its transfer is aborted: the caller fetches the one it wants normally.
+ */
+#ifndef CONFIG_TFTP_PROBE_TIMEOUT
+/* Millisecs to wait for answers before asking again */
+# define PROBE_TIMEOUT		1000UL
+#else
+# define PROBE_TIMEOUT		CONFIG_TFTP_PROBE_TIMEOUT
+#endif
+#define PROBE_TIMEOUT_COUNT	4
+
+static const char * const *probe_names;
+static u8 *probe_result;
+static int probe_count;
+/* Next name to send an RRQ for in this round */
+static int probe_next;
+static int probe_tries;
+/* Our port for the first name; the others follow */
+static int probe_port;
+
+static int tftp_probe_send(int i)
+{
+	uchar *pkt, *xp;
+	__be16 *s;
+
+	pkt = NetTxPacket + NetEthHdrSize() + IP_UDP_HDR_SIZE;
+	xp = pkt;
+	s = (__be16 *)pkt;
+	*s++ = htons(TFTP_RRQ);
+	pkt = (uchar *)s;
+	strcpy((char *)pkt, probe_names[i]);
+	pkt += strlen(probe_names[i]) + 1;
+	strcpy((char *)pkt, "octet");
+	pkt += 5 /*strlen("octet")*/ + 1;
+
+	return NetSendUDPPacket(NetServerEther, TftpRemoteIP, TftpRemotePort,
+				probe_port + i, pkt - xp);
+}
+
+/* Tell the server we do not want the rest of a file */
+static void tftp_probe_abort(int i, int remote_port)
+{
+	uchar *pkt, *xp;
+	__be16 *s;
+
+	pkt = NetTxPacket + NetEthHdrSize() + IP_UDP_HDR_SIZE;
+	xp = pkt;
+	s = (__be16 *)pkt;
+	*s++ = htons(TFTP_ERROR);
+	*s++ = htons(TFTP_ERR_UNDEFINED);
+	pkt = (uchar *)s;
+	strcpy((char *)pkt, "Probe only");
+	pkt += 10 /*strlen("Probe only")*/ + 1;
+
+	NetSendUDPPacket(NetServerEther, TftpRemoteIP, remote_port,
+			 probe_port + i, pkt - xp);
+}
+
+static void tftp_probe_send_all(void)
+{
+	int i;
+
+	while (probe_next < probe_count) {
+		i = probe_next++;
+		if (probe_result[i] != TFTP_PROBE_UNKNOWN)
+			continue;
+		/*
+		 * If we must wait for ARP, send the rest when the server
+		 * first answers
+		 */
+		if (tftp_probe_send(i) > 0)
+			break;
+	}
+}
+
+/* Finish once we know the first file which exists */
+static void tftp_probe_check_done(void)
+{
+	int i;
+
+	for (i = 0; i < probe_count; i++) {
+		if (probe_result[i] == TFTP_PROBE_UNKNOWN)
+			return;
+		if (probe_result[i] == TFTP_PROBE_FOUND)
+			break;
+	}
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+static void tftp_probe_handler(uchar *pkt, unsigned dest, IPaddr_t sip,
+			       unsigned src, unsigned len)
+{
+	__be16 *s = (__be16 *)pkt;
+	int i = dest - probe_port;
+
+	if (i < 0 || i >= probe_count || sip != TftpRemoteIP || len < 4)
+		return;
+
+	switch (ntohs(s[0])) {
+	case TFTP_DATA:
+	case TFTP_OACK:
+		debug("TFTP probe: found '%s'\n", probe_names[i]);
+		probe_result[i] = TFTP_PROBE_FOUND;
+		tftp_probe_abort(i, src);
+		break;
+	case TFTP_ERROR:
+		debug("TFTP probe: '%s': '%s' (%d)\n", probe_names[i],
+		      pkt + 4, ntohs(s[1]));
+		if (ntohs(s[1]) == TFTP_ERR_FILE_NOT_FOUND ||
+		    ntohs(s[1]) == TFTP_ERR_ACCESS_DENIED)
+			probe_result[i] = TFTP_PROBE_MISSING;
+		break;
+	default:
+		return;
+	}
+
+	tftp_probe_send_all();
+	tftp_probe_check_done();
+}
+
+static void tftp_probe_timeout(void)
+{
+	if (++probe_tries >= PROBE_TIMEOUT_COUNT) {
+		/* Settle for what we know */
+		net_set_state(NETLOOP_SUCCESS);
+		return;
+	}
+	puts("T ");
+	probe_next = 0;
+	tftp_probe_send_all();
+	NetSetTimeout(PROBE_TIMEOUT, tftp_probe_timeout);
+}
+
+void tftp_probe_start(void)
+{
+#ifdef CONFIG_TFTP_PORT
+	char *ep;
+#endif
+
+	printf("Using %s device\n", eth_get_name());
+	printf("TFTP probing %d files on server %pI4\n", probe_count,
+	       &NetServerIP);
+
+	TftpRemoteIP = NetServerIP;
+	TftpRemotePort = WELL_KNOWN_PORT;
+#ifdef CONFIG_TFTP_PORT
+	ep = getenv("tftpdstp");
+	if (ep != NULL)
+		TftpRemotePort = simple_strtol(ep, NULL, 10);
+#endif
+	probe_port = 1024 + (get_timer(0) % (3072 - TFTP_PROBE_MAX));
+	probe_next = 0;
+	probe_tries = 0;
+
+	/* zero out server ether in case the server ip has changed */
+	memset(NetServerEther, 0, 6);
+	net_set_udp_handler(tftp_probe_handler);
+	NetSetTimeout(PROBE_TIMEOUT, tftp_probe_timeout);
+
+	tftp_probe_send_all();
+}
+
+int tftp_probe(const char * const names[], int count, u8 *result)
+{
+	int i;
+
+	if (count > TFTP_PROBE_MAX)
+		return -EINVAL;
+	memset(result, TFTP_PROBE_UNKNOWN, count);
+	if (!count)
+		return -ENOENT;
+
+	probe_names = names;
+	probe_result = result;
+	probe_count = count;
+	if (NetLoop(TFTPPROBE) < 0)
+		return -EIO;
+
+	for (i = 0; i < count; i++) {
+		if (result[i] == TFTP_PROBE_FOUND)
+			return i;
+	}
+	for (i = 0; i < count; i++) {
+		if (result[i] == TFTP_PROBE_UNKNOWN)
+			return -ETIMEDOUT;
+	}
+
+	return -ENOENT;
+}
+#endif /* CONFIG_TFTP_PROBE */
+
+#ifdef CONFIG_TFTP_MULTI
+/*
+ * Fetching several files at once: each transfer runs from its own port
+ * with its own block count, so that the round trips of one file overlap
+ * with those of the others. Only plain downloads are supported, to RAM
+ * or, with CONFIG_SYS_DIRECT_FLASH_TFTP, to flash.
+ */
+/* Millisecs between checks for transfers which have stalled */
+#define MULTI_TICK		500UL
+/* Print a hash mark per this many bytes, over all files */
+#define MULTI_HASH_BYTES	(64 << 10)
+
+enum {
+	MULTI_RRQ,		/* waiting for the first answer */
+	MULTI_DATA,
+	MULTI_DONE,
+};
+
+struct tftp_multi_xfer {
+	int state;
+	int sent;		/* RRQ has been sent */
+	int remote_port;
+	ushort blksize;
+	ulong block;		/* blocks received, counting wraps */
+	ulong start;		/* time of the first RRQ */
+	ulong last_rx;		/* time of the last answer or request */
+	ulong time;		/* time taken, once done */
+	int timeouts;
+};
+
+static struct tftp_multi_file *multi_files;
+static struct tftp_multi_xfer multi_xfer[TFTP_MULTI_MAX];
+static int multi_count;
+/* Our port for the first file; the others follow */
+static int multi_port;
+static ulong multi_next_hash;
+static int multi_hashes;
+
+static int tftp_multi_send_rrq(int i)
+{
+	uchar *pkt, *xp;
+	__be16 *s;
+
+	pkt = NetTxPacket + NetEthHdrSize() + IP_UDP_HDR_SIZE;
+	xp = pkt;
+	s = (__be16 *)pkt;
+	*s++ = htons(TFTP_RRQ);
+	pkt = (uchar *)s;
+	pkt += sprintf((char *)pkt, "%s%coctet%ctimeout%c%lu%cblksize%c%d%c",
+		       multi_files[i].name, 0, 0, 0, TIMEOUT / 1000, 0, 0,
+		       TftpBlkSizeOption, 0);
+
+	return NetSendUDPPacket(NetServerEther, TftpRemoteIP, TftpRemotePort,
+				multi_port + i, pkt - xp);
+}
+
+static void tftp_multi_send_ack(int i)
+{
+	__be16 *s;
+
+	s = (__be16 *)(NetTxPacket + NetEthHdrSize() + IP_UDP_HDR_SIZE);
+	s[0] = htons(TFTP_ACK);
+	s[1] = htons((ushort)multi_xfer[i].block);
+
+	NetSendUDPPacket(NetServerEther, TftpRemoteIP,
+			 multi_xfer[i].remote_port, multi_port + i, 4);
+}
+
+/* Refuse the rest of a file, e.g. because of the options in its OACK */
+static void tftp_multi_send_error(int i, int remote_port, int code,
+				  const char *msg)
+{
+	uchar *pkt, *xp;
+	__be16 *s;
+
+	pkt = NetTxPacket + NetEthHdrSize() + IP_UDP_HDR_SIZE;
+	xp = pkt;
+	s = (__be16 *)pkt;
+	*s++ = htons(TFTP_ERROR);
+	*s++ = htons(code);
+	pkt = (uchar *)s;
+	strcpy((char *)pkt, msg);
+	pkt += strlen(msg) + 1;
+
+	NetSendUDPPacket(NetServerEther, TftpRemoteIP, remote_port,
+			 multi_port + i, pkt - xp);
+}
+
+static void tftp_multi_send_pending(void)
+{
+	struct tftp_multi_xfer *x;
+	int i;
+
+	for (i = 0, x = multi_xfer; i < multi_count; i++, x++) {
+		if (x->state != MULTI_RRQ || x->sent)
+			continue;
+		x->sent = 1;
+		x->start = x->last_rx = get_timer(0);
+		/*
+		 * If we must wait for ARP, send the rest when the server
+		 * first answers
+		 */
+		if (tftp_multi_send_rrq(i) > 0)
+			break;
+	}
+}
+
+static void tftp_multi_check_done(void)
+{
+	struct tftp_multi_file *f;
+	struct tftp_multi_xfer *x;
+	int i;
+
+	for (i = 0; i < multi_count; i++) {
+		if (multi_xfer[i].state != MULTI_DONE)
+			return;
+	}
+
+	puts("\ndone\n");
+	for (i = 0; i < multi_count; i++) {
+		f = &multi_files[i];
+		x = &multi_xfer[i];
+		printf("%s: 0x%lx bytes at 0x%lx", f->name, f->size, f->addr);
+		if (x->time > 0) {
+			puts(", ");
+			print_size(f->size / x->time * 1000, "/s");
+		}
+		putc('\n');
+	}
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+static int tftp_multi_store(int i, uchar *src, unsigned len)
+{
+	struct tftp_multi_file *f = &multi_files[i];
+	struct tftp_multi_xfer *x = &multi_xfer[i];
+	ulong addr = f->addr + x->block * x->blksize;
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
+	int rc;
+
+	if (tftp_addr_in_flash(addr)) {
+		rc = flash_write((char *)src, addr, len);
+		if (rc) {
+			flash_perror(rc);
+			net_set_state(NETLOOP_FAIL);
+			return -1;
+		}
+	} else
+#endif
+	{
+		memcpy((void *)addr, src, len);
+	}
+	x->block++;
+	f->size += len;
+	NetBootFileXferSize += len;
+
+	while (NetBootFileXferSize >= multi_next_hash) {
+		putc('#');
+		if (++multi_hashes == HASHES_PER_LINE) {
+			puts("\n\t ");
+			multi_hashes = 0;
+		}
+		multi_next_hash += MULTI_HASH_BYTES;
+	}
+
+	return 0;
+}
+
+/* The block size from an OACK, or 0 if it is one we cannot take */
+static ulong tftp_multi_oack_blksize(uchar *pkt, unsigned len)
+{
+	ulong blksize;
+	unsigned n;
+
+	/* the options are NUL-separated name/value pairs */
+	for (n = 2; n + 8 < len; n++) {
+		if (strcmp((char *)pkt + n, "blksize"))
+			continue;
+		blksize = simple_strtoul((char *)pkt + n + 8, NULL, 10);
+		/* RFC 2348: at least 8, and no more than we asked for */
+		if (blksize < 8 || blksize > TftpBlkSizeOption)
+			return 0;
+		return blksize;
+	}
+
+	return TFTP_BLOCK_SIZE;
+}
+
+static void tftp_multi_handler(uchar *pkt, unsigned dest, IPaddr_t sip,
+			       unsigned src, unsigned len)
+{
+	__be16 *s = (__be16 *)pkt;
+	int i = dest - multi_port;
+	struct tftp_multi_xfer *x;
+	ulong blksize;
+
+	if (i < 0 || i >= multi_count || sip != TftpRemoteIP || len < 4)
+		return;
+	x = &multi_xfer[i];
+	if (x->state == MULTI_DONE ||
+	    (x->state != MULTI_RRQ && src != x->remote_port))
+		return;
+
+	switch (ntohs(s[0])) {
+	case TFTP_OACK:
+		if (x->state == MULTI_RRQ) {
+			x->remote_port = src;
+			blksize = tftp_multi_oack_blksize(pkt, len);
+			if (!blksize) {
+				printf("\nBad block size from server for "
+				       "'%s'\n", multi_files[i].name);
+				tftp_multi_send_error(i, src,
+						      TFTP_ERR_BAD_OPTION,
+						      "Bad blksize");
+				net_set_state(NETLOOP_FAIL);
+				return;
+			}
+			x->blksize = blksize;
+			x->state = MULTI_DATA;
+		}
+		if (!x->block)
+			tftp_multi_send_ack(i);
+		break;
+	case TFTP_DATA:
+		if (x->state == MULTI_RRQ) {
+			/* the server ignored our options */
+			x->remote_port = src;
+			x->blksize = TFTP_BLOCK_SIZE;
+			x->state = MULTI_DATA;
+		}
+		x->last_rx = get_timer(0);
+		x->timeouts = 0;
+		if (ntohs(s[1]) != (ushort)(x->block + 1)) {
+			/* a block we have already: our ack was lost */
+			net_stat_inc(NET_STAT_TFTP_DUPS);
+			tftp_multi_send_ack(i);
+			break;
+		}
+		len = min(len - 4, (unsigned)x->blksize);
+		if (tftp_multi_store(i, pkt + 4, len))
+			return;
+		tftp_multi_send_ack(i);
+		if (len < x->blksize) {
+			x->state = MULTI_DONE;
+			x->time = get_timer(x->start);
+		}
+		break;
+	case TFTP_ERROR:
+		printf("\nTFTP error: '%s' (%d) for '%s'\n", pkt + 4,
+		       ntohs(s[1]), multi_files[i].name);
+		net_set_state(NETLOOP_FAIL);
+		return;
+	default:
+		return;
+	}
+
+	tftp_multi_send_pending();
+	tftp_multi_check_done();
+}
+
+static void tftp_multi_timeout(void)
+{
+	struct tftp_multi_xfer *x;
+	int i;
+
+	for (i = 0, x = multi_xfer; i < multi_count; i++, x++) {
+		if (x->state == MULTI_DONE || !x->sent ||
+		    get_timer(x->last_rx) < TIMEOUT)
+			continue;
+		if (++x->timeouts > TIMEOUT_COUNT) {
+			printf("\nRetry count exceeded for '%s'\n",
+			       multi_files[i].name);
+			net_set_state(NETLOOP_FAIL);
+			return;
+		}
+		puts("T ");
+		net_stat_inc(NET_STAT_TFTP_TIMEOUTS);
+		x->last_rx = get_timer(0);
+		if (x->state == MULTI_RRQ)
+			tftp_multi_send_rrq(i);
+		else
+			tftp_multi_send_ack(i);
+	}
+	tftp_multi_send_pending();
+	NetSetTimeout(MULTI_TICK, tftp_multi_timeout);
+}
+
+void tftp_multi_start(void)
+{
+	int i;
+#ifdef CONFIG_TFTP_PORT
+	char *ep;
+#endif
+
+	printf("Using %s device\n", eth_get_name());
+	printf("TFTP from server %pI4; our IP address is %pI4\n",
+	       &NetServerIP, &NetOurIP);
+	for (i = 0; i < multi_count; i++) {
+		printf("Filename '%s', load address 0x%lx\n",
+		       multi_files[i].name, multi_files[i].addr);
+		multi_files[i].size = 0;
+	}
+	puts("Loading: *\b");
+
+	TftpRemoteIP = NetServerIP;
+	TftpRemotePort = WELL_KNOWN_PORT;
+#ifdef CONFIG_TFTP_PORT
+	ep = getenv("tftpdstp");
+	if (ep != NULL)
+		TftpRemotePort = simple_strtol(ep, NULL, 10);
+#endif
+	multi_port = 1024 + (get_timer(0) % (3072 - TFTP_MULTI_MAX));
+	memset(multi_xfer, 0, sizeof(multi_xfer));
+	multi_next_hash = MULTI_HASH_BYTES;
+	multi_hashes = 0;
+
+	/* zero out server ether in case the server ip has changed */
+	memset(NetServerEther, 0, 6);
+	net_set_udp_handler(tftp_multi_handler);
+	NetSetTimeout(MULTI_TICK, tftp_multi_timeout);
+
+	tftp_multi_send_pending();
+}
+
+int tftp_multi(struct tftp_multi_file *files, int count)
+{
+	struct tftp_multi_file *last;
+
+	if (count < 1 || count > TFTP_MULTI_MAX)
+		return -1;
+
+	multi_files = files;
+	multi_count = count;
+	if (NetLoop(TFTPMULTI) < 0)
+		return -1;
+
+	/* as if the files had been loaded one after the other */
+	last = &files[count - 1];
+	setenv_hex("filesize", last->size);
+	setenv_hex("fileaddr", last->addr);
+
+	return 0;
+}
+#endif /* CONFIG_TFTP_MULTI */
+
 #ifdef CONFIG_CMD_TFTPSRV
 void
 TftpStartServer(void)
@@ -873,8 +1486,13 @@ static void parse_multicast_oack(char *pkt, int len)
 	int i;
 	IPaddr_t addr;
 	char *mc_adr, *port,  *mc;
+	ulong tsize = 0;
 
 	mc_adr = port = mc = NULL;
+	for (i = 0; i + 6 < len; i++) {
+		if (strcmp(pkt + i, "tsize") == 0)
+			tsize = simple_strtoul(pkt + i + 6, NULL, 10);
+	}
 	/* march along looking for 'multicast\0', which has to start at least
 	 * 14 bytes back from the end.
 	 */
@@ -912,6 +1530,25 @@ static void parse_multicast_oack(char *pkt, int len)
 			ProhibitMcast = 1;
 			return ;
 		}
+		/*
+		 * With the size we know how many blocks to expect, and when
+		 * we have them all without waiting to become master client.
+		 * Block numbers are only 16 bits, so the file must fit in
+		 * 65535 blocks (set a larger tftpblocksize if not).
+		 */
+		if (tsize) {
+			McastBlocks = tsize / TftpBlkSize + 1;
+			if (McastBlocks >= TFTP_SEQUENCE_SIZE) {
+				printf("File too big for multicast, "
+				       "revert to TFTP\n");
+				ProhibitMcast = 1;
+				McastBlocks = 0;
+				NetStartAgain();
+				return;
+			}
+			/* one spare bit: the hole after the last block */
+			Mapsize = DIV_ROUND_UP(McastBlocks + 1, 32) * 4;
+		}
 		/* I malloc instead of pre-declare; so that if the file ends
 		 * up being too big for this bitmap I can retry
 		 */
@@ -923,6 +1560,7 @@ static void parse_multicast_oack(char *pkt, int len)
 		}
 		memset(Bitmap, 0, Mapsize);
 		PrevBitmapHole = 0;
+		McastBlocksGot = 0;
 		Multicast = 1;
 	}
 	addr = string_to_ip(mc_adr);
@@ -22,6 +22,14 @@ void TftpStart(enum proto_t protocol);	/* Begin TFTP get/put */
 extern void TftpStartServer(void);	/* Wait for incoming TFTP put */
 #endif
 
+#ifdef CONFIG_TFTP_PROBE
+void tftp_probe_start(void);		/* Begin probing, see tftp_probe() */
+#endif
+
+#ifdef CONFIG_TFTP_MULTI
+void tftp_multi_start(void);		/* Begin fetching, see tftp_multi() */
+#endif
+
 extern ulong TftpRRQTimeoutMSecs;
 extern int TftpRRQTimeoutCountMax;
 
@@ -0,0 +1,66 @@
+/*
+ * Flashing over UDP
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * Carries the packets of common/udp_flash.c over the network. Replies go
+ * to whichever host sent the last packet.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <net.h>
+#include <udp_flash.h>
+#include "udp_flash.h"
+
+static IPaddr_t uf_host_ip;
+static int uf_host_port;
+static uchar uf_host_ether[6];
+
+static void udp_flash_send(const uchar *pkt, unsigned len)
+{
+	uchar *p = (uchar *)NetTxPacket + NetEthHdrSize() + IP_UDP_HDR_SIZE;
+
+	memcpy(p, pkt, len);
+	NetSendUDPPacket(uf_host_ether, uf_host_ip, uf_host_port,
+			 UDP_FLASH_PORT, len);
+}
+
+static void udp_flash_handler(uchar *pkt, unsigned dest, IPaddr_t sip,
+			      unsigned src, unsigned len)
+{
+	if (dest != UDP_FLASH_PORT)
+		return;
+	if (sip != uf_host_ip) {
+		uf_host_ip = sip;
+		memset(uf_host_ether, 0, sizeof(uf_host_ether));
+	}
+	uf_host_port = src;
+
+	switch (udp_flash_packet(pkt, len)) {
+	case 1:
+		net_set_state(NETLOOP_SUCCESS);
+		break;
+	case 2:
+		puts("Resetting...\n");
+		do_reset(NULL, 0, 0, NULL);
+		break;
+	}
+}
+
+void udp_flash_start(void)
+{
+	if (udp_flash_init(udp_flash_send)) {
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	uf_host_ip = 0;
+	printf("Using %s device\n", eth_get_name());
+	printf("Waiting for udpflash on %pI4 port %d; Ctrl-C to stop\n",
+	       &NetOurIP, UDP_FLASH_PORT);
+
+	NetSetTimeout(0, NULL);
+	net_set_udp_handler(udp_flash_handler);
+}
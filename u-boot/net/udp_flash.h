@@ -0,0 +1,15 @@
+/*
+ * Flashing over UDP
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __NET_UDP_FLASH_H__
+#define __NET_UDP_FLASH_H__
+
+/* Wait for the host tool on UDP_FLASH_PORT (beginning of netloop) */
+void udp_flash_start(void);
+
+#endif /* __NET_UDP_FLASH_H__ */
@@ -0,0 +1,370 @@
+/*
+ * HTTP client
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * Fetches a file with an HTTP/1.1 GET over the TCP client in tcp.c. A
+ * transfer which breaks off is resumed with a Range request. If the link
+ * is kept up between commands (see net_keep_link()), so is the connection
+ * and the next wget to the same server skips the TCP handshake.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <net.h>
+#include <linux/ctype.h>
+#include <asm/io.h>
+#include "tcp.h"
+#include "wget.h"
+
+#define HTTP_PORT		80
+/* Number of "loading" hashes per line */
+#define HASHES_PER_LINE		65
+/* Bytes per hash */
+#define HASH_BYTES		(64 << 10)
+/* Longest response header we accept */
+#define WGET_HDR_MAX		1024
+#ifndef CONFIG_NET_RETRY_COUNT
+#define WGET_RETRIES		5
+#else
+#define WGET_RETRIES		CONFIG_NET_RETRY_COUNT
+#endif
+
+enum wget_state {
+	WGET_CONNECTING,
+	WGET_HEADERS,
+	WGET_BODY,
+	WGET_DONE,
+};
+
+static enum wget_state wget_state;
+static IPaddr_t wget_server;
+static int wget_port;
+static char wget_path[sizeof(BootFile) + 1];
+
+static ulong wget_offset;	/* bytes of the file stored so far */
+static ulong wget_size;		/* size of the file, if wget_size_known */
+static int wget_size_known;
+static int wget_keep;		/* server keeps the connection open */
+static int wget_idle;		/* connection is open with nothing pending */
+static int wget_reused;		/* request went on an existing connection */
+static int wget_retries;
+
+static char wget_hdr[WGET_HDR_MAX + 1];
+static int wget_hdr_len;
+
+static ulong wget_next_hash;
+static int wget_hashes;
+static ulong time_start;
+
+static void wget_fail(const char *msg)
+{
+	printf("\n%s\n", msg);
+	tcp_abort();
+	wget_state = WGET_DONE;
+	net_set_state(NETLOOP_FAIL);
+}
+
+static void wget_done(void)
+{
+	time_start = get_timer(time_start);
+	if (time_start > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(NetBootFileXferSize / time_start * 1000, "/s");
+	}
+	puts("\ndone\n");
+
+	if (wget_keep && net_keep_link())
+		wget_idle = 1;
+	else
+		tcp_close();
+	wget_state = WGET_DONE;
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+static void wget_connect(void)
+{
+	wget_state = WGET_CONNECTING;
+	wget_reused = 0;
+	tcp_connect(wget_server, wget_port);
+}
+
+/* The connection broke: try again, carrying on where it stopped */
+static void wget_retry(const char *why)
+{
+	if (wget_state == WGET_DONE)
+		return;
+
+	tcp_abort();
+	/* the server may have closed an old connection meanwhile */
+	if (wget_reused && wget_state == WGET_HEADERS && !wget_hdr_len) {
+		debug("wget: kept connection is gone, reconnecting\n");
+		wget_connect();
+		return;
+	}
+	if (++wget_retries > WGET_RETRIES) {
+		wget_fail(why);
+		return;
+	}
+	printf("\n%s, ", why);
+	if (wget_offset)
+		printf("resuming at %lu\n\t ", wget_offset);
+	else
+		puts("retrying\n\t ");
+	wget_hashes = 0;
+	wget_connect();
+}
+
+static void wget_send_request(void)
+{
+	/* the path is limited by BootFile, so this fits in TCP_TX_MAX */
+	char req[TCP_TX_MAX];
+	char *p = req;
+
+	p += sprintf(p, "GET %s HTTP/1.1\r\nHost: %pI4\r\n"
+		     "User-Agent: U-Boot\r\n", wget_path, &wget_server);
+	if (wget_offset)
+		p += sprintf(p, "Range: bytes=%lu-\r\n", wget_offset);
+	if (!net_keep_link())
+		p += sprintf(p, "Connection: close\r\n");
+	p += sprintf(p, "\r\n");
+
+	wget_state = WGET_HEADERS;
+	wget_hdr_len = 0;
+	if (!tcp_send(req, p - req))
+		return;
+	/* a kept connection may be closing; a new one only fails on the MSS */
+	if (wget_reused)
+		wget_retry("Connection closed");
+	else
+		wget_fail("HTTP request too long for the server");
+}
+
+static void wget_store(const uchar *data, unsigned len)
+{
+	void *buf;
+
+	if (wget_size_known && len > wget_size - wget_offset)
+		len = wget_size - wget_offset;
+	buf = map_sysmem(load_addr + wget_offset, len);
+	memcpy(buf, data, len);
+	unmap_sysmem(buf);
+	wget_offset += len;
+	NetBootFileXferSize = wget_offset;
+
+	while (wget_offset >= wget_next_hash) {
+		putc('#');
+		if (++wget_hashes == HASHES_PER_LINE) {
+			puts("\n\t ");
+			wget_hashes = 0;
+		}
+		wget_next_hash += HASH_BYTES;
+	}
+
+	if (wget_size_known && wget_offset == wget_size)
+		wget_done();
+}
+
+static const char *wget_header_value(const char *line, const char *name)
+{
+	int len = strlen(name);
+
+	if (strncasecmp(line, name, len) || line[len] != ':')
+		return NULL;
+	for (line += len + 1; *line == ' ' || *line == '\t'; line++)
+		;
+
+	return line;
+}
+
+/* Check the status and headers; returns 0 if the body can follow */
+static int wget_parse_headers(char *hdr)
+{
+	const char *val;
+	char *line, *next;
+	char msg[20];
+	ulong length = 0, range_start = 0;
+	int have_length = 0;
+	int status;
+
+	if (strncmp(hdr, "HTTP/1.", 7) || !isdigit(hdr[9])) {
+		wget_fail("Bad HTTP response");
+		return -1;
+	}
+	/* HTTP/1.1 connections are persistent unless the server says not */
+	wget_keep = hdr[7] != '0';
+	status = simple_strtoul(hdr + 9, NULL, 10);
+
+	for (line = strstr(hdr, "\r\n"); line; line = next) {
+		line += 2;
+		next = strstr(line, "\r\n");
+		if (next)
+			*next = '\0';
+
+		val = wget_header_value(line, "Content-Length");
+		if (val) {
+			length = simple_strtoul(val, NULL, 10);
+			have_length = 1;
+		}
+
+		val = wget_header_value(line, "Content-Range");
+		if (val && !strncasecmp(val, "bytes ", 6))
+			range_start = simple_strtoul(val + 6, NULL, 10);
+
+		val = wget_header_value(line, "Connection");
+		if (val) {
+			if (!strncasecmp(val, "close", 5))
+				wget_keep = 0;
+			else if (!strncasecmp(val, "keep-alive", 10))
+				wget_keep = 1;
+		}
+
+		val = wget_header_value(line, "Transfer-Encoding");
+		if (val && strncasecmp(val, "identity", 8)) {
+			wget_fail("Transfer encoding not supported");
+			return -1;
+		}
+	}
+
+	switch (status) {
+	case 200:
+		if (wget_offset) {
+			puts("\nNo range support, restarting\n\t ");
+			wget_offset = 0;
+			wget_next_hash = HASH_BYTES;
+			wget_hashes = 0;
+		}
+		break;
+	case 206:
+		if (range_start == wget_offset)
+			break;
+		/* Fall through */
+	default:
+		sprintf(msg, "HTTP error %d", status);
+		wget_fail(msg);
+		return -1;
+	}
+
+	wget_size_known = have_length;
+	wget_size = wget_offset + length;
+
+	return 0;
+}
+
+static void wget_headers(const uchar *data, unsigned len)
+{
+	unsigned n, used;
+	char *end;
+
+	n = min(len, (unsigned)(WGET_HDR_MAX - wget_hdr_len));
+	memcpy(wget_hdr + wget_hdr_len, data, n);
+	wget_hdr_len += n;
+	wget_hdr[wget_hdr_len] = '\0';
+
+	end = strstr(wget_hdr, "\r\n\r\n");
+	if (!end) {
+		if (wget_hdr_len == WGET_HDR_MAX)
+			wget_fail("HTTP header too long");
+		return;
+	}
+	/* how much of this segment was header */
+	used = end + 4 - wget_hdr - (wget_hdr_len - n);
+	end[2] = '\0';
+	if (wget_parse_headers(wget_hdr))
+		return;
+
+	wget_state = WGET_BODY;
+	if (len > used)
+		wget_store(data + used, len - used);
+	else if (wget_size_known && wget_offset == wget_size)
+		wget_done();
+}
+
+static void wget_handler(enum tcp_event ev, const uchar *data, unsigned len)
+{
+	if (wget_state == WGET_DONE)
+		return;
+
+	switch (ev) {
+	case TCP_EV_CONNECTED:
+		wget_send_request();
+		break;
+	case TCP_EV_DATA:
+		/* something arrived, so the server is there */
+		wget_retries = 0;
+		if (wget_state == WGET_HEADERS)
+			wget_headers(data, len);
+		else if (wget_state == WGET_BODY)
+			wget_store(data, len);
+		break;
+	case TCP_EV_CLOSED:
+		tcp_close();
+		/* without a length, the end of the connection ends the file */
+		if (wget_state == WGET_BODY && !wget_size_known) {
+			wget_keep = 0;
+			wget_done();
+		} else {
+			wget_retry("Connection closed");
+		}
+		break;
+	case TCP_EV_RESET:
+		wget_retry("Connection reset");
+		break;
+	case TCP_EV_TIMEOUT:
+		wget_retry("Timeout");
+		break;
+	}
+}
+
+void wget_start(void)
+{
+	char *s, *name = BootFile;
+	int reuse;
+
+	s = strchr(BootFile, ':');
+	if (s) {
+		*s = '\0';
+		wget_server = string_to_ip(BootFile);
+		*s = ':';
+		name = s + 1;
+	} else {
+		wget_server = NetServerIP;
+	}
+	if (!*name) {
+		puts("*** ERROR: no file name given\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	sprintf(wget_path, "%s%s", *name == '/' ? "" : "/", name);
+
+	s = getenv("httpdstp");
+	wget_port = s ? simple_strtoul(s, NULL, 10) : HTTP_PORT;
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4:%d; our IP address is %pI4\n",
+	       &wget_server, wget_port, &NetOurIP);
+	printf("Filename '%s'.\n", wget_path);
+	printf("Load address: 0x%lx\n", load_addr);
+	puts("Loading: *\b");
+
+	wget_offset = 0;
+	wget_size = 0;
+	wget_size_known = 0;
+	wget_retries = 0;
+	wget_next_hash = HASH_BYTES;
+	wget_hashes = 0;
+	time_start = get_timer(0);
+
+	reuse = wget_idle && tcp_connected(wget_server, wget_port);
+	wget_idle = 0;
+	tcp_set_handler(wget_handler);
+	if (reuse) {
+		debug("wget: using the kept connection\n");
+		wget_reused = 1;
+		wget_send_request();
+	} else {
+		wget_connect();
+	}
+}
@@ -0,0 +1,18 @@
+/*
+ * HTTP client
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __WGET_H__
+#define __WGET_H__
+
+/*
+ * Fetch BootFile ([server:]path) over HTTP to load_addr (beginning of
+ * netloop)
+ */
+void wget_start(void);
+
+#endif /* __WGET_H__ */
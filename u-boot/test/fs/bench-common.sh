@@ -0,0 +1,52 @@
+# Copyright (c) 2013
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+
+# Helpers for the filesystem benchmarks in this directory, which source
+# this file. They run from the top of the source tree and keep a disk
+# image in ${img}, sandbox output in ${tmp} and, if needed, a tree of
+# files in ${dir}.
+
+OUTPUT_DIR=sandbox
+
+fail() {
+	echo "Test failed: $1"
+	remove_scratch
+	exit 1
+}
+
+make_scratch() {
+	img="$(mktemp)"
+	tmp="$(mktemp)"
+	dir="$(mktemp -d)"
+}
+
+remove_scratch() {
+	rm -rf ${img} ${tmp} ${dir}
+}
+
+build_uboot() {
+	echo "Build sandbox"
+	OPTS="O=${OUTPUT_DIR}"
+	NUM_CPUS=$(grep -c processor /proc/cpuinfo)
+	make ${OPTS} sandbox_config
+	make ${OPTS} -s -j${NUM_CPUS}
+}
+
+# Run the commands on stdin with ${img} bound as 'hostfile 0'
+run_sandbox() {
+	(
+	echo "sb bind 0 ${img}"
+	cat
+	echo "reset"
+	) | ./${OUTPUT_DIR}/u-boot
+}
+
+# check_timed <command> <count>
+# Check that sandbox timed <count> runs of <command>
+check_timed() {
+	if [ $(grep -c "^time:" ${tmp}) -ne $2 ]; then
+		fail "$1 did not run"
+	fi
+}
@@ -0,0 +1,64 @@
+#!/bin/sh
+#
+# Copyright (c) 2013
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+
+# Time ext4write against filesystems of growing size, using sandbox with
+# host files as block devices. Block group bitmaps are loaded as groups
+# are touched, so the time for a small write should hardly depend on the
+# size of the filesystem. The host's page cache makes the times small,
+# so the blocks read and written ('sb info') are shown too. Needs
+# mkfs.ext4 and room for sparse files.
+
+SIZES="64M 1G 8G 32G"
+WRITES=4
+
+. $(dirname "$0")/bench-common.sh
+
+make_fs() {
+	rm -f ${img}
+	truncate -s $1 ${img} || fail "cannot create ${img}"
+	mkfs.ext4 -q -F -O ^metadata_csum,^64bit ${img} ||
+		fail "mkfs.ext4 failed"
+}
+
+# The commands for sandbox
+write_cmds() {
+	echo "mw.b 1000000 5a 10000"
+	i=0
+	while [ ${i} -lt ${WRITES} ]; do
+		echo "sb info"
+		echo "time ext4write hostfile 0 1000000 /file${i} 65536"
+		i=$((i + 1))
+	done
+	echo "sb info"
+	echo "ext4ls hostfile 0 /"
+}
+
+check_results() {
+	check_timed ext4write ${WRITES}
+	if [ $(grep -c " file[0-9]" ${tmp}) -ne ${WRITES} ]; then
+		fail "files missing after ext4write"
+	fi
+	if ! e2fsck -fn ${img} >/dev/null 2>&1; then
+		fail "e2fsck found errors at size $1"
+	fi
+}
+
+echo "ext4write latency against filesystem size, using sandbox"
+echo
+make_scratch
+build_uboot
+for size in ${SIZES}; do
+	make_fs ${size}
+	write_cmds | run_sandbox >${tmp}
+	check_results ${size}
+	printf "%6s:" ${size}
+	awk '/^time:/ { printf " %ss", $2 }
+		/^hostfile 0:/ && n++ { printf " (%s/%s)", $6, $8 }' ${tmp}
+	echo " (blocks read/written)"
+done
+remove_scratch
+echo "Test passed"
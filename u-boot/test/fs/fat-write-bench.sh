@@ -0,0 +1,91 @@
+#!/bin/sh
+#
+# Copyright (c) 2013
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+
+# Time fatwrite against file size and how full the filesystem is, using
+# sandbox with a host file as block device. Each filesystem is filled
+# with files of FILL_SIZE, with holes of HOLE_SIZE left between them, so
+# that the free space is scattered the way it is on a well-used card.
+# The host's page cache makes the times small, so the blocks read and
+# written ('sb info') are shown too. Needs mkfs.vfat, mtools and
+# fsck.vfat.
+
+FS_SIZE=1G
+FILLS="0 50 90 98"
+SIZES="64K 1M 16M"
+FILL_SIZE=1048576
+HOLE_SIZE=16384
+
+. $(dirname "$0")/bench-common.sh
+
+# make_fs <percent full>
+make_fs() {
+	rm -f ${img}
+	truncate -s ${FS_SIZE} ${img} || fail "cannot create ${img}"
+	mkfs.vfat -F 32 -s 1 ${img} >/dev/null || fail "mkfs.vfat failed"
+
+	rm -rf ${dir}
+	mkdir ${dir}
+	count=$(($(stat -c %s ${img}) / 100 * $1 / (FILL_SIZE + HOLE_SIZE)))
+	[ ${count} -gt 0 ] || return 0
+	head -c ${FILL_SIZE} /dev/zero >${dir}/fill
+	head -c ${HOLE_SIZE} /dev/zero >${dir}/hole
+	# Copied in this order, each hole sits between two files
+	files=
+	i=0
+	while [ ${i} -lt ${count} ]; do
+		ln ${dir}/fill ${dir}/f${i}
+		ln ${dir}/hole ${dir}/h${i}
+		files="${files} ${dir}/f${i} ${dir}/h${i}"
+		i=$((i + 1))
+	done
+	mcopy -i ${img} ${files} ::/ || fail "mcopy failed"
+	mdel -i ${img} '::/h*' || fail "mdel failed"
+}
+
+# The commands for sandbox
+write_cmds() {
+	for size in ${SIZES}; do
+		echo "sb info"
+		echo "time fatwrite hostfile 0 1000000 w${size} $(printf %x \
+			$(numfmt --from=iec ${size}))"
+	done
+	echo "sb info"
+}
+
+check_results() {
+	check_timed fatwrite $(echo ${SIZES} | wc -w)
+	if [ $(grep -c "bytes written" ${tmp}) -ne \
+	     $(echo ${SIZES} | wc -w) ]; then
+		fail "fatwrite failed at $1% full"
+	fi
+	if ! fsck.vfat -n ${img} >/dev/null 2>&1; then
+		fail "fsck.vfat found errors at $1% full"
+	fi
+}
+
+echo "fatwrite latency against file size and fill level, using sandbox"
+echo
+make_scratch
+build_uboot
+printf "%5s" "full"
+for size in ${SIZES}; do
+	printf "%22s" ${size}
+done
+echo
+for fill in ${FILLS}; do
+	make_fs ${fill}
+	write_cmds | run_sandbox >${tmp}
+	check_results ${fill}
+	printf "%4s%%" ${fill}
+	awk '/^time:/ { t = $2 }
+		/^hostfile 0:/ && n++ {
+			printf "%22s", sprintf("%ss (%s/%s)", t, $6, $8) }' ${tmp}
+	echo
+done
+echo "(seconds, blocks read/written)"
+remove_scratch
+echo "Test passed"
@@ -0,0 +1,94 @@
+#!/bin/sh
+#
+# Copyright (c) 2013
+#
+# SquashFS read benchmark
+#
+# SPDX-License-Identifier:	GPL-2.0+
+
+# Builds sandbox, packs the same tree with each compressor in COMPRESSORS
+# and loads two files from every image with sqfsload: a KERNEL_SIZE image
+# made from copies of u-boot, and SMALL_FILE, which sits in a fragment
+# block. The tree is also put on ext4 and loaded with ext4load for
+# comparison. Run it from the top of the source tree; mksquashfs must have
+# been built with LZO and LZMA support, and mkfs.ext4 must support -d.
+#
+# Each column gives the load time and, in brackets, the number of blocks
+# sandbox read from the image file. Under each compressor come the
+# metadata and block cache counts from sqfsinfo.
+
+COMPRESSORS="gzip lzo lzma"
+KERNEL_SIZE=8388608
+SMALL_FILE=include/common.h
+
+. $(dirname "$0")/bench-common.sh
+
+make_tree() {
+	rm -rf ${dir}
+	mkdir -p ${dir}/boot
+	while [ $(stat -c %s ${dir}/boot/Image 2>/dev/null || echo 0) -lt \
+			${KERNEL_SIZE} ]; do
+		cat ./${OUTPUT_DIR}/u-boot >>${dir}/boot/Image
+	done
+	truncate -s ${KERNEL_SIZE} ${dir}/boot/Image
+	cp -r include ${dir}/
+}
+
+# load_cmds <load command>
+# The commands for sandbox
+load_cmds() {
+	for file in boot/Image ${SMALL_FILE}; do
+		echo "sb info"
+		echo "time $1 hostfile 0 1000000 /${file}"
+		echo "sb info"
+		echo "sb load host 0 4000000 ${dir}/${file}"
+		echo "cmp.b 1000000 4000000 \$filesize"
+	done
+	if [ "$1" = "sqfsload" ]; then
+		echo "sqfsinfo hostfile 0"
+	fi
+}
+
+check_results() {
+	check_timed $1 2
+	if grep -q "!=" ${tmp} || [ $(grep -c "were the same" ${tmp}) -ne 2 ]
+	then
+		fail "$1 read the wrong data"
+	fi
+}
+
+# show_results <name>
+show_results() {
+	printf "%-6s%10s" $1 $(stat -c %s ${img})
+	awk '/^time:/ { t = $2 }
+		/^hostfile 0:/ && n++ % 2 {
+			printf "%22s", sprintf("%ss (%s)", t, $6) }' ${tmp}
+	echo
+	grep "cache:" ${tmp} | sed 's/^/      /'
+}
+
+echo "SquashFS load times against compressor, using sandbox"
+echo
+make_scratch
+build_uboot
+make_tree
+printf "%-6s%10s%22s%22s\n" "" "bytes" "$(basename boot/Image)" \
+	"$(basename ${SMALL_FILE})"
+for comp in ${COMPRESSORS}; do
+	rm -f ${img}
+	mksquashfs ${dir} ${img} -comp ${comp} -noappend -quiet >/dev/null ||
+		fail "mksquashfs -comp ${comp} failed"
+	load_cmds sqfsload | run_sandbox >${tmp}
+	check_results sqfsload
+	show_results ${comp}
+done
+rm -f ${img}
+# Without the features U-Boot's ext4 cannot read
+mkfs.ext4 -q -F -O ^metadata_csum,^64bit -d ${dir} ${img} \
+	$(($(du -sk ${dir} | cut -f1) * 2))k >/dev/null || fail "mkfs.ext4 failed"
+load_cmds ext4load | run_sandbox >${tmp}
+check_results ext4load
+show_results ext4
+echo "(seconds, blocks read)"
+remove_scratch
+echo "Test passed"
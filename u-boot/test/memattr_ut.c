@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#define DEBUG
+
+#include <common.h>
+#include <command.h>
+#include <memattr.h>
+
+#define MB	(1UL << 20)
+
+static int check_table(const struct mem_attr_map *map, ulong base,
+		       int count, const char *expect)
+{
+	u8 table[16];
+	int i;
+
+	mem_attr_build_table(map, base, 20, count, table);
+	for (i = 0; i < count; i++) {
+		if (table[i] != expect[i] - '0') {
+			printf("block %d: got %s, expected %s\n", i,
+			       mem_attr_name(table[i]),
+			       mem_attr_name(expect[i] - '0'));
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int do_ut_memattr(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char * const argv[])
+{
+	struct mem_attr_map map, *cur;
+	int i;
+
+	printf("%s: Testing memory attribute map\n", __func__);
+
+	/* names */
+	for (i = 0; i < MEM_ATTR_COUNT; i++)
+		assert(mem_attr_lookup(mem_attr_name(i)) == i);
+	assert(mem_attr_lookup("wc,") == MEM_ATTR_WRITECOMBINE);
+	assert(mem_attr_lookup("w") == -1);
+	assert(mem_attr_lookup("wbx") == -1);
+
+	/* parsing */
+	map.def_attr = MEM_ATTR_WRITEBACK;
+	map.count = 0;
+	assert(!mem_attr_parse("80200000:1M:wc, 0x80400000:0x200000:off", &map,
+			       0));
+	assert(map.count == 2);
+	assert(map.region[0].start == 0x80200000);
+	assert(map.region[0].size == MB);
+	assert(map.region[0].attr == MEM_ATTR_WRITECOMBINE);
+	assert(map.region[1].start == 0x80400000);
+	assert(map.region[1].size == 2 * MB);
+	assert(map.region[1].attr == MEM_ATTR_OFF);
+
+	map.count = 0;
+	assert(!mem_attr_parse("82000000:16M:wc,90000000:2MiB:wt", &map, 0));
+	assert(map.region[0].size == 16 * MB);
+	assert(map.region[1].size == 2 * MB);
+	assert(!mem_attr_parse("0:1048576:wt", &map, 0));
+	assert(map.region[2].size == MB);
+
+	assert(mem_attr_parse("80000000:1M", &map, 0));
+	assert(mem_attr_parse("80000000:1M:xx", &map, 0));
+	assert(mem_attr_parse("80000000", &map, 0));
+
+	map.count = 0;
+	for (i = 0; i < CONFIG_MEM_ATTR_MAX_REGIONS; i++)
+		assert(!mem_attr_parse("0:1:wt", &map, 0));
+	assert(mem_attr_parse("0:1:wt", &map, 0));
+
+	/* one digit per block: default, clipping, rounding, precedence */
+	map.count = 0;
+	assert(!check_table(&map, 0x80000000, 4, "2222"));
+	assert(!mem_attr_parse("80100000:1024K:wc 80280000:0x200000:off", &map, 0));
+	assert(!check_table(&map, 0x80000000, 6, "232022"));
+	assert(!mem_attr_parse("80000000:2M:wt", &map, 0));
+	assert(!check_table(&map, 0x80000000, 4, "1120"));
+	assert(!check_table(&map, 0x80300000, 2, "02"));
+	assert(!check_table(&map, 0x7ff00000, 2, "21"));
+
+	/*
+	 * A page-aligned framebuffer just below U-Boot at the top of RAM:
+	 * the sections shared with U-Boot must keep the default
+	 */
+	map.count = 0;
+	assert(!mem_attr_parse("8fc5a000:0x300000:wc", &map, 0));
+	assert(!check_table(&map, 0x8fc00000, 4, "2332"));
+	map.count = 0;
+	assert(!mem_attr_parse("8ff00800:0x7f000:wc", &map, 0));
+	assert(!check_table(&map, 0x8fe00000, 2, "22"));
+
+	/* a region ending at the top of the address space */
+	map.count = 0;
+	assert(!mem_attr_parse("fff00000:1M:off", &map, 0));
+	assert(!check_table(&map, 0xffe00000, 2, "20"));
+
+	/* environment regions replace each other, code regions stay */
+	cur = mem_attr_get_map();
+	run_command("setenv memattr", 0);
+	assert(!mem_attr_set_region(0x1000000, MB, MEM_ATTR_WRITECOMBINE));
+	run_command("setenv memattr 2000000:1M:wt", 0);
+	assert(cur->count == 2);
+	run_command("setenv memattr 3000000:1M:off,4000000:1M:wt", 0);
+	assert(cur->count == 3);
+	assert(cur->region[0].start == 0x1000000);
+	assert(cur->region[1].start == 0x3000000);
+	run_command("setenv memattr 5000000:1M:bad", 0);
+	assert(cur->count == 3);
+	run_command("setenv memattr", 0);
+	assert(cur->count == 1);
+	assert(!mem_attr_set_region(0x1000000, MB, MEM_ATTR_OFF));
+	assert(cur->count == 1);
+	assert(cur->region[0].attr == MEM_ATTR_OFF);
+#ifdef CONFIG_CMD_MEMATTR
+	assert(!run_command("memattr 6000000 1M wc", 0));
+	assert(cur->count == 2);
+	assert(cur->region[1].size == MB);
+	assert(run_command("memattr 7000000 1Mx wc", 0));
+	assert(run_command("memattr 7000000 1M wcx", 0));
+	assert(run_command("memattr 7000000q 1M wc", 0));
+	assert(cur->count == 2);
+#endif
+	cur->count = 0;
+
+	printf("%s: Everything went swimmingly\n", __func__);
+	return 0;
+}
+
+U_BOOT_CMD(
+	ut_memattr,	1,	1,	do_ut_memattr,
+	"Very basic test of the memory attribute map",
+	""
+);
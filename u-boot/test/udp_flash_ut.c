@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * Plays the host side of the UDP flashing protocol straight into the
+ * engine, with the replies looped back, and writes to RAM and to a
+ * sandbox block device backed by a host file.
+ */
+
+#define DEBUG
+
+#include <common.h>
+#include <command.h>
+#include <os.h>
+#include <part.h>
+#include <sparse_format.h>
+#include <udp_flash.h>
+#include <asm/io.h>
+#include <asm/unaligned.h>
+
+#define UT_TARGET	0x2000000
+#define UT_BLK_SZ	512
+/* Host file behind the block device target, left behind afterwards */
+#define UT_DISK		"/tmp/udp_flash_ut.img"
+
+static uchar reply[UDP_FLASH_MAX_PACKET + 1];
+static unsigned reply_len;
+static int replies;
+static u16 seq;
+
+static void ut_reply(const uchar *pkt, unsigned len)
+{
+	memcpy(reply, pkt, len);
+	reply[len] = '\0';
+	reply_len = len;
+	replies++;
+}
+
+/* Send a packet numbered @num, which need not follow the last one */
+static int ut_packet(int type, int flags, u16 num, const void *data,
+		     unsigned len)
+{
+	uchar pkt[UDP_FLASH_MAX_PACKET];
+	struct udp_flash_hdr *hdr = (struct udp_flash_hdr *)pkt;
+
+	hdr->type = type;
+	hdr->flags = flags;
+	put_unaligned_be16(num, hdr->seq);
+	memcpy(pkt + UDP_FLASH_HDR_SIZE, data, len);
+
+	return udp_flash_packet(pkt, UDP_FLASH_HDR_SIZE + len);
+}
+
+static int ut_send(int type, const void *data, unsigned len)
+{
+	return ut_packet(type, 0, ++seq, data, len);
+}
+
+/* Check that the last reply was to packet @seq and reads @msg */
+static int ut_reply_is(const char *msg)
+{
+	const struct udp_flash_hdr *hdr = (struct udp_flash_hdr *)reply;
+
+	if (reply_len < UDP_FLASH_HDR_SIZE || hdr->type != UDP_FLASH_REPLY ||
+	    get_unaligned_be16(hdr->seq) != seq) {
+		printf("no reply to packet %u\n", seq);
+		return 0;
+	}
+	if (strcmp((char *)reply + UDP_FLASH_HDR_SIZE, msg)) {
+		printf("reply '%s', expected '%s'\n",
+		       reply + UDP_FLASH_HDR_SIZE, msg);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* Send @len bytes of @data in packets of up to @pkt_len bytes */
+static int ut_data(const uchar *data, ulong len, unsigned pkt_len)
+{
+	ulong off, n;
+
+	for (off = 0; off < len; off += n) {
+		n = min(len - off, (ulong)pkt_len);
+		ut_send(UDP_FLASH_DATA, data + off, n);
+		if (!ut_reply_is(off + n < len ? "" : "OKAY"))
+			return -1;
+	}
+
+	return 0;
+}
+
+static uchar *ut_chunk(uchar *p, int type, u32 blocks, u32 data_len)
+{
+	put_unaligned_le16(type, p);
+	put_unaligned_le16(0, p + 2);
+	put_unaligned_le32(blocks, p + 4);
+	put_unaligned_le32(sizeof(struct chunk_header) + data_len, p + 8);
+
+	return p + sizeof(struct chunk_header);
+}
+
+/*
+ * A sparse image of 8 blocks: 2 raw, 3 filled with 0x12345678, 2 left
+ * alone and 1 more raw
+ */
+static ulong ut_sparse_image(uchar *img, const uchar *raw)
+{
+	uchar *p = img;
+
+	put_unaligned_le32(SPARSE_HEADER_MAGIC, p);
+	put_unaligned_le16(SPARSE_MAJOR_VERSION, p + 4);
+	put_unaligned_le16(0, p + 6);
+	put_unaligned_le16(sizeof(struct sparse_header), p + 8);
+	put_unaligned_le16(sizeof(struct chunk_header), p + 10);
+	put_unaligned_le32(UT_BLK_SZ, p + 12);
+	put_unaligned_le32(8, p + 16);
+	put_unaligned_le32(4, p + 20);
+	put_unaligned_le32(0, p + 24);
+	p += sizeof(struct sparse_header);
+
+	p = ut_chunk(p, CHUNK_TYPE_RAW, 2, 2 * UT_BLK_SZ);
+	memcpy(p, raw, 2 * UT_BLK_SZ);
+	p += 2 * UT_BLK_SZ;
+	p = ut_chunk(p, CHUNK_TYPE_FILL, 3, sizeof(u32));
+	put_unaligned_le32(0x12345678, p);
+	p += sizeof(u32);
+	p = ut_chunk(p, CHUNK_TYPE_DONT_CARE, 2, 0);
+	p = ut_chunk(p, CHUNK_TYPE_RAW, 1, UT_BLK_SZ);
+	memcpy(p, raw + 2 * UT_BLK_SZ, UT_BLK_SZ);
+	p += UT_BLK_SZ;
+
+	return p - img;
+}
+
+/* Bind a host file of 8 blocks of 0xee as hostfile 0 */
+static block_dev_desc_t *ut_disk(void)
+{
+	uchar blk[UT_BLK_SZ];
+	int fd, i;
+
+	fd = os_open(UT_DISK, OS_O_WRONLY | OS_O_CREAT);
+	if (fd < 0)
+		return NULL;
+	memset(blk, 0xee, sizeof(blk));
+	for (i = 0; i < 8; i++)
+		os_write(fd, blk, sizeof(blk));
+	os_close(fd);
+	if (host_dev_bind(0, UT_DISK))
+		return NULL;
+
+	return host_get_dev(0);
+}
+
+static int do_ut_udpflash(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	uchar raw[3 * UT_BLK_SZ];
+	uchar img[sizeof(raw) + 256];
+	char cmd[64];
+	uchar *out, *load;
+	block_dev_desc_t *disk;
+	ulong len;
+	int i, count;
+
+	printf("%s: Testing flashing over UDP\n", __func__);
+	for (i = 0; i < sizeof(raw); i++)
+		raw[i] = i * 7 + (i >> 8);
+	assert(!udp_flash_init(ut_reply));
+
+	/* nothing happens before a start packet */
+	seq = 100;
+	ut_send(UDP_FLASH_CMD, "getvar:version", 14);
+	assert(!replies);
+	ut_packet(UDP_FLASH_CMD, UDP_FLASH_F_START, ++seq, "getvar:version",
+		  14);
+	assert(ut_reply_is("OKAY" UDP_FLASH_VERSION));
+	ut_send(UDP_FLASH_CMD, "getvar:nothing", 14);
+	assert(!strncmp((char *)reply + UDP_FLASH_HDR_SIZE, "FAIL", 4));
+
+	/* a packet sent again gets the same reply; one skipped is ignored */
+	count = replies;
+	ut_packet(UDP_FLASH_CMD, 0, seq, "continue", 8);
+	assert(replies == count + 1);
+	assert(!strncmp((char *)reply + UDP_FLASH_HDR_SIZE, "FAIL", 4));
+	ut_packet(UDP_FLASH_CMD, 0, seq + 2, "continue", 8);
+	assert(replies == count + 1);
+
+	/* download, then flash from RAM */
+	load = map_sysmem(load_addr, sizeof(raw));
+	memset(load, 0, sizeof(raw));
+	unmap_sysmem(load);
+	sprintf(cmd, "download:%x", (unsigned)sizeof(raw));
+	ut_send(UDP_FLASH_CMD, cmd, strlen(cmd));
+	assert(ut_reply_is("DATA00000600"));
+	assert(!ut_data(raw, sizeof(raw), 1000));
+	assert(getenv_hex("filesize", 0) == sizeof(raw));
+	out = map_sysmem(UT_TARGET, 9 * UT_BLK_SZ);
+	memset(out, 0xee, 8 * UT_BLK_SZ);
+	sprintf(cmd, "flash:mem %x", UT_TARGET + 100);
+	ut_send(UDP_FLASH_CMD, cmd, strlen(cmd));
+	assert(ut_reply_is("OKAY"));
+	assert(!memcmp(out + 100, raw, sizeof(raw)));
+	assert(out[99] == 0xee && out[100 + sizeof(raw)] == 0xee);
+
+	/* a sparse image written as it arrives, in awkward pieces */
+	len = ut_sparse_image(img, raw);
+	memset(out, 0xee, 8 * UT_BLK_SZ);
+	sprintf(cmd, "write:%lx:mem %x", len, UT_TARGET);
+	ut_send(UDP_FLASH_CMD, cmd, strlen(cmd));
+	assert(ut_reply_is("DATA00000650"));
+	assert(!ut_data(img, len, 7));
+	assert(!memcmp(out, raw, 2 * UT_BLK_SZ));
+	for (i = 2 * UT_BLK_SZ; i < 5 * UT_BLK_SZ; i += 4)
+		assert(get_unaligned_le32(out + i) == 0x12345678);
+	for (i = 5 * UT_BLK_SZ; i < 7 * UT_BLK_SZ; i++)
+		assert(out[i] == 0xee);
+	assert(!memcmp(out + 7 * UT_BLK_SZ, raw + 2 * UT_BLK_SZ, UT_BLK_SZ));
+
+	/* the same image to a block device */
+	disk = ut_disk();
+	assert(disk);
+	sprintf(cmd, "write:%lx:hostfile 0", len);
+	ut_send(UDP_FLASH_CMD, cmd, strlen(cmd));
+	assert(ut_reply_is("DATA00000650"));
+	assert(!ut_data(img, len, 700));
+	memset(out, 0, 8 * UT_BLK_SZ);
+	assert(disk->block_read(0, 0, 8, out) == 8);
+	assert(!memcmp(out, raw, 2 * UT_BLK_SZ));
+	for (i = 2 * UT_BLK_SZ; i < 5 * UT_BLK_SZ; i += 4)
+		assert(get_unaligned_le32(out + i) == 0x12345678);
+	for (i = 5 * UT_BLK_SZ; i < 7 * UT_BLK_SZ; i++)
+		assert(out[i] == 0xee);
+	assert(!memcmp(out + 7 * UT_BLK_SZ, raw + 2 * UT_BLK_SZ, UT_BLK_SZ));
+
+	/* a download one block too big for it */
+	sprintf(cmd, "download:%x", 9 * UT_BLK_SZ);
+	ut_send(UDP_FLASH_CMD, cmd, strlen(cmd));
+	assert(!ut_data(out, 9 * UT_BLK_SZ, 1000));
+	ut_send(UDP_FLASH_CMD, "flash:hostfile 0", 16);
+	assert(ut_reply_is("FAILwrite failed"));
+	host_dev_bind(0, NULL);
+
+	/* a data packet sent again is not stored twice */
+	memset(out, 0xee, 8 * UT_BLK_SZ);
+	sprintf(cmd, "write:%x:mem %x", 2 * UT_BLK_SZ, UT_TARGET);
+	ut_send(UDP_FLASH_CMD, cmd, strlen(cmd));
+	ut_send(UDP_FLASH_DATA, raw, UT_BLK_SZ);
+	assert(ut_reply_is(""));
+	ut_packet(UDP_FLASH_DATA, 0, seq, raw, UT_BLK_SZ);
+	assert(ut_reply_is(""));
+	ut_send(UDP_FLASH_DATA, raw + UT_BLK_SZ, UT_BLK_SZ);
+	assert(ut_reply_is("OKAY"));
+	assert(!memcmp(out, raw, 2 * UT_BLK_SZ));
+	assert(out[2 * UT_BLK_SZ] == 0xee);
+
+	/* too much data, and data with no transfer */
+	ut_send(UDP_FLASH_CMD, "download:10", 11);
+	ut_send(UDP_FLASH_DATA, raw, 17);
+	assert(!strncmp((char *)reply + UDP_FLASH_HDR_SIZE, "FAIL", 4));
+	ut_send(UDP_FLASH_DATA, raw, 1);
+	assert(ut_reply_is("FAILno transfer"));
+
+	ut_send(UDP_FLASH_CMD, "continue", 8);
+	assert(ut_reply_is("OKAY"));
+	unmap_sysmem(out);
+
+	printf("%s: Everything went swimmingly\n", __func__);
+	return 0;
+}
+
+U_BOOT_CMD(
+	ut_udpflash,	1,	1,	do_ut_udpflash,
+	"Very basic test of flashing over UDP",
+	""
+);
@@ -0,0 +1,53 @@
+#!/bin/sh
+#
+# Copyright (c) 2013
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+
+# Compare lib/vsprintf.c with the version in an earlier commit, checking
+# that the output is identical for a large random corpus and timing both.
+# By default the earlier commit is the one before the last change to
+# lib/vsprintf.c.
+#
+# Usage: test-vsprintf.sh [<commit> [<count>]]
+
+OUTPUT_DIR=sandbox
+REF=${1:-$(git log -1 --format=%H -- lib/vsprintf.c)^}
+COUNT=${2:-1000000}
+
+fail() {
+	echo "Test failed: $1"
+	rm -rf ${tmp}
+	exit 1
+}
+
+build_config() {
+	echo "Configure sandbox"
+	make O=${OUTPUT_DIR} -s sandbox_config || fail "configure"
+	make O=${OUTPUT_DIR} -s depend || fail "depend"
+}
+
+build_obj() {
+	prefix=$1
+	src=$2
+	gcc -Os -D__KERNEL__ -DCONFIG_SANDBOX -D__SANDBOX__ \
+		-I${OUTPUT_DIR}/include2 -I${OUTPUT_DIR}/include -Iinclude \
+		-fno-builtin -ffreestanding -nostdinc \
+		-isystem $(gcc -print-file-name=include) \
+		-ffunction-sections -fno-stack-protector \
+		-c ${src} -o ${tmp}/${prefix}.o || fail "compile ${src}"
+	objcopy --prefix-symbols=${prefix}_ ${tmp}/${prefix}.o
+}
+
+tmp="$(mktemp -d)"
+build_config
+git show ${REF}:./lib/vsprintf.c >${tmp}/old.c || fail "git show ${REF}"
+cmp -s ${tmp}/old.c lib/vsprintf.c && fail "lib/vsprintf.c is the same at ${REF}"
+build_obj old ${tmp}/old.c
+build_obj new lib/vsprintf.c
+gcc -O2 -o ${tmp}/vsprintf-compare test/vsprintf/vsprintf-compare.c \
+	${tmp}/old.o ${tmp}/new.o -Wl,--gc-sections || fail "link"
+${tmp}/vsprintf-compare ${COUNT} || fail "output differs"
+rm -rf ${tmp}
+echo "Test passed"
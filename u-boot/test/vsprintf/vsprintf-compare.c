@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+/*
+ * Host-side comparison of two builds of lib/vsprintf.c. The objects are
+ * built for sandbox by test-vsprintf.sh, with their symbols prefixed by
+ * 'old_' and 'new_' so that both can be linked into this program.
+ *
+ * The output of both versions is compared for a corpus of randomly
+ * generated conversions and values, and then each is timed on a few
+ * typical format strings.
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int old_sprintf(char *buf, const char *fmt, ...);
+int new_sprintf(char *buf, const char *fmt, ...);
+
+/* Things that vsprintf.c needs from the rest of U-Boot */
+#define STUBS(p) \
+	size_t p##strnlen(const char *s, size_t n) { return strnlen(s, n); } \
+	size_t p##strlen(const char *s) { return strlen(s); } \
+	uint32_t p##__div64_32(uint64_t *n, uint32_t base) \
+	{ \
+		uint32_t rem = *n % base; \
+		*n /= base; \
+		return rem; \
+	} \
+	void p##do_reset(void) {} \
+	void p##udelay(void) {} \
+	void p##putc(void) {} \
+	int p##printf(void) { return 0; } \
+	int p##vprintf(void) { return 0; } \
+	unsigned char p##_ctype[256];
+
+STUBS(old_)
+STUBS(new_)
+
+static void init_ctype(unsigned char *ctype)
+{
+	int c;
+
+	/* Only _U, _L and _D are used by vsprintf.c */
+	for (c = 0; c < 256; c++)
+		ctype[c] = (isupper(c) ? 0x01 : 0) | (islower(c) ? 0x02 : 0) |
+			(isdigit(c) ? 0x04 : 0);
+}
+
+/* A random value with a random number of significant bits */
+static uint64_t random_value(void)
+{
+	uint64_t val = ((uint64_t)random() << 62) ^
+		((uint64_t)random() << 31) ^ random();
+	int bits = random() % 65;
+
+	return bits == 64 ? val : val & ((1ULL << bits) - 1);
+}
+
+static int compare(long count)
+{
+	static const char *const quals[] = { "", "l", "ll", "h", "z", "t" };
+	static const char convs[] = "diuxXoc";
+	char fmt[64], old[512], new[512];
+	int fail = 0;
+	long n;
+
+	for (n = 0; n < count; n++) {
+		const char *qual;
+		uint64_t val = random_value();
+		int ival = (int)random_value();
+		char conv, *p = fmt;
+		int i;
+
+		*p++ = '%';
+		for (i = 0; i < 5; i++)
+			if (!(random() % 4))
+				*p++ = "-+ #0"[i];
+		if (random() % 2)
+			p += sprintf(p, "%ld", random() % 25);
+		if (!(random() % 3))
+			p += sprintf(p, ".%ld", random() % 25);
+		conv = convs[random() % (sizeof(convs) - 1)];
+		qual = conv == 'c' ? "" : quals[random() % 6];
+		sprintf(p, "%s%c|%%s|%%d", qual, conv);
+
+		if (!strcmp(qual, "ll")) {
+			old_sprintf(old, fmt, val, "str", ival);
+			new_sprintf(new, fmt, val, "str", ival);
+		} else if (*qual == 'l' || *qual == 'z' || *qual == 't') {
+			old_sprintf(old, fmt, (unsigned long)val, "str", ival);
+			new_sprintf(new, fmt, (unsigned long)val, "str", ival);
+		} else {
+			old_sprintf(old, fmt, (unsigned)val, "str", ival);
+			new_sprintf(new, fmt, (unsigned)val, "str", ival);
+		}
+		if (strcmp(old, new) && fail++ < 10)
+			printf("'%s': old '%s', new '%s'\n", fmt, old, new);
+
+		/* These all take the fast path in the new code */
+		val = (unsigned)random_value();
+		old_sprintf(old, "%u %d %x %s %i", (unsigned)val, (int)val,
+			    (unsigned)val, (char *)NULL, -(int)val);
+		new_sprintf(new, "%u %d %x %s %i", (unsigned)val, (int)val,
+			    (unsigned)val, (char *)NULL, -(int)val);
+		if (strcmp(old, new) && fail++ < 10)
+			printf("fast path: old '%s', new '%s'\n", old, new);
+	}
+	printf("%ld cases, %d mismatches\n", count, fail);
+
+	return fail;
+}
+
+static double time_ns(int (*func)(char *buf, const char *fmt, ...),
+		      const char *fmt, int count)
+{
+	struct timespec start, end;
+	char buf[128];
+	unsigned val;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++) {
+		val = i * 2654435761u;
+		func(buf, fmt, val, val >> 8, val & 0xff, val >> 24);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return ((end.tv_sec - start.tv_sec) * 1e9 +
+		(end.tv_nsec - start.tv_nsec)) / count;
+}
+
+static void benchmark(int count)
+{
+	static const char *const fmts[] = {
+		"%u", "%d.%d.%d.%d", "%08x", "%lu/%lu", "%#llx",
+	};
+	int i;
+
+	printf("%-14s %10s %10s\n", "format", "old ns", "new ns");
+	for (i = 0; i < sizeof(fmts) / sizeof(fmts[0]); i++)
+		printf("%-14s %10.1f %10.1f\n", fmts[i],
+		       time_ns(old_sprintf, fmts[i], count),
+		       time_ns(new_sprintf, fmts[i], count));
+}
+
+int main(int argc, char *argv[])
+{
+	long count = argc > 1 ? atol(argv[1]) : 1000000;
+
+	init_ctype(old__ctype);
+	init_ctype(new__ctype);
+	srandom(argc > 2 ? atoi(argv[2]) : 1);
+	if (compare(count))
+		return 1;
+	benchmark(2000000);
+
+	return 0;
+}
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * Plays the server side of an HTTP download against wget, feeding canned
+ * segments through NetReceive() and catching the replies with a fake
+ * Ethernet device.
+ */
+
+#define DEBUG
+
+#include <common.h>
+#include <command.h>
+#include <net.h>
+#include <asm/io.h>
+#include <asm/unaligned.h>
+#include "../net/tcp.h"
+#include "../net/wget.h"
+
+#define UT_LOAD		0x1000000
+#define UT_FILE_SIZE	3000
+#define UT_PORT		80
+#define UT_MSS		1460
+
+static const uchar ut_server_ether[6] = { 0x02, 0, 0, 0, 0, 0x02 };
+static IPaddr_t ut_server;
+static struct eth_device ut_eth;
+
+/* the last packet sent, and the TCP fields of the last segment */
+static uchar tx[PKTSIZE];
+static int tx_len;
+static uchar ut_flags;
+static int ut_sport;
+static u32 ut_ack;		/* next sequence number the client sends */
+static u32 ut_acked;		/* what the client has acked of ours */
+static char ut_request[TCP_TX_MAX + 1];
+
+static u32 ut_seq;		/* our next sequence number */
+static uchar ut_file[UT_FILE_SIZE];
+
+static int ut_eth_send(struct eth_device *dev, void *packet, int len)
+{
+	struct ethernet_hdr *et = packet;
+	struct ip_hdr *ip = (struct ip_hdr *)(tx + ETHER_HDR_SIZE);
+	struct tcp_hdr *tcp = (struct tcp_hdr *)((uchar *)ip + IP_HDR_SIZE);
+	int hlen, seg_len;
+
+	memcpy(tx, packet, len);
+	tx_len = len;
+	if (ntohs(et->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_TCP)
+		return 0;
+
+	hlen = (tcp->tcp_hlen >> 4) * 4;
+	seg_len = ntohs(ip->ip_len) - IP_HDR_SIZE - hlen;
+	ut_flags = tcp->tcp_flags;
+	ut_sport = ntohs(tcp->tcp_src);
+	ut_ack = get_unaligned_be32(&tcp->tcp_seq) + seg_len;
+	if (ut_flags & (TCP_SYN | TCP_FIN))
+		ut_ack++;
+	ut_acked = get_unaligned_be32(&tcp->tcp_ack);
+	if (seg_len) {
+		memcpy(ut_request, (uchar *)tcp + hlen, seg_len);
+		ut_request[seg_len] = '\0';
+	}
+
+	return 0;
+}
+
+static int ut_eth_init(struct eth_device *dev, bd_t *bis)
+{
+	return 0;
+}
+
+static int ut_eth_recv(struct eth_device *dev)
+{
+	return 0;
+}
+
+static void ut_eth_halt(struct eth_device *dev)
+{
+}
+
+static void ut_arp_reply(void)
+{
+	uchar pkt[ETHER_HDR_SIZE + ARP_HDR_SIZE];
+	struct arp_hdr *arp = (struct arp_hdr *)(pkt + ETHER_HDR_SIZE);
+
+	assert(tx_len && ntohs(((struct ethernet_hdr *)tx)->et_protlen) ==
+	       PROT_ARP);
+	NetSetEther(pkt, NetOurEther, PROT_ARP);
+	memcpy(pkt + 6, ut_server_ether, 6);
+	arp->ar_hrd = htons(ARP_ETHER);
+	arp->ar_pro = htons(PROT_IP);
+	arp->ar_hln = ARP_HLEN;
+	arp->ar_pln = ARP_PLEN;
+	arp->ar_op = htons(ARPOP_REPLY);
+	memcpy(&arp->ar_sha, ut_server_ether, ARP_HLEN);
+	NetWriteIP(&arp->ar_spa, ut_server);
+	memcpy(&arp->ar_tha, NetOurEther, ARP_HLEN);
+	NetWriteIP(&arp->ar_tpa, NetOurIP);
+	NetReceive(pkt, sizeof(pkt));
+}
+
+/* Send a segment at @seq, with an MSS option of @mss on a SYN */
+static void ut_segment(uchar flags, u32 seq, const void *data, int len,
+		       int mss)
+{
+	uchar pkt[PKTSIZE];
+	struct ip_hdr *ip = (struct ip_hdr *)(pkt + ETHER_HDR_SIZE);
+	struct tcp_hdr *tcp = (struct tcp_hdr *)((uchar *)ip + IP_HDR_SIZE);
+	int hlen = TCP_HDR_SIZE;
+	uint sum;
+
+	NetSetEther(pkt, NetOurEther, PROT_IP);
+	memcpy(pkt + 6, ut_server_ether, 6);
+	tcp->tcp_src = htons(UT_PORT);
+	tcp->tcp_dst = htons(ut_sport);
+	put_unaligned_be32(seq, &tcp->tcp_seq);
+	put_unaligned_be32(ut_ack, &tcp->tcp_ack);
+	if (flags & TCP_SYN) {
+		uchar *opt = (uchar *)tcp + hlen;
+
+		opt[0] = 2;
+		opt[1] = 4;
+		put_unaligned_be16(mss, opt + 2);
+		hlen += 4;
+	}
+	tcp->tcp_hlen = (hlen / 4) << 4;
+	tcp->tcp_flags = flags | TCP_ACK;
+	tcp->tcp_win = htons(8192);
+	tcp->tcp_urg = 0;
+	memcpy((uchar *)tcp + hlen, data, len);
+
+	tcp->tcp_xsum = 0;
+	sum = (ut_server & 0xffff) + (ut_server >> 16) +
+		(NetOurIP & 0xffff) + (NetOurIP >> 16) +
+		htons(IPPROTO_TCP) + htons(hlen + len);
+	tcp->tcp_xsum = ~net_csum_fold(net_csum_partial(tcp, hlen + len,
+							sum));
+
+	net_set_ip_header((uchar *)ip, NetOurIP, ut_server);
+	ip->ip_len = htons(IP_HDR_SIZE + hlen + len);
+	ip->ip_p = IPPROTO_TCP;
+	ip->ip_sum = 0;
+	ip->ip_sum = ~NetCksum((uchar *)ip, IP_HDR_SIZE >> 1);
+
+	NetReceive(pkt, ETHER_HDR_SIZE + IP_HDR_SIZE + hlen + len);
+}
+
+/* Send the next @len bytes of the stream */
+static void ut_data(const void *data, int len)
+{
+	ut_segment(TCP_PSH, ut_seq, data, len, 0);
+	ut_seq += len;
+}
+
+static void ut_str(const char *str)
+{
+	ut_data(str, strlen(str));
+}
+
+/* Answer the ARP request and SYN of a new connection */
+static void ut_accept(int mss)
+{
+	ut_arp_reply();
+	assert(ut_flags == TCP_SYN);
+	ut_seq = 0x12345678;
+	ut_segment(TCP_SYN, ut_seq++, NULL, 0, mss);
+}
+
+/* Start fetching @name and accept the connection */
+static void ut_wget(const char *name, int mss)
+{
+	uchar *buf = map_sysmem(UT_LOAD, UT_FILE_SIZE + 1);
+
+	memset(buf, 0xee, UT_FILE_SIZE + 1);
+	unmap_sysmem(buf);
+	ut_request[0] = '\0';
+	tx_len = 0;
+	copy_filename(BootFile, name, sizeof(BootFile));
+	net_set_state(NETLOOP_CONTINUE);
+	wget_start();
+	ut_accept(mss);
+}
+
+static int ut_loaded(ulong len)
+{
+	uchar *buf = map_sysmem(UT_LOAD, len + 1);
+	int ret;
+
+	ret = net_state == NETLOOP_SUCCESS && NetBootFileXferSize == len &&
+		!memcmp(buf, ut_file, len) && buf[len] == 0xee;
+	unmap_sysmem(buf);
+
+	return ret;
+}
+
+static int do_ut_wget(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	char hdr[120];
+	u32 seq;
+	int i;
+
+	printf("%s: Testing HTTP downloads\n", __func__);
+	for (i = 0; i < UT_FILE_SIZE; i++)
+		ut_file[i] = i * 7 + (i >> 8);
+
+	if (!ut_eth.name[0]) {
+		strcpy(ut_eth.name, "ut_eth");
+		memcpy(ut_eth.enetaddr, "\x02\0\0\0\0\x01", 6);
+		ut_eth.init = ut_eth_init;
+		ut_eth.send = ut_eth_send;
+		ut_eth.recv = ut_eth_recv;
+		ut_eth.halt = ut_eth_halt;
+		eth_register(&ut_eth);
+	}
+	setenv("ethact", ut_eth.name);
+	eth_set_current();
+	setenv("ipaddr", "192.168.1.1");
+	setenv("netmask", "255.255.255.0");
+	setenv("serverip", "192.168.1.2");
+	ut_server = string_to_ip("192.168.1.2");
+	load_addr = UT_LOAD;
+	net_init();
+
+	/* header and body in awkward pieces, with a gap and a repeat */
+	ut_wget("file.bin", UT_MSS);
+	assert(!strcmp(ut_request, "GET /file.bin HTTP/1.1\r\n"
+		       "Host: 192.168.1.2\r\nUser-Agent: U-Boot\r\n"
+		       "Connection: close\r\n\r\n"));
+	ut_str("HTTP/1.1 200 OK\r\nContent-Le");
+	sprintf(hdr, "ngth: %d\r\nServer: ut\r\n\r", UT_FILE_SIZE);
+	ut_str(hdr);
+	ut_segment(TCP_PSH, ut_seq, "\n", 1, 0);
+	ut_data("\n", 1);
+	ut_data(ut_file, 1000);
+	assert(ut_acked == ut_seq);
+	ut_segment(TCP_PSH, ut_seq + 1000, ut_file + 2000, 1000, 0);
+	assert(ut_acked == ut_seq && net_state == NETLOOP_CONTINUE);
+	ut_segment(TCP_PSH, ut_seq - 500, ut_file + 500, 1000, 0);
+	ut_seq += 500;
+	assert(ut_acked == ut_seq);
+	ut_data(ut_file + 1500, 1000);
+	ut_data(ut_file + 2500, 500);
+	assert(ut_loaded(UT_FILE_SIZE));
+	assert(ut_flags & TCP_FIN);
+
+	/* without a length, the end of the connection ends the file */
+	ut_wget("/file.bin", UT_MSS);
+	ut_str("HTTP/1.0 200 OK\r\n\r\n");
+	ut_data(ut_file, 1200);
+	assert(net_state == NETLOOP_CONTINUE);
+	ut_segment(TCP_FIN, ut_seq, NULL, 0, 0);
+	assert(ut_loaded(1200));
+
+	/* a reset part way through resumes with a range request */
+	ut_wget("file.bin", UT_MSS);
+	sprintf(hdr, "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n",
+		UT_FILE_SIZE);
+	ut_str(hdr);
+	ut_data(ut_file, 1100);
+	ut_segment(TCP_RST, ut_seq, NULL, 0, 0);
+	assert(net_state == NETLOOP_CONTINUE);
+	ut_accept(UT_MSS);
+	assert(strstr(ut_request, "\r\nRange: bytes=1100-\r\n"));
+	sprintf(hdr, "HTTP/1.1 206 Partial Content\r\nContent-Range: "
+		"bytes 1100-%d/%d\r\nContent-Length: %d\r\n\r\n",
+		UT_FILE_SIZE - 1, UT_FILE_SIZE, UT_FILE_SIZE - 1100);
+	ut_str(hdr);
+	ut_data(ut_file + 1100, 1000);
+	ut_data(ut_file + 2100, UT_FILE_SIZE - 2100);
+	assert(ut_loaded(UT_FILE_SIZE));
+
+	/* errors from the server abort the connection */
+	ut_wget("missing", UT_MSS);
+	ut_str("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+	assert(net_state == NETLOOP_FAIL && (ut_flags & TCP_RST));
+
+	ut_wget("file.bin", UT_MSS);
+	ut_str("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
+	assert(net_state == NETLOOP_FAIL && (ut_flags & TCP_RST));
+
+	ut_wget("file.bin", UT_MSS);
+	ut_str("SSH-2.0-OpenSSH\r\n\r\n");
+	assert(net_state == NETLOOP_FAIL);
+
+	ut_wget("file.bin", UT_MSS);
+	ut_str("HTTP/1.1 200 OK\r\n");
+	for (i = 0; i < 60 && net_state == NETLOOP_CONTINUE; i++)
+		ut_str("X-Padding: 0123456789\r\n");
+	assert(net_state == NETLOOP_FAIL);
+
+	/* data for an old connection is ignored */
+	ut_wget("file.bin", UT_MSS);
+	seq = ut_seq;
+	ut_sport--;
+	ut_str("HTTP/1.1 200 OK\r\n\r\n");
+	ut_sport++;
+	assert(ut_acked == seq && net_state == NETLOOP_CONTINUE);
+
+	/* a request which does not fit the server's MSS fails */
+	ut_wget("file.bin", 64);
+	assert(net_state == NETLOOP_FAIL && (ut_flags & TCP_RST));
+	assert(!ut_request[0]);
+	tcp_set_handler(NULL);
+
+	printf("%s: Everything went swimmingly\n", __func__);
+	return 0;
+}
+
+U_BOOT_CMD(
+	ut_wget,	1,	1,	do_ut_wget,
+	"Very basic test of HTTP downloads",
+	""
+);
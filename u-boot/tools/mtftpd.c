@@ -0,0 +1,510 @@
+/*
+ * Multicast TFTP server, for loading one file into many boards at once
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * Serves a single file to U-Boot clients built with CONFIG_MCAST_TFTP,
+ * using the TFTP multicast option (RFC 2090). Data blocks go to one
+ * multicast group, so each block crosses the server's link once however
+ * many boards are listening.
+ *
+ * One client at a time is the master client: it acks blocks and so sets
+ * the pace. The others only listen. When the master has the whole file
+ * it acks the block after the last one and the next client becomes
+ * master. Its acks name the blocks it missed (it asks for its holes in
+ * turn), so these repairs go out once to the group as well. A client
+ * which completes while listening acks the end block to say so, and is
+ * not made master.
+ *
+ * Block numbers are 16 bits, so the file must fit in 65535 blocks. For
+ * large images use a larger block size (-b), with tftpblocksize set to
+ * match on the boards and CONFIG_IP_DEFRAG enabled there.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define TFTP_RRQ	1
+#define TFTP_DATA	3
+#define TFTP_ACK	4
+#define TFTP_ERROR	5
+#define TFTP_OACK	6
+
+#define TFTP_ERR_NOT_FOUND	1
+#define TFTP_ERR_ACCESS		2
+
+#define MAX_CLIENTS	256
+#define MAX_BLKSIZE	65464
+#define MAX_BLOCKS	65535
+
+enum client_state {
+	CLIENT_WAITING,		/* listening, not yet master */
+	CLIENT_MASTER,
+	CLIENT_DONE,
+};
+
+struct client {
+	struct sockaddr_in addr;
+	enum client_state state;
+};
+
+static const char *prog;
+static const char *file_name;	/* name the clients ask for, */
+static const char *file_base;	/* or just its last part */
+static unsigned char *file_data;
+static unsigned long file_size;
+static unsigned blksize = 1468;
+static unsigned long nblocks;
+
+static struct sockaddr_in group;
+static int ctl_sock;		/* well-known port, for requests */
+static int data_sock;		/* our transfer ID: OACKs, data and acks */
+
+static struct client clients[MAX_CLIENTS];
+static int nclients;
+static struct client *master;
+static int ndone;
+
+static unsigned timeout_ms = 1000;
+static int max_retries = 10;
+static int retries;
+static int master_acked;	/* master has acked our OACK */
+static unsigned long last_block;	/* last block sent, or 0 */
+static struct timeval last_send;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"Usage: %s [options] file\n"
+		"  -p port     port to take requests on (default 69)\n"
+		"  -g group    multicast group[:port] (default 239.255.0.1:1758)\n"
+		"  -i addr     address of the interface to send from\n"
+		"  -b size     block size (default 1468)\n"
+		"  -t ms       time to wait for an ack (default 1000)\n"
+		"  -n count    exit once count clients have the file\n",
+		prog);
+	exit(EXIT_FAILURE);
+}
+
+static unsigned long elapsed_ms(const struct timeval *since)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - since->tv_sec) * 1000 +
+		(now.tv_usec - since->tv_usec) / 1000;
+}
+
+static void send_to(const struct sockaddr_in *to, const void *buf, int len)
+{
+	if (sendto(data_sock, buf, len, 0, (const struct sockaddr *)to,
+		   sizeof(*to)) < 0)
+		fprintf(stderr, "%s: sendto %s: %s\n", prog,
+			inet_ntoa(to->sin_addr), strerror(errno));
+}
+
+static void send_error(int sock, const struct sockaddr_in *to, int code,
+		       const char *msg)
+{
+	unsigned char buf[128];
+	int len;
+
+	buf[0] = 0;
+	buf[1] = TFTP_ERROR;
+	buf[2] = code >> 8;
+	buf[3] = code;
+	len = 4 + snprintf((char *)buf + 4, sizeof(buf) - 4, "%s", msg) + 1;
+	sendto(sock, buf, len, 0, (const struct sockaddr *)to, sizeof(*to));
+}
+
+/* Send the options, telling the client whether it is master */
+static void send_oack(struct client *c, int is_master)
+{
+	char buf[256];
+	char *p = buf;
+
+	*p++ = 0;
+	*p++ = TFTP_OACK;
+	p += sprintf(p, "blksize%c%u%c", 0, blksize, 0);
+	p += sprintf(p, "tsize%c%lu%c", 0, file_size, 0);
+	p += sprintf(p, "multicast%c%s,%u,%d%c", 0, inet_ntoa(group.sin_addr),
+		     ntohs(group.sin_port), is_master, 0);
+	send_to(&c->addr, buf, p - buf);
+}
+
+/* Send a block (counting from 1) to the group */
+static void send_block(unsigned long block)
+{
+	static unsigned char buf[4 + MAX_BLKSIZE];
+	unsigned long offset = (block - 1) * blksize;
+	unsigned long len = 0;
+
+	if (offset < file_size) {
+		len = file_size - offset;
+		if (len > blksize)
+			len = blksize;
+	}
+	buf[0] = 0;
+	buf[1] = TFTP_DATA;
+	buf[2] = block >> 8;
+	buf[3] = block;
+	memcpy(buf + 4, file_data + offset, len);
+	send_to(&group, buf, 4 + len);
+
+	last_block = block;
+	gettimeofday(&last_send, NULL);
+}
+
+static struct client *find_client(const struct sockaddr_in *addr)
+{
+	int i;
+
+	for (i = 0; i < nclients; i++) {
+		if (clients[i].addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+		    clients[i].addr.sin_port == addr->sin_port)
+			return &clients[i];
+	}
+
+	return NULL;
+}
+
+/* Make the next waiting client master, if there is one */
+static void next_master(void)
+{
+	int i;
+
+	master = NULL;
+	for (i = 0; i < nclients; i++) {
+		if (clients[i].state == CLIENT_WAITING) {
+			master = &clients[i];
+			break;
+		}
+	}
+	if (!master)
+		return;
+
+	master->state = CLIENT_MASTER;
+	master_acked = 0;
+	retries = 0;
+	last_block = 0;
+	send_oack(master, 1);
+	gettimeofday(&last_send, NULL);
+}
+
+static void client_done(struct client *c)
+{
+	c->state = CLIENT_DONE;
+	ndone++;
+	printf("%s:%u has the file (%d done, %d waiting)\n",
+	       inet_ntoa(c->addr.sin_addr), ntohs(c->addr.sin_port), ndone,
+	       nclients - ndone - (master && master != c));
+	if (c == master)
+		next_master();
+}
+
+static void handle_request(unsigned char *buf, int len,
+			   struct sockaddr_in *from)
+{
+	char *p = (char *)buf + 2, *end = (char *)buf + len;
+	char *name, *opt, *val;
+	int multicast = 0;
+	unsigned want = 512;
+	struct client *c;
+
+	if (len < 4 || buf[0] != 0 || buf[1] != TFTP_RRQ || end[-1] != '\0')
+		return;
+
+	name = p;
+	p += strlen(p) + 1;
+	if (p >= end)
+		return;
+	p += strlen(p) + 1;		/* mode: always octet from U-Boot */
+	while (p < end) {
+		opt = p;
+		p += strlen(p) + 1;
+		if (p >= end)
+			break;
+		val = p;
+		p += strlen(p) + 1;
+		if (!strcasecmp(opt, "multicast"))
+			multicast = 1;
+		else if (!strcasecmp(opt, "blksize"))
+			want = strtoul(val, NULL, 10);
+	}
+
+	if (strcmp(name, file_name) && strcmp(name, file_base)) {
+		send_error(ctl_sock, from, TFTP_ERR_NOT_FOUND,
+			   "File not found");
+		return;
+	}
+	/* this makes U-Boot give up rather than ask again */
+	if (!multicast) {
+		send_error(ctl_sock, from, TFTP_ERR_ACCESS,
+			   "Multicast clients only");
+		return;
+	}
+	if (want < blksize) {
+		send_error(ctl_sock, from, TFTP_ERR_ACCESS,
+			   "Block size too small");
+		return;
+	}
+
+	c = find_client(from);
+	if (!c) {
+		if (nclients == MAX_CLIENTS) {
+			send_error(ctl_sock, from, 0, "Too many clients");
+			return;
+		}
+		c = &clients[nclients++];
+		c->addr = *from;
+		c->state = CLIENT_WAITING;
+		printf("%s:%u joined\n", inet_ntoa(from->sin_addr),
+		       ntohs(from->sin_port));
+	} else if (c->state == CLIENT_DONE) {
+		/* loading again */
+		c->state = CLIENT_WAITING;
+		ndone--;
+	}
+
+	if (!master)
+		next_master();
+	else if (c != master)
+		send_oack(c, 0);
+}
+
+static void handle_ack(unsigned char *buf, int len, struct sockaddr_in *from)
+{
+	struct client *c = find_client(from);
+	unsigned long block;
+
+	if (!c || len < 4 || buf[0] != 0)
+		return;
+	if (buf[1] == TFTP_ERROR) {
+		printf("%s:%u gave up: %s\n", inet_ntoa(from->sin_addr),
+		       ntohs(from->sin_port), len > 4 ? (char *)buf + 4 : "");
+		if (c->state != CLIENT_DONE)
+			client_done(c);
+		return;
+	}
+	if (buf[1] != TFTP_ACK || c->state == CLIENT_DONE)
+		return;
+
+	block = (buf[2] << 8) | buf[3];
+	if (block >= nblocks) {
+		client_done(c);
+		return;
+	}
+	if (c != master)
+		return;
+
+	/* the master wants the block after the one it acks */
+	master_acked = 1;
+	retries = 0;
+	send_block(block + 1);
+}
+
+/* Nothing from the master for a while: send again, or give up on it */
+static void check_timeout(void)
+{
+	if (!master || elapsed_ms(&last_send) < timeout_ms)
+		return;
+
+	if (++retries > max_retries) {
+		printf("%s:%u stopped answering\n",
+		       inet_ntoa(master->addr.sin_addr),
+		       ntohs(master->addr.sin_port));
+		client_done(master);
+		return;
+	}
+	if (!master_acked) {
+		send_oack(master, 1);
+		gettimeofday(&last_send, NULL);
+	} else {
+		send_block(last_block);
+	}
+}
+
+static int open_socket(int port)
+{
+	struct sockaddr_in addr;
+	int s, on = 1;
+
+	s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s < 0) {
+		perror("socket");
+		exit(EXIT_FAILURE);
+	}
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "%s: bind port %d: %s\n", prog, port,
+			strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	return s;
+}
+
+static void load_file(const char *path)
+{
+	struct stat st;
+	ssize_t n;
+	unsigned long done = 0;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "%s: %s: %s\n", prog, path, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	file_size = st.st_size;
+	file_data = malloc(file_size ? file_size : 1);
+	if (!file_data) {
+		fprintf(stderr, "%s: out of memory\n", prog);
+		exit(EXIT_FAILURE);
+	}
+	while (done < file_size) {
+		n = read(fd, file_data + done, file_size - done);
+		if (n <= 0) {
+			fprintf(stderr, "%s: %s: read error\n", prog, path);
+			exit(EXIT_FAILURE);
+		}
+		done += n;
+	}
+	close(fd);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned char buf[1024];
+	struct sockaddr_in from, local;
+	struct in_addr ifaddr;
+	socklen_t fromlen;
+	unsigned char ttl = 1;
+	int port = 69, exit_count = 0;
+	char group_str[32] = "239.255.0.1:1758", *colon;
+	struct timeval tv;
+	fd_set fds;
+	int opt, len;
+
+	prog = argv[0];
+	ifaddr.s_addr = htonl(INADDR_ANY);
+	while ((opt = getopt(argc, argv, "p:g:i:b:t:n:")) != -1) {
+		switch (opt) {
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'g':
+			snprintf(group_str, sizeof(group_str), "%s", optarg);
+			break;
+		case 'i':
+			if (!inet_aton(optarg, &ifaddr))
+				usage();
+			break;
+		case 'b':
+			blksize = atoi(optarg);
+			break;
+		case 't':
+			timeout_ms = atoi(optarg);
+			break;
+		case 'n':
+			exit_count = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc - 1 || blksize < 8 || blksize > MAX_BLKSIZE)
+		usage();
+
+	memset(&group, 0, sizeof(group));
+	group.sin_family = AF_INET;
+	group.sin_port = htons(1758);
+	colon = strchr(group_str, ':');
+	if (colon) {
+		*colon = '\0';
+		group.sin_port = htons(atoi(colon + 1));
+	}
+	if (!inet_aton(group_str, &group.sin_addr) ||
+	    !IN_MULTICAST(ntohl(group.sin_addr.s_addr))) {
+		fprintf(stderr, "%s: %s is not a multicast address\n", prog,
+			group_str);
+		exit(EXIT_FAILURE);
+	}
+
+	file_name = argv[optind];
+	file_base = strrchr(file_name, '/');
+	file_base = file_base ? file_base + 1 : file_name;
+	load_file(file_name);
+	nblocks = file_size / blksize + 1;
+	if (nblocks > MAX_BLOCKS) {
+		fprintf(stderr, "%s: %lu blocks is too many, "
+			"use a block size of at least %lu\n",
+			prog, nblocks, file_size / MAX_BLOCKS + 1);
+		exit(EXIT_FAILURE);
+	}
+
+	ctl_sock = open_socket(port);
+	data_sock = open_socket(0);
+	setsockopt(data_sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+	if (ifaddr.s_addr != htonl(INADDR_ANY))
+		setsockopt(data_sock, IPPROTO_IP, IP_MULTICAST_IF, &ifaddr,
+			   sizeof(ifaddr));
+	fromlen = sizeof(local);
+	getsockname(data_sock, (struct sockaddr *)&local, &fromlen);
+
+	printf("Serving '%s' (%lu bytes, %lu blocks of %u) to %s:%u, "
+	       "transfer port %u\n", file_name, file_size, nblocks, blksize,
+	       inet_ntoa(group.sin_addr), ntohs(group.sin_port),
+	       ntohs(local.sin_port));
+
+	while (!exit_count || ndone < exit_count) {
+		FD_ZERO(&fds);
+		FD_SET(ctl_sock, &fds);
+		FD_SET(data_sock, &fds);
+		tv.tv_sec = 0;
+		tv.tv_usec = 100000;
+		if (select((ctl_sock > data_sock ? ctl_sock : data_sock) + 1,
+			   &fds, NULL, NULL, &tv) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("select");
+			break;
+		}
+
+		if (FD_ISSET(ctl_sock, &fds)) {
+			fromlen = sizeof(from);
+			len = recvfrom(ctl_sock, buf, sizeof(buf) - 1, 0,
+				       (struct sockaddr *)&from, &fromlen);
+			if (len > 0)
+				handle_request(buf, len, &from);
+		}
+		if (FD_ISSET(data_sock, &fds)) {
+			fromlen = sizeof(from);
+			len = recvfrom(data_sock, buf, sizeof(buf) - 1, 0,
+				       (struct sockaddr *)&from, &fromlen);
+			if (len > 0) {
+				buf[len] = '\0';
+				handle_ack(buf, len, &from);
+			}
+		}
+		check_timeout();
+	}
+
+	return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * Host side of flashing over UDP
+ *
+ * Copyright (c) 2013
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ *
+ * Talks to the U-Boot 'udpflash' command (see include/udp_flash.h). Each
+ * packet is sent again until it is answered, so a lost packet costs one
+ * timeout and nothing more. Commands are carried out in the order given,
+ * for example:
+ *
+ *   udpflash 192.168.1.2 flash "mmc 0:2" rootfs.img continue
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "udp_flash.h"
+
+static const char *prog;
+static int sock;
+static unsigned short seq;
+static int started;
+static unsigned timeout_ms = 500;
+static unsigned retries = 60;	/* a NAND erase can take a while */
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: %s [-p port] [-t timeout_ms] [-r retries] board_ip "
+		"command...\n"
+		"commands:\n"
+		"  getvar <name>\n"
+		"  download <file>          load <file> into RAM\n"
+		"  flash <target> [<file>]  write <file> as it is sent, or what\n"
+		"                           was downloaded\n"
+		"  erase <target>\n"
+		"  continue\n"
+		"  reboot\n"
+		"A target is \"<iface> <dev>[:<part>]\", \"nand <partition>\", "
+		"\"nand <off> <size>\"\nor \"mem <addr>\".\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * Send a packet and wait for its reply, which is put in @reply
+ * (nul-terminated) without its header.
+ *
+ * @return length of the reply, or -1 if the board did not answer
+ */
+static int transact(int type, const void *data, size_t len, char *reply)
+{
+	unsigned char pkt[UDP_FLASH_MAX_PACKET];
+	unsigned char in[UDP_FLASH_MAX_PACKET + 1];
+	struct udp_flash_hdr *hdr = (struct udp_flash_hdr *)pkt;
+	struct udp_flash_hdr *rhdr = (struct udp_flash_hdr *)in;
+	unsigned tries;
+
+	seq++;
+	hdr->type = type;
+	hdr->flags = started ? 0 : UDP_FLASH_F_START;
+	hdr->seq[0] = seq >> 8;
+	hdr->seq[1] = seq;
+	memcpy(pkt + UDP_FLASH_HDR_SIZE, data, len);
+	started = 1;
+
+	for (tries = 0; tries < retries; tries++) {
+		struct timeval tv;
+		fd_set fds;
+		ssize_t n;
+
+		if (send(sock, pkt, UDP_FLASH_HDR_SIZE + len, 0) < 0 &&
+		    errno != ECONNREFUSED) {
+			fprintf(stderr, "%s: send: %s\n", prog,
+				strerror(errno));
+			return -1;
+		}
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+		for (;;) {
+			FD_ZERO(&fds);
+			FD_SET(sock, &fds);
+			if (select(sock + 1, &fds, NULL, NULL, &tv) <= 0)
+				break;
+			n = recv(sock, in, UDP_FLASH_MAX_PACKET, 0);
+			if (n < UDP_FLASH_HDR_SIZE)
+				continue;
+			/* late answers to packets sent again are dropped */
+			if (rhdr->type != UDP_FLASH_REPLY ||
+			    ((rhdr->seq[0] << 8) | rhdr->seq[1]) != seq)
+				continue;
+			n -= UDP_FLASH_HDR_SIZE;
+			memcpy(reply, in + UDP_FLASH_HDR_SIZE, n);
+			reply[n] = '\0';
+			return n;
+		}
+	}
+	fprintf(stderr, "%s: no answer from the board\n", prog);
+
+	return -1;
+}
+
+/* Send a command; @return 0 on OKAY, the DATA size in @size if asked */
+static int command(const char *cmd, unsigned long *size)
+{
+	char reply[UDP_FLASH_MAX_PACKET + 1];
+
+	if (transact(UDP_FLASH_CMD, cmd, strlen(cmd), reply) < 0)
+		return -1;
+	if (size && !strncmp(reply, "DATA", 4)) {
+		*size = strtoul(reply + 4, NULL, 16);
+		return 0;
+	}
+	if (!strncmp(reply, "OKAY", 4)) {
+		if (reply[4])
+			printf("%s\n", reply + 4);
+		return 0;
+	}
+	fprintf(stderr, "%s: %s: %s\n", prog, cmd,
+		strncmp(reply, "FAIL", 4) ? reply : reply + 4);
+
+	return -1;
+}
+
+static unsigned char *read_file(const char *name, unsigned long *size)
+{
+	struct stat st;
+	unsigned char *buf;
+	int fd;
+
+	fd = open(name, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "%s: %s: %s\n", prog, name, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	buf = malloc(st.st_size ? st.st_size : 1);
+	if (!buf || read(fd, buf, st.st_size) != st.st_size) {
+		fprintf(stderr, "%s: cannot read %s\n", prog, name);
+		exit(EXIT_FAILURE);
+	}
+	close(fd);
+	*size = st.st_size;
+
+	return buf;
+}
+
+/* Send @cmd, then the contents of @name once the board asks for them */
+static int send_file(const char *cmd, const char *name)
+{
+	char reply[UDP_FLASH_MAX_PACKET + 1];
+	struct timeval start, end;
+	unsigned long size, want, off, n;
+	unsigned char *buf;
+	double secs;
+
+	buf = read_file(name, &size);
+	if (command(cmd, &want) < 0)
+		goto err;
+	if (want != size) {
+		fprintf(stderr, "%s: board wants %lu bytes\n", prog, want);
+		goto err;
+	}
+	gettimeofday(&start, NULL);
+	for (off = 0; off < size; off += n) {
+		n = size - off;
+		if (n > UDP_FLASH_MAX_DATA)
+			n = UDP_FLASH_MAX_DATA;
+		if (transact(UDP_FLASH_DATA, buf + off, n, reply) < 0)
+			goto err;
+		if (!strncmp(reply, "FAIL", 4)) {
+			fprintf(stderr, "\n%s: %s\n", prog, reply + 4);
+			goto err;
+		}
+		if (((off + n) >> 20) != (off >> 20)) {
+			printf("\r%lu / %lu KiB", (off + n) >> 10, size >> 10);
+			fflush(stdout);
+		}
+	}
+	gettimeofday(&end, NULL);
+	secs = (end.tv_sec - start.tv_sec) +
+		(end.tv_usec - start.tv_usec) / 1e6;
+	printf("\r%lu bytes in %.1f s", size, secs);
+	if (secs > 0)
+		printf(" (%.0f KiB/s)", size / 1024 / secs);
+	printf("\n");
+	free(buf);
+	if (strncmp(reply, "OKAY", 4)) {
+		fprintf(stderr, "%s: %s\n", prog, reply);
+		return -1;
+	}
+
+	return 0;
+err:
+	free(buf);
+	return -1;
+}
+
+int main(int argc, char **argv)
+{
+	struct sockaddr_in addr;
+	int port = UDP_FLASH_PORT;
+	char cmd[UDP_FLASH_MAX_DATA + 1];
+	int opt, i;
+
+	prog = argv[0];
+	while ((opt = getopt(argc, argv, "p:t:r:")) != -1) {
+		switch (opt) {
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 't':
+			timeout_ms = atoi(optarg);
+			break;
+		case 'r':
+			retries = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (argc - optind < 2)
+		usage();
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if (!inet_aton(argv[optind], &addr.sin_addr)) {
+		fprintf(stderr, "%s: bad address %s\n", prog, argv[optind]);
+		return EXIT_FAILURE;
+	}
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock < 0 ||
+	    connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "%s: socket: %s\n", prog, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	/* a new session: start somewhere the board has not just been */
+	srand(time(NULL) ^ getpid());
+	seq = rand();
+
+	for (i = optind + 1; i < argc; i++) {
+		const char *verb = argv[i];
+		int ret = 0;
+
+		if (!strcmp(verb, "getvar") && i + 1 < argc) {
+			snprintf(cmd, sizeof(cmd), "getvar:%s", argv[++i]);
+			ret = command(cmd, NULL);
+		} else if (!strcmp(verb, "download") && i + 1 < argc) {
+			const char *name = argv[++i];
+			struct stat st;
+
+			if (stat(name, &st) < 0) {
+				fprintf(stderr, "%s: %s: %s\n", prog, name,
+					strerror(errno));
+				return EXIT_FAILURE;
+			}
+			snprintf(cmd, sizeof(cmd), "download:%08lx",
+				 (unsigned long)st.st_size);
+			ret = send_file(cmd, name);
+		} else if (!strcmp(verb, "flash") && i + 1 < argc) {
+			const char *target = argv[++i];
+			const char *name = NULL;
+			struct stat st;
+
+			/* the next word is a file to send if there is one */
+			if (i + 1 < argc && !stat(argv[i + 1], &st))
+				name = argv[++i];
+			if (name) {
+				snprintf(cmd, sizeof(cmd), "write:%08lx:%s",
+					 (unsigned long)st.st_size, target);
+				ret = send_file(cmd, name);
+			} else {
+				snprintf(cmd, sizeof(cmd), "flash:%s", target);
+				ret = command(cmd, NULL);
+			}
+		} else if (!strcmp(verb, "erase") && i + 1 < argc) {
+			snprintf(cmd, sizeof(cmd), "erase:%s", argv[++i]);
+			ret = command(cmd, NULL);
+		} else if (!strcmp(verb, "continue") ||
+			   !strcmp(verb, "reboot")) {
+			ret = command(verb, NULL);
+		} else {
+			usage();
+		}
+		if (ret < 0)
+			return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}